@@ -0,0 +1,181 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "batch_element_capture.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "screenshot_parallel.h"
+
+namespace tooltip {
+
+namespace {
+
+// Below this many crops per worker the thread start-up costs more than the
+// copies it saves
+const size_t kMinCropsPerThread = 8;
+
+}  // namespace
+
+BatchElementCapture::Options::Options() = default;
+
+BatchElementCapture::BatchElementCapture(Delegate* delegate,
+                                         const Options& options)
+    : delegate_(delegate), options_(options) {
+  DCHECK(delegate_);
+}
+
+BatchElementCapture::~BatchElementCapture() = default;
+
+// static
+std::vector<gfx::Rect> BatchElementCapture::PlanTiles(
+    const std::vector<gfx::Rect>& element_bounds,
+    const Options& options,
+    std::vector<size_t>* tile_of_element) {
+  tile_of_element->assign(element_bounds.size(), kNoTile);
+  std::vector<gfx::Rect> tiles;
+
+  gfx::Rect page(0, 0, options.page_size.width(), options.page_size.height());
+  if (page.IsEmpty()) {
+    return tiles;
+  }
+
+  if (options.full_page_capture) {
+    for (size_t i = 0; i < element_bounds.size(); ++i) {
+      if (!element_bounds[i].IsEmpty() && page.Contains(element_bounds[i])) {
+        (*tile_of_element)[i] = 0;
+      }
+    }
+    if (std::find(tile_of_element->begin(), tile_of_element->end(), 0u) !=
+        tile_of_element->end()) {
+      tiles.push_back(page);
+    }
+    return tiles;
+  }
+
+  // Tiles scroll vertically only and always start at the left edge
+  int tile_width = std::min(options.viewport_size.width(), page.width());
+  int tile_height = std::min(options.viewport_size.height(), page.height());
+  if (tile_width <= 0 || tile_height <= 0) {
+    return tiles;
+  }
+  gfx::Rect tile_columns(0, 0, tile_width, page.height());
+
+  std::vector<size_t> pending;
+  for (size_t i = 0; i < element_bounds.size(); ++i) {
+    const gfx::Rect& bounds = element_bounds[i];
+    if (!bounds.IsEmpty() && tile_columns.Contains(bounds) &&
+        bounds.height() <= tile_height) {
+      pending.push_back(i);
+    }
+  }
+  std::sort(pending.begin(), pending.end(), [&](size_t a, size_t b) {
+    return element_bounds[a].y() < element_bounds[b].y();
+  });
+
+  // Each tile starts at the top of the highest element not yet covered.
+  // An element fits tiles starting anywhere in [bottom - height, top], so
+  // taking the smallest top first needs the fewest tiles.
+  while (!pending.empty()) {
+    int top = std::min(element_bounds[pending.front()].y(),
+                       page.height() - tile_height);
+    gfx::Rect tile(0, top, tile_width, tile_height);
+    size_t tile_index = tiles.size();
+    tiles.push_back(tile);
+
+    std::vector<size_t> remaining;
+    for (size_t i : pending) {
+      if (tile.Contains(element_bounds[i])) {
+        (*tile_of_element)[i] = tile_index;
+      } else {
+        remaining.push_back(i);
+      }
+    }
+    DCHECK_LT(remaining.size(), pending.size());
+    pending.swap(remaining);
+  }
+  return tiles;
+}
+
+std::vector<ScreenshotBitmap> BatchElementCapture::Capture(
+    const std::vector<gfx::Rect>& element_bounds) {
+  return Capture(element_bounds, nullptr);
+}
+
+std::vector<ScreenshotBitmap> BatchElementCapture::Capture(
+    const std::vector<gfx::Rect>& element_bounds,
+    std::vector<PerceptualHash>* perceptual_hashes) {
+  stats_ = Stats();
+  std::vector<ScreenshotBitmap> results(element_bounds.size());
+  if (perceptual_hashes) {
+    perceptual_hashes->assign(element_bounds.size(), PerceptualHash());
+  }
+
+  std::vector<size_t> tile_of_element;
+  std::vector<gfx::Rect> tiles =
+      PlanTiles(element_bounds, options_, &tile_of_element);
+
+  std::vector<std::vector<size_t>> elements_in_tile(tiles.size());
+  std::vector<size_t> individual;
+  for (size_t i = 0; i < element_bounds.size(); ++i) {
+    size_t tile = tile_of_element[i];
+    if (tile == kNoTile ||
+        delegate_->IsOccluded(element_bounds[i], tiles[tile])) {
+      individual.push_back(i);
+    } else {
+      elements_in_tile[tile].push_back(i);
+    }
+  }
+
+  // One tile at a time, so that only one tile bitmap is alive at once
+  for (size_t tile_index = 0; tile_index < tiles.size(); ++tile_index) {
+    const std::vector<size_t>& elements = elements_in_tile[tile_index];
+    if (elements.empty()) {
+      continue;
+    }
+
+    const gfx::Rect& tile = tiles[tile_index];
+    ScreenshotBitmap tile_bitmap = delegate_->CaptureTile(tile);
+    if (tile_bitmap.empty()) {
+      VLOG(1) << "Tile capture failed; capturing " << elements.size()
+              << " elements individually";
+      individual.insert(individual.end(), elements.begin(), elements.end());
+      continue;
+    }
+    ++stats_.tiles_captured;
+
+    ScreenshotParallelFor(
+        elements.size(),
+        ResolveScreenshotThreadCount(options_.max_threads, elements.size(),
+                                     kMinCropsPerThread),
+        [&](size_t i) {
+          const gfx::Rect& bounds = element_bounds[elements[i]];
+          results[elements[i]] = tile_bitmap.Crop(
+              gfx::Rect(bounds.x() - tile.x(), bounds.y() - tile.y(),
+                        bounds.width(), bounds.height()));
+          if (perceptual_hashes) {
+            (*perceptual_hashes)[elements[i]] =
+                ComputeDifferenceHash(results[elements[i]]);
+          }
+        });
+    stats_.elements_cropped += elements.size();
+  }
+
+  for (size_t i : individual) {
+    results[i] = delegate_->CaptureElement(element_bounds[i]);
+    if (results[i].empty()) {
+      ++stats_.elements_failed;
+    } else {
+      ++stats_.elements_captured_individually;
+      if (perceptual_hashes) {
+        (*perceptual_hashes)[i] = ComputeDifferenceHash(results[i]);
+      }
+    }
+  }
+  return results;
+}
+
+}  // namespace tooltip
@@ -0,0 +1,116 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_BATCH_ELEMENT_CAPTURE_H_
+#define CHROME_BROWSER_TOOLTIP_BATCH_ELEMENT_CAPTURE_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#include "ui/gfx/geometry/rect.h"
+#include "ui/gfx/geometry/size.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/screenshot_perceptual_hash.h"
+
+namespace tooltip {
+
+// Screenshots many elements of one page with as few captures as possible.
+// Elements are grouped into viewport-sized tiles, each tile is captured
+// once and every element is cropped from its tile's bitmap in parallel.
+// Elements that no tile can show (outside the page horizontally, taller
+// than the viewport, zero-sized) or that the delegate reports as occluded
+// in their tile are captured individually instead.
+//
+// Capture() runs on the caller's sequence, which must be allowed to block;
+// only the cropping uses worker threads.
+class BatchElementCapture {
+ public:
+  // Performs the actual captures against the page
+  class Delegate {
+   public:
+    virtual ~Delegate() = default;
+
+    // Captures the page area |tile|, in page coordinates, at device scale
+    // 1. |tile| is never larger than the viewport. Returns an empty bitmap
+    // on failure.
+    virtual ScreenshotBitmap CaptureTile(const gfx::Rect& tile) = 0;
+
+    // Individual capture for |element_bounds|, used for elements the tiles
+    // cannot provide. Returns an empty bitmap on failure.
+    virtual ScreenshotBitmap CaptureElement(
+        const gfx::Rect& element_bounds) = 0;
+
+    // Whether something else covers the element when the viewport shows
+    // |tile|, e.g. a sticky header over the top of the tile
+    virtual bool IsOccluded(const gfx::Rect& /*element_bounds*/,
+                            const gfx::Rect& /*tile*/) {
+      return false;
+    }
+  };
+
+  struct Options {
+    Options();
+
+    gfx::Size viewport_size;
+    gfx::Size page_size;
+    // Use one capture of the whole page instead of viewport tiles, for
+    // delegates that can capture beyond the viewport
+    bool full_page_capture = false;
+    // Crop workers, including the calling thread; 0 picks from the number
+    // of cores
+    size_t max_threads = 0;
+  };
+
+  struct Stats {
+    size_t tiles_captured = 0;
+    size_t elements_cropped = 0;
+    size_t elements_captured_individually = 0;
+    size_t elements_failed = 0;
+  };
+
+  BatchElementCapture(Delegate* delegate, const Options& options);
+  ~BatchElementCapture();
+
+  // Returns one bitmap per entry of |element_bounds|, in the same order.
+  // Bitmaps of elements that could not be captured are empty.
+  std::vector<ScreenshotBitmap> Capture(
+      const std::vector<gfx::Rect>& element_bounds);
+
+  // As above, and sets |perceptual_hashes| to the dHash of every bitmap,
+  // computed by the crop workers while the pixels are still in cache.
+  // Failed captures get a zero hash.
+  std::vector<ScreenshotBitmap> Capture(
+      const std::vector<gfx::Rect>& element_bounds,
+      std::vector<PerceptualHash>* perceptual_hashes);
+
+  // Counts for the last Capture() call
+  const Stats& stats() const { return stats_; }
+
+  // Groups |element_bounds| into the fewest tiles of |options.viewport_size|
+  // that contain each element whole. Sets (*tile_of_element)[i] to the
+  // index of the tile that contains element i, or to kNoTile for elements
+  // that need an individual capture. Exposed for benchmarks.
+  static constexpr size_t kNoTile = static_cast<size_t>(-1);
+  static std::vector<gfx::Rect> PlanTiles(
+      const std::vector<gfx::Rect>& element_bounds,
+      const Options& options,
+      std::vector<size_t>* tile_of_element);
+
+ private:
+  Delegate* const delegate_;
+  const Options options_;
+  Stats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(BatchElementCapture);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_BATCH_ELEMENT_CAPTURE_H_
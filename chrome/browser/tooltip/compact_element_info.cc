@@ -0,0 +1,184 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "compact_element_info.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+
+namespace tooltip {
+
+namespace {
+
+// Size of a regular arena chunk. Strings larger than a quarter of this get
+// a chunk of their own so that they do not waste the tail of a shared one.
+const size_t kArenaChunkSize = 64 * 1024;
+
+std::string ToString(std::string_view value) {
+  return std::string(value.data(), value.size());
+}
+
+}  // namespace
+
+// StringArena implementation
+StringArena::StringArena()
+    : cursor_(nullptr), remaining_(0), bytes_reserved_(0), bytes_used_(0) {}
+
+StringArena::~StringArena() = default;
+
+std::string_view StringArena::Store(std::string_view value) {
+  if (value.empty()) {
+    return std::string_view();
+  }
+
+  if (value.size() > kArenaChunkSize / 4) {
+    chunks_.push_back(std::make_unique<char[]>(value.size()));
+    memcpy(chunks_.back().get(), value.data(), value.size());
+    bytes_reserved_ += value.size();
+    bytes_used_ += value.size();
+    return std::string_view(chunks_.back().get(), value.size());
+  }
+
+  if (value.size() > remaining_) {
+    chunks_.push_back(std::make_unique<char[]>(kArenaChunkSize));
+    cursor_ = chunks_.back().get();
+    remaining_ = kArenaChunkSize;
+    bytes_reserved_ += kArenaChunkSize;
+  }
+
+  char* stored = cursor_;
+  memcpy(stored, value.data(), value.size());
+  cursor_ += value.size();
+  remaining_ -= value.size();
+  bytes_used_ += value.size();
+  return std::string_view(stored, value.size());
+}
+
+// StringInterner implementation
+StringInterner::StringInterner() {
+  strings_.push_back(std::string_view());
+  ids_.emplace(std::string_view(), 0);
+}
+
+StringInterner::~StringInterner() = default;
+
+uint32_t StringInterner::Intern(std::string_view value) {
+  auto it = ids_.find(value);
+  if (it != ids_.end()) {
+    return it->second;
+  }
+
+  std::string_view stored = arena_.Store(value);
+  uint32_t id = static_cast<uint32_t>(strings_.size());
+  strings_.push_back(stored);
+  ids_.emplace(stored, id);
+  return id;
+}
+
+// ElementInfoView implementation
+ElementInfoView::ElementInfoView() = default;
+
+ElementInfoView::ElementInfoView(const ElementInfo& element_info)
+    : tag_name(element_info.tag_name),
+      id(element_info.id),
+      class_name(element_info.class_name),
+      text_content(element_info.text_content),
+      href(element_info.href),
+      src(element_info.src),
+      alt_text(element_info.alt_text),
+      title(element_info.title),
+      role(element_info.role),
+      aria_label(element_info.aria_label),
+      type(element_info.type),
+      bounds(element_info.bounds),
+      computed_styles(element_info.computed_styles) {}
+
+// CompactElementStore implementation
+CompactElementStore::CompactElementStore() = default;
+CompactElementStore::~CompactElementStore() = default;
+
+size_t CompactElementStore::Add(const ElementInfoView& element) {
+  CompactElement compact;
+  compact.tag_name = interner_.Intern(element.tag_name);
+  compact.class_name = interner_.Intern(element.class_name);
+  compact.role = interner_.Intern(element.role);
+  compact.type = interner_.Intern(element.type);
+  compact.id = text_.Store(element.id);
+  compact.text_content = text_.Store(element.text_content);
+  compact.href = text_.Store(element.href);
+  compact.src = text_.Store(element.src);
+  compact.alt_text = text_.Store(element.alt_text);
+  compact.title = text_.Store(element.title);
+  compact.aria_label = text_.Store(element.aria_label);
+  compact.computed_styles = text_.Store(element.computed_styles);
+  compact.bounds = element.bounds;
+  elements_.push_back(compact);
+  return elements_.size() - 1;
+}
+
+size_t CompactElementStore::Add(const ElementInfo& element_info) {
+  return Add(ElementInfoView(element_info));
+}
+
+void CompactElementStore::Reserve(size_t element_count) {
+  elements_.reserve(element_count);
+}
+
+ElementInfoView CompactElementStore::GetView(size_t index) const {
+  DCHECK_LT(index, elements_.size());
+  const CompactElement& compact = elements_[index];
+  ElementInfoView view;
+  view.tag_name = interner_.Get(compact.tag_name);
+  view.id = compact.id;
+  view.class_name = interner_.Get(compact.class_name);
+  view.text_content = compact.text_content;
+  view.href = compact.href;
+  view.src = compact.src;
+  view.alt_text = compact.alt_text;
+  view.title = compact.title;
+  view.role = interner_.Get(compact.role);
+  view.aria_label = compact.aria_label;
+  view.type = interner_.Get(compact.type);
+  view.bounds = compact.bounds;
+  view.computed_styles = compact.computed_styles;
+  return view;
+}
+
+ElementInfo CompactElementStore::ToElementInfo(size_t index) const {
+  ElementInfoView view = GetView(index);
+  ElementInfo element_info;
+  element_info.tag_name = ToString(view.tag_name);
+  element_info.id = ToString(view.id);
+  element_info.class_name = ToString(view.class_name);
+  element_info.text_content = ToString(view.text_content);
+  element_info.href = ToString(view.href);
+  element_info.src = ToString(view.src);
+  element_info.alt_text = ToString(view.alt_text);
+  element_info.title = ToString(view.title);
+  element_info.role = ToString(view.role);
+  element_info.aria_label = ToString(view.aria_label);
+  element_info.type = ToString(view.type);
+  element_info.bounds = view.bounds;
+  element_info.computed_styles = ToString(view.computed_styles);
+  element_info.ParseComputedStyles();
+  return element_info;
+}
+
+CompactElementStore::MemoryStats CompactElementStore::GetMemoryStats() const {
+  MemoryStats stats;
+  stats.element_count = elements_.size();
+  stats.element_bytes = elements_.capacity() * sizeof(CompactElement);
+  stats.interned_strings = interner_.size();
+  // Arena plus the id table: one view per string and a hash node per key
+  stats.interned_bytes =
+      interner_.arena().bytes_reserved() +
+      interner_.size() * (sizeof(std::string_view) * 2 + sizeof(uint32_t) +
+                          2 * sizeof(void*));
+  stats.text_bytes = text_.bytes_reserved();
+  stats.arena_chunks = interner_.arena().chunk_count() + text_.chunk_count();
+  return stats;
+}
+
+}  // namespace tooltip
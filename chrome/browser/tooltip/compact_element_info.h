@@ -0,0 +1,160 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_COMPACT_ELEMENT_INFO_H_
+#define CHROME_BROWSER_TOOLTIP_COMPACT_ELEMENT_INFO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#include "ui/gfx/geometry/rect.h"
+#endif
+#include "chrome/browser/tooltip/tooltip_service.h"
+
+namespace tooltip {
+
+// Bump allocator for string bytes. Strings are copied into large chunks and
+// live until the arena is destroyed, so thousands of short fields cost a
+// handful of allocations.
+class StringArena {
+ public:
+  StringArena();
+  ~StringArena();
+
+  // Copy |value| into the arena. Empty strings take no space.
+  std::string_view Store(std::string_view value);
+
+  // Bytes reserved in chunks and bytes handed out
+  size_t bytes_reserved() const { return bytes_reserved_; }
+  size_t bytes_used() const { return bytes_used_; }
+  size_t chunk_count() const { return chunks_.size(); }
+
+ private:
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char* cursor_;
+  size_t remaining_;
+  size_t bytes_reserved_;
+  size_t bytes_used_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringArena);
+};
+
+// Deduplicates strings that repeat across elements, such as tag names and
+// roles. Each distinct value is stored once and identified by a small id;
+// id 0 is the empty string.
+class StringInterner {
+ public:
+  StringInterner();
+  ~StringInterner();
+
+  uint32_t Intern(std::string_view value);
+  std::string_view Get(uint32_t id) const { return strings_[id]; }
+
+  size_t size() const { return strings_.size(); }
+  const StringArena& arena() const { return arena_; }
+
+ private:
+  StringArena arena_;
+  std::vector<std::string_view> strings_;
+  // Keys point into |arena_|
+  std::unordered_map<std::string_view, uint32_t> ids_;
+
+  DISALLOW_COPY_AND_ASSIGN(StringInterner);
+};
+
+// ElementInfo fields as views, used to add elements to a store without
+// building std::strings first. The views only need to live for the call.
+struct ElementInfoView {
+  std::string_view tag_name;
+  std::string_view id;
+  std::string_view class_name;
+  std::string_view text_content;
+  std::string_view href;
+  std::string_view src;
+  std::string_view alt_text;
+  std::string_view title;
+  std::string_view role;
+  std::string_view aria_label;
+  std::string_view type;
+  gfx::Rect bounds;
+  std::string_view computed_styles;
+
+  ElementInfoView();
+  explicit ElementInfoView(const ElementInfo& element_info);
+};
+
+// Element set of a scraped page. Tag, role, type and class are interned;
+// the remaining text lives in an arena shared by all elements. Converting
+// back to ElementInfo copies the strings of that single element only.
+class CompactElementStore {
+ public:
+  struct MemoryStats {
+    size_t element_count = 0;
+    size_t element_bytes = 0;
+    size_t interned_strings = 0;
+    size_t interned_bytes = 0;
+    size_t text_bytes = 0;
+    size_t arena_chunks = 0;
+
+    size_t total_bytes() const {
+      return element_bytes + interned_bytes + text_bytes;
+    }
+  };
+
+  CompactElementStore();
+  ~CompactElementStore();
+
+  // Append an element and return its index
+  size_t Add(const ElementInfoView& element);
+  size_t Add(const ElementInfo& element_info);
+
+  void Reserve(size_t element_count);
+  size_t size() const { return elements_.size(); }
+
+  // Fields of element |index|. The views stay valid while the store lives.
+  ElementInfoView GetView(size_t index) const;
+
+  // Element |index| in the form taken by TooltipService
+  ElementInfo ToElementInfo(size_t index) const;
+
+  MemoryStats GetMemoryStats() const;
+
+ private:
+  // Interned ids for the repetitive fields, arena views for the rest
+  struct CompactElement {
+    uint32_t tag_name;
+    uint32_t class_name;
+    uint32_t role;
+    uint32_t type;
+    std::string_view id;
+    std::string_view text_content;
+    std::string_view href;
+    std::string_view src;
+    std::string_view alt_text;
+    std::string_view title;
+    std::string_view aria_label;
+    std::string_view computed_styles;
+    gfx::Rect bounds;
+  };
+
+  StringInterner interner_;
+  StringArena text_;
+  std::vector<CompactElement> elements_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompactElementStore);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_COMPACT_ELEMENT_INFO_H_
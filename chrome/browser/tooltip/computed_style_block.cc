@@ -0,0 +1,617 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "computed_style_block.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tooltip {
+
+namespace {
+
+// Bumped whenever the encoded layout changes
+constexpr uint8_t kEncodingVersion = 1;
+
+constexpr uint16_t kAllProperties = (ComputedStyleBlock::kZIndex << 1) - 1;
+
+constexpr uint32_t kOpaqueBlack = 0xFF000000U;
+
+// Backgrounds more transparent than this say little about what is behind
+// the element, so HasDarkBackground() falls back to the text color
+constexpr uint32_t kMinBackgroundAlpha = 0x80;
+
+std::string_view TrimWhitespace(std::string_view value) {
+  size_t begin = 0;
+  while (begin < value.size() &&
+         (value[begin] == ' ' || value[begin] == '\t' ||
+          value[begin] == '\n' || value[begin] == '\r')) {
+    ++begin;
+  }
+  size_t end = value.size();
+  while (end > begin && (value[end - 1] == ' ' || value[end - 1] == '\t' ||
+                         value[end - 1] == '\n' || value[end - 1] == '\r')) {
+    --end;
+  }
+  return value.substr(begin, end - begin);
+}
+
+char ToLowerASCII(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool EqualsCaseInsensitiveASCII(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (ToLowerASCII(a[i]) != ToLowerASCII(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ConsumeSuffix(std::string_view* value, std::string_view suffix) {
+  if (value->size() < suffix.size() ||
+      !EqualsCaseInsensitiveASCII(
+          value->substr(value->size() - suffix.size()), suffix)) {
+    return false;
+  }
+  value->remove_suffix(suffix.size());
+  return true;
+}
+
+// Parses a plain decimal number ("12", "-0.5", ".75") from the front of
+// |input| and advances past it. Locale independent, unlike strtod().
+bool ConsumeNumber(std::string_view* input, double* number) {
+  std::string_view value = *input;
+  size_t pos = 0;
+  bool negative = false;
+  if (pos < value.size() && (value[pos] == '-' || value[pos] == '+')) {
+    negative = value[pos] == '-';
+    ++pos;
+  }
+
+  double result = 0;
+  bool has_digits = false;
+  while (pos < value.size() && value[pos] >= '0' && value[pos] <= '9') {
+    result = result * 10 + (value[pos] - '0');
+    has_digits = true;
+    ++pos;
+  }
+  if (pos < value.size() && value[pos] == '.') {
+    ++pos;
+    double scale = 0.1;
+    while (pos < value.size() && value[pos] >= '0' && value[pos] <= '9') {
+      result += (value[pos] - '0') * scale;
+      scale *= 0.1;
+      has_digits = true;
+      ++pos;
+    }
+  }
+  if (!has_digits) {
+    return false;
+  }
+
+  *number = negative ? -result : result;
+  input->remove_prefix(pos);
+  return true;
+}
+
+// The whole of |value| must be a number
+bool ParseNumber(std::string_view value, double* number) {
+  return ConsumeNumber(&value, number) && value.empty();
+}
+
+uint8_t ClampToByte(double value) {
+  return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0, 255.0)));
+}
+
+int HexDigitValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  c = ToLowerASCII(c);
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// #rgb, #rgba, #rrggbb and #rrggbbaa
+bool ParseHexColor(std::string_view hex, uint32_t* color) {
+  if (hex.size() != 3 && hex.size() != 4 && hex.size() != 6 &&
+      hex.size() != 8) {
+    return false;
+  }
+  bool short_form = hex.size() <= 4;
+  uint32_t channels[4] = {0, 0, 0, 0xFF};
+  size_t channel_count = short_form ? hex.size() : hex.size() / 2;
+  for (size_t i = 0; i < channel_count; ++i) {
+    int high = HexDigitValue(hex[short_form ? i : i * 2]);
+    int low = HexDigitValue(hex[short_form ? i : i * 2 + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    channels[i] = static_cast<uint32_t>(high * 16 + low);
+  }
+  *color = (channels[3] << 24) | (channels[0] << 16) | (channels[1] << 8) |
+           channels[2];
+  return true;
+}
+
+// rgb()/rgba() in both the legacy comma form, which is what
+// getComputedStyle() returns, and the space separated "r g b / a" form
+bool ParseRgbFunction(std::string_view arguments, uint32_t* color) {
+  double channels[4] = {0, 0, 0, 1};
+  for (size_t i = 0; i < 4; ++i) {
+    arguments = TrimWhitespace(arguments);
+    if (arguments.empty()) {
+      if (i < 3) {
+        return false;
+      }
+      break;
+    }
+    if (i > 0 && (arguments.front() == ',' || arguments.front() == '/')) {
+      arguments = TrimWhitespace(arguments.substr(1));
+    }
+    if (!ConsumeNumber(&arguments, &channels[i])) {
+      return false;
+    }
+    if (!arguments.empty() && arguments.front() == '%') {
+      channels[i] *= i < 3 ? 2.55 : 0.01;
+      arguments.remove_prefix(1);
+    }
+  }
+  if (!TrimWhitespace(arguments).empty()) {
+    return false;
+  }
+
+  *color = (static_cast<uint32_t>(ClampToByte(channels[3] * 255)) << 24) |
+           (static_cast<uint32_t>(ClampToByte(channels[0])) << 16) |
+           (static_cast<uint32_t>(ClampToByte(channels[1])) << 8) |
+           ClampToByte(channels[2]);
+  return true;
+}
+
+bool ParseColor(std::string_view value, uint32_t* color) {
+  if (!value.empty() && value.front() == '#') {
+    return ParseHexColor(value.substr(1), color);
+  }
+  if (EqualsCaseInsensitiveASCII(value, "transparent")) {
+    *color = 0;
+    return true;
+  }
+  if (EqualsCaseInsensitiveASCII(value, "black")) {
+    *color = kOpaqueBlack;
+    return true;
+  }
+  if (EqualsCaseInsensitiveASCII(value, "white")) {
+    *color = 0xFFFFFFFFU;
+    return true;
+  }
+
+  size_t open = value.find('(');
+  if (open == std::string_view::npos || value.back() != ')') {
+    return false;
+  }
+  std::string_view function = TrimWhitespace(value.substr(0, open));
+  if (!EqualsCaseInsensitiveASCII(function, "rgb") &&
+      !EqualsCaseInsensitiveASCII(function, "rgba")) {
+    return false;
+  }
+  return ParseRgbFunction(value.substr(open + 1, value.size() - open - 2),
+                          color);
+}
+
+bool ParseFontSize(std::string_view value, float* px) {
+  double size = 0;
+  // Computed styles are always in px; pt shows up in hand-written input
+  if (ConsumeSuffix(&value, "px")) {
+    if (!ParseNumber(value, &size)) {
+      return false;
+    }
+  } else if (ConsumeSuffix(&value, "pt")) {
+    if (!ParseNumber(value, &size)) {
+      return false;
+    }
+    size = size * 4 / 3;
+  } else {
+    return false;
+  }
+  if (size < 0) {
+    return false;
+  }
+  *px = static_cast<float>(size);
+  return true;
+}
+
+bool ParseFontWeight(std::string_view value, int* weight) {
+  if (EqualsCaseInsensitiveASCII(value, "normal")) {
+    *weight = 400;
+    return true;
+  }
+  if (EqualsCaseInsensitiveASCII(value, "bold")) {
+    *weight = 700;
+    return true;
+  }
+  double number = 0;
+  if (!ParseNumber(value, &number) || number < 1 || number > 1000) {
+    return false;
+  }
+  *weight = static_cast<int>(number);
+  return true;
+}
+
+bool ParseOpacity(std::string_view value, float* opacity) {
+  double number = 0;
+  bool percent = ConsumeSuffix(&value, "%");
+  if (!ParseNumber(value, &number)) {
+    return false;
+  }
+  *opacity = static_cast<float>(percent ? number / 100 : number);
+  return true;
+}
+
+bool ParseVisibility(std::string_view value,
+                     ComputedStyleBlock::Visibility* visibility) {
+  using Visibility = ComputedStyleBlock::Visibility;
+  if (EqualsCaseInsensitiveASCII(value, "visible")) {
+    *visibility = Visibility::kVisible;
+  } else if (EqualsCaseInsensitiveASCII(value, "hidden")) {
+    *visibility = Visibility::kHidden;
+  } else if (EqualsCaseInsensitiveASCII(value, "collapse")) {
+    *visibility = Visibility::kCollapse;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+ComputedStyleBlock::Display ParseDisplay(std::string_view value) {
+  using Display = ComputedStyleBlock::Display;
+  struct {
+    std::string_view keyword;
+    Display display;
+  } const kKeywords[] = {
+      {"none", Display::kNone},        {"inline", Display::kInline},
+      {"block", Display::kBlock},      {"inline-block", Display::kInlineBlock},
+      {"flex", Display::kFlex},        {"inline-flex", Display::kFlex},
+      {"grid", Display::kGrid},        {"inline-grid", Display::kGrid},
+  };
+  for (const auto& keyword : kKeywords) {
+    if (EqualsCaseInsensitiveASCII(value, keyword.keyword)) {
+      return keyword.display;
+    }
+  }
+  return Display::kOther;
+}
+
+bool ParsePosition(std::string_view value,
+                   ComputedStyleBlock::Position* position) {
+  using Position = ComputedStyleBlock::Position;
+  struct {
+    std::string_view keyword;
+    Position position;
+  } const kKeywords[] = {
+      {"static", Position::kStatic},     {"relative", Position::kRelative},
+      {"absolute", Position::kAbsolute}, {"fixed", Position::kFixed},
+      {"sticky", Position::kSticky},
+  };
+  for (const auto& keyword : kKeywords) {
+    if (EqualsCaseInsensitiveASCII(value, keyword.keyword)) {
+      *position = keyword.position;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Relative luminance in [0, 1] from the sRGB channels, without the gamma
+// expansion; good enough to tell dark from light
+double Luminance(uint32_t color) {
+  double red = (color >> 16) & 0xFF;
+  double green = (color >> 8) & 0xFF;
+  double blue = color & 0xFF;
+  return (0.2126 * red + 0.7152 * green + 0.0722 * blue) / 255;
+}
+
+void AppendUint8(std::string* output, uint8_t value) {
+  output->push_back(static_cast<char>(value));
+}
+
+void AppendUint16(std::string* output, uint16_t value) {
+  AppendUint8(output, static_cast<uint8_t>(value));
+  AppendUint8(output, static_cast<uint8_t>(value >> 8));
+}
+
+void AppendUint32(std::string* output, uint32_t value) {
+  AppendUint16(output, static_cast<uint16_t>(value));
+  AppendUint16(output, static_cast<uint16_t>(value >> 16));
+}
+
+// Reads little-endian values from the front of an encoded block
+class Reader {
+ public:
+  explicit Reader(std::string_view data) : data_(data) {}
+
+  bool ReadUint8(uint8_t* value) {
+    if (data_.empty()) {
+      return false;
+    }
+    *value = static_cast<uint8_t>(data_.front());
+    data_.remove_prefix(1);
+    return true;
+  }
+
+  bool ReadUint16(uint16_t* value) {
+    uint8_t low = 0;
+    uint8_t high = 0;
+    if (!ReadUint8(&low) || !ReadUint8(&high)) {
+      return false;
+    }
+    *value = static_cast<uint16_t>(low | (high << 8));
+    return true;
+  }
+
+  bool ReadUint32(uint32_t* value) {
+    uint16_t low = 0;
+    uint16_t high = 0;
+    if (!ReadUint16(&low) || !ReadUint16(&high)) {
+      return false;
+    }
+    *value = low | (static_cast<uint32_t>(high) << 16);
+    return true;
+  }
+
+  template <typename Enum>
+  bool ReadEnum(Enum* value) {
+    uint8_t raw = 0;
+    if (!ReadUint8(&raw) || raw > static_cast<uint8_t>(Enum::kMaxValue)) {
+      return false;
+    }
+    *value = static_cast<Enum>(raw);
+    return true;
+  }
+
+  bool done() const { return data_.empty(); }
+
+ private:
+  std::string_view data_;
+};
+
+}  // namespace
+
+ComputedStyleBlock::ComputedStyleBlock()
+    : present_(0),
+      color_(kOpaqueBlack),
+      background_color_(0),
+      font_size_quarter_px_(0),
+      font_weight_(400),
+      opacity_(0xFF),
+      visibility_(Visibility::kVisible),
+      display_(Display::kOther),
+      position_(Position::kStatic),
+      z_index_(0) {}
+
+// static
+ComputedStyleBlock ComputedStyleBlock::Parse(std::string_view css_text) {
+  ComputedStyleBlock block;
+  while (!css_text.empty()) {
+    size_t end = css_text.find(';');
+    std::string_view declaration = css_text.substr(0, end);
+    css_text = end == std::string_view::npos ? std::string_view()
+                                             : css_text.substr(end + 1);
+
+    size_t colon = declaration.find(':');
+    if (colon == std::string_view::npos) {
+      continue;
+    }
+    std::string_view name = TrimWhitespace(declaration.substr(0, colon));
+    std::string_view value = TrimWhitespace(declaration.substr(colon + 1));
+    if (value.empty()) {
+      continue;
+    }
+
+    uint32_t color = 0;
+    float number = 0;
+    int weight = 0;
+    Visibility visibility = Visibility::kVisible;
+    Position position = Position::kStatic;
+    double z_index = 0;
+    if (EqualsCaseInsensitiveASCII(name, "color")) {
+      if (ParseColor(value, &color)) {
+        block.SetColor(color);
+      }
+    } else if (EqualsCaseInsensitiveASCII(name, "background-color")) {
+      if (ParseColor(value, &color)) {
+        block.SetBackgroundColor(color);
+      }
+    } else if (EqualsCaseInsensitiveASCII(name, "font-size")) {
+      if (ParseFontSize(value, &number)) {
+        block.SetFontSize(number);
+      }
+    } else if (EqualsCaseInsensitiveASCII(name, "font-weight")) {
+      if (ParseFontWeight(value, &weight)) {
+        block.SetFontWeight(weight);
+      }
+    } else if (EqualsCaseInsensitiveASCII(name, "opacity")) {
+      if (ParseOpacity(value, &number)) {
+        block.SetOpacity(number);
+      }
+    } else if (EqualsCaseInsensitiveASCII(name, "visibility")) {
+      if (ParseVisibility(value, &visibility)) {
+        block.SetVisibility(visibility);
+      }
+    } else if (EqualsCaseInsensitiveASCII(name, "display")) {
+      block.SetDisplay(ParseDisplay(value));
+    } else if (EqualsCaseInsensitiveASCII(name, "position")) {
+      if (ParsePosition(value, &position)) {
+        block.SetPosition(position);
+      }
+    } else if (EqualsCaseInsensitiveASCII(name, "z-index")) {
+      // "auto" leaves the property absent
+      if (ParseNumber(value, &z_index)) {
+        block.SetZIndex(static_cast<int32_t>(
+            std::clamp(z_index, -2147483648.0, 2147483647.0)));
+      }
+    }
+  }
+  return block;
+}
+
+// static
+bool ComputedStyleBlock::Decode(std::string_view encoded,
+                                ComputedStyleBlock* block) {
+  Reader reader(encoded);
+  uint8_t version = 0;
+  ComputedStyleBlock decoded;
+  if (!reader.ReadUint8(&version) || version != kEncodingVersion ||
+      !reader.ReadUint16(&decoded.present_) ||
+      (decoded.present_ & ~kAllProperties) != 0) {
+    return false;
+  }
+
+  uint32_t z_index = 0;
+  bool ok = (!decoded.Has(kColor) || reader.ReadUint32(&decoded.color_)) &&
+            (!decoded.Has(kBackgroundColor) ||
+             reader.ReadUint32(&decoded.background_color_)) &&
+            (!decoded.Has(kFontSize) ||
+             reader.ReadUint16(&decoded.font_size_quarter_px_)) &&
+            (!decoded.Has(kFontWeight) ||
+             reader.ReadUint16(&decoded.font_weight_)) &&
+            (!decoded.Has(kOpacity) || reader.ReadUint8(&decoded.opacity_)) &&
+            (!decoded.Has(kVisibility) ||
+             reader.ReadEnum(&decoded.visibility_)) &&
+            (!decoded.Has(kDisplay) || reader.ReadEnum(&decoded.display_)) &&
+            (!decoded.Has(kPosition) ||
+             reader.ReadEnum(&decoded.position_)) &&
+            (!decoded.Has(kZIndex) || reader.ReadUint32(&z_index));
+  if (!ok || !reader.done()) {
+    return false;
+  }
+  decoded.z_index_ = static_cast<int32_t>(z_index);
+
+  *block = decoded;
+  return true;
+}
+
+void ComputedStyleBlock::AppendEncoded(std::string* output) const {
+  AppendUint8(output, kEncodingVersion);
+  AppendUint16(output, present_);
+  if (Has(kColor)) {
+    AppendUint32(output, color_);
+  }
+  if (Has(kBackgroundColor)) {
+    AppendUint32(output, background_color_);
+  }
+  if (Has(kFontSize)) {
+    AppendUint16(output, font_size_quarter_px_);
+  }
+  if (Has(kFontWeight)) {
+    AppendUint16(output, font_weight_);
+  }
+  if (Has(kOpacity)) {
+    AppendUint8(output, opacity_);
+  }
+  if (Has(kVisibility)) {
+    AppendUint8(output, static_cast<uint8_t>(visibility_));
+  }
+  if (Has(kDisplay)) {
+    AppendUint8(output, static_cast<uint8_t>(display_));
+  }
+  if (Has(kPosition)) {
+    AppendUint8(output, static_cast<uint8_t>(position_));
+  }
+  if (Has(kZIndex)) {
+    AppendUint32(output, static_cast<uint32_t>(z_index_));
+  }
+}
+
+std::string ComputedStyleBlock::Encode() const {
+  std::string encoded;
+  encoded.reserve(kMaxEncodedSize);
+  AppendEncoded(&encoded);
+  return encoded;
+}
+
+void ComputedStyleBlock::SetColor(uint32_t color) {
+  color_ = color;
+  present_ |= kColor;
+}
+
+void ComputedStyleBlock::SetBackgroundColor(uint32_t color) {
+  background_color_ = color;
+  present_ |= kBackgroundColor;
+}
+
+void ComputedStyleBlock::SetFontSize(float px) {
+  font_size_quarter_px_ = static_cast<uint16_t>(
+      std::lround(std::clamp(px * 4.0f, 0.0f, 65535.0f)));
+  present_ |= kFontSize;
+}
+
+void ComputedStyleBlock::SetFontWeight(int weight) {
+  font_weight_ = static_cast<uint16_t>(std::clamp(weight, 1, 1000));
+  present_ |= kFontWeight;
+}
+
+void ComputedStyleBlock::SetOpacity(float opacity) {
+  opacity_ = ClampToByte(opacity * 255.0);
+  present_ |= kOpacity;
+}
+
+void ComputedStyleBlock::SetVisibility(Visibility visibility) {
+  visibility_ = visibility;
+  present_ |= kVisibility;
+}
+
+void ComputedStyleBlock::SetDisplay(Display display) {
+  display_ = display;
+  present_ |= kDisplay;
+}
+
+void ComputedStyleBlock::SetPosition(Position position) {
+  position_ = position;
+  present_ |= kPosition;
+}
+
+void ComputedStyleBlock::SetZIndex(int32_t z_index) {
+  z_index_ = z_index;
+  present_ |= kZIndex;
+}
+
+bool ComputedStyleBlock::IsRendered() const {
+  if (Has(kDisplay) && display_ == Display::kNone) {
+    return false;
+  }
+  return !Has(kVisibility) || visibility_ == Visibility::kVisible;
+}
+
+bool ComputedStyleBlock::HasDarkBackground() const {
+  if (Has(kBackgroundColor) &&
+      (background_color_ >> 24) >= kMinBackgroundAlpha) {
+    return Luminance(background_color_) < 0.5;
+  }
+  // Light text is drawn on something dark
+  return Has(kColor) && Luminance(color_) > 0.5;
+}
+
+bool ComputedStyleBlock::operator==(const ComputedStyleBlock& other) const {
+  return present_ == other.present_ &&
+         (!Has(kColor) || color_ == other.color_) &&
+         (!Has(kBackgroundColor) ||
+          background_color_ == other.background_color_) &&
+         (!Has(kFontSize) ||
+          font_size_quarter_px_ == other.font_size_quarter_px_) &&
+         (!Has(kFontWeight) || font_weight_ == other.font_weight_) &&
+         (!Has(kOpacity) || opacity_ == other.opacity_) &&
+         (!Has(kVisibility) || visibility_ == other.visibility_) &&
+         (!Has(kDisplay) || display_ == other.display_) &&
+         (!Has(kPosition) || position_ == other.position_) &&
+         (!Has(kZIndex) || z_index_ == other.z_index_);
+}
+
+}  // namespace tooltip
@@ -0,0 +1,136 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_COMPUTED_STYLE_BLOCK_H_
+#define CHROME_BROWSER_TOOLTIP_COMPUTED_STYLE_BLOCK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+
+namespace tooltip {
+
+// The computed style properties the tooltip pipeline looks at, as numbers
+// rather than CSS text. The block is a small fixed-size value with no heap
+// storage, so it is cheap to copy along with an ElementInfo. Properties
+// missing from the source are reported as absent by Has().
+class ComputedStyleBlock {
+ public:
+  // Bit set in the presence mask for each property
+  enum Property : uint16_t {
+    kColor = 1 << 0,
+    kBackgroundColor = 1 << 1,
+    kFontSize = 1 << 2,
+    kFontWeight = 1 << 3,
+    kOpacity = 1 << 4,
+    kVisibility = 1 << 5,
+    kDisplay = 1 << 6,
+    kPosition = 1 << 7,
+    kZIndex = 1 << 8,
+  };
+
+  enum class Visibility : uint8_t {
+    kVisible,
+    kHidden,
+    kCollapse,
+    kMaxValue = kCollapse,
+  };
+
+  // Only the values the pipeline distinguishes; everything else is kOther
+  enum class Display : uint8_t {
+    kOther,
+    kNone,
+    kInline,
+    kBlock,
+    kInlineBlock,
+    kFlex,
+    kGrid,
+    kMaxValue = kGrid,
+  };
+
+  enum class Position : uint8_t {
+    kStatic,
+    kRelative,
+    kAbsolute,
+    kFixed,
+    kSticky,
+    kMaxValue = kSticky,
+  };
+
+  // Size of the largest encoding, with every property present
+  static constexpr size_t kMaxEncodedSize = 23;
+
+  ComputedStyleBlock();
+
+  // Parses |css_text| in the "name: value; name: value" form produced by
+  // the element detector from getComputedStyle(). Unknown properties and
+  // values that fail to parse are skipped.
+  static ComputedStyleBlock Parse(std::string_view css_text);
+
+  // Reads a block written by AppendEncoded(). Returns false and leaves
+  // |block| untouched if |encoded| is truncated, has trailing bytes or was
+  // written by an unknown version.
+  static bool Decode(std::string_view encoded, ComputedStyleBlock* block);
+
+  // Appends the compact binary form: a version byte, the presence mask and
+  // the present properties in a fixed little-endian layout
+  void AppendEncoded(std::string* output) const;
+  std::string Encode() const;
+
+  bool Has(Property property) const { return (present_ & property) != 0; }
+  bool empty() const { return present_ == 0; }
+
+  // Colors are 0xAARRGGBB, the SkColor layout
+  uint32_t color() const { return color_; }
+  uint32_t background_color() const { return background_color_; }
+  float font_size_px() const { return font_size_quarter_px_ / 4.0f; }
+  int font_weight() const { return font_weight_; }
+  float opacity() const { return opacity_ / 255.0f; }
+  Visibility visibility() const { return visibility_; }
+  Display display() const { return display_; }
+  Position position() const { return position_; }
+  int32_t z_index() const { return z_index_; }
+
+  void SetColor(uint32_t color);
+  void SetBackgroundColor(uint32_t color);
+  void SetFontSize(float px);
+  void SetFontWeight(int weight);
+  void SetOpacity(float opacity);
+  void SetVisibility(Visibility visibility);
+  void SetDisplay(Display display);
+  void SetPosition(Position position);
+  void SetZIndex(int32_t z_index);
+
+  // False for display: none and for hidden or collapsed visibility. Absent
+  // properties count as rendered.
+  bool IsRendered() const;
+
+  // Whether the element reads as light text on a dark surface. Uses the
+  // background when it is opaque enough to judge, otherwise the text color.
+  bool HasDarkBackground() const;
+
+  bool operator==(const ComputedStyleBlock& other) const;
+  bool operator!=(const ComputedStyleBlock& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  uint16_t present_;
+  uint32_t color_;
+  uint32_t background_color_;
+  // Quantized so that the encoded form round-trips exactly
+  uint16_t font_size_quarter_px_;
+  uint16_t font_weight_;
+  uint8_t opacity_;
+  Visibility visibility_;
+  Display display_;
+  Position position_;
+  int32_t z_index_;
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_COMPUTED_STYLE_BLOCK_H_
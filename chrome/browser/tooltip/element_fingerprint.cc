@@ -0,0 +1,340 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "element_fingerprint.h"
+
+#include <string.h>
+
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TOOLTIP_FINGERPRINT_SSE2 1
+#endif
+
+namespace tooltip {
+
+namespace {
+
+// The hash follows the structure of XXH3: 64-byte stripes feed eight 64-bit
+// lanes through 32x32->64 multiplies, which SSE2 does two lanes at a time,
+// and the lanes are scrambled every kStripesPerBlock stripes. The scalar and
+// SSE2 loops perform the same arithmetic and must stay in lockstep; any
+// change to either changes persisted fingerprints.
+
+constexpr size_t kStripeSize = 64;
+constexpr size_t kLanes = kStripeSize / sizeof(uint64_t);
+constexpr size_t kSecretSize = 192;
+// Each stripe reads the secret 8 bytes further along
+constexpr size_t kSecretStride = 8;
+constexpr size_t kSecretPositions =
+    (kSecretSize - kStripeSize) / kSecretStride + 1;
+constexpr size_t kStripesPerBlock = 16;
+
+constexpr uint64_t kPrime32_1 = 0x9E3779B1U;
+constexpr uint64_t kPrime32_2 = 0x85EBCA77U;
+constexpr uint64_t kPrime32_3 = 0xC2B2AE3DU;
+constexpr uint64_t kPrime64_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime64_3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime64_5 = 0x27D4EB2F165667C5ULL;
+
+constexpr uint64_t SplitMix64(uint64_t* state) {
+  uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+// Secret derived from a fixed seed. Never change the seed: it is part of
+// the persisted fingerprint format.
+constexpr std::array<uint64_t, kSecretSize / 8> MakeSecret() {
+  std::array<uint64_t, kSecretSize / 8> secret{};
+  uint64_t state = 0x746F6F6C746970ULL;  // "tooltip"
+  for (size_t i = 0; i < secret.size(); ++i) {
+    secret[i] = SplitMix64(&state);
+  }
+  return secret;
+}
+
+constexpr std::array<uint64_t, kSecretSize / 8> kSecret = MakeSecret();
+
+inline uint64_t Read64(const uint8_t* data) {
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  value = __builtin_bswap64(value);
+#endif
+  return value;
+}
+
+// Secret word |word| of stripe position |position|
+inline uint64_t SecretWord(size_t position, size_t word) {
+  return kSecret[position * (kSecretStride / 8) + word];
+}
+
+// Low and high halves of the 128-bit product, folded together
+inline uint64_t MulFold64(uint64_t a, uint64_t b) {
+  uint64_t a_lo = a & 0xFFFFFFFF;
+  uint64_t a_hi = a >> 32;
+  uint64_t b_lo = b & 0xFFFFFFFF;
+  uint64_t b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo;
+  uint64_t hi_lo = a_hi * b_lo;
+  uint64_t lo_hi = a_lo * b_hi;
+  uint64_t hi_hi = a_hi * b_hi;
+  uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFF) + lo_hi;
+  uint64_t upper = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  uint64_t lower = (cross << 32) | (lo_lo & 0xFFFFFFFF);
+  return lower ^ upper;
+}
+
+inline uint64_t Avalanche(uint64_t hash) {
+  hash ^= hash >> 37;
+  hash *= 0x165667919E3779F9ULL;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+void InitAccumulators(uint64_t* acc) {
+  acc[0] = kPrime32_3;
+  acc[1] = kPrime64_1;
+  acc[2] = kPrime64_2;
+  acc[3] = kPrime64_3;
+  acc[4] = kPrime64_4;
+  acc[5] = kPrime32_2;
+  acc[6] = kPrime64_5;
+  acc[7] = kPrime32_1;
+}
+
+uint64_t MergeAccumulators(const uint64_t* acc, size_t length) {
+  uint64_t result = static_cast<uint64_t>(length) * kPrime64_1;
+  for (size_t i = 0; i < kLanes / 2; ++i) {
+    result += MulFold64(acc[2 * i] ^ kSecret[3 + 2 * i],
+                        acc[2 * i + 1] ^ kSecret[4 + 2 * i]);
+  }
+  return Avalanche(result);
+}
+
+// Zero-padded copy of the bytes after the last full stripe
+void CopyTail(const uint8_t* tail, size_t tail_length, uint8_t* stripe) {
+  memset(stripe, 0, kStripeSize);
+  memcpy(stripe, tail, tail_length);
+}
+
+void AccumulateStripeScalar(uint64_t* acc,
+                            const uint8_t* stripe,
+                            size_t position) {
+  for (size_t i = 0; i < kLanes; ++i) {
+    uint64_t data = Read64(stripe + 8 * i);
+    uint64_t keyed = data ^ SecretWord(position, i);
+    acc[i ^ 1] += data;
+    acc[i] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+  }
+}
+
+void ScrambleScalar(uint64_t* acc) {
+  for (size_t i = 0; i < kLanes; ++i) {
+    uint64_t value = acc[i] ^ (acc[i] >> 47) ^ kSecret[kSecret.size() - 8 + i];
+    acc[i] = value * kPrime32_1;
+  }
+}
+
+#if defined(TOOLTIP_FINGERPRINT_SSE2)
+
+void AccumulateStripeSSE2(__m128i* acc,
+                          const uint8_t* stripe,
+                          size_t position) {
+  const uint64_t* secret = &kSecret[position * (kSecretStride / 8)];
+  for (size_t i = 0; i < kLanes / 2; ++i) {
+    __m128i data = _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(stripe + 16 * i));
+    __m128i key =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret + 2 * i));
+    __m128i keyed = _mm_xor_si128(data, key);
+    // Low 32 bits of each lane times its high 32 bits
+    __m128i keyed_hi = _mm_shuffle_epi32(keyed, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128i product = _mm_mul_epu32(keyed, keyed_hi);
+    // acc[i ^ 1] += data
+    __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(product, swapped));
+  }
+}
+
+void ScrambleSSE2(__m128i* acc) {
+  const __m128i prime = _mm_set1_epi32(static_cast<int>(kPrime32_1));
+  const uint64_t* secret = &kSecret[kSecret.size() - 8];
+  for (size_t i = 0; i < kLanes / 2; ++i) {
+    __m128i key =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret + 2 * i));
+    __m128i value = _mm_xor_si128(
+        _mm_xor_si128(acc[i], _mm_srli_epi64(acc[i], 47)), key);
+    // 64-bit multiply by a 32-bit constant from two 32x32 products
+    __m128i product_lo = _mm_mul_epu32(value, prime);
+    __m128i product_hi = _mm_mul_epu32(_mm_srli_epi64(value, 32), prime);
+    acc[i] = _mm_add_epi64(product_lo, _mm_slli_epi64(product_hi, 32));
+  }
+}
+
+#endif  // defined(TOOLTIP_FINGERPRINT_SSE2)
+
+// |bytes| low-order bytes of |value|, least significant first
+void EncodeLittleEndian(uint64_t value, size_t bytes, uint8_t* output) {
+  for (size_t i = 0; i < bytes; ++i) {
+    output[i] = static_cast<uint8_t>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+}  // namespace
+
+std::string ElementFingerprint::ToString() const {
+  static const char kHexDigits[] = "0123456789abcdef";
+  std::string hex(16, '0');
+  for (int i = 0; i < 16; ++i) {
+    hex[15 - i] = kHexDigits[(value >> (4 * i)) & 0xF];
+  }
+  return hex;
+}
+
+ElementFingerprint ComputeElementFingerprint(const ElementInfo& element_info,
+                                             FingerprintBounds bounds) {
+  FingerprintBuilder builder;
+  builder.AddString(element_info.tag_name)
+      .AddString(element_info.id)
+      .AddString(element_info.class_name)
+      .AddString(element_info.role)
+      .AddString(element_info.aria_label)
+      .AddString(element_info.href)
+      .AddString(element_info.src);
+  if (bounds == FingerprintBounds::kInclude) {
+    builder.AddInt(element_info.bounds.x())
+        .AddInt(element_info.bounds.y())
+        .AddInt(element_info.bounds.width())
+        .AddInt(element_info.bounds.height());
+  }
+  return builder.Finish();
+}
+
+// FingerprintBuilder implementation
+FingerprintBuilder::FingerprintBuilder() : inline_size_(0) {}
+
+FingerprintBuilder::~FingerprintBuilder() = default;
+
+FingerprintBuilder& FingerprintBuilder::AddString(std::string_view value) {
+  uint8_t length[4];
+  EncodeLittleEndian(value.size(), sizeof(length), length);
+  Append(length, sizeof(length));
+  Append(value.data(), value.size());
+  return *this;
+}
+
+FingerprintBuilder& FingerprintBuilder::AddInt(int64_t value) {
+  uint8_t encoded[8];
+  EncodeLittleEndian(static_cast<uint64_t>(value), sizeof(encoded), encoded);
+  Append(encoded, sizeof(encoded));
+  return *this;
+}
+
+ElementFingerprint FingerprintBuilder::Finish() const {
+  ElementFingerprint fingerprint;
+  fingerprint.value =
+      overflow_.empty() ? FingerprintHash(inline_buffer_, inline_size_)
+                        : FingerprintHash(overflow_.data(), overflow_.size());
+  return fingerprint;
+}
+
+void FingerprintBuilder::Append(const void* data, size_t length) {
+  if (overflow_.empty() && inline_size_ + length <= kInlineCapacity) {
+    memcpy(inline_buffer_ + inline_size_, data, length);
+    inline_size_ += length;
+    return;
+  }
+  if (overflow_.empty()) {
+    overflow_.assign(inline_buffer_, inline_size_);
+  }
+  overflow_.append(static_cast<const char*>(data), length);
+}
+
+uint64_t FingerprintHash(const void* data, size_t length) {
+#if defined(TOOLTIP_FINGERPRINT_SSE2)
+  return internal::FingerprintHashSSE2(data, length);
+#else
+  return internal::FingerprintHashScalar(data, length);
+#endif
+}
+
+namespace internal {
+
+uint64_t FingerprintHashScalar(const void* data, size_t length) {
+  const uint8_t* input = static_cast<const uint8_t*>(data);
+  uint64_t acc[kLanes];
+  InitAccumulators(acc);
+
+  size_t stripes = length / kStripeSize;
+  for (size_t stripe = 0; stripe < stripes; ++stripe) {
+    AccumulateStripeScalar(acc, input + stripe * kStripeSize,
+                           stripe % kSecretPositions);
+    if ((stripe + 1) % kStripesPerBlock == 0) {
+      ScrambleScalar(acc);
+    }
+  }
+
+  size_t tail_length = length % kStripeSize;
+  if (tail_length) {
+    uint8_t tail[kStripeSize];
+    CopyTail(input + stripes * kStripeSize, tail_length, tail);
+    AccumulateStripeScalar(acc, tail, stripes % kSecretPositions);
+  }
+  return MergeAccumulators(acc, length);
+}
+
+uint64_t FingerprintHashSSE2(const void* data, size_t length) {
+#if defined(TOOLTIP_FINGERPRINT_SSE2)
+  const uint8_t* input = static_cast<const uint8_t*>(data);
+  uint64_t initial[kLanes];
+  InitAccumulators(initial);
+  __m128i acc[kLanes / 2];
+  for (size_t i = 0; i < kLanes / 2; ++i) {
+    acc[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(initial + 2 * i));
+  }
+
+  size_t stripes = length / kStripeSize;
+  for (size_t stripe = 0; stripe < stripes; ++stripe) {
+    AccumulateStripeSSE2(acc, input + stripe * kStripeSize,
+                         stripe % kSecretPositions);
+    if ((stripe + 1) % kStripesPerBlock == 0) {
+      ScrambleSSE2(acc);
+    }
+  }
+
+  size_t tail_length = length % kStripeSize;
+  if (tail_length) {
+    uint8_t tail[kStripeSize];
+    CopyTail(input + stripes * kStripeSize, tail_length, tail);
+    AccumulateStripeSSE2(acc, tail, stripes % kSecretPositions);
+  }
+
+  uint64_t lanes[kLanes];
+  for (size_t i = 0; i < kLanes / 2; ++i) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes + 2 * i), acc[i]);
+  }
+  return MergeAccumulators(lanes, length);
+#else
+  return FingerprintHashScalar(data, length);
+#endif
+}
+
+bool HasSSE2FingerprintHash() {
+#if defined(TOOLTIP_FINGERPRINT_SSE2)
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace internal
+
+}  // namespace tooltip
@@ -0,0 +1,99 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_ELEMENT_FINGERPRINT_H_
+#define CHROME_BROWSER_TOOLTIP_ELEMENT_FINGERPRINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#endif
+#include "chrome/browser/tooltip/tooltip_service.h"
+
+namespace tooltip {
+
+// Identity of an element for caching, deduplication and request
+// coalescing. The value depends only on the hashed bytes, never on the
+// process, platform or build, so it can be persisted as a cache key.
+struct ElementFingerprint {
+  uint64_t value = 0;
+
+  bool operator==(const ElementFingerprint& other) const {
+    return value == other.value;
+  }
+  bool operator!=(const ElementFingerprint& other) const {
+    return value != other.value;
+  }
+  bool operator<(const ElementFingerprint& other) const {
+    return value < other.value;
+  }
+
+  // 16 lowercase hex digits
+  std::string ToString() const;
+};
+
+enum class FingerprintBounds {
+  // Elements at different positions get different fingerprints
+  kInclude,
+  // Position and size are ignored, so scrolling or relayout keeps the
+  // fingerprint
+  kIgnore,
+};
+
+// Fingerprint of |element_info| over tag, id, class, role, aria-label, href
+// and src, plus bounds unless |bounds| is kIgnore
+ElementFingerprint ComputeElementFingerprint(
+    const ElementInfo& element_info,
+    FingerprintBounds bounds = FingerprintBounds::kInclude);
+
+// Builds a fingerprint from a sequence of fields. Each field is length
+// prefixed, so ("ab", "c") and ("a", "bc") differ.
+class FingerprintBuilder {
+ public:
+  FingerprintBuilder();
+  ~FingerprintBuilder();
+
+  FingerprintBuilder& AddString(std::string_view value);
+  FingerprintBuilder& AddInt(int64_t value);
+
+  ElementFingerprint Finish() const;
+
+ private:
+  // Typical elements fit inline; longer input moves to |overflow_|
+  static constexpr size_t kInlineCapacity = 256;
+
+  void Append(const void* data, size_t length);
+
+  char inline_buffer_[kInlineCapacity];
+  size_t inline_size_;
+  std::string overflow_;
+
+  DISALLOW_COPY_AND_ASSIGN(FingerprintBuilder);
+};
+
+// Stable 64-bit hash of |length| bytes. Uses SSE2 where available; every
+// implementation returns the same value for the same bytes.
+uint64_t FingerprintHash(const void* data, size_t length);
+
+namespace internal {
+
+// Individual implementations, exposed for benchmarks and consistency
+// checks. FingerprintHashSSE2() falls back to the scalar loop on builds
+// without SSE2.
+uint64_t FingerprintHashScalar(const void* data, size_t length);
+uint64_t FingerprintHashSSE2(const void* data, size_t length);
+bool HasSSE2FingerprintHash();
+
+}  // namespace internal
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_ELEMENT_FINGERPRINT_H_
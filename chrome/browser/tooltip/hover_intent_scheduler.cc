@@ -0,0 +1,60 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "hover_intent_scheduler.h"
+
+#include <utility>
+
+#include "base/bind.h"
+#include "base/logging.h"
+
+namespace tooltip {
+
+HoverIntentScheduler::HoverIntentScheduler(ShowCallback show_callback)
+    : show_callback_(std::move(show_callback)) {}
+
+HoverIntentScheduler::~HoverIntentScheduler() = default;
+
+void HoverIntentScheduler::Schedule(content::WebContents* web_contents,
+                                    const ElementInfo& element_info,
+                                    const gfx::Point& mouse_position,
+                                    base::TimeDelta delay) {
+  if (pending_) {
+    VLOG(2) << "Pending tooltip replaced by hover over: "
+            << element_info.tag_name;
+  }
+
+  pending_ = std::make_unique<PendingHover>();
+  pending_->web_contents = web_contents;
+  pending_->element_info = element_info;
+  pending_->mouse_position = mouse_position;
+
+  // Restarting the timer makes the delay count from the latest hover.
+  timer_.Start(FROM_HERE, delay,
+               base::BindOnce(&HoverIntentScheduler::OnDelayElapsed,
+                              base::Unretained(this)));
+}
+
+void HoverIntentScheduler::Cancel() {
+  timer_.Stop();
+  pending_.reset();
+}
+
+bool HoverIntentScheduler::HasPendingRequest() const {
+  return pending_ != nullptr;
+}
+
+void HoverIntentScheduler::OnDelayElapsed() {
+  if (!pending_) {
+    return;
+  }
+
+  // Release the pending slot before running the callback so that the show
+  // path is free to schedule or cancel again.
+  std::unique_ptr<PendingHover> hover = std::move(pending_);
+  show_callback_.Run(hover->web_contents, hover->element_info,
+                     hover->mouse_position);
+}
+
+}  // namespace tooltip
@@ -0,0 +1,71 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_HOVER_INTENT_SCHEDULER_H_
+#define CHROME_BROWSER_TOOLTIP_HOVER_INTENT_SCHEDULER_H_
+
+#include <memory>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/callback.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "ui/gfx/geometry/point.h"
+#endif
+#include "chrome/browser/tooltip/tooltip_service.h"
+
+namespace content {
+class WebContents;
+}
+
+namespace tooltip {
+
+// Holds hover requests until the pointer has rested on an element for the
+// configured delay. A newer hover replaces the pending one and leaving the
+// element drops it, so sweeping across a page never starts any tooltip work.
+class HoverIntentScheduler {
+ public:
+  using ShowCallback =
+      base::RepeatingCallback<void(content::WebContents* web_contents,
+                                   const ElementInfo& element_info,
+                                   const gfx::Point& mouse_position)>;
+
+  explicit HoverIntentScheduler(ShowCallback show_callback);
+  ~HoverIntentScheduler();
+
+  // Schedule a tooltip for |element_info| once |delay| has elapsed. Any
+  // request that is still pending is replaced.
+  void Schedule(content::WebContents* web_contents,
+                const ElementInfo& element_info,
+                const gfx::Point& mouse_position,
+                base::TimeDelta delay);
+
+  // Drop the pending request, if any.
+  void Cancel();
+
+  // Check if a request is waiting for its delay to elapse
+  bool HasPendingRequest() const;
+
+ private:
+  struct PendingHover {
+    content::WebContents* web_contents = nullptr;
+    ElementInfo element_info;
+    gfx::Point mouse_position;
+  };
+
+  // Called when the pending request has survived the hover delay
+  void OnDelayElapsed();
+
+  ShowCallback show_callback_;
+  std::unique_ptr<PendingHover> pending_;
+  base::OneShotTimer timer_;
+
+  DISALLOW_COPY_AND_ASSIGN(HoverIntentScheduler);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_HOVER_INTENT_SCHEDULER_H_
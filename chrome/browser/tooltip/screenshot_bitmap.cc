@@ -0,0 +1,90 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "screenshot_bitmap.h"
+
+#include <string.h>
+
+#include <utility>
+
+namespace tooltip {
+
+ScreenshotBitmap::ScreenshotBitmap() : width_(0), height_(0) {}
+
+ScreenshotBitmap::ScreenshotBitmap(int width, int height)
+    : width_(0), height_(0) {
+  if (width > 0 && height > 0) {
+    width_ = width;
+    height_ = height;
+    pixels_.resize(stride() * height_);
+  }
+}
+
+ScreenshotBitmap::ScreenshotBitmap(int width,
+                                   int height,
+                                   std::vector<uint8_t> pixels)
+    : width_(0), height_(0), pixels_(std::move(pixels)) {
+  if (width > 0 && height > 0) {
+    width_ = width;
+    height_ = height;
+  }
+  pixels_.resize(stride() * height_);
+}
+
+ScreenshotBitmap::ScreenshotBitmap(ScreenshotBitmap&& other)
+    : width_(other.width_),
+      height_(other.height_),
+      pixels_(std::move(other.pixels_)) {
+  other.width_ = 0;
+  other.height_ = 0;
+  other.pixels_.clear();
+}
+
+ScreenshotBitmap& ScreenshotBitmap::operator=(ScreenshotBitmap&& other) {
+  if (this != &other) {
+    width_ = other.width_;
+    height_ = other.height_;
+    pixels_ = std::move(other.pixels_);
+    other.width_ = 0;
+    other.height_ = 0;
+    other.pixels_.clear();
+  }
+  return *this;
+}
+
+ScreenshotBitmap::~ScreenshotBitmap() = default;
+
+ScreenshotBitmap ScreenshotBitmap::Clone() const {
+  ScreenshotBitmap copy;
+  copy.width_ = width_;
+  copy.height_ = height_;
+  copy.pixels_ = pixels_;
+  return copy;
+}
+
+std::vector<uint8_t> ScreenshotBitmap::TakePixels() {
+  std::vector<uint8_t> pixels = std::move(pixels_);
+  pixels_.clear();
+  width_ = 0;
+  height_ = 0;
+  return pixels;
+}
+
+ScreenshotBitmap ScreenshotBitmap::Crop(const gfx::Rect& rect) const {
+  gfx::Rect clipped = rect;
+  clipped.Intersect(bounds());
+  if (clipped.IsEmpty()) {
+    return ScreenshotBitmap();
+  }
+
+  ScreenshotBitmap cropped(clipped.width(), clipped.height());
+  size_t row_bytes = cropped.stride();
+  size_t x_offset = static_cast<size_t>(clipped.x()) * kBytesPerPixel;
+  for (int y = 0; y < clipped.height(); ++y) {
+    memcpy(cropped.row(y), row(clipped.y() + y) + x_offset, row_bytes);
+  }
+  return cropped;
+}
+
+}  // namespace tooltip
@@ -0,0 +1,73 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_BITMAP_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_BITMAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#include "ui/gfx/geometry/rect.h"
+#endif
+
+namespace tooltip {
+
+// Uncompressed capture in 8-bit RGBA, rows top to bottom with no padding.
+// This is what the screenshot pipeline crops, scales and encodes before a
+// capture becomes a gfx::Image or a file. Move-only; use Clone() for the
+// rare deliberate copy of a multi-megabyte buffer.
+class ScreenshotBitmap {
+ public:
+  static constexpr int kBytesPerPixel = 4;
+
+  ScreenshotBitmap();
+  // Zero-filled bitmap; empty if either dimension is not positive
+  ScreenshotBitmap(int width, int height);
+  // Bitmap over |pixels|, resized to fit. Existing bytes are kept rather
+  // than cleared, so recycled buffers cost no fill.
+  ScreenshotBitmap(int width, int height, std::vector<uint8_t> pixels);
+  ScreenshotBitmap(ScreenshotBitmap&& other);
+  ScreenshotBitmap& operator=(ScreenshotBitmap&& other);
+  ~ScreenshotBitmap();
+
+  ScreenshotBitmap Clone() const;
+
+  // Gives up the pixel storage, leaving this bitmap empty
+  std::vector<uint8_t> TakePixels();
+
+  bool empty() const { return width_ == 0 || height_ == 0; }
+  int width() const { return width_; }
+  int height() const { return height_; }
+  size_t stride() const {
+    return static_cast<size_t>(width_) * kBytesPerPixel;
+  }
+  size_t byte_size() const { return pixels_.size(); }
+  gfx::Rect bounds() const { return gfx::Rect(0, 0, width_, height_); }
+
+  uint8_t* data() { return pixels_.data(); }
+  const uint8_t* data() const { return pixels_.data(); }
+  uint8_t* row(int y) { return pixels_.data() + y * stride(); }
+  const uint8_t* row(int y) const { return pixels_.data() + y * stride(); }
+
+  // Copies the part of this bitmap inside |rect|, clipped to the bitmap.
+  // Returns an empty bitmap when they do not overlap.
+  ScreenshotBitmap Crop(const gfx::Rect& rect) const;
+
+ private:
+  int width_;
+  int height_;
+  std::vector<uint8_t> pixels_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScreenshotBitmap);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_BITMAP_H_
@@ -0,0 +1,256 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "screenshot_buffer_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+
+namespace tooltip {
+
+namespace {
+
+// Smallest class; smaller buffers are not worth keeping
+const int kMinClassShift = 12;
+const size_t kMinClassCapacity = size_t{1} << kMinClassShift;
+const int kClassesPerOctave = 4;
+
+int HighestBit(size_t value) {
+  int bit = -1;
+  while (value) {
+    value >>= 1;
+    ++bit;
+  }
+  return bit;
+}
+
+// Index of the smallest class holding |size| bytes. Class 0 holds 4 KB;
+// after it each octave 2^k..2^(k+1) has classes at 2^k plus 1/4, 2/4, 3/4
+// and 4/4 of 2^k.
+size_t ClassIndex(size_t size) {
+  if (size <= kMinClassCapacity) {
+    return 0;
+  }
+  int octave = HighestBit(size - 1);
+  size_t base = size_t{1} << octave;
+  size_t step = base / kClassesPerOctave;
+  size_t quarter = (size - base + step - 1) / step;
+  return (octave - kMinClassShift) * kClassesPerOctave + quarter;
+}
+
+size_t ClassCapacity(size_t index) {
+  if (index == 0) {
+    return kMinClassCapacity;
+  }
+  int octave = kMinClassShift + static_cast<int>((index - 1) /
+                                                 kClassesPerOctave);
+  size_t base = size_t{1} << octave;
+  return base + ((index - 1) % kClassesPerOctave + 1) *
+                    (base / kClassesPerOctave);
+}
+
+}  // namespace
+
+ScreenshotBuffer::ScreenshotBuffer() : pool_(nullptr) {}
+
+ScreenshotBuffer::ScreenshotBuffer(ScreenshotBufferPool* pool,
+                                   std::vector<uint8_t> bytes)
+    : pool_(pool), bytes_(std::move(bytes)) {}
+
+ScreenshotBuffer::ScreenshotBuffer(ScreenshotBuffer&& other)
+    : pool_(other.pool_), bytes_(std::move(other.bytes_)) {
+  other.pool_ = nullptr;
+  other.bytes_.clear();
+}
+
+ScreenshotBuffer& ScreenshotBuffer::operator=(ScreenshotBuffer&& other) {
+  if (this != &other) {
+    Reset();
+    pool_ = other.pool_;
+    bytes_ = std::move(other.bytes_);
+    other.pool_ = nullptr;
+    other.bytes_.clear();
+  }
+  return *this;
+}
+
+ScreenshotBuffer::~ScreenshotBuffer() {
+  Reset();
+}
+
+std::vector<uint8_t> ScreenshotBuffer::Release() {
+  if (pool_) {
+    pool_->Detach(bytes_.capacity());
+    pool_ = nullptr;
+  }
+  std::vector<uint8_t> bytes = std::move(bytes_);
+  bytes_.clear();
+  return bytes;
+}
+
+void ScreenshotBuffer::Reset() {
+  if (pool_) {
+    pool_->Return(std::move(bytes_), true);
+    pool_ = nullptr;
+  }
+  bytes_ = std::vector<uint8_t>();
+}
+
+PooledScreenshotBitmap::PooledScreenshotBitmap() : pool_(nullptr) {}
+
+PooledScreenshotBitmap::PooledScreenshotBitmap(ScreenshotBufferPool* pool,
+                                               ScreenshotBitmap bitmap)
+    : pool_(pool), bitmap_(std::move(bitmap)) {}
+
+PooledScreenshotBitmap::PooledScreenshotBitmap(
+    PooledScreenshotBitmap&& other)
+    : pool_(other.pool_), bitmap_(std::move(other.bitmap_)) {
+  other.pool_ = nullptr;
+}
+
+PooledScreenshotBitmap& PooledScreenshotBitmap::operator=(
+    PooledScreenshotBitmap&& other) {
+  if (this != &other) {
+    Reset();
+    pool_ = other.pool_;
+    bitmap_ = std::move(other.bitmap_);
+    other.pool_ = nullptr;
+  }
+  return *this;
+}
+
+PooledScreenshotBitmap::~PooledScreenshotBitmap() {
+  Reset();
+}
+
+void PooledScreenshotBitmap::Reset() {
+  std::vector<uint8_t> pixels = bitmap_.TakePixels();
+  if (pool_) {
+    pool_->Return(std::move(pixels), true);
+    pool_ = nullptr;
+  }
+}
+
+ScreenshotBufferPool::ScreenshotBufferPool(const Options& options)
+    : options_(options) {}
+
+ScreenshotBufferPool::~ScreenshotBufferPool() {
+  DCHECK_EQ(0u, stats_.in_use_buffers)
+      << "Screenshot buffers outlive their pool";
+}
+
+ScreenshotBuffer ScreenshotBufferPool::Acquire(size_t size) {
+  return ScreenshotBuffer(this, Take(size));
+}
+
+PooledScreenshotBitmap ScreenshotBufferPool::AcquireBitmap(int width,
+                                                           int height) {
+  if (width <= 0 || height <= 0) {
+    return PooledScreenshotBitmap();
+  }
+  size_t size = static_cast<size_t>(width) * height *
+                ScreenshotBitmap::kBytesPerPixel;
+  return PooledScreenshotBitmap(this,
+                                ScreenshotBitmap(width, height, Take(size)));
+}
+
+void ScreenshotBufferPool::Recycle(std::vector<uint8_t> bytes) {
+  Return(std::move(bytes), false);
+}
+
+void ScreenshotBufferPool::Trim() {
+  std::vector<std::vector<std::vector<uint8_t>>> idle;
+  {
+    std::lock_guard<std::mutex> hold(lock_);
+    idle.swap(classes_);
+    stats_.pooled_bytes = 0;
+  }
+  // |idle| is freed here, outside the lock
+}
+
+ScreenshotBufferPool::Stats ScreenshotBufferPool::GetStats() const {
+  std::lock_guard<std::mutex> hold(lock_);
+  return stats_;
+}
+
+// static
+size_t ScreenshotBufferPool::GetClassCapacity(size_t size) {
+  return ClassCapacity(ClassIndex(size));
+}
+
+std::vector<uint8_t> ScreenshotBufferPool::Take(size_t size) {
+  size_t index = ClassIndex(size);
+  std::vector<uint8_t> bytes;
+  {
+    std::lock_guard<std::mutex> hold(lock_);
+    ++stats_.acquires;
+    if (index < classes_.size() && !classes_[index].empty()) {
+      bytes = std::move(classes_[index].back());
+      classes_[index].pop_back();
+      stats_.pooled_bytes -= bytes.capacity();
+      ++stats_.reuses;
+    }
+    // Counted by class capacity before allocating, so the peak covers
+    // buffers that are still being faulted in
+    stats_.in_use_bytes += bytes.capacity() ? bytes.capacity()
+                                            : ClassCapacity(index);
+    stats_.peak_in_use_bytes =
+        std::max(stats_.peak_in_use_bytes, stats_.in_use_bytes);
+    ++stats_.in_use_buffers;
+    stats_.peak_in_use_buffers =
+        std::max(stats_.peak_in_use_buffers, stats_.in_use_buffers);
+  }
+  if (!bytes.capacity()) {
+    bytes.reserve(ClassCapacity(index));
+  }
+  // Only bytes past the buffer's previous size are cleared
+  bytes.resize(size);
+  return bytes;
+}
+
+void ScreenshotBufferPool::Return(std::vector<uint8_t> bytes, bool in_use) {
+  size_t capacity = bytes.capacity();
+  // File under the largest class the buffer can serve
+  size_t index = ClassIndex(capacity);
+  bool keep = capacity >= kMinClassCapacity;
+  if (keep && ClassCapacity(index) > capacity) {
+    --index;
+  }
+
+  std::lock_guard<std::mutex> hold(lock_);
+  if (in_use) {
+    DCHECK_GE(stats_.in_use_bytes, capacity);
+    DCHECK_GT(stats_.in_use_buffers, 0u);
+    stats_.in_use_bytes -= std::min(stats_.in_use_bytes, capacity);
+    --stats_.in_use_buffers;
+  }
+  if (!keep) {
+    return;
+  }
+  if (index >= classes_.size()) {
+    classes_.resize(index + 1);
+  }
+  if (classes_[index].size() >= options_.max_per_class ||
+      stats_.pooled_bytes + capacity > options_.max_pooled_bytes) {
+    ++stats_.discards;
+    // |bytes| is freed on return; the allocator call is short next to
+    // the fault-in it saves on the next capture
+    return;
+  }
+  stats_.pooled_bytes += capacity;
+  stats_.peak_pooled_bytes =
+      std::max(stats_.peak_pooled_bytes, stats_.pooled_bytes);
+  classes_[index].push_back(std::move(bytes));
+}
+
+void ScreenshotBufferPool::Detach(size_t capacity) {
+  std::lock_guard<std::mutex> hold(lock_);
+  DCHECK_GT(stats_.in_use_buffers, 0u);
+  stats_.in_use_bytes -= std::min(stats_.in_use_bytes, capacity);
+  --stats_.in_use_buffers;
+}
+
+}  // namespace tooltip
@@ -0,0 +1,161 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_BUFFER_POOL_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_BUFFER_POOL_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+
+namespace tooltip {
+
+class ScreenshotBufferPool;
+
+// Byte buffer borrowed from a ScreenshotBufferPool, returned to it on
+// destruction. Its contents start out unspecified. Move-only.
+class ScreenshotBuffer {
+ public:
+  ScreenshotBuffer();
+  ScreenshotBuffer(ScreenshotBuffer&& other);
+  ScreenshotBuffer& operator=(ScreenshotBuffer&& other);
+  ~ScreenshotBuffer();
+
+  uint8_t* data() { return bytes_.data(); }
+  const uint8_t* data() const { return bytes_.data(); }
+  size_t size() const { return bytes_.size(); }
+
+  // The underlying vector, for encoders that append to their output.
+  // Growing it past its capacity works but defeats the pool.
+  std::vector<uint8_t>* vector() { return &bytes_; }
+
+  // Takes the bytes out of the pool's accounting, e.g. to become a
+  // capture's |image_data|. Hand them back with Recycle() once done.
+  std::vector<uint8_t> Release();
+
+ private:
+  friend class ScreenshotBufferPool;
+
+  ScreenshotBuffer(ScreenshotBufferPool* pool, std::vector<uint8_t> bytes);
+
+  void Reset();
+
+  ScreenshotBufferPool* pool_;
+  std::vector<uint8_t> bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScreenshotBuffer);
+};
+
+// ScreenshotBitmap whose pixels came from a ScreenshotBufferPool and go
+// back to it on destruction. The pixels start out unspecified; captures
+// overwrite every one. Move-only.
+class PooledScreenshotBitmap {
+ public:
+  PooledScreenshotBitmap();
+  PooledScreenshotBitmap(PooledScreenshotBitmap&& other);
+  PooledScreenshotBitmap& operator=(PooledScreenshotBitmap&& other);
+  ~PooledScreenshotBitmap();
+
+  ScreenshotBitmap& bitmap() { return bitmap_; }
+  const ScreenshotBitmap& bitmap() const { return bitmap_; }
+  ScreenshotBitmap* operator->() { return &bitmap_; }
+  const ScreenshotBitmap* operator->() const { return &bitmap_; }
+
+ private:
+  friend class ScreenshotBufferPool;
+
+  PooledScreenshotBitmap(ScreenshotBufferPool* pool, ScreenshotBitmap bitmap);
+
+  void Reset();
+
+  ScreenshotBufferPool* pool_;
+  ScreenshotBitmap bitmap_;
+
+  DISALLOW_COPY_AND_ASSIGN(PooledScreenshotBitmap);
+};
+
+// Recycles the multi-megabyte buffers of raw frames and encoded output so
+// that concurrent captures do not each map, fault in and unmap their own.
+//
+// Buffers are kept in size classes four to an octave, so a request is
+// served by a buffer at most a quarter larger than it asked for. Idle
+// buffers are bounded by |max_pooled_bytes| in total and |max_per_class|
+// per class; anything returned beyond that is freed.
+//
+// Thread-safe. Must outlive every buffer it hands out.
+class ScreenshotBufferPool {
+ public:
+  struct Options {
+    size_t max_pooled_bytes = 256 * 1024 * 1024;
+    size_t max_per_class = 8;
+  };
+
+  struct Stats {
+    uint64_t acquires = 0;
+    // Acquires served from an idle buffer
+    uint64_t reuses = 0;
+    // Returned buffers freed because the pool was full
+    uint64_t discards = 0;
+    size_t in_use_bytes = 0;
+    size_t peak_in_use_bytes = 0;
+    size_t pooled_bytes = 0;
+    size_t peak_pooled_bytes = 0;
+    size_t in_use_buffers = 0;
+    size_t peak_in_use_buffers = 0;
+  };
+
+  explicit ScreenshotBufferPool(const Options& options);
+  ~ScreenshotBufferPool();
+
+  // Buffer of exactly |size| bytes
+  ScreenshotBuffer Acquire(size_t size);
+
+  // Bitmap of |width| x |height|; empty if either is not positive
+  PooledScreenshotBitmap AcquireBitmap(int width, int height);
+
+  // Adopts a buffer that left the pool through ScreenshotBuffer::Release(),
+  // or any other vector worth keeping
+  void Recycle(std::vector<uint8_t> bytes);
+
+  // Frees every idle buffer
+  void Trim();
+
+  Stats GetStats() const;
+
+  // Capacity of the class that serves a request for |size| bytes
+  static size_t GetClassCapacity(size_t size);
+
+ private:
+  friend class ScreenshotBuffer;
+  friend class PooledScreenshotBitmap;
+
+  std::vector<uint8_t> Take(size_t size);
+  // Files |bytes| away. |in_use| is false for buffers the pool did not
+  // count as handed out.
+  void Return(std::vector<uint8_t> bytes, bool in_use);
+  // Forgets a buffer handed out by Take()
+  void Detach(size_t capacity);
+
+  const Options options_;
+
+  mutable std::mutex lock_;
+  // Idle buffers by class index
+  std::vector<std::vector<std::vector<uint8_t>>> classes_;
+  Stats stats_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScreenshotBufferPool);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_BUFFER_POOL_H_
@@ -0,0 +1,172 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "screenshot_capture_scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+
+namespace tooltip {
+
+ScreenshotCaptureScheduler::Policy::Policy() = default;
+
+ScreenshotCaptureScheduler::ScreenshotCaptureScheduler(const Policy& policy)
+    : policy_(policy) {
+  size_t thread_count = std::max<size_t>(1, policy_.capture_threads);
+  for (size_t i = 0; i < thread_count; ++i) {
+    threads_.emplace_back(&ScreenshotCaptureScheduler::Run, this);
+  }
+}
+
+ScreenshotCaptureScheduler::~ScreenshotCaptureScheduler() {
+  {
+    std::lock_guard<std::mutex> hold(lock_);
+    shutting_down_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+ScreenshotCaptureScheduler::TaskId ScreenshotCaptureScheduler::Submit(
+    CapturePriority priority,
+    Task task) {
+  size_t index = static_cast<size_t>(priority);
+  DCHECK_LT(index, kCapturePriorityCount);
+  TaskId id;
+  {
+    std::lock_guard<std::mutex> hold(lock_);
+    ClassStats& stats = stats_[index];
+    size_t max_queued = policy_.max_queued[index];
+    if (max_queued && queues_[index].size() >= max_queued) {
+      ++stats.rejected;
+      return kRejected;
+    }
+    id = next_id_++;
+    queues_[index].push_back(
+        {id, std::move(task), std::chrono::steady_clock::now()});
+    ++stats.submitted;
+    stats.queued = queues_[index].size();
+    stats.peak_queued = std::max(stats.peak_queued, stats.queued);
+  }
+  work_available_.notify_one();
+  return id;
+}
+
+bool ScreenshotCaptureScheduler::Cancel(TaskId id) {
+  Task cancelled;
+  bool found = false;
+  {
+    std::lock_guard<std::mutex> hold(lock_);
+    for (size_t index = 0; index < kCapturePriorityCount && !found;
+         ++index) {
+      std::deque<QueuedTask>& queue = queues_[index];
+      auto it = std::find_if(
+          queue.begin(), queue.end(),
+          [id](const QueuedTask& queued) { return queued.id == id; });
+      if (it == queue.end()) {
+        continue;
+      }
+      cancelled = std::move(it->task);
+      queue.erase(it);
+      found = true;
+      ++stats_[index].cancelled;
+      stats_[index].queued = queue.size();
+    }
+  }
+  // |cancelled| is destroyed here, outside the lock
+  return found;
+}
+
+bool ScreenshotCaptureScheduler::ShouldYield(CapturePriority priority) const {
+  std::lock_guard<std::mutex> hold(lock_);
+  if (idle_threads_ > 0) {
+    return false;
+  }
+  for (size_t index = 0; index < static_cast<size_t>(priority); ++index) {
+    if (CanStart(index)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+ScreenshotCaptureScheduler::ClassStats ScreenshotCaptureScheduler::GetStats(
+    CapturePriority priority) const {
+  std::lock_guard<std::mutex> hold(lock_);
+  return stats_[static_cast<size_t>(priority)];
+}
+
+bool ScreenshotCaptureScheduler::CanStart(size_t index) const {
+  size_t max_running = policy_.max_running[index];
+  return !queues_[index].empty() &&
+         (!max_running || stats_[index].running < max_running);
+}
+
+int ScreenshotCaptureScheduler::PickClass() const {
+  int picked = -1;
+  for (size_t index = 0; index < kCapturePriorityCount; ++index) {
+    if (!CanStart(index)) {
+      continue;
+    }
+    if (picked < 0) {
+      picked = static_cast<int>(index);
+    } else if (policy_.starvation_limit &&
+               passed_over_[index] >= policy_.starvation_limit) {
+      return static_cast<int>(index);
+    }
+  }
+  return picked;
+}
+
+void ScreenshotCaptureScheduler::Run() {
+  std::unique_lock<std::mutex> hold(lock_);
+  while (true) {
+    ++idle_threads_;
+    work_available_.wait(
+        hold, [this] { return shutting_down_ || PickClass() >= 0; });
+    --idle_threads_;
+    if (shutting_down_) {
+      return;
+    }
+
+    size_t picked = static_cast<size_t>(PickClass());
+    passed_over_[picked] = 0;
+    // Classes held back by their running limit are not passed over
+    for (size_t index = picked + 1; index < kCapturePriorityCount; ++index) {
+      if (CanStart(index)) {
+        ++passed_over_[index];
+      }
+    }
+
+    QueuedTask queued = std::move(queues_[picked].front());
+    queues_[picked].pop_front();
+    ClassStats& stats = stats_[picked];
+    stats.queued = queues_[picked].size();
+    ++stats.running;
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - queued.submitted);
+    stats.total_wait += wait;
+    stats.max_wait = std::max(stats.max_wait, wait);
+
+    hold.unlock();
+    queued.task();
+    queued.task = nullptr;
+    hold.lock();
+
+    --stats.running;
+    ++stats.completed;
+    // This thread looks for work next; another may now fit under a
+    // running limit only if this class was at its limit
+    if (policy_.max_running[picked] &&
+        stats.running + 1 == policy_.max_running[picked]) {
+      work_available_.notify_one();
+    }
+  }
+}
+
+}  // namespace tooltip
@@ -0,0 +1,144 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_CAPTURE_SCHEDULER_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_CAPTURE_SCHEDULER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#endif
+
+namespace tooltip {
+
+// Who is waiting for a capture, highest priority first
+enum class CapturePriority {
+  // A user is looking at the page: TooltipService::CaptureElementScreenshot
+  kInteractive,
+  // Work started by the user but not waited on, e.g. a Scraper run with
+  // take_screenshots
+  kBackground,
+  // Crawls such as WebsiteExplorer
+  kBatch,
+};
+
+const size_t kCapturePriorityCount = 3;
+
+// Runs screenshot captures on a fixed set of capture threads, choosing the
+// next one by priority so that a background crawl cannot delay the tooltip
+// a user is waiting on.
+//
+// - A free capture thread takes the oldest task of the highest priority
+//   that has work and is below its running limit.
+//   |max_running[kBatch]| below |capture_threads| keeps threads free for
+//   interactive captures.
+// - Running captures are not interrupted. Long batch tasks, such as a
+//   full-page tile loop, poll ShouldYield() between steps and resubmit the
+//   rest.
+// - Lower classes are not starved: after |starvation_limit| tasks have
+//   passed a waiting class, its oldest task goes next.
+// - Each class has a queue limit; Submit() rejects tasks beyond it, which
+//   is how crawlers learn to slow down.
+//
+// Thread-safe. Destruction waits for running captures and drops queued
+// ones unrun.
+class ScreenshotCaptureScheduler {
+ public:
+  using Task = std::function<void()>;
+  using TaskId = uint64_t;
+
+  struct Policy {
+    Policy();
+
+    size_t capture_threads = 2;
+    // Per CapturePriority; 0 means no limit
+    size_t max_running[kCapturePriorityCount] = {0, 0, 1};
+    size_t max_queued[kCapturePriorityCount] = {0, 256, 1024};
+    // Tasks allowed to start ahead of a waiting lower class; 0 disables
+    // the starvation guard
+    size_t starvation_limit = 16;
+  };
+
+  struct ClassStats {
+    uint64_t submitted = 0;
+    uint64_t rejected = 0;
+    uint64_t cancelled = 0;
+    uint64_t completed = 0;
+    size_t queued = 0;
+    size_t peak_queued = 0;
+    size_t running = 0;
+    // Time from Submit() to start, over completed and running tasks
+    std::chrono::microseconds total_wait{0};
+    std::chrono::microseconds max_wait{0};
+  };
+
+  // Returned by Submit() for rejected tasks
+  static constexpr TaskId kRejected = 0;
+
+  explicit ScreenshotCaptureScheduler(const Policy& policy);
+  ~ScreenshotCaptureScheduler();
+
+  // Queues |task| at |priority|. Returns an id for Cancel(), or kRejected
+  // if the class's queue is full.
+  TaskId Submit(CapturePriority priority, Task task);
+
+  // Removes a task that has not started. Returns false if it has started,
+  // finished or never existed.
+  bool Cancel(TaskId id);
+
+  // Whether a task at |priority| should stop early: work of a higher
+  // priority is waiting and no capture thread can take it
+  bool ShouldYield(CapturePriority priority) const;
+
+  ClassStats GetStats(CapturePriority priority) const;
+
+ private:
+  struct QueuedTask {
+    TaskId id;
+    Task task;
+    std::chrono::steady_clock::time_point submitted;
+  };
+
+  void Run();
+
+  // Whether class |index| has a task waiting and is below its running
+  // limit
+  bool CanStart(size_t index) const;
+
+  // Class of the task to start next, or -1 if nothing can start
+  int PickClass() const;
+
+  const Policy policy_;
+
+  mutable std::mutex lock_;
+  std::condition_variable work_available_;
+
+  std::deque<QueuedTask> queues_[kCapturePriorityCount];
+  ClassStats stats_[kCapturePriorityCount];
+  // Tasks started ahead of each class while it could have started one
+  size_t passed_over_[kCapturePriorityCount] = {};
+  size_t idle_threads_ = 0;
+  TaskId next_id_ = 1;
+  bool shutting_down_ = false;
+
+  std::vector<std::thread> threads_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScreenshotCaptureScheduler);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_CAPTURE_SCHEDULER_H_
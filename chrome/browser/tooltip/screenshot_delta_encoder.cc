@@ -0,0 +1,378 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "screenshot_delta_encoder.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#include "base/logging.h"
+#include "screenshot_parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TOOLTIP_DELTA_SSE2 1
+#endif
+
+namespace tooltip {
+
+namespace {
+
+const uint8_t kRecordVersion = 1;
+const size_t kRecordHeaderSize = 28;
+const size_t kStripHeaderSize = 16;
+
+const uint8_t kFlagKeyframe = 1;
+const uint8_t kFlagAlpha = 2;
+const uint8_t kFlagJpeg = 4;
+const uint8_t kFlagQoi = 8;
+
+// Comparing a strip is a fraction of the cost of encoding it, so only
+// split the comparison when there are enough strips to share
+const size_t kMinComparesPerThread = 4;
+
+void AppendUint32(std::vector<uint8_t>* output, uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    output->push_back(static_cast<uint8_t>(value >> shift));
+  }
+}
+
+uint32_t ReadUint32(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) |
+         static_cast<uint32_t>(data[1]) << 8 |
+         static_cast<uint32_t>(data[2]) << 16 |
+         static_cast<uint32_t>(data[3]) << 24;
+}
+
+size_t StripCount(int height, int strip_height) {
+  return static_cast<size_t>((height + strip_height - 1) / strip_height);
+}
+
+}  // namespace
+
+struct ScreenshotDeltaEncoder::PageState {
+  ScreenshotBitmap frame;
+  bool has_alpha = false;
+  std::vector<EncodedScreenshotStrip> strips;
+  std::list<std::string>::iterator lru_position;
+};
+
+ScreenshotDeltaEncoder::Options::Options() = default;
+
+ScreenshotDeltaEncoder::ScreenshotDeltaEncoder(const Options& options)
+    : options_(options) {
+  options_.encode.independent_strips = true;
+  options_.max_pages = std::max<size_t>(1, options_.max_pages);
+}
+
+ScreenshotDeltaEncoder::~ScreenshotDeltaEncoder() = default;
+
+// static
+bool ScreenshotDeltaEncoder::BlocksEqual(const uint8_t* a,
+                                         const uint8_t* b,
+                                         size_t size) {
+  size_t i = 0;
+#if defined(TOOLTIP_DELTA_SSE2)
+  // 64 bytes per iteration, with one branch on the AND of four compares
+  for (; i + 64 <= size; i += 64) {
+    __m128i equal = _mm_and_si128(
+        _mm_and_si128(
+            _mm_cmpeq_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i))),
+            _mm_cmpeq_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 16)),
+                _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(b + i + 16)))),
+        _mm_and_si128(
+            _mm_cmpeq_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 32)),
+                _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(b + i + 32))),
+            _mm_cmpeq_epi8(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i + 48)),
+                _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(b + i + 48)))));
+    if (_mm_movemask_epi8(equal) != 0xFFFF) {
+      return false;
+    }
+  }
+#endif  // defined(TOOLTIP_DELTA_SSE2)
+  return memcmp(a + i, b + i, size - i) == 0;
+}
+
+bool ScreenshotDeltaEncoder::EncodeFrame(const std::string& page_key,
+                                         ScreenshotBitmap frame,
+                                         std::vector<uint8_t>* image) {
+  image->clear();
+  int width = frame.width();
+  int height = frame.height();
+  std::vector<size_t> changed;
+  PageState* page = Update(page_key, std::move(frame), &changed);
+  return page && AssembleScreenshotStrips(width, height, options_.encode,
+                                          page->has_alpha, page->strips,
+                                          image);
+}
+
+bool ScreenshotDeltaEncoder::EncodeDelta(const std::string& page_key,
+                                         ScreenshotBitmap frame,
+                                         std::vector<uint8_t>* record) {
+  record->clear();
+  std::vector<size_t> changed;
+  PageState* page = Update(page_key, std::move(frame), &changed);
+  if (!page) {
+    return false;
+  }
+
+  uint8_t flags = 0;
+  if (last_frame_stats_.keyframe) {
+    flags |= kFlagKeyframe;
+  }
+  if (page->has_alpha) {
+    flags |= kFlagAlpha;
+  }
+  if (options_.encode.format == TiledEncodeOptions::Format::kJpeg) {
+    flags |= kFlagJpeg;
+  } else if (options_.encode.format == TiledEncodeOptions::Format::kQoi) {
+    flags |= kFlagQoi;
+  }
+
+  size_t size = kRecordHeaderSize;
+  for (size_t strip : changed) {
+    size += kStripHeaderSize + page->strips[strip].data.size();
+  }
+  record->reserve(size);
+  record->push_back('S');
+  record->push_back('D');
+  record->push_back(kRecordVersion);
+  record->push_back(flags);
+  record->push_back(static_cast<uint8_t>(
+      std::max(0, std::min(9, options_.encode.png_compression_level))));
+  record->insert(record->end(), 3, 0);
+  AppendUint32(record, static_cast<uint32_t>(page->frame.width()));
+  AppendUint32(record, static_cast<uint32_t>(page->frame.height()));
+  AppendUint32(record,
+               static_cast<uint32_t>(GetTiledStripHeight(options_.encode)));
+  AppendUint32(record, static_cast<uint32_t>(page->strips.size()));
+  AppendUint32(record, static_cast<uint32_t>(changed.size()));
+  for (size_t strip : changed) {
+    const EncodedScreenshotStrip& encoded = page->strips[strip];
+    AppendUint32(record, static_cast<uint32_t>(strip));
+    AppendUint32(record, encoded.adler);
+    AppendUint32(record, encoded.filtered_size);
+    AppendUint32(record, static_cast<uint32_t>(encoded.data.size()));
+    record->insert(record->end(), encoded.data.begin(), encoded.data.end());
+  }
+  DCHECK_EQ(size, record->size());
+  return true;
+}
+
+void ScreenshotDeltaEncoder::ForgetPage(const std::string& page_key) {
+  auto it = pages_.find(page_key);
+  if (it == pages_.end()) {
+    return;
+  }
+  lru_.erase(it->second->lru_position);
+  pages_.erase(it);
+}
+
+ScreenshotDeltaEncoder::PageState* ScreenshotDeltaEncoder::Update(
+    const std::string& page_key,
+    ScreenshotBitmap frame,
+    std::vector<size_t>* changed) {
+  last_frame_stats_ = FrameStats();
+  changed->clear();
+  if (frame.empty()) {
+    return nullptr;
+  }
+
+  const TiledEncodeOptions& encode = options_.encode;
+  int strip_height = GetTiledStripHeight(encode);
+  size_t strip_count = StripCount(frame.height(), strip_height);
+  size_t strip_bytes = strip_height * frame.stride();
+
+  PageState* page = nullptr;
+  auto it = pages_.find(page_key);
+  if (it != pages_.end()) {
+    page = it->second.get();
+    lru_.splice(lru_.begin(), lru_, page->lru_position);
+  } else {
+    std::unique_ptr<PageState> state(new PageState());
+    lru_.push_front(page_key);
+    state->lru_position = lru_.begin();
+    page = state.get();
+    pages_[page_key] = std::move(state);
+    while (pages_.size() > options_.max_pages) {
+      pages_.erase(lru_.back());
+      lru_.pop_back();
+    }
+  }
+
+  bool keyframe = page->frame.width() != frame.width() ||
+                  page->frame.height() != frame.height();
+  std::vector<uint8_t> dirty(strip_count, 1);
+  if (!keyframe) {
+    // Rows have no padding, so every strip is one contiguous block
+    ScreenshotParallelFor(
+        strip_count,
+        ResolveScreenshotThreadCount(encode.max_threads, strip_count,
+                                     kMinComparesPerThread),
+        [&](size_t strip) {
+          size_t offset = strip * strip_bytes;
+          size_t size = std::min(strip_bytes, frame.byte_size() - offset);
+          dirty[strip] = !BlocksEqual(frame.data() + offset,
+                                      page->frame.data() + offset, size);
+        });
+  }
+
+  // PNG strips of one file share a color type, and a QOI header announces
+  // the channel count, so alpha appearing in a changed strip of an opaque
+  // page re-encodes the whole frame
+  bool tracks_alpha = encode.format != TiledEncodeOptions::Format::kJpeg;
+  if (tracks_alpha && (keyframe || !page->has_alpha)) {
+    bool opaque = true;
+    for (size_t strip = 0; strip < strip_count && opaque; ++strip) {
+      int first_row = static_cast<int>(strip) * strip_height;
+      opaque = !dirty[strip] ||
+               IsScreenshotOpaque(
+                   frame, first_row,
+                   std::min(frame.height(), first_row + strip_height));
+    }
+    if (!opaque && !page->has_alpha) {
+      keyframe = true;
+    }
+    if (keyframe) {
+      page->has_alpha = !opaque;
+    }
+  }
+  if (keyframe) {
+    std::fill(dirty.begin(), dirty.end(), 1);
+    page->strips.clear();
+    page->strips.resize(strip_count);
+  }
+
+  for (size_t strip = 0; strip < strip_count; ++strip) {
+    if (dirty[strip]) {
+      changed->push_back(strip);
+    }
+  }
+
+  std::atomic<bool> ok(true);
+  ScreenshotParallelFor(
+      changed->size(),
+      ResolveScreenshotThreadCount(encode.max_threads, changed->size(), 1),
+      [&](size_t i) {
+        size_t strip = (*changed)[i];
+        if (!EncodeScreenshotStrip(frame, encode, strip, page->has_alpha,
+                                   &page->strips[strip])) {
+          ok.store(false);
+        }
+      });
+  if (!ok.load()) {
+    LOG(ERROR) << "Delta screenshot encoding failed";
+    ForgetPage(page_key);
+    return nullptr;
+  }
+
+  page->frame = std::move(frame);
+  last_frame_stats_.keyframe = keyframe;
+  last_frame_stats_.strip_count = strip_count;
+  last_frame_stats_.strips_encoded = changed->size();
+  VLOG(2) << "Screenshot of " << page_key << ": re-encoded "
+          << changed->size() << " of " << strip_count << " strips";
+  return page;
+}
+
+ScreenshotDeltaReader::ScreenshotDeltaReader() = default;
+
+ScreenshotDeltaReader::~ScreenshotDeltaReader() = default;
+
+bool ScreenshotDeltaReader::Apply(const uint8_t* record,
+                                  size_t size,
+                                  std::vector<uint8_t>* image) {
+  image->clear();
+  if (size < kRecordHeaderSize || record[0] != 'S' || record[1] != 'D' ||
+      record[2] != kRecordVersion) {
+    has_keyframe_ = false;
+    return false;
+  }
+
+  uint8_t flags = record[3];
+  int width = static_cast<int>(ReadUint32(record + 8));
+  int height = static_cast<int>(ReadUint32(record + 12));
+  int strip_height = static_cast<int>(ReadUint32(record + 16));
+  size_t strip_count = ReadUint32(record + 20);
+  size_t changed_count = ReadUint32(record + 24);
+  bool keyframe = flags & kFlagKeyframe;
+  bool has_alpha = flags & kFlagAlpha;
+  TiledEncodeOptions::Format format = TiledEncodeOptions::Format::kPng;
+  if (flags & kFlagJpeg) {
+    format = TiledEncodeOptions::Format::kJpeg;
+  } else if (flags & kFlagQoi) {
+    format = TiledEncodeOptions::Format::kQoi;
+  }
+
+  bool valid = width > 0 && height > 0 && strip_height > 0 &&
+               record[4] <= 9 &&
+               strip_count == StripCount(height, strip_height) &&
+               changed_count <= strip_count;
+  if (valid && keyframe) {
+    valid = changed_count == strip_count;
+  } else if (valid) {
+    valid = has_keyframe_ && width == width_ && height == height_ &&
+            strip_height == options_.strip_height &&
+            format == options_.format && has_alpha == has_alpha_;
+  }
+  if (!valid) {
+    has_keyframe_ = false;
+    return false;
+  }
+
+  if (keyframe) {
+    width_ = width;
+    height_ = height;
+    has_alpha_ = has_alpha;
+    options_ = TiledEncodeOptions();
+    options_.format = format;
+    options_.strip_height = strip_height;
+    options_.png_compression_level = record[4];
+    options_.independent_strips = true;
+    strips_.clear();
+    strips_.resize(strip_count);
+  }
+
+  size_t offset = kRecordHeaderSize;
+  size_t next_index = 0;
+  for (size_t i = 0; i < changed_count; ++i) {
+    if (size - offset < kStripHeaderSize) {
+      has_keyframe_ = false;
+      return false;
+    }
+    size_t index = ReadUint32(record + offset);
+    size_t data_size = ReadUint32(record + offset + 12);
+    if (index < next_index || index >= strip_count ||
+        size - offset - kStripHeaderSize < data_size) {
+      has_keyframe_ = false;
+      return false;
+    }
+    EncodedScreenshotStrip& strip = strips_[index];
+    strip.adler = ReadUint32(record + offset + 4);
+    strip.filtered_size = ReadUint32(record + offset + 8);
+    const uint8_t* data = record + offset + kStripHeaderSize;
+    strip.data.assign(data, data + data_size);
+    offset += kStripHeaderSize + data_size;
+    next_index = index + 1;
+  }
+
+  has_keyframe_ = offset == size && AssembleScreenshotStrips(
+                                        width_, height_, options_, has_alpha_,
+                                        strips_, image);
+  return has_keyframe_;
+}
+
+}  // namespace tooltip
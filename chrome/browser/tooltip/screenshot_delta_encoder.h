@@ -0,0 +1,137 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_DELTA_ENCODER_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_DELTA_ENCODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/tiled_screenshot_encoder.h"
+
+namespace tooltip {
+
+// Encodes successive full-page captures of the same pages, re-encoding only
+// the strips whose pixels changed since the page's previous capture.
+// Exploration runs capture after every click, and a click usually changes
+// a dropdown's worth of rows, so most strips come from the cache.
+//
+// The last frame and the encoded strips of up to |max_pages| pages are
+// kept, least recently captured dropped first. A page's first capture, or
+// one whose size changed, is a keyframe that encodes every strip.
+//
+// A frame comes out either as a complete PNG, JPEG or QOI, byte-identical to
+// EncodeScreenshotTiled() with |independent_strips| set, or as a delta
+// record holding only the changed strips, which ScreenshotDeltaReader turns
+// back into complete files.
+//
+// Delta record, little-endian:
+//   0   'S' 'D'
+//   2   uint8  version
+//   3   uint8  flags: 1 keyframe, 2 alpha, 4 JPEG, 8 QOI
+//   4   uint8  PNG compression level
+//   5   3 bytes reserved, zero
+//   8   uint32 width, uint32 height, uint32 strip height
+//   20  uint32 strip count, uint32 changed strip count
+//   28  per changed strip, by increasing index: uint32 index,
+//       uint32 Adler-32, uint32 filtered size, uint32 data size, data
+class ScreenshotDeltaEncoder {
+ public:
+  struct Options {
+    Options();
+
+    // |independent_strips| is always set
+    TiledEncodeOptions encode;
+    // Each page costs one frame of pixels plus its encoding
+    size_t max_pages = 4;
+  };
+
+  struct FrameStats {
+    bool keyframe = false;
+    size_t strip_count = 0;
+    size_t strips_encoded = 0;
+  };
+
+  explicit ScreenshotDeltaEncoder(const Options& options);
+  ~ScreenshotDeltaEncoder();
+
+  // Replaces |image| with |frame|, the latest capture of |page_key|, as a
+  // complete file and keeps |frame| for the next comparison
+  bool EncodeFrame(const std::string& page_key,
+                   ScreenshotBitmap frame,
+                   std::vector<uint8_t>* image);
+
+  // Replaces |record| with the strips of |frame| that differ from the
+  // previous capture of |page_key|
+  bool EncodeDelta(const std::string& page_key,
+                   ScreenshotBitmap frame,
+                   std::vector<uint8_t>* record);
+
+  // Drops the kept frame of |page_key|, e.g. when its tab navigates away
+  void ForgetPage(const std::string& page_key);
+
+  size_t page_count() const { return pages_.size(); }
+  const FrameStats& last_frame_stats() const { return last_frame_stats_; }
+
+  // Whether the |size| bytes at |a| and |b| are equal. SSE2 where
+  // available; exposed for benchmarks.
+  static bool BlocksEqual(const uint8_t* a, const uint8_t* b, size_t size);
+
+ private:
+  struct PageState;
+
+  // Encodes the strips of |frame| that changed and stores |frame| as the
+  // page's previous capture. Returns the page, with the changed strip
+  // indices in |changed|, or null on failure.
+  PageState* Update(const std::string& page_key,
+                    ScreenshotBitmap frame,
+                    std::vector<size_t>* changed);
+
+  Options options_;
+  FrameStats last_frame_stats_;
+
+  // Most recently captured first
+  std::list<std::string> lru_;
+  std::unordered_map<std::string, std::unique_ptr<PageState>> pages_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScreenshotDeltaEncoder);
+};
+
+// Rebuilds complete files from the delta records of one page, in order
+class ScreenshotDeltaReader {
+ public:
+  ScreenshotDeltaReader();
+  ~ScreenshotDeltaReader();
+
+  // Applies |record| and replaces |image| with the frame it completes.
+  // Returns false, leaving the reader waiting for a keyframe, if the record
+  // is malformed or does not follow the frames applied so far.
+  bool Apply(const uint8_t* record, size_t size, std::vector<uint8_t>* image);
+
+ private:
+  bool has_keyframe_ = false;
+  int width_ = 0;
+  int height_ = 0;
+  bool has_alpha_ = false;
+  TiledEncodeOptions options_;
+  std::vector<EncodedScreenshotStrip> strips_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScreenshotDeltaReader);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_DELTA_ENCODER_H_
@@ -0,0 +1,393 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "screenshot_downscaler.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "base/logging.h"
+#include "screenshot_parallel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TOOLTIP_DOWNSCALE_SSE2 1
+#endif
+
+namespace tooltip {
+
+namespace {
+
+// The resize is separable: each destination row is a weighted sum of source
+// rows, kept with kIntermediateBits of fraction, and each destination pixel
+// a weighted sum of pixels of that row. Weights are fixed point and sum to
+// exactly kWeightOne per destination pixel. The scalar and SSE2 loops do
+// the same integer arithmetic and must stay in lockstep.
+const int kWeightBits = 14;
+const int kWeightOne = 1 << kWeightBits;
+const int kIntermediateBits = 7;
+const int kBytesPerPixel = ScreenshotBitmap::kBytesPerPixel;
+
+// Destination rows per task, so that each task reuses one row buffer
+const int kRowsPerTask = 16;
+
+// Weights of the source pixels along one axis for every destination pixel.
+// Every destination pixel has the same, even, number of taps; the padding
+// taps have zero weight.
+struct AxisFilter {
+  int taps = 0;
+  // First source pixel of each destination pixel
+  std::vector<int> first;
+  // |taps| weights per destination pixel
+  std::vector<int16_t> weights;
+  // The weights in pairs, each pair packed into an int32 as SSE2's madd
+  // takes them
+  std::vector<int32_t> weight_pairs;
+};
+
+AxisFilter BuildAxisFilter(int source_size, int dest_size) {
+  DCHECK_LE(dest_size, source_size);
+  // Measured in units where a source pixel is |dest_size| long and a
+  // destination pixel |source_size| long
+  AxisFilter filter;
+  filter.first.resize(dest_size);
+  int max_taps = 1;
+  for (int i = 0; i < dest_size; ++i) {
+    int64_t begin = static_cast<int64_t>(i) * source_size;
+    int64_t end = begin + source_size;
+    filter.first[i] = static_cast<int>(begin / dest_size);
+    int last = static_cast<int>((end - 1) / dest_size);
+    max_taps = std::max(max_taps, last - filter.first[i] + 1);
+  }
+  filter.taps = (max_taps + 1) & ~1;
+
+  filter.weights.assign(static_cast<size_t>(dest_size) * filter.taps, 0);
+  for (int i = 0; i < dest_size; ++i) {
+    int64_t begin = static_cast<int64_t>(i) * source_size;
+    int64_t end = begin + source_size;
+    int16_t* weights = &filter.weights[static_cast<size_t>(i) * filter.taps];
+    int sum = 0;
+    int largest = 0;
+    for (int tap = 0; tap < filter.taps; ++tap) {
+      int64_t pixel_begin =
+          static_cast<int64_t>(filter.first[i] + tap) * dest_size;
+      int64_t overlap = std::min(end, pixel_begin + dest_size) -
+                        std::max(begin, pixel_begin);
+      if (overlap <= 0) {
+        continue;
+      }
+      weights[tap] = static_cast<int16_t>(
+          (overlap * kWeightOne + source_size / 2) / source_size);
+      sum += weights[tap];
+      if (weights[tap] > weights[largest]) {
+        largest = tap;
+      }
+    }
+    // Rounding leftovers go to the largest weight, so flat areas stay flat
+    weights[largest] = static_cast<int16_t>(weights[largest] + kWeightOne -
+                                            sum);
+  }
+
+  filter.weight_pairs.resize(filter.weights.size() / 2);
+  for (size_t pair = 0; pair < filter.weight_pairs.size(); ++pair) {
+    filter.weight_pairs[pair] = static_cast<int32_t>(
+        static_cast<uint32_t>(static_cast<uint16_t>(
+            filter.weights[2 * pair + 1]))
+            << 16 |
+        static_cast<uint16_t>(filter.weights[2 * pair]));
+  }
+  return filter;
+}
+
+struct Frame {
+  const uint8_t* source;
+  int source_width;
+  int source_height;
+  size_t source_stride;
+  uint8_t* dest;
+  int dest_width;
+  int dest_height;
+  size_t dest_stride;
+};
+
+const uint8_t* SourceRow(const Frame& frame, int y) {
+  // Padding taps may point past the last row; their weight is zero
+  return frame.source +
+         std::min(y, frame.source_height - 1) * frame.source_stride;
+}
+
+uint8_t FinishPixel(int32_t sum) {
+  int value = (sum + (1 << (kWeightBits + kIntermediateBits - 1))) >>
+              (kWeightBits + kIntermediateBits);
+  return static_cast<uint8_t>(std::min(255, std::max(0, value)));
+}
+
+void VerticalPassScalar(const Frame& frame,
+                        const AxisFilter& rows,
+                        int dest_y,
+                        std::vector<int32_t>* sums,
+                        int16_t* out) {
+  size_t row_bytes = static_cast<size_t>(frame.source_width) * kBytesPerPixel;
+  sums->assign(row_bytes, 0);
+  const int16_t* weights = &rows.weights[dest_y * rows.taps];
+  for (int tap = 0; tap < rows.taps; ++tap) {
+    if (!weights[tap]) {
+      continue;
+    }
+    const uint8_t* row = SourceRow(frame, rows.first[dest_y] + tap);
+    for (size_t i = 0; i < row_bytes; ++i) {
+      (*sums)[i] += weights[tap] * row[i];
+    }
+  }
+  for (size_t i = 0; i < row_bytes; ++i) {
+    out[i] = static_cast<int16_t>(((*sums)[i] + (1 << (kIntermediateBits - 1)))
+                                  >> kIntermediateBits);
+  }
+}
+
+void HorizontalPassScalar(const Frame& frame,
+                          const AxisFilter& columns,
+                          const int16_t* row,
+                          uint8_t* out) {
+  for (int x = 0; x < frame.dest_width; ++x) {
+    const int16_t* weights = &columns.weights[x * columns.taps];
+    const int16_t* pixel = row + columns.first[x] * kBytesPerPixel;
+    int32_t sums[kBytesPerPixel] = {};
+    for (int tap = 0; tap < columns.taps; ++tap) {
+      for (int channel = 0; channel < kBytesPerPixel; ++channel) {
+        sums[channel] += weights[tap] * pixel[tap * kBytesPerPixel + channel];
+      }
+    }
+    for (int channel = 0; channel < kBytesPerPixel; ++channel) {
+      out[x * kBytesPerPixel + channel] = FinishPixel(sums[channel]);
+    }
+  }
+}
+
+#if defined(TOOLTIP_DOWNSCALE_SSE2)
+
+// 16 bytes of two rows at a time: interleaving the rows' 16-bit values
+// lets one madd apply both rows' weights
+void VerticalPassSSE2(const Frame& frame,
+                      const AxisFilter& rows,
+                      int dest_y,
+                      std::vector<int32_t>* sums,
+                      int16_t* out) {
+  size_t row_bytes = static_cast<size_t>(frame.source_width) * kBytesPerPixel;
+  size_t vector_bytes = row_bytes & ~static_cast<size_t>(15);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i round = _mm_set1_epi32(1 << (kIntermediateBits - 1));
+  const int32_t* pairs = &rows.weight_pairs[dest_y * rows.taps / 2];
+  int first = rows.first[dest_y];
+
+  for (size_t i = 0; i < vector_bytes; i += 16) {
+    __m128i sum0 = zero;
+    __m128i sum1 = zero;
+    __m128i sum2 = zero;
+    __m128i sum3 = zero;
+    for (int pair = 0; pair < rows.taps / 2; ++pair) {
+      __m128i weights = _mm_set1_epi32(pairs[pair]);
+      __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+          SourceRow(frame, first + 2 * pair) + i));
+      __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+          SourceRow(frame, first + 2 * pair + 1) + i));
+      __m128i a_low = _mm_unpacklo_epi8(a, zero);
+      __m128i a_high = _mm_unpackhi_epi8(a, zero);
+      __m128i b_low = _mm_unpacklo_epi8(b, zero);
+      __m128i b_high = _mm_unpackhi_epi8(b, zero);
+      sum0 = _mm_add_epi32(
+          sum0, _mm_madd_epi16(_mm_unpacklo_epi16(a_low, b_low), weights));
+      sum1 = _mm_add_epi32(
+          sum1, _mm_madd_epi16(_mm_unpackhi_epi16(a_low, b_low), weights));
+      sum2 = _mm_add_epi32(
+          sum2, _mm_madd_epi16(_mm_unpacklo_epi16(a_high, b_high), weights));
+      sum3 = _mm_add_epi32(
+          sum3, _mm_madd_epi16(_mm_unpackhi_epi16(a_high, b_high), weights));
+    }
+    sum0 = _mm_srai_epi32(_mm_add_epi32(sum0, round), kIntermediateBits);
+    sum1 = _mm_srai_epi32(_mm_add_epi32(sum1, round), kIntermediateBits);
+    sum2 = _mm_srai_epi32(_mm_add_epi32(sum2, round), kIntermediateBits);
+    sum3 = _mm_srai_epi32(_mm_add_epi32(sum3, round), kIntermediateBits);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_packs_epi32(sum0, sum1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 8),
+                     _mm_packs_epi32(sum2, sum3));
+  }
+
+  // The last few bytes of the row
+  const int16_t* weights = &rows.weights[dest_y * rows.taps];
+  for (size_t i = vector_bytes; i < row_bytes; ++i) {
+    int32_t sum = 0;
+    for (int tap = 0; tap < rows.taps; ++tap) {
+      sum += weights[tap] * SourceRow(frame, first + tap)[i];
+    }
+    out[i] = static_cast<int16_t>((sum + (1 << (kIntermediateBits - 1))) >>
+                                  kIntermediateBits);
+  }
+  (void)sums;
+}
+
+// One destination pixel at a time, two source pixels per madd
+void HorizontalPassSSE2(const Frame& frame,
+                        const AxisFilter& columns,
+                        const int16_t* row,
+                        uint8_t* out) {
+  const __m128i round =
+      _mm_set1_epi32(1 << (kWeightBits + kIntermediateBits - 1));
+  for (int x = 0; x < frame.dest_width; ++x) {
+    const int32_t* pairs = &columns.weight_pairs[x * columns.taps / 2];
+    const int16_t* pixel = row + columns.first[x] * kBytesPerPixel;
+    __m128i sum = _mm_setzero_si128();
+    for (int pair = 0; pair < columns.taps / 2; ++pair) {
+      __m128i a = _mm_loadl_epi64(
+          reinterpret_cast<const __m128i*>(pixel + 2 * pair * kBytesPerPixel));
+      __m128i b = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(
+          pixel + (2 * pair + 1) * kBytesPerPixel));
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(a, b),
+                                              _mm_set1_epi32(pairs[pair])));
+    }
+    sum = _mm_srai_epi32(_mm_add_epi32(sum, round),
+                         kWeightBits + kIntermediateBits);
+    __m128i packed = _mm_packs_epi32(sum, sum);
+    int32_t value = _mm_cvtsi128_si32(_mm_packus_epi16(packed, packed));
+    memcpy(out + x * kBytesPerPixel, &value, kBytesPerPixel);
+  }
+}
+
+#endif  // defined(TOOLTIP_DOWNSCALE_SSE2)
+
+typedef void (*VerticalPass)(const Frame&,
+                             const AxisFilter&,
+                             int,
+                             std::vector<int32_t>*,
+                             int16_t*);
+typedef void (*HorizontalPass)(const Frame&,
+                               const AxisFilter&,
+                               const int16_t*,
+                               uint8_t*);
+
+void Downscale(const Frame& frame,
+               size_t max_threads,
+               VerticalPass vertical_pass,
+               HorizontalPass horizontal_pass) {
+  if (frame.source_width <= 0 || frame.source_height <= 0 ||
+      frame.dest_width <= 0 || frame.dest_height <= 0) {
+    return;
+  }
+  DCHECK_LE(frame.dest_width, frame.source_width);
+  DCHECK_LE(frame.dest_height, frame.source_height);
+
+  AxisFilter rows = BuildAxisFilter(frame.source_height, frame.dest_height);
+  AxisFilter columns = BuildAxisFilter(frame.source_width, frame.dest_width);
+
+  size_t tasks = (frame.dest_height + kRowsPerTask - 1) / kRowsPerTask;
+  ScreenshotParallelFor(
+      tasks, ResolveScreenshotThreadCount(max_threads, tasks, 1),
+      [&](size_t task) {
+        // Padding taps may reach past the last pixel; their weight is zero
+        std::vector<int16_t> row(
+            static_cast<size_t>(frame.source_width + columns.taps) *
+                kBytesPerPixel,
+            0);
+        std::vector<int32_t> sums;
+        int first_row = static_cast<int>(task) * kRowsPerTask;
+        int end_row = std::min(frame.dest_height, first_row + kRowsPerTask);
+        for (int y = first_row; y < end_row; ++y) {
+          vertical_pass(frame, rows, y, &sums, row.data());
+          horizontal_pass(frame, columns, row.data(),
+                          frame.dest + y * frame.dest_stride);
+        }
+      });
+}
+
+}  // namespace
+
+gfx::Size GetDownscaledSize(int width, int height, int max_edge) {
+  int longest_edge = std::max(width, height);
+  if (max_edge <= 0 || longest_edge <= max_edge) {
+    return gfx::Size(width, height);
+  }
+  return gfx::Size(
+      std::max(1, static_cast<int>(static_cast<int64_t>(width) * max_edge /
+                                   longest_edge)),
+      std::max(1, static_cast<int>(static_cast<int64_t>(height) * max_edge /
+                                   longest_edge)));
+}
+
+void DownscalePixels(const uint8_t* source,
+                     int source_width,
+                     int source_height,
+                     size_t source_stride,
+                     uint8_t* dest,
+                     int dest_width,
+                     int dest_height,
+                     size_t dest_stride,
+                     size_t max_threads) {
+  internal::DownscalePixelsSSE2(source, source_width, source_height,
+                                source_stride, dest, dest_width, dest_height,
+                                dest_stride, max_threads);
+}
+
+ScreenshotBitmap DownscaleScreenshot(const ScreenshotBitmap& bitmap,
+                                     int max_edge) {
+  gfx::Size size = GetDownscaledSize(bitmap.width(), bitmap.height(),
+                                     max_edge);
+  if (size.width() == bitmap.width() && size.height() == bitmap.height()) {
+    return bitmap.Clone();
+  }
+  ScreenshotBitmap scaled(size.width(), size.height());
+  DownscalePixels(bitmap.data(), bitmap.width(), bitmap.height(),
+                  bitmap.stride(), scaled.data(), scaled.width(),
+                  scaled.height(), scaled.stride(), 0);
+  return scaled;
+}
+
+namespace internal {
+
+void DownscalePixelsScalar(const uint8_t* source,
+                           int source_width,
+                           int source_height,
+                           size_t source_stride,
+                           uint8_t* dest,
+                           int dest_width,
+                           int dest_height,
+                           size_t dest_stride,
+                           size_t max_threads) {
+  Frame frame = {source,     source_width, source_height, source_stride,
+                 dest,       dest_width,   dest_height,   dest_stride};
+  Downscale(frame, max_threads, &VerticalPassScalar, &HorizontalPassScalar);
+}
+
+void DownscalePixelsSSE2(const uint8_t* source,
+                         int source_width,
+                         int source_height,
+                         size_t source_stride,
+                         uint8_t* dest,
+                         int dest_width,
+                         int dest_height,
+                         size_t dest_stride,
+                         size_t max_threads) {
+  Frame frame = {source,     source_width, source_height, source_stride,
+                 dest,       dest_width,   dest_height,   dest_stride};
+#if defined(TOOLTIP_DOWNSCALE_SSE2)
+  Downscale(frame, max_threads, &VerticalPassSSE2, &HorizontalPassSSE2);
+#else
+  Downscale(frame, max_threads, &VerticalPassScalar, &HorizontalPassScalar);
+#endif
+}
+
+bool HasSSE2Downscale() {
+#if defined(TOOLTIP_DOWNSCALE_SSE2)
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace internal
+
+}  // namespace tooltip
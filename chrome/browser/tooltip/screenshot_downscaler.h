@@ -0,0 +1,77 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_DOWNSCALER_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_DOWNSCALER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "ui/gfx/geometry/size.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+
+namespace tooltip {
+
+// Size of a |width| x |height| image scaled down so that its longest edge is
+// at most |max_edge|, keeping the aspect ratio. Sizes that already fit, and
+// a |max_edge| <= 0, are returned unchanged.
+gfx::Size GetDownscaledSize(int width, int height, int max_edge);
+
+// Resizes 4-byte pixels by area averaging: every destination pixel is the
+// mean of the source area it covers, weighted by partial coverage at its
+// edges. Channels are averaged independently, so any channel order works;
+// premultiplied alpha stays premultiplied. The destination must be no
+// larger than the source in either dimension. Rows are split across up to
+// |max_threads| threads, 0 meaning one per core. Uses SSE2 where available;
+// every implementation writes the same bytes.
+void DownscalePixels(const uint8_t* source,
+                     int source_width,
+                     int source_height,
+                     size_t source_stride,
+                     uint8_t* dest,
+                     int dest_width,
+                     int dest_height,
+                     size_t dest_stride,
+                     size_t max_threads);
+
+// |bitmap| scaled down so that its longest edge is at most |max_edge|, as
+// TooltipPrefs::GetMaxScreenshotSize() requires before a screenshot is
+// encoded or uploaded. A bitmap that already fits is cloned.
+ScreenshotBitmap DownscaleScreenshot(const ScreenshotBitmap& bitmap,
+                                     int max_edge);
+
+namespace internal {
+
+// Individual implementations, exposed for benchmarks and consistency
+// checks. DownscalePixelsSSE2() falls back to the scalar loops on builds
+// without SSE2.
+void DownscalePixelsScalar(const uint8_t* source,
+                           int source_width,
+                           int source_height,
+                           size_t source_stride,
+                           uint8_t* dest,
+                           int dest_width,
+                           int dest_height,
+                           size_t dest_stride,
+                           size_t max_threads);
+void DownscalePixelsSSE2(const uint8_t* source,
+                         int source_width,
+                         int source_height,
+                         size_t source_stride,
+                         uint8_t* dest,
+                         int dest_width,
+                         int dest_height,
+                         size_t dest_stride,
+                         size_t max_threads);
+bool HasSSE2Downscale();
+
+}  // namespace internal
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_DOWNSCALER_H_
@@ -0,0 +1,257 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "screenshot_jpeg_budget.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "base/logging.h"
+
+namespace tooltip {
+
+namespace {
+
+// JPEG size at quality 0, 5, ..., 100 relative to quality 75, measured with
+// this encoder's settings on full-page captures. Text-only and photo-heavy
+// pages stay within 10% of it between qualities 30 and 90.
+const double kSizeCurve[] = {
+    0.15,  0.221, 0.296, 0.367, 0.436, 0.504, 0.564,
+    0.616, 0.659, 0.700, 0.737, 0.775, 0.820, 0.873,
+    0.934, 1.0,   1.100, 1.236, 1.449, 1.880, 3.055,
+};
+const int kCurveStep = 5;
+const int kCurvePoints = sizeof(kSizeCurve) / sizeof(kSizeCurve[0]);
+const int kReferenceQuality = 75;
+
+// Bytes per pixel at the reference quality of a typical page, for frames
+// too short to probe
+const double kDefaultScale = 0.4;
+
+// Bounds on the fitted exponent, so that two close encodes cannot send the
+// next guess to an extreme
+const double kMinExponent = 0.5;
+const double kMaxExponent = 2.0;
+
+// 4:2:0 MCU height, so that sampled rows split no DCT block
+const int kProbeRowHeight = 16;
+
+double CurveAt(int quality) {
+  quality = std::max(0, std::min(100, quality));
+  int index = quality / kCurveStep;
+  if (index >= kCurvePoints - 1) {
+    return kSizeCurve[kCurvePoints - 1];
+  }
+  double fraction = static_cast<double>(quality - index * kCurveStep) /
+                    kCurveStep;
+  // Interpolated in log space, where the curve is nearly straight
+  return std::exp(std::log(kSizeCurve[index]) +
+                  fraction * (std::log(kSizeCurve[index + 1]) -
+                              std::log(kSizeCurve[index])));
+}
+
+double PredictBytes(const JpegSizeModel& model, double pixels, int quality) {
+  return model.scale * pixels * std::pow(CurveAt(quality), model.exponent);
+}
+
+// Highest quality in [low, high] that |model| expects to fit |bytes|, or
+// |low| if none does
+int PickQuality(const JpegSizeModel& model,
+                double pixels,
+                double bytes,
+                int low,
+                int high) {
+  for (int quality = high; quality > low; --quality) {
+    if (PredictBytes(model, pixels, quality) <= bytes) {
+      return quality;
+    }
+  }
+  return low;
+}
+
+// One MCU row in every |interval| of |bitmap|, stacked; empty if that is
+// fewer than two rows
+ScreenshotBitmap SampleMcuRows(const ScreenshotBitmap& bitmap, int interval) {
+  int mcu_rows = bitmap.height() / kProbeRowHeight;
+  int sampled = (mcu_rows + interval - 1) / interval;
+  if (interval <= 1 || sampled < 2) {
+    return ScreenshotBitmap();
+  }
+  ScreenshotBitmap sample(bitmap.width(), sampled * kProbeRowHeight);
+  size_t band_bytes = kProbeRowHeight * bitmap.stride();
+  for (int i = 0; i < sampled; ++i) {
+    memcpy(sample.row(i * kProbeRowHeight),
+           bitmap.row(i * interval * kProbeRowHeight), band_bytes);
+  }
+  return sample;
+}
+
+}  // namespace
+
+JpegBudgetOptions::JpegBudgetOptions() = default;
+
+bool EncodeJpegToBudget(const ScreenshotBitmap& bitmap,
+                        const JpegBudgetOptions& options,
+                        const JpegSizeModel* seed,
+                        std::vector<uint8_t>* output,
+                        JpegBudgetResult* result,
+                        JpegSizeModel* learned) {
+  *result = JpegBudgetResult();
+  output->clear();
+  if (bitmap.empty() || !options.target_bytes) {
+    return false;
+  }
+
+  TiledEncodeOptions encode = options.encode;
+  encode.format = TiledEncodeOptions::Format::kJpeg;
+  double pixels = static_cast<double>(bitmap.width()) * bitmap.height();
+
+  JpegSizeModel model;
+  model.scale = kDefaultScale;
+  if (seed && seed->scale > 0) {
+    model = *seed;
+    result->from_history = true;
+  } else if (options.probe_interval > 0) {
+    ScreenshotBitmap sample = SampleMcuRows(bitmap, options.probe_interval);
+    if (!sample.empty()) {
+      std::vector<uint8_t> probe;
+      encode.jpeg_quality = kReferenceQuality;
+      if (!EncodeScreenshotTiled(sample, encode, &probe)) {
+        return false;
+      }
+      model.scale = probe.size() /
+                    (static_cast<double>(sample.width()) * sample.height());
+      result->probed = true;
+    }
+  }
+
+  double target = static_cast<double>(options.target_bytes);
+  // Aim for the middle of the accepted window, so that a model a few
+  // percent off still lands inside it
+  double aim = target * (1 - options.slack / 2);
+  double floor = target * (1 - options.slack);
+  int low = std::max(1, std::min(100, options.min_quality));
+  int high = std::max(low, std::min(100, options.max_quality));
+  int max_encodes = std::max(1, options.max_encodes);
+
+  std::vector<uint8_t> attempt;
+  int last_quality = 0;
+  size_t last_bytes = 0;
+  while (low <= high && result->encodes < max_encodes) {
+    // Without a fit so far, the last encode goes to the lowest quality
+    // left so that the caller gets the smallest output there is
+    int quality = !result->fits && result->encodes == max_encodes - 1
+                      ? low
+                      : PickQuality(model, pixels, aim, low, high);
+    encode.jpeg_quality = quality;
+    if (!EncodeScreenshotTiled(bitmap, encode, &attempt)) {
+      output->clear();
+      return false;
+    }
+    ++result->encodes;
+    size_t bytes = attempt.size();
+    VLOG(2) << "JPEG quality " << quality << ": " << bytes << " bytes for "
+            << options.target_bytes;
+
+    // Refit the slope on the last two encodes, then the scale on this one
+    if (last_quality && last_bytes && bytes &&
+        CurveAt(last_quality) != CurveAt(quality)) {
+      double exponent =
+          std::log(static_cast<double>(bytes) / last_bytes) /
+          std::log(CurveAt(quality) / CurveAt(last_quality));
+      model.exponent = std::max(kMinExponent, std::min(kMaxExponent, exponent));
+    }
+    model.scale = bytes / (pixels * std::pow(CurveAt(quality), model.exponent));
+    last_quality = quality;
+    last_bytes = bytes;
+
+    if (bytes <= options.target_bytes) {
+      // Every guess lies above the last fit, so this is the best so far
+      output->swap(attempt);
+      result->quality = quality;
+      result->bytes = bytes;
+      result->fits = true;
+      if (bytes >= floor) {
+        break;
+      }
+      low = quality + 1;
+    } else {
+      if (!result->fits) {
+        // Qualities only fall until something fits: the smallest yet
+        output->swap(attempt);
+        result->quality = quality;
+        result->bytes = bytes;
+      }
+      high = quality - 1;
+    }
+  }
+  DCHECK(!output->empty());
+  if (learned) {
+    *learned = model;
+  }
+  return true;
+}
+
+JpegQualityTuner::JpegQualityTuner(size_t max_pages)
+    : max_pages_(std::max<size_t>(1, max_pages)) {}
+
+JpegQualityTuner::~JpegQualityTuner() = default;
+
+bool JpegQualityTuner::Encode(const std::string& page_key,
+                              const ScreenshotBitmap& bitmap,
+                              const JpegBudgetOptions& options,
+                              std::vector<uint8_t>* output,
+                              JpegBudgetResult* result) {
+  JpegSizeModel seed;
+  {
+    std::lock_guard<std::mutex> hold(lock_);
+    auto it = pages_.find(page_key);
+    if (it != pages_.end()) {
+      seed = it->second.model;
+    }
+  }
+
+  JpegSizeModel learned;
+  if (!EncodeJpegToBudget(bitmap, options, &seed, output, result,
+                          &learned)) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> hold(lock_);
+  auto it = pages_.find(page_key);
+  if (it != pages_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+    it->second.model = learned;
+    return true;
+  }
+  lru_.push_front(page_key);
+  PageModel& page = pages_[page_key];
+  page.model = learned;
+  page.lru_position = lru_.begin();
+  while (pages_.size() > max_pages_) {
+    pages_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  return true;
+}
+
+void JpegQualityTuner::ForgetPage(const std::string& page_key) {
+  std::lock_guard<std::mutex> hold(lock_);
+  auto it = pages_.find(page_key);
+  if (it == pages_.end()) {
+    return;
+  }
+  lru_.erase(it->second.lru_position);
+  pages_.erase(it);
+}
+
+size_t JpegQualityTuner::page_count() const {
+  std::lock_guard<std::mutex> hold(lock_);
+  return pages_.size();
+}
+
+}  // namespace tooltip
@@ -0,0 +1,124 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_JPEG_BUDGET_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_JPEG_BUDGET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/tiled_screenshot_encoder.h"
+
+namespace tooltip {
+
+// Encodes a screenshot as JPEG at the highest quality whose output fits a
+// byte budget, so that uploads to AI providers and stored captures have a
+// predictable size.
+//
+// JPEG size follows nearly the same curve over quality for most page
+// content; pages differ mainly in scale. The search models a page's size
+// as scale * pixels * curve(quality)^exponent and calibrates the model on
+// every encode:
+// - The first guess comes from the page's previous result, or else from
+//   encoding a sample of one MCU row in every |probe_interval|.
+// - Later guesses refit the model to the last two encodes and stay inside
+//   the bracket of qualities known to fit and known to overflow, so the
+//   search ends like a binary search even when the model is off.
+// Most pages take one full encode with history and two without.
+struct JpegBudgetOptions {
+  JpegBudgetOptions();
+
+  // |format| and |jpeg_quality| are ignored
+  TiledEncodeOptions encode;
+  size_t target_bytes = 0;
+  // Outputs of at least |target_bytes| * (1 - |slack|) are accepted
+  // without trying a higher quality
+  double slack = 0.1;
+  int min_quality = 20;
+  int max_quality = 95;
+  // Full encodes, not counting the probe
+  int max_encodes = 5;
+  // One MCU row in this many is encoded by the probe; 0 disables the
+  // probe. Frames shorter than two sampled rows are not probed.
+  int probe_interval = 8;
+};
+
+struct JpegBudgetResult {
+  int quality = 0;
+  size_t bytes = 0;
+  // Whether |bytes| <= |target_bytes|. When even |min_quality| does not
+  // fit, the output is the smallest encode and the caller should downscale.
+  bool fits = false;
+  int encodes = 0;
+  bool probed = false;
+  bool from_history = false;
+};
+
+// What a search learned about a page, kept to seed the next capture
+struct JpegSizeModel {
+  // Bytes per pixel where the reference curve is 1, i.e. at quality 75
+  double scale = 0;
+  double exponent = 1;
+};
+
+// Replaces |output| with |bitmap| encoded as JPEG within
+// |options.target_bytes|. |seed|, if not null, replaces the probe.
+// |learned|, if not null, receives the model calibrated on the last encode.
+// Returns false for an empty bitmap, a zero target or an encoder failure.
+bool EncodeJpegToBudget(const ScreenshotBitmap& bitmap,
+                        const JpegBudgetOptions& options,
+                        const JpegSizeModel* seed,
+                        std::vector<uint8_t>* output,
+                        JpegBudgetResult* result,
+                        JpegSizeModel* learned);
+
+// EncodeJpegToBudget() with the size models of up to |max_pages| pages
+// kept, least recently encoded dropped first. Thread-safe; encodes run
+// outside the lock.
+class JpegQualityTuner {
+ public:
+  explicit JpegQualityTuner(size_t max_pages);
+  ~JpegQualityTuner();
+
+  bool Encode(const std::string& page_key,
+              const ScreenshotBitmap& bitmap,
+              const JpegBudgetOptions& options,
+              std::vector<uint8_t>* output,
+              JpegBudgetResult* result);
+
+  void ForgetPage(const std::string& page_key);
+
+  size_t page_count() const;
+
+ private:
+  struct PageModel {
+    JpegSizeModel model;
+    std::list<std::string>::iterator lru_position;
+  };
+
+  const size_t max_pages_;
+
+  mutable std::mutex lock_;
+  // Most recently encoded first
+  std::list<std::string> lru_;
+  std::unordered_map<std::string, PageModel> pages_;
+
+  DISALLOW_COPY_AND_ASSIGN(JpegQualityTuner);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_JPEG_BUDGET_H_
@@ -0,0 +1,99 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_PARALLEL_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_PARALLEL_H_
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include <thread>
+#include <vector>
+#else
+#include "base/barrier_closure.h"
+#include "base/bind.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/system/sys_info.h"
+#include "base/task/thread_pool.h"
+#endif
+
+namespace tooltip {
+
+// Worker count for |task_count| tasks of which each thread should get at
+// least |min_tasks_per_thread|. |max_threads| of 0 means one per core.
+inline size_t ResolveScreenshotThreadCount(size_t max_threads,
+                                           size_t task_count,
+                                           size_t min_tasks_per_thread) {
+  size_t threads = max_threads;
+  if (threads == 0) {
+#ifdef STANDALONE_TOOLTIP_BUILD
+    threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+#else
+    threads = std::max(1, base::SysInfo::NumberOfProcessors());
+#endif
+  }
+  return std::max<size_t>(
+      1, std::min(threads, task_count / std::max<size_t>(
+                                             1, min_tasks_per_thread)));
+}
+
+// Runs |task|(i) for every i below |count| on up to |thread_count| threads,
+// including the calling one, and returns when all calls have finished.
+// The other workers are ThreadPool tasks. Waiting for them blocks, so call
+// this from a sequence that allows it (base::MayBlock() and
+// base::WithBaseSyncPrimitives()), never from the UI thread with a
+// |thread_count| above 1. Standalone builds use short-lived threads.
+template <typename Task>
+void ScreenshotParallelFor(size_t count,
+                           size_t thread_count,
+                           const Task& task) {
+  std::atomic<size_t> next(0);
+  auto worker = [&] {
+    for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+      task(i);
+    }
+  };
+
+  size_t helper_count = std::max<size_t>(1, std::min(thread_count, count)) - 1;
+#ifdef STANDALONE_TOOLTIP_BUILD
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < helper_count; ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+#else
+  if (helper_count == 0) {
+    worker();
+    return;
+  }
+
+  base::WaitableEvent helpers_done;
+  base::RepeatingClosure on_helper_done = base::BarrierClosure(
+      helper_count, base::BindOnce(&base::WaitableEvent::Signal,
+                                   base::Unretained(&helpers_done)));
+  for (size_t i = 0; i < helper_count; ++i) {
+    base::ThreadPool::PostTask(
+        FROM_HERE, {base::TaskPriority::USER_VISIBLE},
+        base::BindOnce(
+            [](const decltype(worker)* worker, base::OnceClosure on_done) {
+              (*worker)();
+              std::move(on_done).Run();
+            },
+            base::Unretained(&worker), on_helper_done));
+  }
+  worker();
+  helpers_done.Wait();
+#endif
+}
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_PARALLEL_H_
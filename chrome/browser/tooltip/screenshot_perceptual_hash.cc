@@ -0,0 +1,221 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "screenshot_perceptual_hash.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <bitset>
+#include <utility>
+
+#include "base/logging.h"
+
+namespace tooltip {
+
+namespace {
+
+const int kDifferenceColumns = 9;
+const int kDifferenceRows = 8;
+// Brightness steps below this many 1/256 luma units count as flat, so that
+// noise and re-encoding do not flip the bits of plain backgrounds
+const uint32_t kDifferenceDeadZone = 3 * 256;
+const int kDctSize = 32;
+const int kDctKept = 8;
+
+// Mean luma of each cell of a |columns| x |rows| grid laid over |bitmap|,
+// in 1/256 steps. Cells narrower than a pixel take the pixel they start in.
+void ComputeLumaGrid(const ScreenshotBitmap& bitmap,
+                     int columns,
+                     int rows,
+                     uint32_t* grid) {
+  const int width = bitmap.width();
+  const int height = bitmap.height();
+  std::vector<int> column_start(columns + 1);
+  for (int x = 0; x <= columns; ++x) {
+    column_start[x] = static_cast<int>(static_cast<int64_t>(x) * width /
+                                       columns);
+  }
+
+  std::vector<uint64_t> sums(columns);
+  for (int cell_y = 0; cell_y < rows; ++cell_y) {
+    int y0 = static_cast<int>(static_cast<int64_t>(cell_y) * height / rows);
+    int y1 = std::max(
+        y0 + 1,
+        static_cast<int>(static_cast<int64_t>(cell_y + 1) * height / rows));
+    std::fill(sums.begin(), sums.end(), 0);
+    for (int y = y0; y < y1; ++y) {
+      const uint8_t* row = bitmap.row(y);
+      for (int cell_x = 0; cell_x < columns; ++cell_x) {
+        int x0 = column_start[cell_x];
+        int x1 = std::max(x0 + 1, column_start[cell_x + 1]);
+        uint32_t sum = 0;
+        for (const uint8_t* pixel = row + x0 * 4; pixel < row + x1 * 4;
+             pixel += 4) {
+          // BT.601 luma weights scaled to 256
+          sum += 77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2];
+        }
+        sums[cell_x] += sum;
+      }
+    }
+    for (int cell_x = 0; cell_x < columns; ++cell_x) {
+      int x0 = column_start[cell_x];
+      int x1 = std::max(x0 + 1, column_start[cell_x + 1]);
+      uint64_t count = static_cast<uint64_t>(x1 - x0) * (y1 - y0);
+      grid[cell_y * columns + cell_x] =
+          static_cast<uint32_t>((sums[cell_x] + count / 2) / count);
+    }
+  }
+}
+
+// cos((2x + 1) u pi / 64) for the kept frequencies u
+struct DctTable {
+  DctTable() {
+    const double kPi = 3.14159265358979323846;
+    for (int u = 0; u < kDctKept; ++u) {
+      for (int x = 0; x < kDctSize; ++x) {
+        cosines[u][x] = cos((2 * x + 1) * u * kPi / (2 * kDctSize));
+      }
+    }
+  }
+
+  double cosines[kDctKept][kDctSize];
+};
+
+}  // namespace
+
+int PerceptualHash::DistanceTo(const PerceptualHash& other) const {
+  return static_cast<int>(std::bitset<64>(value ^ other.value).count());
+}
+
+std::string PerceptualHash::ToString() const {
+  static const char kHexDigits[] = "0123456789abcdef";
+  std::string hex(16, '0');
+  for (int i = 0; i < 16; ++i) {
+    hex[15 - i] = kHexDigits[(value >> (4 * i)) & 0xF];
+  }
+  return hex;
+}
+
+PerceptualHash ComputeDifferenceHash(const ScreenshotBitmap& bitmap) {
+  PerceptualHash hash;
+  if (bitmap.empty()) {
+    return hash;
+  }
+  uint32_t grid[kDifferenceRows * kDifferenceColumns];
+  ComputeLumaGrid(bitmap, kDifferenceColumns, kDifferenceRows, grid);
+  int bit = 0;
+  for (int y = 0; y < kDifferenceRows; ++y) {
+    const uint32_t* row = grid + y * kDifferenceColumns;
+    for (int x = 0; x + 1 < kDifferenceColumns; ++x, ++bit) {
+      if (row[x] + kDifferenceDeadZone < row[x + 1]) {
+        hash.value |= uint64_t{1} << bit;
+      }
+    }
+  }
+  return hash;
+}
+
+PerceptualHash ComputeDctHash(const ScreenshotBitmap& bitmap) {
+  PerceptualHash hash;
+  if (bitmap.empty()) {
+    return hash;
+  }
+  static const DctTable table;
+  uint32_t grid[kDctSize * kDctSize];
+  ComputeLumaGrid(bitmap, kDctSize, kDctSize, grid);
+
+  // Rows, then columns, only for the kept frequencies
+  double rows[kDctSize][kDctKept];
+  for (int y = 0; y < kDctSize; ++y) {
+    for (int u = 0; u < kDctKept; ++u) {
+      double sum = 0;
+      for (int x = 0; x < kDctSize; ++x) {
+        sum += grid[y * kDctSize + x] * table.cosines[u][x];
+      }
+      rows[y][u] = sum;
+    }
+  }
+  // Rounded to whole luma steps so that flat areas give exact zeros rather
+  // than rounding noise, and the bits do not depend on the platform's cos()
+  int64_t coefficients[kDctKept * kDctKept];
+  for (int v = 0; v < kDctKept; ++v) {
+    for (int u = 0; u < kDctKept; ++u) {
+      double sum = 0;
+      for (int y = 0; y < kDctSize; ++y) {
+        sum += rows[y][u] * table.cosines[v][y];
+      }
+      coefficients[v * kDctKept + u] = llround(sum / 256);
+    }
+  }
+
+  // Median of the AC coefficients; the DC term only measures brightness
+  int64_t ac[kDctKept * kDctKept - 1];
+  std::copy(coefficients + 1, coefficients + kDctKept * kDctKept, ac);
+  const size_t kMiddle = (kDctKept * kDctKept - 1) / 2;
+  std::nth_element(ac, ac + kMiddle, ac + kDctKept * kDctKept - 1);
+  int64_t median = ac[kMiddle];
+  for (int i = 0; i < kDctKept * kDctKept; ++i) {
+    if (coefficients[i] > median) {
+      hash.value |= uint64_t{1} << i;
+    }
+  }
+  return hash;
+}
+
+PerceptualHashIndex::PerceptualHashIndex() = default;
+
+PerceptualHashIndex::~PerceptualHashIndex() = default;
+
+void PerceptualHashIndex::Add(PerceptualHash hash, uint64_t id) {
+  size_t index = entries_.size();
+  entries_.push_back({hash, id});
+  for (int band = 0; band < kBands; ++band) {
+    bands_[band].emplace(static_cast<uint16_t>(hash.value >> (16 * band)),
+                         index);
+  }
+}
+
+std::vector<uint64_t> PerceptualHashIndex::Find(PerceptualHash hash,
+                                                int max_distance) const {
+  // (distance, entry index) of the matches
+  std::vector<std::pair<int, size_t>> matches;
+  auto consider = [&](size_t index) {
+    int distance = entries_[index].hash.DistanceTo(hash);
+    if (distance <= max_distance) {
+      matches.emplace_back(distance, index);
+    }
+  };
+
+  if (max_distance <= kMaxIndexedDistance) {
+    std::vector<size_t> candidates;
+    for (int band = 0; band < kBands; ++band) {
+      auto range = bands_[band].equal_range(
+          static_cast<uint16_t>(hash.value >> (16 * band)));
+      for (auto it = range.first; it != range.second; ++it) {
+        candidates.push_back(it->second);
+      }
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()),
+                     candidates.end());
+    for (size_t index : candidates) {
+      consider(index);
+    }
+  } else {
+    for (size_t index = 0; index < entries_.size(); ++index) {
+      consider(index);
+    }
+  }
+
+  std::sort(matches.begin(), matches.end());
+  std::vector<uint64_t> ids;
+  ids.reserve(matches.size());
+  for (const auto& match : matches) {
+    ids.push_back(entries_[match.second].id);
+  }
+  return ids;
+}
+
+}  // namespace tooltip
@@ -0,0 +1,98 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_PERCEPTUAL_HASH_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_PERCEPTUAL_HASH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+
+namespace tooltip {
+
+// 64-bit hash of what a screenshot looks like. Screenshots that look alike
+// get hashes a small Hamming distance apart: re-encoding, slight scaling
+// and small colour shifts move few bits, different content moves about
+// half. Like ElementFingerprint the value depends only on the pixels, so
+// it can be persisted.
+struct PerceptualHash {
+  uint64_t value = 0;
+
+  bool operator==(const PerceptualHash& other) const {
+    return value == other.value;
+  }
+  bool operator!=(const PerceptualHash& other) const {
+    return value != other.value;
+  }
+
+  // Number of differing bits, 0 to 64
+  int DistanceTo(const PerceptualHash& other) const;
+
+  // 16 lowercase hex digits
+  std::string ToString() const;
+};
+
+// dHash: whether brightness rises from left to right between neighbouring
+// cells of a 9x8 grid of area averages, ignoring steps of under 3 luma
+// levels. One pass over the pixels; cheap enough to compute for every
+// capture. Alpha is ignored.
+PerceptualHash ComputeDifferenceHash(const ScreenshotBitmap& bitmap);
+
+// pHash: signs of the lowest 8x8 DCT frequencies of a 32x32 grayscale
+// thumbnail, against their median. Costs about three times the dHash but
+// spreads different content further apart, which suits keys for reuse of
+// AI descriptions. Alpha is ignored.
+PerceptualHash ComputeDctHash(const ScreenshotBitmap& bitmap);
+
+// Finds stored hashes within a small distance of a query, for
+// deduplicating element screenshots and looking up AI descriptions of
+// visually equal elements. Each hash is split into four 16-bit bands and
+// indexed by each band; two hashes at most 3 bits apart share a band, so
+// candidates come from four map lookups rather than a scan.
+//
+// Not thread-safe.
+class PerceptualHashIndex {
+ public:
+  // Largest distance Find() answers from the band maps; larger ones scan
+  static constexpr int kMaxIndexedDistance = 3;
+
+  PerceptualHashIndex();
+  ~PerceptualHashIndex();
+
+  // Adds |hash| for |id|. An id may be added under several hashes.
+  void Add(PerceptualHash hash, uint64_t id);
+
+  // Ids of every entry within |max_distance| of |hash|, nearest first
+  std::vector<uint64_t> Find(PerceptualHash hash, int max_distance) const;
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    PerceptualHash hash;
+    uint64_t id;
+  };
+
+  static constexpr int kBands = 4;
+
+  std::vector<Entry> entries_;
+  // Entry indices by band value, one map per band
+  std::unordered_multimap<uint16_t, size_t> bands_[kBands];
+
+  DISALLOW_COPY_AND_ASSIGN(PerceptualHashIndex);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_PERCEPTUAL_HASH_H_
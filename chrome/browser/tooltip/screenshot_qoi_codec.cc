@@ -0,0 +1,317 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "screenshot_qoi_codec.h"
+
+#include <string.h>
+
+#include <memory>
+#include <utility>
+
+#include "base/logging.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TOOLTIP_QOI_SSE2 1
+#endif
+
+namespace tooltip {
+
+namespace {
+
+const uint8_t kOpIndex = 0x00;
+const uint8_t kOpDiff = 0x40;
+const uint8_t kOpLuma = 0x80;
+const uint8_t kOpRun = 0xC0;
+const uint8_t kOpRgb = 0xFE;
+const uint8_t kOpRgba = 0xFF;
+const uint8_t kOpMask = 0xC0;
+const int kMaxRun = 62;
+// The longest chunk, QOI_OP_RGBA
+const size_t kMaxChunkSize = 5;
+const uint8_t kEndMarker[] = {0, 0, 0, 0, 0, 0, 0, 1};
+// The reference decoder's limit, which keeps width * height * 4 in range
+const uint64_t kMaxPixels = 400000000;
+
+// Pixels are handled as the four RGBA bytes loaded into one word
+inline uint32_t LoadPixel(const uint8_t* pixel) {
+  uint32_t value;
+  memcpy(&value, pixel, sizeof(value));
+  return value;
+}
+
+inline void StorePixel(uint32_t value, uint8_t* pixel) {
+  memcpy(pixel, &value, sizeof(value));
+}
+
+inline uint8_t Channel(uint32_t pixel, int channel) {
+  uint8_t bytes[4];
+  StorePixel(pixel, bytes);
+  return bytes[channel];
+}
+
+inline int Hash(const uint8_t* rgba) {
+  return (rgba[0] * 3 + rgba[1] * 5 + rgba[2] * 7 + rgba[3] * 11) % 64;
+}
+
+inline int Hash(uint32_t pixel) {
+  uint8_t bytes[4];
+  StorePixel(pixel, bytes);
+  return Hash(bytes);
+}
+
+// Number of pixels from |pixel| up to |end| equal to |value|. Page
+// captures are mostly flat, so most of the frame goes through here.
+size_t CountRepeats(const uint8_t* pixel, const uint8_t* end, uint32_t value) {
+  const uint8_t* start = pixel;
+#if defined(TOOLTIP_QOI_SSE2)
+  __m128i repeated = _mm_set1_epi32(static_cast<int>(value));
+  for (; end - pixel >= 16; pixel += 16) {
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixel)), repeated));
+    if (mask != 0xFFFF) {
+      break;
+    }
+  }
+#endif  // defined(TOOLTIP_QOI_SSE2)
+  for (; pixel < end && LoadPixel(pixel) == value; pixel += 4) {
+  }
+  return static_cast<size_t>(pixel - start) / 4;
+}
+
+// What a QOI decoder holds between chunks, as far as the encoder knows it.
+// Strips after the first cannot know the index entries left by the rows
+// above, so only entries written within the strip are used.
+struct QoiEncoderState {
+  uint32_t index[64];
+  uint64_t known = 0;
+  uint32_t previous = 0;
+
+  void Remember(uint32_t pixel) {
+    int slot = Hash(pixel);
+    index[slot] = pixel;
+    known |= uint64_t{1} << slot;
+  }
+};
+
+}  // namespace
+
+void EncodeQoiRows(const ScreenshotBitmap& bitmap,
+                   int first_row,
+                   int end_row,
+                   bool independent,
+                   std::vector<uint8_t>* output) {
+  DCHECK_LE(0, first_row);
+  DCHECK_LE(end_row, bitmap.height());
+  if (first_row >= end_row) {
+    return;
+  }
+
+  QoiEncoderState state;
+  const uint8_t kInitialPixel[] = {0, 0, 0, 0xFF};
+  bool full_first_pixel = false;
+  if (first_row == 0) {
+    // The decoder's initial state: a zeroed index and opaque black
+    memset(state.index, 0, sizeof(state.index));
+    state.known = ~uint64_t{0};
+    state.previous = LoadPixel(kInitialPixel);
+  } else if (independent) {
+    full_first_pixel = true;
+  } else {
+    state.previous = LoadPixel(bitmap.row(first_row - 1) +
+                               (bitmap.width() - 1) *
+                                   ScreenshotBitmap::kBytesPerPixel);
+  }
+
+  // Written through a raw pointer into a worst-case buffer that is never
+  // cleared; only the pages actually written get touched
+  size_t pixel_count = static_cast<size_t>(end_row - first_row) *
+                       bitmap.width();
+  std::unique_ptr<uint8_t[]> buffer(
+      new uint8_t[pixel_count * kMaxChunkSize]);
+  uint8_t* out = buffer.get();
+  int run = 0;
+
+  // Rows are contiguous, so the strip is one run of pixels
+  const uint8_t* pixel = bitmap.row(first_row);
+  const uint8_t* end = pixel + pixel_count * ScreenshotBitmap::kBytesPerPixel;
+  for (; pixel < end; pixel += ScreenshotBitmap::kBytesPerPixel) {
+    uint32_t current = LoadPixel(pixel);
+    if (current == state.previous && !full_first_pixel) {
+      // Whole runs are emitted at once; the remainder may still grow
+      size_t repeats = run + CountRepeats(pixel, end, current);
+      pixel += (repeats - run - 1) * ScreenshotBitmap::kBytesPerPixel;
+      if (repeats >= static_cast<size_t>(kMaxRun)) {
+        size_t full_runs = repeats / kMaxRun;
+        memset(out, kOpRun | (kMaxRun - 1), full_runs);
+        out += full_runs;
+        state.Remember(current);
+      }
+      run = static_cast<int>(repeats % kMaxRun);
+      continue;
+    }
+    if (run > 0) {
+      *out++ = static_cast<uint8_t>(kOpRun | (run - 1));
+      run = 0;
+      state.Remember(state.previous);
+    }
+
+    int slot = Hash(pixel);
+    uint8_t alpha = pixel[3];
+    if (full_first_pixel) {
+      *out++ = kOpRgba;
+      memcpy(out, pixel, 4);
+      out += 4;
+      full_first_pixel = false;
+    } else if ((state.known >> slot & 1) && state.index[slot] == current) {
+      *out++ = static_cast<uint8_t>(kOpIndex | slot);
+    } else if (alpha == Channel(state.previous, 3)) {
+      uint8_t previous[4];
+      StorePixel(state.previous, previous);
+      int8_t dr = static_cast<int8_t>(pixel[0] - previous[0]);
+      int8_t dg = static_cast<int8_t>(pixel[1] - previous[1]);
+      int8_t db = static_cast<int8_t>(pixel[2] - previous[2]);
+      int8_t dr_dg = static_cast<int8_t>(dr - dg);
+      int8_t db_dg = static_cast<int8_t>(db - dg);
+      if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 &&
+          db <= 1) {
+        *out++ = static_cast<uint8_t>(kOpDiff | (dr + 2) << 4 |
+                                      (dg + 2) << 2 | (db + 2));
+      } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 &&
+                 db_dg >= -8 && db_dg <= 7) {
+        *out++ = static_cast<uint8_t>(kOpLuma | (dg + 32));
+        *out++ = static_cast<uint8_t>((dr_dg + 8) << 4 | (db_dg + 8));
+      } else {
+        *out++ = kOpRgb;
+        memcpy(out, pixel, 3);
+        out += 3;
+      }
+    } else {
+      *out++ = kOpRgba;
+      memcpy(out, pixel, 4);
+      out += 4;
+    }
+    state.Remember(current);
+    state.previous = current;
+  }
+  if (run > 0) {
+    *out++ = static_cast<uint8_t>(kOpRun | (run - 1));
+  }
+  output->insert(output->end(), buffer.get(), out);
+}
+
+void AppendQoiHeader(int width,
+                     int height,
+                     bool has_alpha,
+                     std::vector<uint8_t>* output) {
+  const uint8_t kMagic[] = {'q', 'o', 'i', 'f'};
+  output->insert(output->end(), kMagic, kMagic + sizeof(kMagic));
+  for (uint32_t value :
+       {static_cast<uint32_t>(width), static_cast<uint32_t>(height)}) {
+    output->push_back(static_cast<uint8_t>(value >> 24));
+    output->push_back(static_cast<uint8_t>(value >> 16));
+    output->push_back(static_cast<uint8_t>(value >> 8));
+    output->push_back(static_cast<uint8_t>(value));
+  }
+  output->push_back(has_alpha ? 4 : 3);
+  output->push_back(0);  // sRGB with linear alpha
+}
+
+void AppendQoiEndMarker(std::vector<uint8_t>* output) {
+  output->insert(output->end(), kEndMarker, kEndMarker + sizeof(kEndMarker));
+}
+
+bool DecodeQoiScreenshot(const uint8_t* data,
+                         size_t size,
+                         ScreenshotBitmap* bitmap) {
+  *bitmap = ScreenshotBitmap();
+  if (size < kQoiHeaderSize + sizeof(kEndMarker) ||
+      memcmp(data, "qoif", 4) != 0) {
+    return false;
+  }
+  auto read_uint32 = [](const uint8_t* bytes) {
+    return static_cast<uint32_t>(bytes[0]) << 24 |
+           static_cast<uint32_t>(bytes[1]) << 16 |
+           static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+  };
+  uint32_t width = read_uint32(data + 4);
+  uint32_t height = read_uint32(data + 8);
+  uint8_t channels = data[12];
+  if (width == 0 || height == 0 || (channels != 3 && channels != 4) ||
+      data[13] > 1 || static_cast<uint64_t>(width) * height > kMaxPixels) {
+    return false;
+  }
+
+  ScreenshotBitmap decoded(static_cast<int>(width), static_cast<int>(height));
+  uint32_t index[64] = {};
+  uint8_t pixel[4] = {0, 0, 0, 0xFF};
+  const uint8_t* in = data + kQoiHeaderSize;
+  // Chunks never extend into the end marker
+  const uint8_t* chunks_end = data + size - sizeof(kEndMarker);
+  uint8_t* out = decoded.data();
+  uint8_t* out_end = out + decoded.byte_size();
+  while (out < out_end) {
+    if (in >= chunks_end) {
+      return false;
+    }
+    uint8_t op = *in++;
+    int run = 1;
+    if (op == kOpRgb || op == kOpRgba) {
+      size_t channel_count = op == kOpRgb ? 3 : 4;
+      if (static_cast<size_t>(chunks_end - in) < channel_count) {
+        return false;
+      }
+      memcpy(pixel, in, channel_count);
+      in += channel_count;
+    } else {
+      switch (op & kOpMask) {
+        case kOpIndex:
+          StorePixel(index[op], pixel);
+          break;
+        case kOpDiff:
+          pixel[0] = static_cast<uint8_t>(pixel[0] + ((op >> 4) & 3) - 2);
+          pixel[1] = static_cast<uint8_t>(pixel[1] + ((op >> 2) & 3) - 2);
+          pixel[2] = static_cast<uint8_t>(pixel[2] + (op & 3) - 2);
+          break;
+        case kOpLuma: {
+          if (in >= chunks_end) {
+            return false;
+          }
+          uint8_t next = *in++;
+          int dg = (op & 0x3F) - 32;
+          pixel[0] = static_cast<uint8_t>(pixel[0] + dg - 8 + (next >> 4));
+          pixel[1] = static_cast<uint8_t>(pixel[1] + dg);
+          pixel[2] = static_cast<uint8_t>(pixel[2] + dg - 8 + (next & 0xF));
+          break;
+        }
+        case kOpRun:
+          run = (op & 0x3F) + 1;
+          break;
+      }
+    }
+    uint32_t value = LoadPixel(pixel);
+    index[Hash(pixel)] = value;
+    for (; run > 0 && out < out_end; --run) {
+      StorePixel(value, out);
+      out += ScreenshotBitmap::kBytesPerPixel;
+    }
+  }
+  *bitmap = std::move(decoded);
+  return true;
+}
+
+bool TranscodeQoiScreenshot(const std::vector<uint8_t>& qoi,
+                            const TiledEncodeOptions& options,
+                            std::vector<uint8_t>* output) {
+  output->clear();
+  ScreenshotBitmap bitmap;
+  if (!DecodeQoiScreenshot(qoi.data(), qoi.size(), &bitmap)) {
+    LOG(ERROR) << "Cannot decode intermediate screenshot";
+    return false;
+  }
+  return EncodeScreenshotTiled(bitmap, options, output);
+}
+
+}  // namespace tooltip
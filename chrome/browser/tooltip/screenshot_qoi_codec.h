@@ -0,0 +1,69 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_QOI_CODEC_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_QOI_CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/tiled_screenshot_encoder.h"
+
+namespace tooltip {
+
+// QOI ("Quite OK Image", qoiformat.org) is the lossless format for
+// screenshots that stay inside the browser: frames kept for diffing,
+// cropping or AI preprocessing. It costs a single pass with no entropy
+// coding, so it encodes several times faster than PNG at level 1, and
+// flat page areas collapse into runs. Screenshots are kept in QOI and
+// transcoded to PNG or JPEG only when they leave the process.
+//
+// Encoding goes through EncodeScreenshotTiled() with
+// TiledEncodeOptions::Format::kQoi; this file has the strip encoder it
+// uses, the decoder and the transcoder.
+
+// Size of the QOI file header
+const size_t kQoiHeaderSize = 14;
+
+// Appends the QOI chunks for rows [first_row, end_row) of |bitmap| to
+// |output|. A decoder that reaches |first_row| with the state left by the
+// rows above decodes them exactly, so strips encoded separately
+// concatenate into one stream. With |independent| the first pixel is
+// written in full, so the chunks do not depend on the pixel before the
+// strip either.
+void EncodeQoiRows(const ScreenshotBitmap& bitmap,
+                   int first_row,
+                   int end_row,
+                   bool independent,
+                   std::vector<uint8_t>* output);
+
+// Appends the header for a |width| x |height| image. |has_alpha| only sets
+// the channel count the header announces; the chunks always carry alpha.
+void AppendQoiHeader(int width,
+                     int height,
+                     bool has_alpha,
+                     std::vector<uint8_t>* output);
+
+// Appends the end-of-stream marker
+void AppendQoiEndMarker(std::vector<uint8_t>* output);
+
+// Decodes a QOI file of |size| bytes into |bitmap| as RGBA. Returns false
+// and leaves |bitmap| empty if the file is malformed or truncated.
+bool DecodeQoiScreenshot(const uint8_t* data,
+                         size_t size,
+                         ScreenshotBitmap* bitmap);
+
+// Replaces |output| with the QOI screenshot |qoi| re-encoded as described
+// by |options|, for when an intermediate screenshot has to leave the
+// process. Returns false if |qoi| does not decode or cannot be encoded.
+bool TranscodeQoiScreenshot(const std::vector<uint8_t>& qoi,
+                            const TiledEncodeOptions& options,
+                            std::vector<uint8_t>* output);
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_QOI_CODEC_H_
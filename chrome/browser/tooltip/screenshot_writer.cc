@@ -0,0 +1,245 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "screenshot_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <set>
+#include <utility>
+
+#include "base/logging.h"
+
+namespace tooltip {
+
+namespace {
+
+std::string DirectoryOf(const std::string& path) {
+  size_t slash = path.rfind('/');
+  if (slash == std::string::npos) {
+    return ".";
+  }
+  return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+// Writes |data| next to |path| and renames it into place. The file is
+// synced before the rename when |durable|, so the name never points at
+// unsynced data.
+bool WriteFileAtomically(const std::string& path,
+                         const std::vector<uint8_t>& data,
+                         bool durable) {
+  std::string temporary = path + ".tmp";
+  int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0644);
+  if (fd < 0) {
+    LOG(ERROR) << "Cannot create " << temporary << ": " << strerror(errno);
+    return false;
+  }
+  bool ok = WriteAll(fd, data.data(), data.size()) &&
+            (!durable || fdatasync(fd) == 0);
+  if (!ok) {
+    LOG(ERROR) << "Cannot write " << temporary << ": " << strerror(errno);
+  }
+  ok = close(fd) == 0 && ok;
+  if (ok && rename(temporary.c_str(), path.c_str()) != 0) {
+    LOG(ERROR) << "Cannot rename to " << path << ": " << strerror(errno);
+    ok = false;
+  }
+  if (!ok) {
+    unlink(temporary.c_str());
+  }
+  return ok;
+}
+
+bool SyncDirectory(const std::string& directory) {
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  bool ok = fsync(fd) == 0;
+  close(fd);
+  return ok;
+}
+
+}  // namespace
+
+ScreenshotWriter::ScreenshotWriter(const Options& options)
+    : options_(options), worker_(&ScreenshotWriter::Run, this) {}
+
+ScreenshotWriter::~ScreenshotWriter() {
+  {
+    std::lock_guard<std::mutex> hold(lock_);
+    shutting_down_ = true;
+  }
+  work_available_.notify_one();
+  worker_.join();
+  DCHECK(pending_.empty());
+}
+
+std::vector<uint8_t> ScreenshotWriter::AcquireBuffer() {
+  std::lock_guard<std::mutex> hold(lock_);
+  if (buffer_pool_.empty()) {
+    return std::vector<uint8_t>();
+  }
+  std::vector<uint8_t> buffer = std::move(buffer_pool_.back());
+  buffer_pool_.pop_back();
+  buffer.clear();
+  ++stats_.buffers_reused;
+  return buffer;
+}
+
+void ScreenshotWriter::Write(const std::string& path,
+                             std::vector<uint8_t> data,
+                             ScreenshotPersistence persistence) {
+  if (persistence == ScreenshotPersistence::kMemoryOnly) {
+    return;
+  }
+  bool durable = persistence == ScreenshotPersistence::kDurable;
+
+  std::unique_lock<std::mutex> hold(lock_);
+  // Backpressure: wait for room unless the queue is empty, so a single
+  // oversized screenshot still gets through
+  progress_.wait(hold, [this] {
+    return pending_.empty() || pending_bytes_ < options_.max_pending_bytes;
+  });
+  ++stats_.writes_queued;
+  ++queued_;
+  pending_bytes_ += data.size();
+
+  auto it = pending_by_path_.find(path);
+  if (it != pending_by_path_.end()) {
+    // Keep the queue position; only the latest bytes matter
+    PendingWrite& pending = *it->second;
+    pending_bytes_ -= pending.data.size();
+    pending.data.swap(data);
+    pending.durable = pending.durable || durable;
+    ++stats_.writes_coalesced;
+    if (buffer_pool_.size() < options_.max_pooled_buffers) {
+      buffer_pool_.push_back(std::move(data));
+    }
+  } else {
+    pending_.push_back(PendingWrite());
+    PendingWrite& pending = pending_.back();
+    pending.path = path;
+    pending.data = std::move(data);
+    pending.durable = durable;
+    pending_by_path_[path] = std::prev(pending_.end());
+  }
+  hold.unlock();
+  work_available_.notify_one();
+}
+
+bool ScreenshotWriter::Flush() {
+  std::unique_lock<std::mutex> hold(lock_);
+  uint64_t target = queued_;
+  ++flush_waiters_;
+  work_available_.notify_one();
+  progress_.wait(hold, [this, target] { return completed_ >= target; });
+  --flush_waiters_;
+  bool ok = !failed_since_flush_;
+  failed_since_flush_ = false;
+  return ok;
+}
+
+ScreenshotWriter::Stats ScreenshotWriter::GetStats() const {
+  std::lock_guard<std::mutex> hold(lock_);
+  return stats_;
+}
+
+void ScreenshotWriter::Run() {
+  std::unique_lock<std::mutex> hold(lock_);
+  while (true) {
+    work_available_.wait(
+        hold, [this] { return !pending_.empty() || shutting_down_; });
+    if (pending_.empty()) {
+      return;
+    }
+
+    // Give a burst of captures the chance to share one batch
+    work_available_.wait_for(
+        hold, std::chrono::milliseconds(options_.batch_delay_ms), [this] {
+          return shutting_down_ || flush_waiters_ > 0 ||
+                 pending_.size() >= options_.max_batch_files;
+        });
+
+    std::vector<PendingWrite> batch;
+    batch.reserve(pending_.size());
+    for (PendingWrite& pending : pending_) {
+      batch.push_back(std::move(pending));
+    }
+    pending_.clear();
+    pending_by_path_.clear();
+    pending_bytes_ = 0;
+    uint64_t batch_end = queued_;
+    // Room for blocked writers while this batch is on its way to disk
+    progress_.notify_all();
+
+    hold.unlock();
+    size_t files_synced = 0;
+    size_t errors = WriteBatch(&batch, &files_synced);
+    hold.lock();
+
+    stats_.files_written += batch.size() - errors;
+    stats_.files_synced += files_synced;
+    stats_.write_errors += errors;
+    ++stats_.batches;
+    failed_since_flush_ = failed_since_flush_ || errors > 0;
+    for (PendingWrite& written : batch) {
+      if (buffer_pool_.size() >= options_.max_pooled_buffers) {
+        break;
+      }
+      buffer_pool_.push_back(std::move(written.data));
+    }
+    completed_ = batch_end;
+    progress_.notify_all();
+  }
+}
+
+size_t ScreenshotWriter::WriteBatch(std::vector<PendingWrite>* batch,
+                                    size_t* files_synced) {
+  size_t errors = 0;
+  std::set<std::string> directories_to_sync;
+  for (const PendingWrite& pending : *batch) {
+    if (!WriteFileAtomically(pending.path, pending.data, pending.durable)) {
+      ++errors;
+      continue;
+    }
+    if (pending.durable) {
+      ++*files_synced;
+      directories_to_sync.insert(DirectoryOf(pending.path));
+    }
+  }
+
+  // One directory sync makes every rename into it durable
+  for (const std::string& directory : directories_to_sync) {
+    if (!SyncDirectory(directory)) {
+      LOG(ERROR) << "Cannot sync " << directory << ": " << strerror(errno);
+      ++errors;
+    }
+  }
+  VLOG(2) << "Wrote " << batch->size() << " screenshots, " << errors
+          << " errors";
+  return errors;
+}
+
+}  // namespace tooltip
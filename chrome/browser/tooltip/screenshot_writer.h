@@ -0,0 +1,145 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_SCREENSHOT_WRITER_H_
+#define CHROME_BROWSER_TOOLTIP_SCREENSHOT_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#endif
+
+namespace tooltip {
+
+// What happens to an encoded screenshot after capture. ScreenshotOptions
+// carries this in place of a bare |path|: the hover path only needs the
+// bytes, and only exploration runs that keep their screenshots pay for
+// the disk.
+enum class ScreenshotPersistence {
+  // Only |image_data| is returned; nothing touches the disk
+  kMemoryOnly,
+  // |image_data| is returned at once and a copy is queued on the
+  // ScreenshotWriter
+  kWriteBehind,
+  // As kWriteBehind, and the file is fsynced before it counts as written
+  kDurable,
+};
+
+// Writes encoded screenshots to disk on a background thread so that
+// capture latency does not depend on the disk.
+//
+// - Pending writes to the same path coalesce: only the latest bytes are
+//   written.
+// - Writes are taken in batches, waiting up to |batch_delay_ms| for more
+//   to arrive. Durable files in a batch are fsynced together, and each
+//   directory they were renamed into is fsynced once per batch.
+// - Every file is written to a temporary name and renamed into place, so
+//   readers never see a partial screenshot.
+// - Buffers of written screenshots are kept for AcquireBuffer(), so steady
+//   capture does not allocate.
+// - Queued bytes are bounded; Write() blocks while they exceed
+//   |max_pending_bytes|.
+//
+// Thread-safe. Destruction writes everything still queued.
+class ScreenshotWriter {
+ public:
+  struct Options {
+    // Longest wait for more writes before starting a batch
+    int batch_delay_ms = 20;
+    // A batch starts at once when this many files are queued
+    size_t max_batch_files = 32;
+    size_t max_pending_bytes = 64 * 1024 * 1024;
+    size_t max_pooled_buffers = 8;
+  };
+
+  struct Stats {
+    uint64_t writes_queued = 0;
+    // Writes replaced by a later write to the same path before reaching
+    // the disk
+    uint64_t writes_coalesced = 0;
+    uint64_t files_written = 0;
+    uint64_t files_synced = 0;
+    uint64_t batches = 0;
+    uint64_t write_errors = 0;
+    uint64_t buffers_reused = 0;
+  };
+
+  explicit ScreenshotWriter(const Options& options);
+  ~ScreenshotWriter();
+
+  // Empty buffer for encoding the next screenshot into, with the capacity
+  // of a previously written one when there is one
+  std::vector<uint8_t> AcquireBuffer();
+
+  // Queues |data| to be written to |path|, replacing any write to |path|
+  // that has not started yet
+  void Write(const std::string& path,
+             std::vector<uint8_t> data,
+             ScreenshotPersistence persistence);
+
+  // Blocks until every write queued before the call is on disk. Returns
+  // false if any write failed since the previous Flush().
+  bool Flush();
+
+  Stats GetStats() const;
+
+ private:
+  struct PendingWrite {
+    std::string path;
+    std::vector<uint8_t> data;
+    bool durable = false;
+  };
+
+  void Run();
+
+  // Writes |batch| without holding |lock_|. Returns the number of files
+  // that failed.
+  size_t WriteBatch(std::vector<PendingWrite>* batch,
+                    size_t* files_synced);
+
+  const Options options_;
+
+  mutable std::mutex lock_;
+  // Wakes the worker
+  std::condition_variable work_available_;
+  // Wakes Write() callers waiting for room and Flush() callers
+  std::condition_variable progress_;
+
+  std::list<PendingWrite> pending_;
+  std::unordered_map<std::string, std::list<PendingWrite>::iterator>
+      pending_by_path_;
+  size_t pending_bytes_ = 0;
+
+  // Writes are numbered as they are queued; |completed_| is the last one
+  // on disk
+  uint64_t queued_ = 0;
+  uint64_t completed_ = 0;
+  // Flush() callers waiting; batches start without waiting for more
+  int flush_waiters_ = 0;
+  bool failed_since_flush_ = false;
+  bool shutting_down_ = false;
+
+  std::vector<std::vector<uint8_t>> buffer_pool_;
+  Stats stats_;
+
+  std::thread worker_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScreenshotWriter);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_SCREENSHOT_WRITER_H_
@@ -0,0 +1,639 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "tiled_screenshot_encoder.h"
+
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+
+#include "base/logging.h"
+#include "screenshot_parallel.h"
+#include "screenshot_qoi_codec.h"
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include <zlib.h>
+extern "C" {
+#include <jpeglib.h>
+}
+#else
+#include "third_party/zlib/zlib.h"
+extern "C" {
+#include "third_party/libjpeg_turbo/jpeglib.h"
+}
+#endif
+
+namespace tooltip {
+
+namespace {
+
+// Strips below this many rows cost more in per-strip overhead (a sync
+// flush, a restart marker, thread hand-off) than they gain
+const int kMinStripHeight = 16;
+
+// deflate's window; each PNG strip is primed with this much of the
+// previous one so that splitting costs almost no compression
+const size_t kDeflateWindow = 32 * 1024;
+
+// 4:2:0 subsampling, which jpeg_set_defaults() selects, uses 16x16 MCUs
+const int kJpegMcuHeight = 16;
+const int kJpegMaxDimension = 65535;
+
+void AppendUint32BigEndian(std::vector<uint8_t>* output, uint32_t value) {
+  output->push_back(static_cast<uint8_t>(value >> 24));
+  output->push_back(static_cast<uint8_t>(value >> 16));
+  output->push_back(static_cast<uint8_t>(value >> 8));
+  output->push_back(static_cast<uint8_t>(value));
+}
+
+// Splits |height| rows into strips of |strip_height|; the last may be
+// shorter
+std::vector<int> PlanStrips(int height, int strip_height) {
+  std::vector<int> first_rows;
+  for (int row = 0; row < height; row += strip_height) {
+    first_rows.push_back(row);
+  }
+  return first_rows;
+}
+
+// PNG
+
+void AppendPngChunk(std::vector<uint8_t>* output,
+                    const char type[4],
+                    const uint8_t* data,
+                    size_t size) {
+  AppendUint32BigEndian(output, static_cast<uint32_t>(size));
+  size_t type_offset = output->size();
+  output->insert(output->end(), type, type + 4);
+  output->insert(output->end(), data, data + size);
+  uint32_t crc = crc32(0, output->data() + type_offset,
+                       static_cast<uInt>(size + 4));
+  AppendUint32BigEndian(output, crc);
+}
+
+// Copies row |y| with |channels| channels per pixel, dropping alpha for 3
+void ConvertRow(const ScreenshotBitmap& bitmap,
+                int y,
+                int channels,
+                uint8_t* out) {
+  const uint8_t* row = bitmap.row(y);
+  if (channels == ScreenshotBitmap::kBytesPerPixel) {
+    memcpy(out, row, bitmap.stride());
+    return;
+  }
+  for (int x = 0; x < bitmap.width(); ++x) {
+    memcpy(out + x * 3, row + x * ScreenshotBitmap::kBytesPerPixel, 3);
+  }
+}
+
+uint8_t PaethPredictor(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = std::abs(p - a);
+  int pb = std::abs(p - b);
+  int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return static_cast<uint8_t>(a);
+  }
+  return static_cast<uint8_t>(pb <= pc ? b : c);
+}
+
+// PNG's filter types; the first two do not look at the row above
+const int kPngFilterCount = 5;
+const int kPngRowLocalFilterCount = 2;
+
+// Writes the filter byte and filtered bytes of one row to |out|, picking
+// the filter with the smallest sum of absolute values as libpng does.
+// Only the first |filter_count| filter types are tried.
+void FilterRow(const uint8_t* row,
+               const uint8_t* previous,
+               size_t row_bytes,
+               int channels,
+               int filter_count,
+               std::vector<uint8_t>* candidates,
+               uint8_t* out) {
+  candidates->resize(filter_count * row_bytes);
+  uint64_t best_cost = UINT64_MAX;
+  int best_filter = 0;
+  for (int filter = 0; filter < filter_count; ++filter) {
+    uint8_t* filtered = candidates->data() + filter * row_bytes;
+    uint64_t cost = 0;
+    for (size_t i = 0; i < row_bytes; ++i) {
+      int left = i >= static_cast<size_t>(channels) ? row[i - channels] : 0;
+      int up = previous ? previous[i] : 0;
+      int up_left = (previous && i >= static_cast<size_t>(channels))
+                        ? previous[i - channels]
+                        : 0;
+      int predicted = 0;
+      switch (filter) {
+        case 1:
+          predicted = left;
+          break;
+        case 2:
+          predicted = up;
+          break;
+        case 3:
+          predicted = (left + up) / 2;
+          break;
+        case 4:
+          predicted = PaethPredictor(left, up, up_left);
+          break;
+      }
+      uint8_t value = static_cast<uint8_t>(row[i] - predicted);
+      filtered[i] = value;
+      cost += value < 128 ? value : 256 - value;
+    }
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_filter = filter;
+    }
+  }
+  out[0] = static_cast<uint8_t>(best_filter);
+  memcpy(out + 1, candidates->data() + best_filter * row_bytes, row_bytes);
+}
+
+// Filters rows [first_row, end_row). An independent strip filters its
+// first row without the row above, so it does not depend on other strips.
+void FilterStrip(const ScreenshotBitmap& bitmap,
+                 int first_row,
+                 int end_row,
+                 int channels,
+                 bool independent,
+                 std::vector<uint8_t>* filtered) {
+  size_t row_bytes = static_cast<size_t>(bitmap.width()) * channels;
+  std::vector<uint8_t> row(row_bytes);
+  std::vector<uint8_t> previous(row_bytes);
+  std::vector<uint8_t> candidates;
+  filtered->resize((end_row - first_row) * (row_bytes + 1));
+  bool has_previous = first_row > 0 && !independent;
+  if (has_previous) {
+    ConvertRow(bitmap, first_row - 1, channels, previous.data());
+  }
+  for (int y = first_row; y < end_row; ++y) {
+    // Row 0 may use every filter; PNG treats the row above it as zeros
+    bool row_local = y > 0 && y == first_row && !has_previous;
+    ConvertRow(bitmap, y, channels, row.data());
+    FilterRow(row.data(), y > 0 ? previous.data() : nullptr, row_bytes,
+              channels, row_local ? kPngRowLocalFilterCount : kPngFilterCount,
+              &candidates,
+              filtered->data() + (y - first_row) * (row_bytes + 1));
+    row.swap(previous);
+  }
+}
+
+// Raw deflate of one strip, ending on a sync flush so that the next
+// strip's stream can follow it byte-aligned. |dictionary| may be null.
+bool DeflateStrip(const std::vector<uint8_t>& filtered,
+                  const std::vector<uint8_t>* dictionary,
+                  int level,
+                  EncodedScreenshotStrip* strip) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+
+  if (dictionary && !dictionary->empty()) {
+    size_t dictionary_size = std::min(kDeflateWindow, dictionary->size());
+    deflateSetDictionary(
+        &stream, dictionary->data() + dictionary->size() - dictionary_size,
+        static_cast<uInt>(dictionary_size));
+  }
+
+  // Room for the worst case plus the sync flush's empty stored block
+  std::vector<uint8_t>& compressed = strip->data;
+  compressed.resize(deflateBound(&stream, filtered.size()) + 16);
+  stream.next_in = const_cast<Bytef*>(filtered.data());
+  stream.avail_in = static_cast<uInt>(filtered.size());
+  stream.next_out = compressed.data();
+  stream.avail_out = static_cast<uInt>(compressed.size());
+  int result = deflate(&stream, Z_SYNC_FLUSH);
+  bool ok = result == Z_OK && stream.avail_in == 0;
+  compressed.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  strip->adler = static_cast<uint32_t>(adler32(
+      adler32(0, nullptr, 0), filtered.data(),
+      static_cast<uInt>(filtered.size())));
+  strip->filtered_size = static_cast<uint32_t>(filtered.size());
+  return ok;
+}
+
+int ClampPngLevel(const TiledEncodeOptions& options) {
+  return std::max(0, std::min(9, options.png_compression_level));
+}
+
+// Encodes the strips with each one primed by the previous strip's data
+bool EncodePrimedPngStrips(const ScreenshotBitmap& bitmap,
+                           const TiledEncodeOptions& options,
+                           const std::vector<int>& strips,
+                           int strip_height,
+                           int channels,
+                           size_t thread_count,
+                           std::vector<EncodedScreenshotStrip>* encoded) {
+  // Filtering only looks one row back, so all strips filter in parallel;
+  // deflating needs the previous strip's filtered bytes as its dictionary
+  std::vector<std::vector<uint8_t>> filtered(strips.size());
+  ScreenshotParallelFor(strips.size(), thread_count, [&](size_t strip) {
+    FilterStrip(bitmap, strips[strip],
+                std::min(bitmap.height(), strips[strip] + strip_height),
+                channels, false, &filtered[strip]);
+  });
+
+  std::atomic<bool> ok(true);
+  ScreenshotParallelFor(strips.size(), thread_count, [&](size_t strip) {
+    if (!DeflateStrip(filtered[strip],
+                      strip > 0 ? &filtered[strip - 1] : nullptr,
+                      ClampPngLevel(options), &(*encoded)[strip])) {
+      ok.store(false);
+    }
+  });
+  return ok.load();
+}
+
+bool AssemblePng(int width,
+                 int height,
+                 int level,
+                 bool has_alpha,
+                 const std::vector<EncodedScreenshotStrip>& strips,
+                 std::vector<uint8_t>* output) {
+  uLong adler = adler32(0, nullptr, 0);
+  for (const EncodedScreenshotStrip& strip : strips) {
+    adler = adler32_combine(adler, strip.adler,
+                            static_cast<z_off_t>(strip.filtered_size));
+  }
+
+  static const uint8_t kSignature[] = {0x89, 'P',  'N',  'G',
+                                       '\r', '\n', 0x1A, '\n'};
+  output->assign(kSignature, kSignature + sizeof(kSignature));
+
+  std::vector<uint8_t> header;
+  AppendUint32BigEndian(&header, static_cast<uint32_t>(width));
+  AppendUint32BigEndian(&header, static_cast<uint32_t>(height));
+  header.push_back(8);                  // bit depth
+  header.push_back(has_alpha ? 6 : 2);  // RGBA or RGB
+  header.push_back(0);                  // deflate
+  header.push_back(0);                  // adaptive filtering
+  header.push_back(0);                  // no interlace
+  AppendPngChunk(output, "IHDR", header.data(), header.size());
+
+  // One IDAT per strip; the zlib header leads the first, and an empty
+  // final block and the combined checksum trail the last
+  const uint8_t kFlagLevels[] = {0, 0, 1, 1, 1, 1, 2, 3, 3, 3};
+  const uint8_t kEmptyFinalBlock[] = {0x03, 0x00};
+  uint8_t cmf = 0x78;
+  uint8_t flg = static_cast<uint8_t>(kFlagLevels[level] << 6);
+  flg = static_cast<uint8_t>(flg + 31 - (cmf * 256 + flg) % 31);
+  std::vector<uint8_t> chunk;
+  for (size_t strip = 0; strip < strips.size(); ++strip) {
+    chunk.clear();
+    if (strip == 0) {
+      chunk.push_back(cmf);
+      chunk.push_back(flg);
+    }
+    chunk.insert(chunk.end(), strips[strip].data.begin(),
+                 strips[strip].data.end());
+    if (strip + 1 == strips.size()) {
+      chunk.insert(chunk.end(), kEmptyFinalBlock,
+                   kEmptyFinalBlock + sizeof(kEmptyFinalBlock));
+      AppendUint32BigEndian(&chunk, static_cast<uint32_t>(adler));
+    }
+    AppendPngChunk(output, "IDAT", chunk.data(), chunk.size());
+  }
+  AppendPngChunk(output, "IEND", nullptr, 0);
+  return true;
+}
+
+// JPEG
+
+struct JpegErrorManager {
+  jpeg_error_mgr manager;
+  jmp_buf jump_buffer;
+};
+
+void OnJpegError(j_common_ptr cinfo) {
+  JpegErrorManager* errors =
+      reinterpret_cast<JpegErrorManager*>(cinfo->err);
+  longjmp(errors->jump_buffer, 1);
+}
+
+// Encodes rows [first_row, first_row + rows) as a standalone JPEG with a
+// restart marker after every MCU row. |row_buffer| must hold one RGB row.
+// Kept free of objects with destructors because errors longjmp out.
+bool EncodeJpegStrip(const ScreenshotBitmap& bitmap,
+                     int first_row,
+                     int rows,
+                     int quality,
+                     uint8_t* row_buffer,
+                     std::vector<uint8_t>* output) {
+  jpeg_compress_struct cinfo;
+  JpegErrorManager errors;
+  unsigned char* buffer = nullptr;
+  unsigned long buffer_size = 0;
+
+  cinfo.err = jpeg_std_error(&errors.manager);
+  errors.manager.error_exit = OnJpegError;
+  if (setjmp(errors.jump_buffer)) {
+    jpeg_destroy_compress(&cinfo);
+    free(buffer);
+    return false;
+  }
+
+  jpeg_create_compress(&cinfo);
+  jpeg_mem_dest(&cinfo, &buffer, &buffer_size);
+  cinfo.image_width = bitmap.width();
+  cinfo.image_height = rows;
+#ifdef JCS_EXTENSIONS
+  cinfo.input_components = ScreenshotBitmap::kBytesPerPixel;
+  cinfo.in_color_space = JCS_EXT_RGBX;
+#else
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+#endif
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  // Fixed tables in every strip, so one header describes them all
+  cinfo.optimize_coding = FALSE;
+  cinfo.restart_in_rows = 1;
+  jpeg_start_compress(&cinfo, TRUE);
+
+  while (cinfo.next_scanline < cinfo.image_height) {
+    const uint8_t* source = bitmap.row(first_row + cinfo.next_scanline);
+#ifdef JCS_EXTENSIONS
+    JSAMPROW row = const_cast<JSAMPROW>(source);
+    (void)row_buffer;
+#else
+    for (int x = 0; x < bitmap.width(); ++x) {
+      memcpy(row_buffer + x * 3, source + x * ScreenshotBitmap::kBytesPerPixel,
+             3);
+    }
+    JSAMPROW row = row_buffer;
+#endif
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+
+  output->assign(buffer, buffer + buffer_size);
+  free(buffer);
+  return true;
+}
+
+// Locates the SOF0 segment and the first byte of entropy-coded data
+bool ParseJpegHeader(const std::vector<uint8_t>& jpeg,
+                     size_t* sof_offset,
+                     size_t* scan_offset,
+                     bool* has_restart_interval) {
+  *sof_offset = 0;
+  *has_restart_interval = false;
+  size_t pos = 2;
+  while (pos + 4 <= jpeg.size()) {
+    if (jpeg[pos] != 0xFF) {
+      return false;
+    }
+    uint8_t marker = jpeg[pos + 1];
+    size_t length = (jpeg[pos + 2] << 8) | jpeg[pos + 3];
+    if (marker == 0xC0) {
+      *sof_offset = pos;
+    } else if (marker == 0xDD) {
+      *has_restart_interval = true;
+    } else if (marker == 0xDA) {
+      *scan_offset = pos + 2 + length;
+      return *sof_offset != 0 && *scan_offset + 2 <= jpeg.size();
+    }
+    pos += 2 + length;
+  }
+  return false;
+}
+
+// Appends the entropy-coded bytes in [begin, end), giving each restart
+// marker the next number in the sequence
+void AppendRenumberedScan(const uint8_t* begin,
+                          const uint8_t* end,
+                          int* next_restart,
+                          std::vector<uint8_t>* output) {
+  for (const uint8_t* byte = begin; byte < end; ++byte) {
+    if (*byte == 0xFF && byte + 1 < end && byte[1] >= 0xD0 &&
+        byte[1] <= 0xD7) {
+      output->push_back(0xFF);
+      output->push_back(static_cast<uint8_t>(0xD0 + (*next_restart & 7)));
+      ++*next_restart;
+      ++byte;
+    } else if (*byte == 0xFF && byte + 1 < end) {
+      // Stuffed 0xFF00; copy both so the 00 is not taken for data
+      output->push_back(byte[0]);
+      output->push_back(byte[1]);
+      ++byte;
+    } else {
+      output->push_back(*byte);
+    }
+  }
+}
+
+bool AssembleJpeg(int height,
+                  const std::vector<EncodedScreenshotStrip>& strips,
+                  std::vector<uint8_t>* output) {
+  // The first strip's header, with the full height, covers every strip
+  std::vector<size_t> scan_offsets(strips.size());
+  size_t sof_offset = 0;
+  for (size_t strip = 0; strip < strips.size(); ++strip) {
+    size_t strip_sof_offset = 0;
+    bool has_restart_interval = false;
+    if (!ParseJpegHeader(strips[strip].data, &strip_sof_offset,
+                         &scan_offsets[strip], &has_restart_interval) ||
+        !has_restart_interval) {
+      LOG(ERROR) << "Unexpected JPEG strip layout";
+      return false;
+    }
+    if (strip == 0) {
+      sof_offset = strip_sof_offset;
+    }
+  }
+
+  const std::vector<uint8_t>& first = strips[0].data;
+  output->assign(first.begin(), first.begin() + scan_offsets[0]);
+  (*output)[sof_offset + 5] = static_cast<uint8_t>(height >> 8);
+  (*output)[sof_offset + 6] = static_cast<uint8_t>(height);
+
+  int next_restart = 0;
+  for (size_t strip = 0; strip < strips.size(); ++strip) {
+    if (strip > 0) {
+      // The strip starts a new restart interval
+      output->push_back(0xFF);
+      output->push_back(static_cast<uint8_t>(0xD0 + (next_restart & 7)));
+      ++next_restart;
+    }
+    // Everything between the header and the trailing EOI
+    const std::vector<uint8_t>& jpeg = strips[strip].data;
+    AppendRenumberedScan(jpeg.data() + scan_offsets[strip],
+                         jpeg.data() + jpeg.size() - 2, &next_restart,
+                         output);
+  }
+  output->push_back(0xFF);
+  output->push_back(0xD9);
+  return true;
+}
+
+}  // namespace
+
+EncodedScreenshotStrip::EncodedScreenshotStrip() = default;
+EncodedScreenshotStrip::EncodedScreenshotStrip(
+    EncodedScreenshotStrip&& other) = default;
+EncodedScreenshotStrip& EncodedScreenshotStrip::operator=(
+    EncodedScreenshotStrip&& other) = default;
+EncodedScreenshotStrip::~EncodedScreenshotStrip() = default;
+
+int GetTiledStripHeight(const TiledEncodeOptions& options) {
+  int strip_height = std::max(kMinStripHeight, options.strip_height);
+  if (options.format == TiledEncodeOptions::Format::kJpeg) {
+    strip_height = (strip_height + kJpegMcuHeight - 1) / kJpegMcuHeight *
+                   kJpegMcuHeight;
+  }
+  return strip_height;
+}
+
+bool IsScreenshotOpaque(const ScreenshotBitmap& bitmap,
+                        int first_row,
+                        int end_row) {
+  for (int y = first_row; y < end_row; ++y) {
+    const uint8_t* row = bitmap.row(y);
+    for (int x = 0; x < bitmap.width(); ++x) {
+      if (row[x * ScreenshotBitmap::kBytesPerPixel + 3] != 0xFF) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool EncodeScreenshotTiled(const ScreenshotBitmap& bitmap,
+                           const TiledEncodeOptions& options,
+                           std::vector<uint8_t>* output) {
+  output->clear();
+  if (bitmap.empty()) {
+    return false;
+  }
+  if (options.format == TiledEncodeOptions::Format::kJpeg &&
+      (bitmap.width() > kJpegMaxDimension ||
+       bitmap.height() > kJpegMaxDimension)) {
+    return false;
+  }
+
+  int strip_height = GetTiledStripHeight(options);
+  std::vector<int> strips = PlanStrips(bitmap.height(), strip_height);
+  size_t thread_count =
+      ResolveScreenshotThreadCount(options.max_threads, strips.size(), 1);
+
+  bool has_alpha = false;
+  if (options.format != TiledEncodeOptions::Format::kJpeg) {
+    std::atomic<bool> opaque(true);
+    ScreenshotParallelFor(strips.size(), thread_count, [&](size_t strip) {
+      if (opaque.load() &&
+          !IsScreenshotOpaque(
+              bitmap, strips[strip],
+              std::min(bitmap.height(), strips[strip] + strip_height))) {
+        opaque.store(false);
+      }
+    });
+    has_alpha = !opaque.load();
+  }
+
+  std::vector<EncodedScreenshotStrip> encoded(strips.size());
+  bool ok = true;
+  if (options.format == TiledEncodeOptions::Format::kPng &&
+      !options.independent_strips) {
+    ok = EncodePrimedPngStrips(
+        bitmap, options, strips, strip_height,
+        has_alpha ? ScreenshotBitmap::kBytesPerPixel : 3, thread_count,
+        &encoded);
+  } else {
+    std::atomic<bool> all_encoded(true);
+    ScreenshotParallelFor(strips.size(), thread_count, [&](size_t strip) {
+      if (!EncodeScreenshotStrip(bitmap, options, strip, has_alpha,
+                                 &encoded[strip])) {
+        all_encoded.store(false);
+      }
+    });
+    ok = all_encoded.load();
+  }
+  if (!ok) {
+    LOG(ERROR) << "Screenshot strip encoding failed";
+    return false;
+  }
+  return AssembleScreenshotStrips(bitmap.width(), bitmap.height(), options,
+                                  has_alpha, encoded, output);
+}
+
+bool EncodeScreenshotStrip(const ScreenshotBitmap& bitmap,
+                           const TiledEncodeOptions& options,
+                           size_t strip_index,
+                           bool has_alpha,
+                           EncodedScreenshotStrip* strip) {
+  int strip_height = GetTiledStripHeight(options);
+  int first_row = static_cast<int>(strip_index) * strip_height;
+  if (first_row >= bitmap.height()) {
+    return false;
+  }
+  int end_row = std::min(bitmap.height(), first_row + strip_height);
+
+  if (options.format == TiledEncodeOptions::Format::kJpeg) {
+    std::vector<uint8_t> row_buffer(static_cast<size_t>(bitmap.width()) * 3);
+    return EncodeJpegStrip(bitmap, first_row, end_row - first_row,
+                           std::max(1, std::min(100, options.jpeg_quality)),
+                           row_buffer.data(), &strip->data);
+  }
+
+  if (options.format == TiledEncodeOptions::Format::kQoi) {
+    strip->data.clear();
+    EncodeQoiRows(bitmap, first_row, end_row, options.independent_strips,
+                  &strip->data);
+    return true;
+  }
+
+  DCHECK(options.independent_strips);
+  std::vector<uint8_t> filtered;
+  FilterStrip(bitmap, first_row, end_row,
+              has_alpha ? ScreenshotBitmap::kBytesPerPixel : 3, true,
+              &filtered);
+  return DeflateStrip(filtered, nullptr, ClampPngLevel(options), strip);
+}
+
+bool AssembleScreenshotStrips(int width,
+                              int height,
+                              const TiledEncodeOptions& options,
+                              bool has_alpha,
+                              const std::vector<EncodedScreenshotStrip>& strips,
+                              std::vector<uint8_t>* output) {
+  output->clear();
+  int strip_height = GetTiledStripHeight(options);
+  if (width <= 0 || height <= 0 ||
+      (options.format == TiledEncodeOptions::Format::kJpeg &&
+       (width > kJpegMaxDimension || height > kJpegMaxDimension)) ||
+      strips.size() !=
+          static_cast<size_t>((height + strip_height - 1) / strip_height)) {
+    return false;
+  }
+  switch (options.format) {
+    case TiledEncodeOptions::Format::kPng:
+      return AssemblePng(width, height, ClampPngLevel(options), has_alpha,
+                         strips, output);
+    case TiledEncodeOptions::Format::kJpeg:
+      return AssembleJpeg(height, strips, output);
+    case TiledEncodeOptions::Format::kQoi:
+      AppendQoiHeader(width, height, has_alpha, output);
+      for (const EncodedScreenshotStrip& strip : strips) {
+        output->insert(output->end(), strip.data.begin(), strip.data.end());
+      }
+      AppendQoiEndMarker(output);
+      return true;
+  }
+  return false;
+}
+
+}  // namespace tooltip
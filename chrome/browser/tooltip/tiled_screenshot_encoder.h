@@ -0,0 +1,118 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_TILED_SCREENSHOT_ENCODER_H_
+#define CHROME_BROWSER_TOOLTIP_TILED_SCREENSHOT_ENCODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+
+namespace tooltip {
+
+// Encodes tall captures, such as full-page screenshots, by splitting them
+// into horizontal strips that are compressed on all cores and stitched into
+// one standard file.
+//
+// PNG: every strip is filtered and deflated on its own, primed with the
+// last 32 KB of the previous strip's data, and ends on a sync flush, so the
+// concatenated streams form one valid zlib stream. The Adler-32 checksums
+// of the strips are combined.
+// JPEG: every strip is a whole number of MCU rows encoded with a restart
+// marker after each MCU row and the standard Huffman tables. The strips'
+// entropy-coded segments are joined under one header with the restart
+// markers renumbered.
+// QOI: every strip continues the chunk stream from the last pixel of the
+// strip above, using only colour-index entries it wrote itself, so the
+// strips concatenate under one header into a standard file. Meant for
+// screenshots that stay in the process; see screenshot_qoi_codec.h.
+//
+// The output depends on the strip height but not on the thread count.
+//
+// With |independent_strips| every strip encodes the same whatever the rest
+// of the frame holds, so callers that capture the same page repeatedly can
+// keep the encoded strips and re-encode only those whose pixels changed.
+struct TiledEncodeOptions {
+  enum class Format {
+    kPng,
+    kJpeg,
+    // Lossless and several times faster than PNG, for intermediate
+    // screenshots
+    kQoi,
+  };
+
+  Format format = Format::kPng;
+  // zlib level, 0-9
+  int png_compression_level = 6;
+  // 1-100
+  int jpeg_quality = 85;
+  // Rows per strip. Rounded up to a whole number of MCU rows for JPEG.
+  int strip_height = 256;
+  // 0 uses every core; 1 encodes on the calling thread only
+  size_t max_threads = 0;
+  // PNG strips neither filter against nor prime deflate with the previous
+  // strip, and QOI strips write their first pixel in full, at a small cost
+  // in size. JPEG strips are always independent.
+  bool independent_strips = false;
+};
+
+// One strip of a tiled encode, as kept by callers that reuse strips
+struct EncodedScreenshotStrip {
+  EncodedScreenshotStrip();
+  EncodedScreenshotStrip(EncodedScreenshotStrip&& other);
+  EncodedScreenshotStrip& operator=(EncodedScreenshotStrip&& other);
+  ~EncodedScreenshotStrip();
+
+  // PNG: raw deflate data ending on a sync flush. JPEG: the strip as a
+  // standalone file with a restart marker after every MCU row. QOI: the
+  // strip's chunks.
+  std::vector<uint8_t> data;
+  // PNG only: Adler-32 and length of the filtered rows |data| inflates to
+  uint32_t adler = 1;
+  uint32_t filtered_size = 0;
+};
+
+// Rows per strip that |options| encodes with
+int GetTiledStripHeight(const TiledEncodeOptions& options);
+
+// Whether every pixel in rows [first_row, end_row) is fully opaque. PNG
+// strips of opaque frames are encoded without alpha, and QOI headers of
+// opaque frames announce three channels.
+bool IsScreenshotOpaque(const ScreenshotBitmap& bitmap,
+                        int first_row,
+                        int end_row);
+
+// Replaces |output| with |bitmap| encoded as described by |options|.
+// Returns false if the bitmap is empty or cannot be represented in the
+// format (JPEG is limited to 65535 rows and columns).
+bool EncodeScreenshotTiled(const ScreenshotBitmap& bitmap,
+                           const TiledEncodeOptions& options,
+                           std::vector<uint8_t>* output);
+
+// Encodes strip |strip_index| of |bitmap| on the calling thread.
+// |options.independent_strips| must be set for PNG. |has_alpha| selects
+// RGBA over RGB for PNG and must be the same for every strip of a file.
+// QOI strips below the first depend on the last pixel above them unless
+// |options.independent_strips| is set.
+bool EncodeScreenshotStrip(const ScreenshotBitmap& bitmap,
+                           const TiledEncodeOptions& options,
+                           size_t strip_index,
+                           bool has_alpha,
+                           EncodedScreenshotStrip* strip);
+
+// Stitches the strips of a |width| x |height| frame, in order, into one
+// file in |output|, as EncodeScreenshotTiled() would
+bool AssembleScreenshotStrips(int width,
+                              int height,
+                              const TiledEncodeOptions& options,
+                              bool has_alpha,
+                              const std::vector<EncodedScreenshotStrip>& strips,
+                              std::vector<uint8_t>* output);
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_TILED_SCREENSHOT_ENCODER_H_
@@ -0,0 +1,179 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "tooltip_cache.h"
+
+#include "base/bind.h"
+#include "base/logging.h"
+#include "element_fingerprint.h"
+
+namespace tooltip {
+
+namespace {
+
+// Fixed per-entry overhead: list node, index slot and struct padding
+const size_t kEntryOverhead = 128;
+
+size_t StringSize(const std::string& value) {
+  return sizeof(std::string) + value.capacity();
+}
+
+}  // namespace
+
+const int TooltipCache::kMaxScreenshotEdge = 320;
+
+TooltipPayload::TooltipPayload() = default;
+TooltipPayload::TooltipPayload(const TooltipPayload& other) = default;
+TooltipPayload& TooltipPayload::operator=(const TooltipPayload& other) =
+    default;
+TooltipPayload::~TooltipPayload() = default;
+
+TooltipCache::TooltipCache(size_t byte_budget,
+                           TooltipImageBudget* image_budget)
+    : image_budget_(image_budget),
+      byte_budget_(byte_budget),
+      bytes_used_(0),
+      hits_(0),
+      misses_(0),
+      evictions_(0) {}
+
+TooltipCache::~TooltipCache() = default;
+
+// static
+uint64_t TooltipCache::ComputeKey(const ElementInfo& element_info,
+                                  const std::string& page_url) {
+  // The element fingerprint covers identity; the page, type and text decide
+  // whether a stored description still applies
+  ElementFingerprint element =
+      ComputeElementFingerprint(element_info, FingerprintBounds::kIgnore);
+  FingerprintBuilder builder;
+  builder.AddInt(static_cast<int64_t>(element.value))
+      .AddString(page_url)
+      .AddString(element_info.type)
+      .AddString(element_info.text_content);
+  return builder.Finish().value;
+}
+
+// static
+gfx::Image TooltipCache::DownscaleScreenshot(const gfx::Image& screenshot) {
+  return DownscaleImageToEdge(screenshot, kMaxScreenshotEdge);
+}
+
+const TooltipPayload* TooltipCache::Get(uint64_t key) {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    ++misses_;
+    return nullptr;
+  }
+
+  ++hits_;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return &it->second->payload;
+}
+
+void TooltipCache::Put(uint64_t key, const TooltipPayload& payload) {
+  Remove(key);
+
+  size_t size = EstimateSize(payload);
+  if (size > byte_budget_) {
+    VLOG(2) << "Tooltip payload of " << size << " bytes exceeds cache budget";
+    return;
+  }
+
+  entries_.push_front(Entry{key, payload, size, nullptr});
+  index_[key] = entries_.begin();
+  bytes_used_ += size;
+
+  EvictToBudget();
+  if (!index_.count(key) || !image_budget_) {
+    return;
+  }
+
+  scoped_refptr<BudgetedImage> image =
+      image_budget_->Admit(payload.screenshot);
+  if (image) {
+    Entry& entry = *index_[key];
+    // Keep the admitted pixels so that the entry and the budget agree
+    entry.payload.screenshot = image->image();
+    entry.screenshot_lease = image_budget_->Acquire(
+        std::move(image), TooltipImageBudget::Consumer::kPayloadCache,
+        base::BindOnce(&TooltipCache::OnScreenshotEvicted,
+                       base::Unretained(this), key));
+  }
+}
+
+void TooltipCache::Remove(uint64_t key) {
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return;
+  }
+
+  bytes_used_ -= it->second->size;
+  entries_.erase(it->second);
+  index_.erase(it);
+}
+
+void TooltipCache::SetByteBudget(size_t byte_budget) {
+  byte_budget_ = byte_budget;
+  EvictToBudget();
+}
+
+void TooltipCache::Clear() {
+  entries_.clear();
+  index_.clear();
+  bytes_used_ = 0;
+}
+
+TooltipCache::Stats TooltipCache::GetStats() const {
+  Stats stats;
+  stats.hits = hits_;
+  stats.misses = misses_;
+  stats.evictions = evictions_;
+  stats.entry_count = entries_.size();
+  stats.bytes_used = bytes_used_;
+  stats.byte_budget = byte_budget_;
+  return stats;
+}
+
+// static
+size_t TooltipCache::EstimateSize(const TooltipPayload& payload) {
+  const AIResponse& response = payload.ai_response;
+  size_t size = kEntryOverhead + StringSize(response.provider) +
+                StringSize(response.description) +
+                StringSize(response.confidence);
+  for (const std::string& action : response.suggested_actions) {
+    size += StringSize(action);
+  }
+
+  if (!payload.screenshot.IsEmpty()) {
+    // 32-bit pixels
+    size += static_cast<size_t>(payload.screenshot.Width()) *
+            payload.screenshot.Height() * 4;
+  }
+  return size;
+}
+
+void TooltipCache::OnScreenshotEvicted(uint64_t key) {
+  auto it = index_.find(key);
+  DCHECK(it != index_.end());
+  Entry& entry = *it->second;
+  entry.screenshot_lease.reset();
+  entry.payload.screenshot = gfx::Image();
+
+  size_t size = EstimateSize(entry.payload);
+  bytes_used_ -= entry.size - size;
+  entry.size = size;
+}
+
+void TooltipCache::EvictToBudget() {
+  while (bytes_used_ > byte_budget_ && !entries_.empty()) {
+    const Entry& victim = entries_.back();
+    bytes_used_ -= victim.size;
+    index_.erase(victim.key);
+    entries_.pop_back();
+    ++evictions_;
+  }
+}
+
+}  // namespace tooltip
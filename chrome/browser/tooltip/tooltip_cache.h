@@ -0,0 +1,123 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_TOOLTIP_CACHE_H_
+#define CHROME_BROWSER_TOOLTIP_TOOLTIP_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#include "ui/gfx/image/image.h"
+#endif
+#include "chrome/browser/tooltip/tooltip_image_budget.h"
+#include "chrome/browser/tooltip/tooltip_service.h"
+
+namespace tooltip {
+
+// Everything needed to redisplay a tooltip without capturing or asking the
+// AI provider again
+struct TooltipPayload {
+  AIResponse ai_response;
+  // Downscaled copy of the element screenshot
+  gfx::Image screenshot;
+
+  TooltipPayload();
+  TooltipPayload(const TooltipPayload& other);
+  TooltipPayload& operator=(const TooltipPayload& other);
+  ~TooltipPayload();
+};
+
+// Byte-budgeted LRU cache of tooltip payloads keyed by element fingerprint.
+// When an image budget is given, cached screenshots are charged to it and
+// dropped from their entries when it comes under pressure; the text of the
+// entry stays cached.
+class TooltipCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entry_count = 0;
+    size_t bytes_used = 0;
+    size_t byte_budget = 0;
+  };
+
+  // Longest edge of the screenshot kept in a cached payload
+  static const int kMaxScreenshotEdge;
+
+  // |image_budget| may be null and must outlive the cache
+  TooltipCache(size_t byte_budget, TooltipImageBudget* image_budget);
+  ~TooltipCache();
+
+  // Key identifying |element_info| on |page_url|, built on the element
+  // fingerprint. Bounds are left out so that scrolling does not invalidate
+  // the entry. Keys are stable across processes.
+  static uint64_t ComputeKey(const ElementInfo& element_info,
+                             const std::string& page_url);
+
+  // Downscale |screenshot| to the size stored in the cache
+  static gfx::Image DownscaleScreenshot(const gfx::Image& screenshot);
+
+  // Look up a payload and mark it most recently used. Returns nullptr on a
+  // miss. The pointer is valid until the next call that modifies the cache.
+  const TooltipPayload* Get(uint64_t key);
+
+  // Insert or replace the payload stored under |key|
+  void Put(uint64_t key, const TooltipPayload& payload);
+
+  // Drop a single entry
+  void Remove(uint64_t key);
+
+  // Change the budget, evicting entries that no longer fit
+  void SetByteBudget(size_t byte_budget);
+
+  // Drop every entry. Counters are kept.
+  void Clear();
+
+  Stats GetStats() const;
+
+ private:
+  struct Entry {
+    uint64_t key;
+    TooltipPayload payload;
+    size_t size;
+    std::unique_ptr<TooltipImageBudget::Lease> screenshot_lease;
+  };
+
+  // Approximate heap footprint of |payload|
+  static size_t EstimateSize(const TooltipPayload& payload);
+
+  // Evict least recently used entries until the budget is met
+  void EvictToBudget();
+
+  // Called when the image budget revokes the screenshot of |key|
+  void OnScreenshotEvicted(uint64_t key);
+
+  // Most recently used entry first
+  std::list<Entry> entries_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+
+  TooltipImageBudget* const image_budget_;
+
+  size_t byte_budget_;
+  size_t bytes_used_;
+  uint64_t hits_;
+  uint64_t misses_;
+  uint64_t evictions_;
+
+  DISALLOW_COPY_AND_ASSIGN(TooltipCache);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_TOOLTIP_CACHE_H_
@@ -0,0 +1,193 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "tooltip_event_dispatcher.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/callback_helpers.h"
+#include "base/logging.h"
+#include "base/task/thread_pool.h"
+
+namespace tooltip {
+
+TooltipEvent::TooltipEvent() : type(Type::kError), web_contents(nullptr) {}
+TooltipEvent::TooltipEvent(const TooltipEvent& other) = default;
+TooltipEvent::TooltipEvent(TooltipEvent&& other) = default;
+TooltipEvent& TooltipEvent::operator=(const TooltipEvent& other) = default;
+TooltipEvent& TooltipEvent::operator=(TooltipEvent&& other) = default;
+TooltipEvent::~TooltipEvent() = default;
+
+base::TimeDelta TooltipEventDispatcher::ObserverStats::GetMeanLatency() const {
+  if (events_delivered == 0) {
+    return base::TimeDelta();
+  }
+  return total_latency / static_cast<int64_t>(events_delivered);
+}
+
+TooltipEventDispatcher::ObserverHandle::ObserverHandle(
+    AsyncTooltipObserver* observer)
+    : observer(observer), removed(false) {}
+
+TooltipEventDispatcher::ObserverHandle::~ObserverHandle() = default;
+
+const size_t TooltipEventDispatcher::kMaxPendingEvents = 1024;
+
+TooltipEventDispatcher::TooltipEventDispatcher(base::TimeDelta coalesce_window)
+    : coalesce_window_(coalesce_window),
+      task_runner_(base::ThreadPool::CreateSequencedTaskRunner(
+          {base::TaskPriority::BEST_EFFORT,
+           base::TaskShutdownBehavior::SKIP_ON_SHUTDOWN})),
+      observer_count_(0),
+      delivery_scheduled_(false),
+      dropped_events_(0) {}
+
+TooltipEventDispatcher::~TooltipEventDispatcher() = default;
+
+void TooltipEventDispatcher::AddObserver(AsyncTooltipObserver* observer) {
+  base::AutoLock lock(observers_lock_);
+  observers_.push_back(ObserverEntry{
+      base::MakeRefCounted<ObserverHandle>(observer), ObserverStats()});
+  observer_count_.store(observers_.size(), std::memory_order_relaxed);
+}
+
+void TooltipEventDispatcher::RemoveObserver(AsyncTooltipObserver* observer,
+                                            base::OnceClosure on_removed) {
+  {
+    base::AutoLock lock(observers_lock_);
+    auto removed = std::remove_if(
+        observers_.begin(), observers_.end(),
+        [observer](const ObserverEntry& entry) {
+          return entry.handle->observer == observer;
+        });
+    for (auto it = removed; it != observers_.end(); ++it) {
+      it->handle->removed.store(true, std::memory_order_release);
+    }
+    observers_.erase(removed, observers_.end());
+    observer_count_.store(observers_.size(), std::memory_order_relaxed);
+  }
+
+  // Deliveries run in order on |task_runner_|, so the reply comes after a
+  // delivery that was already calling |observer| has returned
+  if (!on_removed.is_null()) {
+    task_runner_->PostTaskAndReply(FROM_HERE, base::DoNothing(),
+                                   std::move(on_removed));
+  }
+}
+
+bool TooltipEventDispatcher::HasObservers() const {
+  return observer_count_.load(std::memory_order_relaxed) > 0;
+}
+
+void TooltipEventDispatcher::Enqueue(TooltipEvent event) {
+  event.enqueue_time = base::TimeTicks::Now();
+
+#ifndef STANDALONE_TOOLTIP_BUILD
+  if (!event.screenshot.IsEmpty()) {
+    // Give the event its own gfx::Image over thread-safe pixel storage. The
+    // pixels are shared, not copied, and observers can read them off the UI
+    // thread.
+    gfx::ImageSkia image_skia = event.screenshot.AsImageSkia();
+    image_skia.MakeThreadSafe();
+    event.screenshot = gfx::Image(image_skia);
+  }
+#endif
+
+  base::AutoLock lock(queue_lock_);
+  if (pending_events_.size() >= kMaxPendingEvents) {
+    pending_events_.erase(pending_events_.begin());
+    ++dropped_events_;
+  }
+  pending_events_.push_back(std::move(event));
+
+  // Later events ride along with the delivery that is already scheduled
+  if (delivery_scheduled_) {
+    return;
+  }
+  delivery_scheduled_ = true;
+  task_runner_->PostDelayedTask(
+      FROM_HERE,
+      base::BindOnce(&TooltipEventDispatcher::DeliverPendingEvents, this),
+      coalesce_window_);
+}
+
+TooltipEventDispatcher::ObserverStats TooltipEventDispatcher::GetObserverStats(
+    AsyncTooltipObserver* observer) const {
+  base::AutoLock lock(observers_lock_);
+  for (const ObserverEntry& entry : observers_) {
+    if (entry.handle->observer == observer) {
+      return entry.stats;
+    }
+  }
+  return ObserverStats();
+}
+
+uint64_t TooltipEventDispatcher::GetDroppedEventCount() const {
+  base::AutoLock lock(queue_lock_);
+  return dropped_events_;
+}
+
+void TooltipEventDispatcher::DeliverPendingEvents() {
+  std::vector<TooltipEvent> batch;
+  {
+    base::AutoLock lock(queue_lock_);
+    batch.swap(pending_events_);
+    delivery_scheduled_ = false;
+  }
+
+  if (batch.empty()) {
+    return;
+  }
+
+  std::vector<scoped_refptr<ObserverHandle>> targets;
+  {
+    base::AutoLock lock(observers_lock_);
+    for (const ObserverEntry& entry : observers_) {
+      targets.push_back(entry.handle);
+    }
+  }
+
+  size_t delivered_to = 0;
+  for (const scoped_refptr<ObserverHandle>& target : targets) {
+    // Skip observers removed since the copy, including by an earlier
+    // callback of this batch
+    if (target->removed.load(std::memory_order_acquire)) {
+      continue;
+    }
+    target->observer->OnTooltipEvents(batch);
+    ++delivered_to;
+
+    // Latency includes the time spent in observers delivered before this one
+    base::TimeTicks delivered = base::TimeTicks::Now();
+    base::AutoLock lock(observers_lock_);
+    ObserverEntry* entry = FindEntryLocked(target.get());
+    if (!entry) {
+      continue;
+    }
+    for (const TooltipEvent& event : batch) {
+      base::TimeDelta latency = delivered - event.enqueue_time;
+      entry->stats.total_latency += latency;
+      entry->stats.max_latency = std::max(entry->stats.max_latency, latency);
+    }
+    entry->stats.events_delivered += batch.size();
+    ++entry->stats.batches_delivered;
+  }
+
+  VLOG(3) << "Delivered " << batch.size() << " tooltip events to "
+          << delivered_to << " async observers";
+}
+
+TooltipEventDispatcher::ObserverEntry* TooltipEventDispatcher::FindEntryLocked(
+    const ObserverHandle* handle) {
+  for (ObserverEntry& entry : observers_) {
+    if (entry.handle.get() == handle) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace tooltip
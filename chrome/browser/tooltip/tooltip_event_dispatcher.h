@@ -0,0 +1,173 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_TOOLTIP_EVENT_DISPATCHER_H_
+#define CHROME_BROWSER_TOOLTIP_TOOLTIP_EVENT_DISPATCHER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/callback.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/sequenced_task_runner.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "base/time/time.h"
+#include "ui/gfx/image/image.h"
+#endif
+#include "chrome/browser/tooltip/tooltip_service.h"
+
+namespace tooltip {
+
+// A tooltip notification captured for delivery off the UI thread
+struct TooltipEvent {
+  enum class Type {
+    kTooltipShown,
+    kTooltipHidden,
+    kScreenshotCaptured,
+    kAIResponseReceived,
+    kError,
+  };
+
+  TooltipEvent();
+  TooltipEvent(const TooltipEvent& other);
+  TooltipEvent(TooltipEvent&& other);
+  TooltipEvent& operator=(const TooltipEvent& other);
+  TooltipEvent& operator=(TooltipEvent&& other);
+  ~TooltipEvent();
+
+  Type type;
+  // Tab the event belongs to, null for errors outside a tab. Only for
+  // telling tabs apart; it must not be dereferenced off the UI thread.
+  content::WebContents* web_contents;
+  // Set for kTooltipShown
+  ElementInfo element_info;
+  // Set for kScreenshotCaptured
+  gfx::Image screenshot;
+  // Set for kAIResponseReceived
+  AIResponse ai_response;
+  // Set for kError
+  std::string error_message;
+  // When the UI thread raised the event
+  base::TimeTicks enqueue_time;
+};
+
+// Opt-in alternative to TooltipObserver for observers that may be slow,
+// such as loggers and recorders. Events are delivered in batches on a
+// background sequence, so the observer never delays tooltip display.
+// Implementations must be safe to call from a thread other than the one
+// that registered them.
+class AsyncTooltipObserver {
+ public:
+  virtual ~AsyncTooltipObserver() = default;
+
+  // |events| are in the order the UI thread raised them
+  virtual void OnTooltipEvents(const std::vector<TooltipEvent>& events) = 0;
+};
+
+// Queues tooltip events raised on the UI thread and delivers them to
+// AsyncTooltipObservers in batches on a background sequence. Events raised
+// within the coalescing window of each other share a single delivery.
+class TooltipEventDispatcher
+    : public base::RefCountedThreadSafe<TooltipEventDispatcher> {
+ public:
+  // Delivery statistics of a single observer
+  struct ObserverStats {
+    uint64_t events_delivered = 0;
+    uint64_t batches_delivered = 0;
+    // Time from enqueue to the observer returning, per event
+    base::TimeDelta total_latency;
+    base::TimeDelta max_latency;
+
+    base::TimeDelta GetMeanLatency() const;
+  };
+
+  // Events held at most while waiting for delivery. Older events are
+  // dropped first when observers cannot keep up.
+  static const size_t kMaxPendingEvents;
+
+  explicit TooltipEventDispatcher(base::TimeDelta coalesce_window);
+
+  // Observer management. RemoveObserver() never blocks: later deliveries
+  // skip the observer, but one that is already calling it may still finish.
+  // |on_removed| runs on the calling sequence once no delivery can be
+  // calling the observer any more, after which it may be destroyed.
+  void AddObserver(AsyncTooltipObserver* observer);
+  void RemoveObserver(AsyncTooltipObserver* observer,
+                      base::OnceClosure on_removed = base::OnceClosure());
+
+  // Lock-free, for the UI thread to check on every event
+  bool HasObservers() const;
+
+  // Queue |event| for delivery. Called on the UI thread.
+  void Enqueue(TooltipEvent event);
+
+  // Statistics of |observer|; empty if it is not registered
+  ObserverStats GetObserverStats(AsyncTooltipObserver* observer) const;
+
+  // Events dropped because the queue was full
+  uint64_t GetDroppedEventCount() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<TooltipEventDispatcher>;
+
+  // Registration of an observer, shared with the deliveries that copied it
+  class ObserverHandle : public base::RefCountedThreadSafe<ObserverHandle> {
+   public:
+    explicit ObserverHandle(AsyncTooltipObserver* observer);
+
+    AsyncTooltipObserver* const observer;
+    // Set by RemoveObserver(); deliveries skip the observer from then on
+    std::atomic<bool> removed;
+
+   private:
+    friend class base::RefCountedThreadSafe<ObserverHandle>;
+    ~ObserverHandle();
+
+    DISALLOW_COPY_AND_ASSIGN(ObserverHandle);
+  };
+
+  struct ObserverEntry {
+    scoped_refptr<ObserverHandle> handle;
+    ObserverStats stats;
+  };
+
+  ~TooltipEventDispatcher();
+
+  // Deliver everything queued so far. Runs on |task_runner_|.
+  void DeliverPendingEvents();
+
+  // Entry registered through |handle| or nullptr
+  ObserverEntry* FindEntryLocked(const ObserverHandle* handle)
+      EXCLUSIVE_LOCKS_REQUIRED(observers_lock_);
+
+  const base::TimeDelta coalesce_window_;
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+
+  // Never held while an observer runs; deliveries work on a copy of the
+  // handles
+  mutable base::Lock observers_lock_;
+  std::vector<ObserverEntry> observers_ GUARDED_BY(observers_lock_);
+  // Size of |observers_|
+  std::atomic<size_t> observer_count_;
+
+  mutable base::Lock queue_lock_;
+  std::vector<TooltipEvent> pending_events_ GUARDED_BY(queue_lock_);
+  bool delivery_scheduled_ GUARDED_BY(queue_lock_);
+  uint64_t dropped_events_ GUARDED_BY(queue_lock_);
+
+  DISALLOW_COPY_AND_ASSIGN(TooltipEventDispatcher);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_TOOLTIP_EVENT_DISPATCHER_H_
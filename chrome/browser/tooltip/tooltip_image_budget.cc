@@ -0,0 +1,283 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "tooltip_image_budget.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "screenshot_downscaler.h"
+#ifndef STANDALONE_TOOLTIP_BUILD
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "ui/gfx/geometry/size.h"
+#include "ui/gfx/image/image_skia.h"
+#include "ui/gfx/image/image_util.h"
+#endif
+
+namespace tooltip {
+
+namespace {
+
+size_t PixelBytes(const gfx::Image& image) {
+  // 32-bit pixels
+  return static_cast<size_t>(image.Width()) * image.Height() * 4;
+}
+
+}  // namespace
+
+// BudgetedImage implementation
+BudgetedImage::BudgetedImage(TooltipImageBudget* budget,
+                             const gfx::Image& image)
+    : budget_(budget),
+      image_(image),
+      byte_size_(PixelBytes(image)),
+      lease_count_(0) {}
+
+BudgetedImage::~BudgetedImage() {
+  budget_->OnImageDestroyed(this);
+}
+
+// Lease implementation
+TooltipImageBudget::Lease::Lease(TooltipImageBudget* budget,
+                                 scoped_refptr<BudgetedImage> image,
+                                 Consumer consumer,
+                                 base::OnceClosure on_evict)
+    : budget_(budget),
+      image_(std::move(image)),
+      consumer_(consumer),
+      on_evict_(std::move(on_evict)) {
+  budget_->ChargeLease(image_.get());
+}
+
+TooltipImageBudget::Lease::~Lease() {
+  budget_->OnLeaseDestroyed(this);
+  budget_->UnchargeLease(image_.get());
+}
+
+// TooltipImageBudget implementation
+TooltipImageBudget::TooltipImageBudget(size_t byte_budget, int max_image_edge)
+    : byte_budget_(byte_budget),
+      max_image_edge_(max_image_edge),
+      bytes_used_(0),
+      images_admitted_(0),
+      images_downscaled_(0),
+      images_shared_(0),
+      evictions_() {}
+
+TooltipImageBudget::~TooltipImageBudget() {
+  DCHECK(leases_.empty()) << "Image leases outlived the budget";
+  DCHECK(images_.empty()) << "Budgeted images outlived the budget";
+}
+
+void TooltipImageBudget::SetByteBudget(size_t byte_budget) {
+  byte_budget_ = byte_budget;
+  EnforceBudget(nullptr);
+}
+
+void TooltipImageBudget::SetMaxImageEdge(int max_image_edge) {
+  max_image_edge_ = max_image_edge;
+}
+
+scoped_refptr<BudgetedImage> TooltipImageBudget::Admit(
+    const gfx::Image& image) {
+  if (image.IsEmpty()) {
+    return nullptr;
+  }
+
+  // Observers hand admitted screenshots back, e.g. for an AI request
+  const gfx::ImageSkia& image_skia = image.AsImageSkia();
+  for (BudgetedImage* admitted : images_) {
+    if (admitted->image().AsImageSkia().BackedBySameObjectAs(image_skia)) {
+      ++images_shared_;
+      return base::WrapRefCounted(admitted);
+    }
+  }
+
+  gfx::Image scaled = DownscaleImageToEdge(image, max_image_edge_);
+  if (scaled.Width() != image.Width() || scaled.Height() != image.Height()) {
+    ++images_downscaled_;
+  }
+
+  scoped_refptr<BudgetedImage> admitted(new BudgetedImage(this, scaled));
+  images_.push_back(admitted.get());
+  ++images_admitted_;
+  return admitted;
+}
+
+std::unique_ptr<TooltipImageBudget::Lease> TooltipImageBudget::Acquire(
+    scoped_refptr<BudgetedImage> image,
+    Consumer consumer,
+    base::OnceClosure on_evict) {
+  DCHECK(image);
+  bool evictable = !on_evict.is_null();
+  std::unique_ptr<Lease> lease(
+      new Lease(this, std::move(image), consumer, std::move(on_evict)));
+  leases_.push_back(lease.get());
+  if (evictable) {
+    lease->eviction_position_ =
+        evictable_leases_.insert(evictable_leases_.end(), lease.get());
+  }
+
+  EnforceBudget(lease.get());
+  return lease;
+}
+
+TooltipImageBudget::Usage TooltipImageBudget::GetUsage() const {
+  Usage usage;
+  usage.bytes_used = bytes_used_;
+  usage.byte_budget = byte_budget_;
+  usage.image_count = images_.size();
+  usage.images_admitted = images_admitted_;
+  usage.images_downscaled = images_downscaled_;
+  usage.images_shared = images_shared_;
+  for (const Lease* lease : leases_) {
+    ConsumerUsage& consumer =
+        usage.consumers[static_cast<int>(lease->consumer())];
+    ++consumer.leases;
+    consumer.bytes += lease->image_->byte_size();
+  }
+  for (int i = 0; i < static_cast<int>(Consumer::kCount); ++i) {
+    usage.consumers[i].evictions = evictions_[i];
+  }
+  return usage;
+}
+
+// static
+const char* TooltipImageBudget::ConsumerName(Consumer consumer) {
+  switch (consumer) {
+    case Consumer::kTooltipView:
+      return "tooltip_view";
+    case Consumer::kAIRequest:
+      return "ai_request";
+    case Consumer::kPayloadCache:
+      return "payload_cache";
+    case Consumer::kCount:
+      break;
+  }
+  NOTREACHED();
+  return "";
+}
+
+void TooltipImageBudget::OnImageDestroyed(BudgetedImage* image) {
+  auto it = std::find(images_.begin(), images_.end(), image);
+  DCHECK(it != images_.end());
+  images_.erase(it);
+  // Every lease holds a reference
+  DCHECK_EQ(0u, image->lease_count_);
+}
+
+void TooltipImageBudget::OnLeaseDestroyed(Lease* lease) {
+  auto it = std::find(leases_.begin(), leases_.end(), lease);
+  DCHECK(it != leases_.end());
+  leases_.erase(it);
+  if (!lease->on_evict_.is_null()) {
+    evictable_leases_.erase(lease->eviction_position_);
+  }
+}
+
+void TooltipImageBudget::ChargeLease(BudgetedImage* image) {
+  if (image->lease_count_++ == 0) {
+    bytes_used_ += image->byte_size();
+  }
+}
+
+void TooltipImageBudget::UnchargeLease(BudgetedImage* image) {
+  DCHECK_GT(image->lease_count_, 0u);
+  if (--image->lease_count_ == 0) {
+    bytes_used_ -= image->byte_size();
+  }
+}
+
+void TooltipImageBudget::EnforceBudget(const Lease* keep) {
+  while (bytes_used_ > byte_budget_) {
+    BudgetedImage* victim = FindEvictableImage(keep);
+    if (!victim) {
+      break;
+    }
+    EvictImage(victim);
+  }
+
+  if (bytes_used_ > byte_budget_) {
+    VLOG(1) << "Pinned screenshots use " << bytes_used_
+            << " bytes, over the image budget of " << byte_budget_;
+  }
+}
+
+BudgetedImage* TooltipImageBudget::FindEvictableImage(
+    const Lease* keep) const {
+  for (const Lease* lease : evictable_leases_) {
+    if (CanRevokeAllLeases(lease->image_.get(), keep)) {
+      return lease->image_.get();
+    }
+  }
+  return nullptr;
+}
+
+bool TooltipImageBudget::CanRevokeAllLeases(const BudgetedImage* image,
+                                            const Lease* keep) const {
+  for (const Lease* lease : leases_) {
+    if (lease->image_.get() == image &&
+        (lease == keep || lease->on_evict_.is_null())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void TooltipImageBudget::EvictImage(BudgetedImage* image) {
+  // Detach every lease first, as running a callback destroys its lease
+  std::vector<base::OnceClosure> callbacks;
+  for (auto it = evictable_leases_.begin(); it != evictable_leases_.end();) {
+    Lease* lease = *it;
+    if (lease->image_.get() != image) {
+      ++it;
+      continue;
+    }
+    it = evictable_leases_.erase(it);
+    ++evictions_[static_cast<int>(lease->consumer())];
+    // Mark the lease pinned so that its destructor skips the eviction list
+    callbacks.push_back(std::move(lease->on_evict_));
+    lease->on_evict_.Reset();
+  }
+
+  VLOG(2) << "Evicting a " << image->byte_size() << " byte screenshot held by "
+          << callbacks.size() << " leases to fit the image budget";
+  for (base::OnceClosure& on_evict : callbacks) {
+    std::move(on_evict).Run();
+  }
+}
+
+gfx::Image DownscaleImageToEdge(const gfx::Image& image, int max_edge) {
+  if (image.IsEmpty()) {
+    return image;
+  }
+  gfx::Size size = GetDownscaledSize(image.Width(), image.Height(), max_edge);
+  if (size.width() == image.Width() && size.height() == image.Height()) {
+    return image;
+  }
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+  // The stub images carry no pixels to average
+  return gfx::ResizedImage(image, size);
+#else
+  // Screenshots are N32; area averaging keeps premultiplied pixels valid
+  const SkBitmap* source = image.ToSkBitmap();
+  SkBitmap scaled;
+  if (!source || source->colorType() != kN32_SkColorType ||
+      !scaled.tryAllocPixels(
+          source->info().makeWH(size.width(), size.height()))) {
+    return gfx::ResizedImage(image, size);
+  }
+  // Runs on the UI thread, so never fan out to worker threads
+  DownscalePixels(static_cast<const uint8_t*>(source->getPixels()),
+                  source->width(), source->height(), source->rowBytes(),
+                  static_cast<uint8_t*>(scaled.getPixels()), scaled.width(),
+                  scaled.height(), scaled.rowBytes(), /*max_threads=*/1);
+  scaled.setImmutable();
+  return gfx::Image::CreateFrom1xBitmap(scaled);
+#endif
+}
+
+}  // namespace tooltip
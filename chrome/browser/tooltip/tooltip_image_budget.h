@@ -0,0 +1,195 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_TOOLTIP_IMAGE_BUDGET_H_
+#define CHROME_BROWSER_TOOLTIP_TOOLTIP_IMAGE_BUDGET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/callback.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "ui/gfx/image/image.h"
+#endif
+
+namespace tooltip {
+
+class TooltipImageBudget;
+
+// Screenshot admitted to a TooltipImageBudget. Every component that holds
+// the screenshot shares these pixels; none keeps a copy of its own.
+class BudgetedImage : public base::RefCounted<BudgetedImage> {
+ public:
+  const gfx::Image& image() const { return image_; }
+
+  // Size of the decoded pixels
+  size_t byte_size() const { return byte_size_; }
+
+ private:
+  friend class base::RefCounted<BudgetedImage>;
+  friend class TooltipImageBudget;
+
+  BudgetedImage(TooltipImageBudget* budget, const gfx::Image& image);
+  ~BudgetedImage();
+
+  TooltipImageBudget* const budget_;
+  const gfx::Image image_;
+  const size_t byte_size_;
+  // Leases holding the image. Its pixels are charged while this is nonzero.
+  size_t lease_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(BudgetedImage);
+};
+
+// Process-wide accounting for screenshots held by tooltip components. Images
+// are downscaled to the configured edge limit on admission, and components
+// hold them through leases charged to that component. An image's pixels are
+// charged to the budget from its first lease until its last one goes; a
+// bare reference, such as the one Admit() returns, carries no charge and is
+// only meant to be held until a lease is acquired. When the charged pixels
+// exceed the byte budget, images are released in the order of their oldest
+// evictable lease by revoking all of their leases. Images with a pinned
+// lease are skipped.
+//
+// Must be used on the UI thread. Images and leases must not outlive the
+// budget.
+class TooltipImageBudget {
+ public:
+  // Components that hold screenshots
+  enum class Consumer {
+    kTooltipView,
+    kAIRequest,
+    kPayloadCache,
+    kCount,
+  };
+
+  // A component's hold on a BudgetedImage. Destroying the lease releases it.
+  class Lease {
+   public:
+    ~Lease();
+
+    const gfx::Image& image() const { return image_->image(); }
+    Consumer consumer() const { return consumer_; }
+
+   private:
+    friend class TooltipImageBudget;
+
+    Lease(TooltipImageBudget* budget,
+          scoped_refptr<BudgetedImage> image,
+          Consumer consumer,
+          base::OnceClosure on_evict);
+
+    TooltipImageBudget* const budget_;
+    scoped_refptr<BudgetedImage> image_;
+    const Consumer consumer_;
+    // Run when the budget revokes the lease; null for pinned leases
+    base::OnceClosure on_evict_;
+    std::list<Lease*>::iterator eviction_position_;
+
+    DISALLOW_COPY_AND_ASSIGN(Lease);
+  };
+
+  struct ConsumerUsage {
+    size_t leases = 0;
+    // Pixels reachable through this consumer's leases. An image shared by
+    // several consumers counts towards each of them.
+    size_t bytes = 0;
+    uint64_t evictions = 0;
+  };
+
+  struct Usage {
+    // Distinct pixels held by leases, each shared image counted once
+    size_t bytes_used = 0;
+    size_t byte_budget = 0;
+    size_t image_count = 0;
+    uint64_t images_admitted = 0;
+    uint64_t images_downscaled = 0;
+    uint64_t images_shared = 0;
+    ConsumerUsage consumers[static_cast<int>(Consumer::kCount)];
+  };
+
+  // |max_image_edge| <= 0 disables downscaling
+  TooltipImageBudget(size_t byte_budget, int max_image_edge);
+  ~TooltipImageBudget();
+
+  // Change the limits. A smaller budget takes effect immediately; a smaller
+  // edge only applies to images admitted afterwards.
+  void SetByteBudget(size_t byte_budget);
+  void SetMaxImageEdge(int max_image_edge);
+
+  // Admit |image|, downscaling it to the edge limit. An image that was
+  // already admitted is returned as is rather than wrapped again. Returns
+  // nullptr for an empty image.
+  scoped_refptr<BudgetedImage> Admit(const gfx::Image& image);
+
+  // Hold |image| on behalf of |consumer|. A lease with a null |on_evict| is
+  // pinned. Otherwise the budget may revoke it under pressure by running
+  // |on_evict|, which must destroy the lease.
+  std::unique_ptr<Lease> Acquire(scoped_refptr<BudgetedImage> image,
+                                 Consumer consumer,
+                                 base::OnceClosure on_evict);
+
+  Usage GetUsage() const;
+
+  static const char* ConsumerName(Consumer consumer);
+
+ private:
+  friend class BudgetedImage;
+
+  void OnImageDestroyed(BudgetedImage* image);
+  void OnLeaseDestroyed(Lease* lease);
+
+  // Charge |image| for a new lease, or drop the charge of a released one
+  void ChargeLease(BudgetedImage* image);
+  void UnchargeLease(BudgetedImage* image);
+
+  // Free images until the pixels fit. |keep| is the lease being acquired,
+  // which is never revoked.
+  void EnforceBudget(const Lease* keep);
+
+  // Image of the oldest evictable lease whose leases can all be revoked,
+  // or nullptr
+  BudgetedImage* FindEvictableImage(const Lease* keep) const;
+  bool CanRevokeAllLeases(const BudgetedImage* image, const Lease* keep) const;
+
+  // Revoke every lease on |image|, which releases its charge
+  void EvictImage(BudgetedImage* image);
+
+  size_t byte_budget_;
+  int max_image_edge_;
+  size_t bytes_used_;
+
+  // Images alive right now, in admission order
+  std::vector<BudgetedImage*> images_;
+
+  // Every lease, charged to its consumer
+  std::vector<Lease*> leases_;
+
+  // Evictable leases, oldest first
+  std::list<Lease*> evictable_leases_;
+
+  uint64_t images_admitted_;
+  uint64_t images_downscaled_;
+  uint64_t images_shared_;
+  uint64_t evictions_[static_cast<int>(Consumer::kCount)];
+
+  DISALLOW_COPY_AND_ASSIGN(TooltipImageBudget);
+};
+
+// |image| scaled down by area averaging so that its longest edge is at most
+// |max_edge|, or |image| itself if it already fits. Screenshots are scaled
+// this way on admission and before they are cached or uploaded.
+gfx::Image DownscaleImageToEdge(const gfx::Image& image, int max_edge);
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_TOOLTIP_IMAGE_BUDGET_H_
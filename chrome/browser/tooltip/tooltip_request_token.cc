@@ -0,0 +1,22 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "tooltip_request_token.h"
+
+namespace tooltip {
+
+TooltipRequestToken::TooltipRequestToken(uint64_t generation)
+    : generation_(generation), cancelled_(false) {}
+
+TooltipRequestToken::~TooltipRequestToken() = default;
+
+void TooltipRequestToken::Cancel() {
+  cancelled_.store(true, std::memory_order_release);
+}
+
+bool TooltipRequestToken::IsCancelled() const {
+  return cancelled_.load(std::memory_order_acquire);
+}
+
+}  // namespace tooltip
@@ -0,0 +1,52 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_TOOLTIP_REQUEST_TOKEN_H_
+#define CHROME_BROWSER_TOOLTIP_TOOLTIP_REQUEST_TOKEN_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#endif
+
+namespace tooltip {
+
+// Identifies the tooltip show that a screenshot or AI request was started
+// for. TooltipService cancels the token as soon as the show is superseded;
+// AIIntegration checks it before starting work and before delivering a
+// result, so abandoned requests stop at the source. ScreenshotCapture takes
+// no token; its results for a superseded show are dropped on arrival.
+// IsCancelled() may be called from any thread.
+class TooltipRequestToken
+    : public base::RefCountedThreadSafe<TooltipRequestToken> {
+ public:
+  explicit TooltipRequestToken(uint64_t generation);
+
+  // Monotonically increasing id of the show this token belongs to
+  uint64_t generation() const { return generation_; }
+
+  // Mark the work started for this show as no longer wanted
+  void Cancel();
+  bool IsCancelled() const;
+
+ private:
+  friend class base::RefCountedThreadSafe<TooltipRequestToken>;
+
+  ~TooltipRequestToken();
+
+  const uint64_t generation_;
+  std::atomic<bool> cancelled_;
+
+  DISALLOW_COPY_AND_ASSIGN(TooltipRequestToken);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_TOOLTIP_REQUEST_TOKEN_H_
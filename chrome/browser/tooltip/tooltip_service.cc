@@ -4,20 +4,47 @@
 
 #include "tooltip_service.h"
 
+#include <algorithm>
+
+#include "base/bind.h"
 #include "base/logging.h"
+#include "base/task/task_traits.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "element_detector.h"
 #include "screenshot_capture.h"
 #include "ai_integration.h"
 #include "dark_mode_manager.h"
 #include "navigrab_integration.h"
-#include "tooltip_view.h"
+#include "tooltip_event_dispatcher.h"
+#include "tooltip_image_budget.h"
+#include "tooltip_tab_state.h"
+#include "tooltip_trace.h"
+#include "content/public/browser/browser_task_traits.h"
+#include "content/public/browser/browser_thread.h"
 #include "content/public/browser/web_contents.h"
-#include "ui/gfx/geometry/rect.h"
-#include "ui/gfx/geometry/size.h"
 
 namespace tooltip {
 
+namespace {
+
+// Providers whose description endpoint accepts an image alongside the
+// element text
+const char* const kImageCapableProviders[] = {"openai", "gemini", "anthropic"};
+
+// TooltipPrefs::GetCacheSize() is expressed in megabytes
+const size_t kBytesPerCacheSizeUnit = 1024 * 1024;
+
+// Pixels all tooltip components may hold at once before cached screenshots
+// are evicted
+const size_t kImageByteBudget = 32 * 1024 * 1024;
+
+// Events raised this close together are delivered to async observers as
+// one batch
+constexpr base::TimeDelta kAsyncObserverCoalesceWindow =
+    base::TimeDelta::FromMilliseconds(50);
+
+}  // namespace
+
 // ElementInfo implementation
 ElementInfo::ElementInfo() = default;
 ElementInfo::~ElementInfo() = default;
@@ -32,10 +59,28 @@ TooltipService* TooltipService::GetInstance() {
 }
 
 TooltipService::TooltipService()
-    : initialized_(false), enabled_(true), tooltip_visible_(false) {}
+    : initialized_(false),
+      enabled_(true),
+      warm_up_scheduled_(false),
+      cache_byte_budget_(0),
+      automation_enabled_(true),
+      show_mode_(ShowMode::kSerial) {}
 
 TooltipService::~TooltipService() = default;
 
+TooltipService::ComponentFactory::ComponentFactory() = default;
+TooltipService::ComponentFactory::ComponentFactory(
+    const ComponentFactory& other) = default;
+TooltipService::ComponentFactory& TooltipService::ComponentFactory::operator=(
+    const ComponentFactory& other) = default;
+TooltipService::ComponentFactory::~ComponentFactory() = default;
+
+void TooltipService::SetComponentFactoryForTesting(
+    const ComponentFactory& factory) {
+  DCHECK(!initialized_);
+  component_factory_ = factory;
+}
+
 void TooltipService::Initialize() {
   if (initialized_) {
     return;
@@ -47,11 +92,17 @@ void TooltipService::Initialize() {
   prefs_ = std::make_unique<TooltipPrefs>();
   prefs_->Initialize();
 
+  // Initialize latency tracing
+  trace_recorder_ = std::make_unique<TooltipTraceRecorder>();
+
+  // Initialize the screenshot memory budget
+  image_budget_ = std::make_unique<TooltipImageBudget>(
+      kImageByteBudget, prefs_->GetMaxScreenshotSize());
+
   // Initialize dark mode manager
   DarkModeManager::GetInstance()->Initialize();
 
-  // Initialize components
-  InitializeComponents();
+  // The remaining components are created on first use; see ScheduleWarmUp()
 
   initialized_ = true;
   VLOG(1) << "TooltipService initialized";
@@ -65,37 +116,100 @@ void TooltipService::Shutdown() {
   // Hide any visible tooltip
   HideTooltip();
 
+  // Drop per-tab state; this also drops completions that are still in flight
+  tab_states_.clear();
+
   // Shutdown components
-  tooltip_view_.reset();
+  navigrab_integration_.reset();
   ai_integration_.reset();
   screenshot_capture_.reset();
   element_detector_.reset();
+  image_budget_.reset();
+  trace_recorder_.reset();
   prefs_.reset();
 
+  warm_up_scheduled_ = false;
   initialized_ = false;
   VLOG(1) << "TooltipService shutdown";
 }
 
-void TooltipService::InitializeComponents() {
-  // Initialize element detector
-  element_detector_ = std::make_unique<ElementDetector>();
-  element_detector_->Initialize();
+void TooltipService::ScheduleWarmUp() {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
+  if (!initialized_ || warm_up_scheduled_) {
+    return;
+  }
 
-  // Initialize screenshot capture
-  screenshot_capture_ = std::make_unique<ScreenshotCapture>();
-  screenshot_capture_->Initialize();
+  // Components must be created on the UI thread, so wait for it to go idle
+  // rather than moving the work to another sequence
+  warm_up_scheduled_ = true;
+  content::GetUIThreadTaskRunner({base::TaskPriority::BEST_EFFORT})
+      ->PostTask(FROM_HERE,
+                 base::BindOnce(&TooltipService::RunScheduledWarmUp,
+                                base::Unretained(this)));
+}
+
+void TooltipService::RunScheduledWarmUp() {
+  if (!warm_up_scheduled_) {
+    // Shutdown() ran after the warm-up was posted
+    return;
+  }
+  warm_up_scheduled_ = false;
+  WarmUpComponents();
+}
+
+void TooltipService::WarmUpComponents() {
+  if (!initialized_) {
+    return;
+  }
+
+  GetElementDetector();
+  screenshot_capture();
+  ai_integration();
+  GetNaviGrabIntegration();
+  VLOG(1) << "TooltipService components warmed up";
+}
+
+ElementDetector* TooltipService::GetElementDetector() {
+  DCHECK(initialized_);
+  if (!element_detector_) {
+    element_detector_ = std::make_unique<ElementDetector>();
+    element_detector_->Initialize();
+  }
+  return element_detector_.get();
+}
 
-  // Initialize AI integration
-  ai_integration_ = std::make_unique<AIIntegration>();
-  ai_integration_->Initialize();
+ScreenshotCapture* TooltipService::screenshot_capture() {
+  DCHECK(initialized_);
+  if (!screenshot_capture_) {
+    screenshot_capture_ = component_factory_.screenshot_capture
+                              ? component_factory_.screenshot_capture.Run()
+                              : std::make_unique<ScreenshotCapture>();
+    screenshot_capture_->Initialize();
+  }
+  return screenshot_capture_.get();
+}
 
-  // Initialize tooltip view
-  tooltip_view_ = std::make_unique<TooltipView>();
-  tooltip_view_->Initialize();
+AIIntegration* TooltipService::ai_integration() {
+  DCHECK(initialized_);
+  if (!ai_integration_) {
+    ai_integration_ = component_factory_.ai_integration
+                          ? component_factory_.ai_integration.Run()
+                          : std::make_unique<AIIntegration>();
+    ai_integration_->Initialize();
+  }
+  return ai_integration_.get();
+}
 
-  // Initialize NaviGrab integration
-  navigrab_integration_ = CreateNaviGrabIntegration();
-  navigrab_integration_->Initialize();
+NaviGrabIntegration* TooltipService::GetNaviGrabIntegration() {
+  if (!initialized_) {
+    return nullptr;
+  }
+  if (!navigrab_integration_) {
+    navigrab_integration_ = CreateNaviGrabIntegration();
+    navigrab_integration_->Initialize();
+    navigrab_integration_->SetEnabled(automation_enabled_);
+  }
+  return navigrab_integration_.get();
 }
 
 void TooltipService::ShowTooltipForElement(
@@ -108,47 +222,44 @@ void TooltipService::ShowTooltipForElement(
 
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
-  // Hide any existing tooltip
-  HideTooltip();
-
-  // Set element information
-  tooltip_view_->SetElementInfo(element_info);
+  TooltipTabState* tab_state = GetOrCreateTabState(web_contents);
 
-  // Calculate tooltip position
-  gfx::Size tooltip_size = tooltip_view_->GetPreferredSize();
-  gfx::Size viewport_size = web_contents->GetContainerBounds().size();
-  gfx::Rect tooltip_bounds = CalculateTooltipPosition(
-      element_info.bounds, tooltip_size, viewport_size);
-
-  // Show tooltip
-  tooltip_view_->ShowAt(tooltip_bounds);
-  tooltip_visible_ = true;
+  // Prefs can change at any time; follow the cache size on each hover
+  if (GetCacheByteBudget() != cache_byte_budget_) {
+    UpdateTabCacheBudgets();
+  }
 
-  // Notify observers
-  NotifyTooltipShown(element_info);
+  tab_state->ShowTooltipForElement(element_info, mouse_position);
+}
 
-  // Capture screenshot if auto-capture is enabled
-  if (prefs_->GetAutoCapture()) {
-    CaptureElementScreenshot(web_contents, element_info);
+void TooltipService::CancelPendingTooltip(content::WebContents* web_contents) {
+  TooltipTabState* tab_state = GetTabState(web_contents);
+  if (tab_state) {
+    tab_state->CancelPendingTooltip();
   }
-
-  VLOG(1) << "Tooltip shown for element: " << element_info.tag_name;
 }
 
-void TooltipService::HideTooltip() {
-  if (!tooltip_visible_) {
-    return;
+void TooltipService::CancelPendingTooltip() {
+  for (auto& entry : tab_states_) {
+    entry.second->CancelPendingTooltip();
   }
+}
 
+void TooltipService::HideTooltip(content::WebContents* web_contents) {
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
-  tooltip_view_->Hide();
-  tooltip_visible_ = false;
+  TooltipTabState* tab_state = GetTabState(web_contents);
+  if (tab_state) {
+    tab_state->HideTooltip();
+  }
+}
 
-  // Notify observers
-  NotifyTooltipHidden();
+void TooltipService::HideTooltip() {
+  DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
-  VLOG(1) << "Tooltip hidden";
+  for (auto& entry : tab_states_) {
+    entry.second->HideTooltip();
+  }
 }
 
 void TooltipService::CaptureElementScreenshot(
@@ -160,26 +271,100 @@ void TooltipService::CaptureElementScreenshot(
 
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
-  // Capture screenshot asynchronously
-  screenshot_capture_->CaptureElement(
-      web_contents, element_info,
-      base::BindOnce(&TooltipService::OnScreenshotCaptured,
-                     base::Unretained(this)));
+  GetOrCreateTabState(web_contents)->CaptureElementScreenshot(element_info);
 }
 
-void TooltipService::GetAIDescription(const ElementInfo& element_info,
-                                     const gfx::Image& screenshot) {
+void TooltipService::GetAIDescription(content::WebContents* web_contents,
+                                      const ElementInfo& element_info,
+                                      const gfx::Image& screenshot) {
   if (!initialized_) {
     return;
   }
 
   DCHECK_CURRENTLY_ON(content::BrowserThread::UI);
 
-  // Get AI description asynchronously
-  ai_integration_->GetDescription(
-      element_info, screenshot,
-      base::BindOnce(&TooltipService::OnAIResponseReceived,
-                     base::Unretained(this)));
+  GetOrCreateTabState(web_contents)
+      ->GetAIDescription(element_info, screenshot);
+}
+
+TooltipCache* TooltipService::GetCache(content::WebContents* web_contents) {
+  TooltipTabState* tab_state = GetTabState(web_contents);
+  return tab_state ? tab_state->cache() : nullptr;
+}
+
+TooltipTabState* TooltipService::GetOrCreateTabState(
+    content::WebContents* web_contents) {
+  std::unique_ptr<TooltipTabState>& tab_state = tab_states_[web_contents];
+  if (!tab_state) {
+    tab_state = std::make_unique<TooltipTabState>(this, web_contents);
+    UpdateTabCacheBudgets();
+  }
+  return tab_state.get();
+}
+
+TooltipTabState* TooltipService::GetTabState(
+    content::WebContents* web_contents) const {
+  auto it = tab_states_.find(web_contents);
+  return it == tab_states_.end() ? nullptr : it->second.get();
+}
+
+void TooltipService::OnTabStateDestroyed(content::WebContents* web_contents) {
+  tab_states_.erase(web_contents);
+  UpdateTabCacheBudgets();
+}
+
+size_t TooltipService::GetCacheByteBudget() const {
+  return static_cast<size_t>(std::max(0, prefs_->GetCacheSize())) *
+         kBytesPerCacheSizeUnit;
+}
+
+size_t TooltipService::GetTabCacheByteBudget() const {
+  return cache_byte_budget_ / std::max<size_t>(1, tab_states_.size());
+}
+
+void TooltipService::UpdateTabCacheBudgets() {
+  if (!prefs_) {
+    return;
+  }
+  cache_byte_budget_ = GetCacheByteBudget();
+  size_t tab_budget = GetTabCacheByteBudget();
+  for (auto& entry : tab_states_) {
+    // Null while the tab state is being created
+    if (entry.second) {
+      entry.second->cache()->SetByteBudget(tab_budget);
+    }
+  }
+}
+
+scoped_refptr<BudgetedImage> TooltipService::AdmitScreenshot(
+    const gfx::Image& screenshot) {
+  // Prefs can change at any time; apply the current limit on admission
+  image_budget_->SetMaxImageEdge(prefs_->GetMaxScreenshotSize());
+  return image_budget_->Admit(screenshot);
+}
+
+bool TooltipService::ProviderSupportsImages() const {
+  if (!prefs_) {
+    return false;
+  }
+
+  const std::string provider = prefs_->GetPreferredAIProvider();
+  for (const char* capable_provider : kImageCapableProviders) {
+    if (provider == capable_provider) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void TooltipService::SetShowMode(ShowMode mode) {
+  show_mode_ = mode;
+  VLOG(1) << "TooltipService pipelined show: "
+          << (mode == ShowMode::kPipelined);
+}
+
+TooltipService::ShowMode TooltipService::GetShowMode() const {
+  return show_mode_;
 }
 
 void TooltipService::AddObserver(TooltipObserver* observer) {
@@ -190,8 +375,36 @@ void TooltipService::RemoveObserver(TooltipObserver* observer) {
   observers_.RemoveObserver(observer);
 }
 
+void TooltipService::AddAsyncObserver(AsyncTooltipObserver* observer) {
+  if (!event_dispatcher_) {
+    event_dispatcher_ = base::MakeRefCounted<TooltipEventDispatcher>(
+        kAsyncObserverCoalesceWindow);
+  }
+  event_dispatcher_->AddObserver(observer);
+}
+
+void TooltipService::RemoveAsyncObserver(AsyncTooltipObserver* observer,
+                                         base::OnceClosure on_removed) {
+  if (event_dispatcher_) {
+    event_dispatcher_->RemoveObserver(observer, std::move(on_removed));
+  } else if (!on_removed.is_null()) {
+    std::move(on_removed).Run();
+  }
+}
+
+bool TooltipService::IsTooltipVisible(
+    content::WebContents* web_contents) const {
+  TooltipTabState* tab_state = GetTabState(web_contents);
+  return tab_state && tab_state->IsTooltipVisible();
+}
+
 bool TooltipService::IsTooltipVisible() const {
-  return tooltip_visible_;
+  for (const auto& entry : tab_states_) {
+    if (entry.second->IsTooltipVisible()) {
+      return true;
+    }
+  }
+  return false;
 }
 
 void TooltipService::SetEnabled(bool enabled) {
@@ -208,84 +421,93 @@ bool TooltipService::IsEnabled() const {
   return enabled_;
 }
 
-gfx::Rect TooltipService::CalculateTooltipPosition(
-    const gfx::Rect& element_bounds,
-    const gfx::Size& tooltip_size,
-    const gfx::Size& viewport_size) {
-  // Default position: above the element
-  gfx::Point position(element_bounds.x(), element_bounds.y() - tooltip_size.height() - 10);
-  
-  // Adjust if tooltip would go off screen
-  if (position.y() < 0) {
-    // Position below element instead
-    position.set_y(element_bounds.bottom() + 10);
-  }
-  
-  if (position.x() + tooltip_size.width() > viewport_size.width()) {
-    // Adjust horizontal position
-    position.set_x(viewport_size.width() - tooltip_size.width() - 10);
+void TooltipService::NotifyTooltipShown(content::WebContents* web_contents,
+                                        const ElementInfo& element_info) {
+  for (auto& observer : observers_) {
+    observer.OnTooltipShown(web_contents, element_info);
   }
-  
-  if (position.x() < 0) {
-    position.set_x(10);
+
+  if (HasAsyncObservers()) {
+    TooltipEvent event;
+    event.type = TooltipEvent::Type::kTooltipShown;
+    event.web_contents = web_contents;
+    event.element_info = element_info;
+    event_dispatcher_->Enqueue(std::move(event));
   }
-  
-  return gfx::Rect(position, tooltip_size);
 }
 
-void TooltipService::OnScreenshotCaptured(const gfx::Image& screenshot) {
-  if (tooltip_view_) {
-    tooltip_view_->SetScreenshot(screenshot);
+void TooltipService::NotifyTooltipHidden(content::WebContents* web_contents) {
+  for (auto& observer : observers_) {
+    observer.OnTooltipHidden(web_contents);
   }
-  
-  NotifyScreenshotCaptured(screenshot);
-}
 
-void TooltipService::OnAIResponseReceived(const AIResponse& response) {
-  if (tooltip_view_) {
-    tooltip_view_->SetAIResponse(response);
+  if (HasAsyncObservers()) {
+    TooltipEvent event;
+    event.type = TooltipEvent::Type::kTooltipHidden;
+    event.web_contents = web_contents;
+    event_dispatcher_->Enqueue(std::move(event));
   }
-  
-  NotifyAIResponseReceived(response);
 }
 
-void TooltipService::NotifyTooltipShown(const ElementInfo& element_info) {
+void TooltipService::NotifyScreenshotCaptured(
+    content::WebContents* web_contents,
+    const gfx::Image& screenshot) {
   for (auto& observer : observers_) {
-    observer.OnTooltipShown(element_info);
+    observer.OnScreenshotCaptured(web_contents, screenshot);
   }
-}
 
-void TooltipService::NotifyTooltipHidden() {
-  for (auto& observer : observers_) {
-    observer.OnTooltipHidden();
+  if (HasAsyncObservers()) {
+    TooltipEvent event;
+    event.type = TooltipEvent::Type::kScreenshotCaptured;
+    event.web_contents = web_contents;
+    event.screenshot = screenshot;
+    event_dispatcher_->Enqueue(std::move(event));
   }
 }
 
-void TooltipService::NotifyScreenshotCaptured(const gfx::Image& screenshot) {
+void TooltipService::NotifyAIResponseReceived(
+    content::WebContents* web_contents,
+    const AIResponse& response) {
   for (auto& observer : observers_) {
-    observer.OnScreenshotCaptured(screenshot);
+    observer.OnAIResponseReceived(web_contents, response);
   }
-}
 
-void TooltipService::NotifyAIResponseReceived(const AIResponse& response) {
-  for (auto& observer : observers_) {
-    observer.OnAIResponseReceived(response);
+  if (HasAsyncObservers()) {
+    TooltipEvent event;
+    event.type = TooltipEvent::Type::kAIResponseReceived;
+    event.web_contents = web_contents;
+    event.ai_response = response;
+    event_dispatcher_->Enqueue(std::move(event));
   }
 }
 
-void TooltipService::NotifyError(const std::string& error_message) {
+void TooltipService::NotifyError(content::WebContents* web_contents,
+                                 const std::string& error_message) {
   for (auto& observer : observers_) {
-    observer.OnError(error_message);
+    observer.OnError(web_contents, error_message);
+  }
+
+  if (HasAsyncObservers()) {
+    TooltipEvent event;
+    event.type = TooltipEvent::Type::kError;
+    event.web_contents = web_contents;
+    event.error_message = error_message;
+    event_dispatcher_->Enqueue(std::move(event));
   }
 }
 
+bool TooltipService::HasAsyncObservers() const {
+  return event_dispatcher_ && event_dispatcher_->HasObservers();
+}
+
 // NaviGrab automation integration methods
 void TooltipService::ExecuteAutomationAction(
     const ElementInfo& element_info,
     const AutomationAction& action,
     base::OnceCallback<void(const AutomationResult&)> callback) {
   
-  if (!initialized_ || !navigrab_integration_) {
+  NaviGrabIntegration* navigrab = GetNaviGrabIntegration();
+  if (!navigrab) {
     AutomationResult result;
     result.success = false;
     result.error_message = "NaviGrab integration not available";
@@ -293,29 +515,35 @@ void TooltipService::ExecuteAutomationAction(
     return;
   }
 
-  navigrab_integration_->ExecuteAction(element_info, action, std::move(callback));
+  navigrab->ExecuteAction(element_info, action, std::move(callback));
 }
 
 std::vector<AutomationAction> TooltipService::GetAvailableActions(
     const ElementInfo& element_info) {
   
-  if (!initialized_ || !navigrab_integration_) {
+  NaviGrabIntegration* navigrab = GetNaviGrabIntegration();
+  if (!navigrab) {
     return std::vector<AutomationAction>();
   }
 
-  return navigrab_integration_->GetSuggestedActions(element_info);
+  return navigrab->GetSuggestedActions(element_info);
 }
 
 void TooltipService::SetAutomationEnabled(bool enabled) {
+  automation_enabled_ = enabled;
   if (navigrab_integration_) {
     navigrab_integration_->SetEnabled(enabled);
   }
 }
 
 bool TooltipService::IsAutomationEnabled() const {
-  if (!navigrab_integration_) {
+  if (!initialized_) {
     return false;
   }
+  // Answer from the stored setting rather than creating the integration
+  if (!navigrab_integration_) {
+    return automation_enabled_;
+  }
   return navigrab_integration_->IsEnabled();
 }
 
@@ -5,6 +5,10 @@
 #ifndef CHROME_BROWSER_TOOLTIP_TOOLTIP_SERVICE_H_
 #define CHROME_BROWSER_TOOLTIP_TOOLTIP_SERVICE_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -12,10 +16,13 @@
 #ifdef STANDALONE_TOOLTIP_BUILD
 #include "base/base_stubs.h"
 #else
+#include "base/callback.h"
+#include "base/memory/scoped_refptr.h"
 #include "base/memory/singleton.h"
 #include "base/observer_list.h"
 #include "base/values.h"
 #endif
+#include "chrome/browser/tooltip/computed_style_block.h"
 #include "chrome/browser/tooltip/tooltip_prefs.h"
 #include "chrome/browser/tooltip/dark_mode_manager.h"
 #include "chrome/browser/tooltip/navigrab_integration.h"
@@ -37,10 +44,16 @@ class Element;
 
 namespace tooltip {
 
+class AsyncTooltipObserver;
 class ElementDetector;
 class ScreenshotCapture;
 class AIIntegration;
-class TooltipView;
+class BudgetedImage;
+class TooltipCache;
+class TooltipEventDispatcher;
+class TooltipImageBudget;
+class TooltipTabState;
+class TooltipTraceRecorder;
 
 // Information about a detected element
 struct ElementInfo {
@@ -60,6 +73,28 @@ struct ElementInfo {
   
   ElementInfo() = default;
   ~ElementInfo() = default;
+
+  // Structured form of |computed_styles|, filled by whoever builds this
+  // ElementInfo and carried along with copies. Reading it never parses, so
+  // copies can be read from any thread. The default block when
+  // |has_style| is false.
+  const ComputedStyleBlock& GetStyle() const { return style; }
+
+  // Parses |computed_styles| into |style|. Call again after changing it.
+  void ParseComputedStyles() {
+    style = ComputedStyleBlock::Parse(computed_styles);
+    has_style = true;
+  }
+
+  // Sets the style directly, e.g. from the binary form sent by the detector,
+  // so that |computed_styles| is never parsed
+  void SetStyle(const ComputedStyleBlock& new_style) {
+    style = new_style;
+    has_style = true;
+  }
+
+  ComputedStyleBlock style;
+  bool has_style = false;
 };
 
 // AI response data
@@ -74,54 +109,157 @@ struct AIResponse {
   ~AIResponse() = default;
 };
 
-// Observer for tooltip events
+// Observer for tooltip events. Every event names the tab it belongs to, so
+// that follow-up calls such as GetAIDescription() go to the same tab.
 class TooltipObserver : public base::CheckedObserver {
  public:
-  virtual void OnTooltipShown(const ElementInfo& element_info) {}
+  virtual void OnTooltipShown(content::WebContents* /*web_contents*/,
+                              const ElementInfo& element_info) {
+    OnTooltipShown(element_info);
+  }
+  virtual void OnTooltipHidden(content::WebContents* /*web_contents*/) {
+    OnTooltipHidden();
+  }
+  virtual void OnScreenshotCaptured(content::WebContents* /*web_contents*/,
+                                    const gfx::Image& screenshot) {
+    OnScreenshotCaptured(screenshot);
+  }
+  virtual void OnAIResponseReceived(content::WebContents* /*web_contents*/,
+                                    const AIResponse& response) {
+    OnAIResponseReceived(response);
+  }
+  // |web_contents| is null for errors that do not belong to a tab
+  virtual void OnError(content::WebContents* /*web_contents*/,
+                       const std::string& error_message) {
+    OnError(error_message);
+  }
+
+  // Deprecated tab-less forms, called by the defaults above so that
+  // observers written against them keep working. Override the forms that
+  // take a WebContents instead.
+  virtual void OnTooltipShown(const ElementInfo& /*element_info*/) {}
   virtual void OnTooltipHidden() {}
-  virtual void OnScreenshotCaptured(const gfx::Image& screenshot) {}
-  virtual void OnAIResponseReceived(const AIResponse& response) {}
-  virtual void OnError(const std::string& error_message) {}
+  virtual void OnScreenshotCaptured(const gfx::Image& /*screenshot*/) {}
+  virtual void OnAIResponseReceived(const AIResponse& /*response*/) {}
+  virtual void OnError(const std::string& /*error_message*/) {}
 };
 
-// Main tooltip service that manages tooltip functionality
+// Main tooltip service that manages tooltip functionality. Tooltip state is
+// kept per WebContents in a TooltipTabState; the service owns the shared,
+// read-mostly pieces (prefs, AI client, screenshot capture, observers).
 class TooltipService : public base::Singleton<TooltipService> {
  public:
   static TooltipService* GetInstance();
 
+  // How screenshot capture and the AI description are sequenced when a
+  // tooltip is shown
+  enum class ShowMode {
+    // Capture the screenshot only; callers request the description.
+    kSerial,
+    // Request a text-only description from ElementInfo right away and
+    // capture the screenshot in parallel. The screenshot is sent as a
+    // refinement when the provider accepts images.
+    kPipelined,
+  };
+
+  // Creates the shared components. Benchmarks and tests install fakes
+  // through SetComponentFactoryForTesting() to run the tooltip pipeline
+  // without a browser. Unset callbacks create the real component.
+  struct ComponentFactory {
+    ComponentFactory();
+    ComponentFactory(const ComponentFactory& other);
+    ComponentFactory& operator=(const ComponentFactory& other);
+    ~ComponentFactory();
+
+    base::RepeatingCallback<std::unique_ptr<ScreenshotCapture>()>
+        screenshot_capture;
+    base::RepeatingCallback<std::unique_ptr<AIIntegration>()> ai_integration;
+  };
+
+  // Must be called before Initialize()
+  void SetComponentFactoryForTesting(const ComponentFactory& factory);
+
   // Initialize the service
   void Initialize();
 
   // Shutdown the service
   void Shutdown();
 
-  // Show tooltip for an element
+  // Show tooltip for an element once the pointer has rested on it for
+  // TooltipPrefs::GetTooltipDelay(). A newer hover in the same tab replaces
+  // a pending one. Elements with a cached payload wait for the delay too but
+  // skip the capture and AI request. Hovers over the element whose tooltip
+  // is already shown are ignored.
   void ShowTooltipForElement(content::WebContents* web_contents,
                             const ElementInfo& element_info,
                             const gfx::Point& mouse_position);
 
-  // Hide current tooltip
+  // Drop a tooltip that is still waiting for the hover delay. Call when the
+  // pointer leaves the element.
+  void CancelPendingTooltip(content::WebContents* web_contents);
+  void CancelPendingTooltip();
+
+  // Hide the tooltip of |web_contents|, drop any pending one and cancel the
+  // screenshot and AI work started for it. Other tabs are not affected.
+  void HideTooltip(content::WebContents* web_contents);
+
+  // Hide tooltips in every tab
   void HideTooltip();
 
-  // Capture screenshot of element
+  // Capture screenshot of element for the current tooltip of
+  // |web_contents|. The capture is cancelled when that tooltip is hidden or
+  // replaced.
   void CaptureElementScreenshot(content::WebContents* web_contents,
                                const ElementInfo& element_info);
 
-  // Get AI description for element
-  void GetAIDescription(const ElementInfo& element_info,
-                       const gfx::Image& screenshot);
+  // Get AI description for element for the current tooltip of
+  // |web_contents|. The request is cancelled when that tooltip is hidden or
+  // replaced.
+  void GetAIDescription(content::WebContents* web_contents,
+                        const ElementInfo& element_info,
+                        const gfx::Image& screenshot);
+
+  // Show mode management
+  void SetShowMode(ShowMode mode);
+  ShowMode GetShowMode() const;
 
   // Observer management
   void AddObserver(TooltipObserver* observer);
   void RemoveObserver(TooltipObserver* observer);
 
+  // Observers that receive events in batches off the UI thread. The
+  // dispatch queue is only created once the first one is added.
+  void AddAsyncObserver(AsyncTooltipObserver* observer);
+  // See TooltipEventDispatcher::RemoveObserver() for |on_removed|
+  void RemoveAsyncObserver(AsyncTooltipObserver* observer,
+                           base::OnceClosure on_removed = base::OnceClosure());
+
+  // Batched dispatch queue with per-observer latency statistics, or nullptr
+  // if no async observer was ever added
+  TooltipEventDispatcher* GetEventDispatcher() {
+    return event_dispatcher_.get();
+  }
+
   // Settings management
   TooltipPrefs* GetPrefs() { return prefs_.get(); }
+
+  // Per-stage latency traces of shown tooltips
+  TooltipTraceRecorder* GetTraceRecorder() { return trace_recorder_.get(); }
+
+  // Memory budget for screenshots held by the tooltip components
+  TooltipImageBudget* GetImageBudget() { return image_budget_.get(); }
+
+  // Payload cache of |web_contents|, including hit/miss/eviction counters.
+  // Returns nullptr if the tab never showed a tooltip.
+  TooltipCache* GetCache(content::WebContents* web_contents);
   
   // Dark mode management
   DarkModeManager* GetDarkModeManager() { return DarkModeManager::GetInstance(); }
 
-  // Check if tooltip is currently visible
+  // Check if a tooltip is visible in |web_contents|
+  bool IsTooltipVisible(content::WebContents* web_contents) const;
+
+  // Check if a tooltip is visible in any tab
   bool IsTooltipVisible() const;
 
   // Enable/disable tooltip functionality
@@ -135,42 +273,98 @@ class TooltipService : public base::Singleton<TooltipService> {
   std::vector<AutomationAction> GetAvailableActions(const ElementInfo& element_info);
   void SetAutomationEnabled(bool enabled);
   bool IsAutomationEnabled() const;
-  NaviGrabIntegration* GetNaviGrabIntegration() { return navigrab_integration_.get(); }
+  NaviGrabIntegration* GetNaviGrabIntegration();
+
+  // Element detector, created on first use
+  ElementDetector* GetElementDetector();
+
+  // Components are created on first use. Call this once the first paint is
+  // done to build them at idle priority instead of on the first hover.
+  void ScheduleWarmUp();
+
+  // Create every component that does not exist yet
+  void WarmUpComponents();
 
  private:
   friend struct base::DefaultSingletonTraits<TooltipService>;
+  friend class TooltipTabState;
 
   TooltipService();
   ~TooltipService();
 
-  // Initialize components
-  void InitializeComponents();
+  // Tab state for |web_contents|, created on first use
+  TooltipTabState* GetOrCreateTabState(content::WebContents* web_contents);
+
+  // Tab state for |web_contents| or nullptr
+  TooltipTabState* GetTabState(content::WebContents* web_contents) const;
+
+  // Called by a TooltipTabState when its WebContents goes away
+  void OnTabStateDestroyed(content::WebContents* web_contents);
+
+  // Payload cache budget for all tabs together, from prefs
+  size_t GetCacheByteBudget() const;
+
+  // Share of the cache budget for each live tab
+  size_t GetTabCacheByteBudget() const;
+
+  // Split the cache budget in prefs evenly across live tabs
+  void UpdateTabCacheBudgets();
 
-  // Handle tooltip positioning
-  gfx::Rect CalculateTooltipPosition(const gfx::Rect& element_bounds,
-                                    const gfx::Size& tooltip_size,
-                                    const gfx::Size& viewport_size);
+  // Admit |screenshot| to the image budget, downscaled to the edge limit
+  // in prefs. Returns nullptr for an empty image.
+  scoped_refptr<BudgetedImage> AdmitScreenshot(const gfx::Image& screenshot);
 
-  // Notify observers
-  void NotifyTooltipShown(const ElementInfo& element_info);
-  void NotifyTooltipHidden();
-  void NotifyScreenshotCaptured(const gfx::Image& screenshot);
-  void NotifyAIResponseReceived(const AIResponse& response);
-  void NotifyError(const std::string& error_message);
+  // Check if the preferred AI provider accepts image input
+  bool ProviderSupportsImages() const;
 
-  // Component instances
+  // Shared components used by every tab, created on first use
+  ScreenshotCapture* screenshot_capture();
+  AIIntegration* ai_integration();
+
+  // Task posted by ScheduleWarmUp()
+  void RunScheduledWarmUp();
+
+  // Notify observers of an event in |web_contents|
+  void NotifyTooltipShown(content::WebContents* web_contents,
+                          const ElementInfo& element_info);
+  void NotifyTooltipHidden(content::WebContents* web_contents);
+  void NotifyScreenshotCaptured(content::WebContents* web_contents,
+                                const gfx::Image& screenshot);
+  void NotifyAIResponseReceived(content::WebContents* web_contents,
+                                const AIResponse& response);
+  void NotifyError(content::WebContents* web_contents,
+                   const std::string& error_message);
+
+  // Check if events need to be queued for async observers
+  bool HasAsyncObservers() const;
+
+  // Component instances. Everything except |prefs_|, |trace_recorder_| and
+  // |image_budget_| is created lazily through its getter.
   std::unique_ptr<ElementDetector> element_detector_;
   std::unique_ptr<ScreenshotCapture> screenshot_capture_;
   std::unique_ptr<AIIntegration> ai_integration_;
-  std::unique_ptr<TooltipView> tooltip_view_;
   std::unique_ptr<TooltipPrefs> prefs_;
   std::unique_ptr<NaviGrabIntegration> navigrab_integration_;
+  std::unique_ptr<TooltipTraceRecorder> trace_recorder_;
+  std::unique_ptr<TooltipImageBudget> image_budget_;
+
+  ComponentFactory component_factory_;
+
+  // Per-tab tooltip state
+  std::map<content::WebContents*, std::unique_ptr<TooltipTabState>>
+      tab_states_;
 
   // State
   bool initialized_;
   bool enabled_;
-  bool tooltip_visible_;
+  bool warm_up_scheduled_;
+  // Cache budget last split by UpdateTabCacheBudgets()
+  size_t cache_byte_budget_;
+  // Applied to the NaviGrab integration when it is created
+  bool automation_enabled_;
+  ShowMode show_mode_;
   base::ObserverList<TooltipObserver> observers_;
+  scoped_refptr<TooltipEventDispatcher> event_dispatcher_;
 
   DISALLOW_COPY_AND_ASSIGN(TooltipService);
 };
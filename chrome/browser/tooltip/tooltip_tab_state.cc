@@ -0,0 +1,423 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "tooltip_tab_state.h"
+
+#include <utility>
+
+#include "base/bind.h"
+#include "base/logging.h"
+#include "ai_integration.h"
+#include "hover_intent_scheduler.h"
+#include "screenshot_capture.h"
+#include "tooltip_cache.h"
+#include "tooltip_request_token.h"
+#include "tooltip_trace.h"
+#include "tooltip_view.h"
+#include "content/public/browser/web_contents.h"
+#include "ui/gfx/geometry/size.h"
+
+namespace tooltip {
+
+using Span = TooltipTraceRecorder::Span;
+
+TooltipTabState::TooltipTabState(TooltipService* service,
+                                 content::WebContents* web_contents)
+    : content::WebContentsObserver(web_contents),
+      service_(service),
+      cache_fill_key_(0),
+      next_generation_(0),
+      trace_id_(0),
+      hover_start_us_(0),
+      tooltip_visible_(false),
+      visible_element_key_(0) {
+  cache_ = std::make_unique<TooltipCache>(service_->GetTabCacheByteBudget(),
+                                          service_->GetImageBudget());
+
+  hover_scheduler_ = std::make_unique<HoverIntentScheduler>(
+      base::BindRepeating(&TooltipTabState::ShowTooltipNow,
+                          base::Unretained(this)));
+}
+
+TooltipTabState::~TooltipTabState() {
+  CancelPendingTooltip();
+  CancelInFlightRequests();
+  tracer()->FinishTrace(trace_id_);
+  if (tooltip_visible_) {
+    tooltip_view_->Hide();
+  }
+}
+
+void TooltipTabState::ShowTooltipForElement(const ElementInfo& element_info,
+                                            const gfx::Point& mouse_position) {
+  // Pointer moves within the element that is already shown
+  if (tooltip_visible_ &&
+      ComputeCacheKey(element_info) == visible_element_key_) {
+    CancelPendingTooltip();
+    return;
+  }
+
+  hover_start_us_ = TooltipTraceRecorder::NowMicros();
+
+  // Hold the request until the pointer has rested on the element. Nothing is
+  // shown, captured or sent to the AI provider while the pointer sweeps,
+  // and cached elements wait too so that sweeps do not flash them.
+  int delay_ms = service_->GetPrefs()->GetTooltipDelay();
+  if (delay_ms <= 0) {
+    hover_scheduler_->Cancel();
+    ShowTooltipNow(web_contents(), element_info, mouse_position);
+    return;
+  }
+
+  hover_scheduler_->Schedule(web_contents(), element_info, mouse_position,
+                             base::TimeDelta::FromMilliseconds(delay_ms));
+}
+
+void TooltipTabState::ShowTooltipNow(content::WebContents* web_contents,
+                                     const ElementInfo& element_info,
+                                     const gfx::Point& mouse_position) {
+  DCHECK_EQ(web_contents, this->web_contents());
+
+  if (!service_->IsEnabled()) {
+    return;
+  }
+
+  // A cached payload needs no capture or AI request
+  uint64_t cache_key = ComputeCacheKey(element_info);
+  const TooltipPayload* cached_payload = cache_->Get(cache_key);
+  if (cached_payload) {
+    ShowCachedTooltip(element_info, cache_key, *cached_payload);
+    return;
+  }
+
+  DisplayTooltip(element_info, cache_key);
+
+  // Collect the payload so that a re-hover can be served from the cache
+  cache_fill_key_ = cache_key;
+  cache_fill_ = std::make_unique<TooltipPayload>();
+
+  TooltipPrefs* prefs = service_->GetPrefs();
+  if (service_->GetShowMode() == TooltipService::ShowMode::kPipelined) {
+    // Start the description first so it does not wait on the capture
+    StartPipelinedDescription(element_info);
+
+    // The screenshot is still needed for the refinement stage
+    if (prefs->GetAutoCapture() || service_->ProviderSupportsImages()) {
+      CaptureElementScreenshot(element_info);
+    }
+  } else if (prefs->GetAutoCapture()) {
+    // Capture screenshot if auto-capture is enabled
+    CaptureElementScreenshot(element_info);
+  }
+
+  VLOG(1) << "Tooltip shown for element: " << element_info.tag_name;
+}
+
+void TooltipTabState::DisplayTooltip(const ElementInfo& element_info,
+                                     uint64_t element_key) {
+  // Hide any existing tooltip in this tab
+  HideTooltip();
+
+  // Work started from here on belongs to this tooltip
+  request_token_ =
+      base::MakeRefCounted<TooltipRequestToken>(++next_generation_);
+
+  trace_id_ = tracer()->StartTrace(element_info.tag_name);
+  tracer()->RecordSpan(trace_id_, Span::kHoverDelay, hover_start_us_,
+                       TooltipTraceRecorder::NowMicros());
+  tracer()->BeginSpan(trace_id_, Span::kShow);
+
+  // Set element information
+  TooltipView* view = GetTooltipView();
+  view->SetElementInfo(element_info);
+
+  // Calculate tooltip position
+  gfx::Size tooltip_size = view->GetPreferredSize();
+  gfx::Size viewport_size = web_contents()->GetContainerBounds().size();
+  gfx::Rect tooltip_bounds = CalculateTooltipPosition(
+      element_info.bounds, tooltip_size, viewport_size);
+
+  // Show tooltip
+  view->ShowAt(tooltip_bounds);
+  tooltip_visible_ = true;
+  visible_element_key_ = element_key;
+  tracer()->EndSpan(trace_id_, Span::kShow);
+
+  service_->NotifyTooltipShown(web_contents(), element_info);
+}
+
+void TooltipTabState::ShowCachedTooltip(const ElementInfo& element_info,
+                                        uint64_t cache_key,
+                                        const TooltipPayload& payload) {
+  // Copy before DisplayTooltip() runs observers that may touch the cache
+  TooltipPayload cached = payload;
+  DisplayTooltip(element_info, cache_key);
+
+  // Observers see the same events as for a miss, with the downscaled
+  // screenshot kept in the cache
+  if (!cached.screenshot.IsEmpty()) {
+    GetTooltipView()->SetScreenshot(cached.screenshot);
+    service_->NotifyScreenshotCaptured(web_contents(), cached.screenshot);
+  }
+  GetTooltipView()->SetAIResponse(cached.ai_response);
+  service_->NotifyAIResponseReceived(web_contents(), cached.ai_response);
+  RecordTimeToDescription();
+
+  VLOG(1) << "Tooltip served from cache for element: "
+          << element_info.tag_name;
+}
+
+void TooltipTabState::CancelPendingTooltip() {
+  hover_scheduler_->Cancel();
+}
+
+void TooltipTabState::HideTooltip() {
+  CancelPendingTooltip();
+  CancelInFlightRequests();
+  tracer()->FinishTrace(trace_id_);
+  trace_id_ = 0;
+
+  if (!tooltip_visible_) {
+    return;
+  }
+
+  tooltip_view_->Hide();
+  // A hidden view must not keep the screenshot alive
+  tooltip_view_->SetScreenshot(gfx::Image());
+  view_image_lease_.reset();
+  tooltip_visible_ = false;
+  visible_element_key_ = 0;
+  pipelined_request_.reset();
+  cache_fill_.reset();
+
+  // Notify observers
+  service_->NotifyTooltipHidden(web_contents());
+
+  VLOG(1) << "Tooltip hidden";
+}
+
+void TooltipTabState::CaptureElementScreenshot(
+    const ElementInfo& element_info) {
+  // Capture screenshot asynchronously. ScreenshotCapture takes no request
+  // token; a superseded capture is dropped in OnScreenshotCaptured()
+  uint64_t generation = GetRequestToken()->generation();
+  tracer()->BeginSpan(trace_id_, Span::kScreenshotCapture);
+  service_->screenshot_capture()->CaptureElement(
+      web_contents(), element_info,
+      base::BindOnce(&TooltipTabState::OnScreenshotCaptured,
+                     weak_ptr_factory_.GetWeakPtr(), generation));
+}
+
+void TooltipTabState::GetAIDescription(const ElementInfo& element_info,
+                                       const gfx::Image& screenshot) {
+  // Observers usually pass back the screenshot they were notified with,
+  // which shares the admitted pixels instead of being admitted again
+  scoped_refptr<BudgetedImage> image = service_->AdmitScreenshot(screenshot);
+  LeaseImageForAIRequest(image);
+
+  // Get AI description asynchronously
+  TooltipRequestToken* token = GetRequestToken();
+  tracer()->BeginSpan(trace_id_, Span::kAIDescription);
+  service_->ai_integration()->GetDescription(
+      element_info, image ? image->image() : gfx::Image(), token,
+      base::BindOnce(&TooltipTabState::OnAIResponseReceived,
+                     weak_ptr_factory_.GetWeakPtr(), token->generation()));
+}
+
+bool TooltipTabState::IsTooltipVisible() const {
+  return tooltip_visible_;
+}
+
+void TooltipTabState::WebContentsDestroyed() {
+  // Deletes |this|.
+  service_->OnTabStateDestroyed(web_contents());
+}
+
+TooltipRequestToken* TooltipTabState::GetRequestToken() {
+  if (!request_token_) {
+    request_token_ =
+        base::MakeRefCounted<TooltipRequestToken>(++next_generation_);
+  }
+  return request_token_.get();
+}
+
+void TooltipTabState::CancelInFlightRequests() {
+  if (!request_token_) {
+    return;
+  }
+
+  request_token_->Cancel();
+  request_token_ = nullptr;
+  ai_image_lease_.reset();
+}
+
+bool TooltipTabState::IsCurrentGeneration(uint64_t generation) const {
+  return request_token_ && request_token_->generation() == generation;
+}
+
+void TooltipTabState::StartPipelinedDescription(
+    const ElementInfo& element_info) {
+  pipelined_request_ = std::make_unique<PipelinedRequest>();
+  pipelined_request_->element_info = element_info;
+
+  // An empty image makes AIIntegration build the prompt from the element
+  // text alone.
+  TooltipRequestToken* token = GetRequestToken();
+  tracer()->BeginSpan(trace_id_, Span::kAIDescription);
+  service_->ai_integration()->GetDescription(
+      element_info, gfx::Image(), token,
+      base::BindOnce(&TooltipTabState::OnPipelinedAIResponse,
+                     weak_ptr_factory_.GetWeakPtr(), token->generation(),
+                     AIRequestStage::kTextOnly));
+}
+
+void TooltipTabState::OnScreenshotCaptured(uint64_t generation,
+                                           const gfx::Image& screenshot) {
+  if (!IsCurrentGeneration(generation)) {
+    VLOG(2) << "Dropping screenshot for superseded tooltip " << generation;
+    return;
+  }
+
+  tracer()->EndSpan(trace_id_, Span::kScreenshotCapture);
+
+  // Everything below shares the admitted, downscaled pixels
+  scoped_refptr<BudgetedImage> image = service_->AdmitScreenshot(screenshot);
+  if (image) {
+    view_image_lease_ = service_->GetImageBudget()->Acquire(
+        image, TooltipImageBudget::Consumer::kTooltipView, base::OnceClosure());
+  } else {
+    view_image_lease_.reset();
+  }
+  const gfx::Image& admitted = image ? image->image() : screenshot;
+
+  GetTooltipView()->SetScreenshot(admitted);
+  service_->NotifyScreenshotCaptured(web_contents(), admitted);
+
+  if (cache_fill_) {
+    cache_fill_->screenshot = TooltipCache::DownscaleScreenshot(admitted);
+  }
+
+  // Attach the image as a refinement of the text-only description
+  if (pipelined_request_ && !pipelined_request_->refinement_requested &&
+      image && service_->ProviderSupportsImages()) {
+    pipelined_request_->refinement_requested = true;
+    LeaseImageForAIRequest(image);
+    tracer()->BeginSpan(trace_id_, Span::kAIRefinement);
+    service_->ai_integration()->GetDescription(
+        pipelined_request_->element_info, admitted, request_token_.get(),
+        base::BindOnce(&TooltipTabState::OnPipelinedAIResponse,
+                       weak_ptr_factory_.GetWeakPtr(), generation,
+                       AIRequestStage::kRefinement));
+  }
+}
+
+void TooltipTabState::OnAIResponseReceived(uint64_t generation,
+                                           const AIResponse& response) {
+  if (!IsCurrentGeneration(generation)) {
+    VLOG(2) << "Dropping AI response for superseded tooltip " << generation;
+    return;
+  }
+
+  tracer()->EndSpan(trace_id_, Span::kAIDescription);
+  ai_image_lease_.reset();
+  HandleAIResponse(response);
+}
+
+void TooltipTabState::OnPipelinedAIResponse(uint64_t generation,
+                                            AIRequestStage stage,
+                                            const AIResponse& response) {
+  if (!IsCurrentGeneration(generation) || !pipelined_request_) {
+    VLOG(2) << "Dropping AI response for superseded tooltip " << generation;
+    return;
+  }
+
+  tracer()->EndSpan(trace_id_, stage == AIRequestStage::kRefinement
+                                   ? Span::kAIRefinement
+                                   : Span::kAIDescription);
+
+  if (stage == AIRequestStage::kRefinement) {
+    pipelined_request_->refinement_received = true;
+    ai_image_lease_.reset();
+  } else if (pipelined_request_->refinement_received) {
+    // Never replace a refined description with the text-only one
+    return;
+  }
+
+  HandleAIResponse(response);
+}
+
+void TooltipTabState::LeaseImageForAIRequest(
+    scoped_refptr<BudgetedImage> image) {
+  if (!image) {
+    ai_image_lease_.reset();
+    return;
+  }
+  ai_image_lease_ = service_->GetImageBudget()->Acquire(
+      std::move(image), TooltipImageBudget::Consumer::kAIRequest,
+      base::OnceClosure());
+}
+
+void TooltipTabState::HandleAIResponse(const AIResponse& response) {
+  tracer()->BeginSpan(trace_id_, Span::kAIResponseHandling);
+  GetTooltipView()->SetAIResponse(response);
+
+  // A refinement replaces the text-only payload stored earlier
+  if (cache_fill_) {
+    cache_fill_->ai_response = response;
+    cache_->Put(cache_fill_key_, *cache_fill_);
+  }
+
+  service_->NotifyAIResponseReceived(web_contents(), response);
+  tracer()->EndSpan(trace_id_, Span::kAIResponseHandling);
+  RecordTimeToDescription();
+}
+
+void TooltipTabState::RecordTimeToDescription() {
+  if (tracer()->HasSpan(trace_id_, Span::kTimeToDescription)) {
+    return;
+  }
+  tracer()->RecordSpan(trace_id_, Span::kTimeToDescription, hover_start_us_,
+                       TooltipTraceRecorder::NowMicros());
+}
+
+gfx::Rect TooltipTabState::CalculateTooltipPosition(
+    const gfx::Rect& element_bounds,
+    const gfx::Size& tooltip_size,
+    const gfx::Size& viewport_size) {
+  // Default position: above the element
+  gfx::Point position(element_bounds.x(), element_bounds.y() - tooltip_size.height() - 10);
+  
+  // Adjust if tooltip would go off screen
+  if (position.y() < 0) {
+    // Position below element instead
+    position.set_y(element_bounds.bottom() + 10);
+  }
+  
+  if (position.x() + tooltip_size.width() > viewport_size.width()) {
+    // Adjust horizontal position
+    position.set_x(viewport_size.width() - tooltip_size.width() - 10);
+  }
+  
+  if (position.x() < 0) {
+    position.set_x(10);
+  }
+  
+  return gfx::Rect(position, tooltip_size);
+}
+
+TooltipView* TooltipTabState::GetTooltipView() {
+  if (!tooltip_view_) {
+    tooltip_view_ = std::make_unique<TooltipView>();
+    tooltip_view_->Initialize();
+  }
+  return tooltip_view_.get();
+}
+
+uint64_t TooltipTabState::ComputeCacheKey(
+    const ElementInfo& element_info) const {
+  return TooltipCache::ComputeKey(element_info,
+                                  web_contents()->GetLastCommittedURL().spec());
+}
+
+}  // namespace tooltip
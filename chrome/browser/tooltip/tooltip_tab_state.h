@@ -0,0 +1,170 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_TOOLTIP_TAB_STATE_H_
+#define CHROME_BROWSER_TOOLTIP_TOOLTIP_TAB_STATE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "content/public/browser/web_contents_observer.h"
+#include "ui/gfx/geometry/point.h"
+#include "ui/gfx/geometry/rect.h"
+#include "ui/gfx/image/image.h"
+#endif
+#include "chrome/browser/tooltip/tooltip_image_budget.h"
+#include "chrome/browser/tooltip/tooltip_service.h"
+
+namespace content {
+class WebContents;
+}
+
+namespace tooltip {
+
+class HoverIntentScheduler;
+class TooltipCache;
+class TooltipRequestToken;
+class TooltipTraceRecorder;
+class TooltipView;
+struct TooltipPayload;
+
+// Tooltip state of a single tab: its view, visibility, pending hover,
+// in-flight requests and payload cache. Each WebContents gets its own
+// instance, so one tab never tears down or waits on another tab's tooltip.
+// Owned by TooltipService and destroyed with the WebContents.
+class TooltipTabState : public content::WebContentsObserver {
+ public:
+  TooltipTabState(TooltipService* service, content::WebContents* web_contents);
+  ~TooltipTabState() override;
+
+  // See the TooltipService methods of the same name
+  void ShowTooltipForElement(const ElementInfo& element_info,
+                             const gfx::Point& mouse_position);
+  void CancelPendingTooltip();
+  void HideTooltip();
+  void CaptureElementScreenshot(const ElementInfo& element_info);
+  void GetAIDescription(const ElementInfo& element_info,
+                        const gfx::Image& screenshot);
+  bool IsTooltipVisible() const;
+
+  TooltipCache* cache() { return cache_.get(); }
+
+  // content::WebContentsObserver:
+  void WebContentsDestroyed() override;
+
+ private:
+  // Stage of a pipelined AI request
+  enum class AIRequestStage {
+    kTextOnly,
+    kRefinement,
+  };
+
+  // Pipelined description in flight for the visible tooltip
+  struct PipelinedRequest {
+    ElementInfo element_info;
+    bool refinement_requested = false;
+    bool refinement_received = false;
+  };
+
+  // Run the full show path once the hover delay has elapsed
+  void ShowTooltipNow(content::WebContents* web_contents,
+                      const ElementInfo& element_info,
+                      const gfx::Point& mouse_position);
+
+  // Show the tooltip view for |element_info|, whose cache key is
+  // |element_key|, and notify observers
+  void DisplayTooltip(const ElementInfo& element_info, uint64_t element_key);
+
+  // Show a cached payload without capturing or asking the AI provider
+  void ShowCachedTooltip(const ElementInfo& element_info,
+                         uint64_t cache_key,
+                         const TooltipPayload& payload);
+
+  // Token for work belonging to the current tooltip, created on demand
+  TooltipRequestToken* GetRequestToken();
+
+  // Cancel the screenshot and AI work started for the current tooltip
+  void CancelInFlightRequests();
+
+  // Check if a completion for |generation| still belongs to the current
+  // tooltip
+  bool IsCurrentGeneration(uint64_t generation) const;
+
+  // Start the text-only AI request for a pipelined show
+  void StartPipelinedDescription(const ElementInfo& element_info);
+
+  // Component callbacks
+  void OnScreenshotCaptured(uint64_t generation, const gfx::Image& screenshot);
+  void OnAIResponseReceived(uint64_t generation, const AIResponse& response);
+  void OnPipelinedAIResponse(uint64_t generation,
+                             AIRequestStage stage,
+                             const AIResponse& response);
+
+  // Hold |image| for the AI request about to be sent
+  void LeaseImageForAIRequest(scoped_refptr<BudgetedImage> image);
+
+  // Apply a description that belongs to the current tooltip
+  void HandleAIResponse(const AIResponse& response);
+
+  // Handle tooltip positioning
+  gfx::Rect CalculateTooltipPosition(const gfx::Rect& element_bounds,
+                                    const gfx::Size& tooltip_size,
+                                    const gfx::Size& viewport_size);
+
+  // Record the time-to-description span once per tooltip
+  void RecordTimeToDescription();
+
+  TooltipTraceRecorder* tracer() { return service_->GetTraceRecorder(); }
+
+  // Tooltip view, created the first time this tab shows a tooltip
+  TooltipView* GetTooltipView();
+
+  // Key of |element_info| in the payload cache
+  uint64_t ComputeCacheKey(const ElementInfo& element_info) const;
+
+  TooltipService* const service_;
+
+  // Tabs that never show a tooltip never pay for a view
+  std::unique_ptr<TooltipView> tooltip_view_;
+  std::unique_ptr<HoverIntentScheduler> hover_scheduler_;
+  std::unique_ptr<PipelinedRequest> pipelined_request_;
+  std::unique_ptr<TooltipCache> cache_;
+
+  // Payload collected for the visible tooltip. It is stored in the cache
+  // under |cache_fill_key_| whenever a description arrives.
+  std::unique_ptr<TooltipPayload> cache_fill_;
+  uint64_t cache_fill_key_;
+
+  // Token shared by all work started for the current tooltip
+  scoped_refptr<TooltipRequestToken> request_token_;
+  uint64_t next_generation_;
+
+  // Trace of the current tooltip and the time its hover started
+  uint64_t trace_id_;
+  int64_t hover_start_us_;
+
+  bool tooltip_visible_;
+  // Cache key of the element the visible tooltip belongs to
+  uint64_t visible_element_key_;
+
+  // Screenshot shown by |tooltip_view_| and the one attached to the AI
+  // request in flight, charged to the service's image budget
+  std::unique_ptr<TooltipImageBudget::Lease> view_image_lease_;
+  std::unique_ptr<TooltipImageBudget::Lease> ai_image_lease_;
+
+  base::WeakPtrFactory<TooltipTabState> weak_ptr_factory_{this};
+
+  DISALLOW_COPY_AND_ASSIGN(TooltipTabState);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_TOOLTIP_TAB_STATE_H_
@@ -0,0 +1,270 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "tooltip_trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+
+#ifndef STANDALONE_TOOLTIP_BUILD
+#include "base/trace_event/trace_event.h"
+#endif
+
+namespace tooltip {
+
+namespace {
+
+const char kTraceCategory[] = "tooltip";
+
+const char* const kSpanNames[] = {
+    "hover_delay",    "show",                 "screenshot_capture",
+    "ai_description", "ai_refinement",        "ai_response_handling",
+    "time_to_description",
+};
+
+static_assert(sizeof(kSpanNames) / sizeof(kSpanNames[0]) ==
+                  static_cast<size_t>(TooltipTraceRecorder::Span::kCount),
+              "kSpanNames must name every span");
+
+size_t SpanIndex(TooltipTraceRecorder::Span span) {
+  return static_cast<size_t>(span);
+}
+
+#ifndef STANDALONE_TOOLTIP_BUILD
+// NowMicros() reads the same monotonic clock as base::TimeTicks
+base::TimeTicks ToTimeTicks(int64_t us) {
+  return base::TimeTicks() + base::TimeDelta::FromMicroseconds(us);
+}
+#endif
+
+void AppendJsonString(const std::string& value, std::ostringstream* out) {
+  *out << '"';
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        *out << "\\\"";
+        break;
+      case '\\':
+        *out << "\\\\";
+        break;
+      case '\n':
+        *out << "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          *out << ' ';
+        } else {
+          *out << c;
+        }
+    }
+  }
+  *out << '"';
+}
+
+int64_t Percentile(const std::vector<int64_t>& sorted, int percent) {
+  size_t index = (sorted.size() - 1) * percent / 100;
+  return sorted[index];
+}
+
+}  // namespace
+
+const size_t TooltipTraceRecorder::kMaxCompletedTraces = 256;
+const size_t TooltipTraceRecorder::kMaxSamplesPerSpan = 4096;
+
+TooltipTraceRecorder::TooltipTraceRecorder() : next_trace_id_(1) {
+  std::fill(std::begin(next_sample_), std::end(next_sample_), 0);
+}
+
+TooltipTraceRecorder::~TooltipTraceRecorder() = default;
+
+// static
+int64_t TooltipTraceRecorder::NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// static
+const char* TooltipTraceRecorder::GetSpanName(Span span) {
+  return kSpanNames[SpanIndex(span)];
+}
+
+uint64_t TooltipTraceRecorder::StartTrace(const std::string& label) {
+  uint64_t trace_id = next_trace_id_++;
+  Trace& trace = active_traces_[trace_id];
+  trace.id = trace_id;
+  trace.label = label;
+  return trace_id;
+}
+
+void TooltipTraceRecorder::BeginSpan(uint64_t trace_id, Span span) {
+  Trace* trace = FindActiveTrace(trace_id);
+  if (!trace) {
+    return;
+  }
+
+  trace->spans.push_back(SpanRecord{span, NowMicros(), -1, false});
+#ifndef STANDALONE_TOOLTIP_BUILD
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN0(kTraceCategory, GetSpanName(span),
+                                    TRACE_ID_LOCAL(trace_id));
+#endif
+}
+
+void TooltipTraceRecorder::EndSpan(uint64_t trace_id, Span span) {
+  Trace* trace = FindActiveTrace(trace_id);
+  if (!trace) {
+    return;
+  }
+
+  for (auto it = trace->spans.rbegin(); it != trace->spans.rend(); ++it) {
+    if (it->span == span && it->end_us < 0) {
+      it->end_us = NowMicros();
+      AddSample(span, it->end_us - it->begin_us);
+#ifndef STANDALONE_TOOLTIP_BUILD
+      TRACE_EVENT_NESTABLE_ASYNC_END0(kTraceCategory, GetSpanName(span),
+                                      TRACE_ID_LOCAL(trace_id));
+#endif
+      return;
+    }
+  }
+}
+
+void TooltipTraceRecorder::RecordSpan(uint64_t trace_id,
+                                      Span span,
+                                      int64_t begin_us,
+                                      int64_t end_us) {
+  Trace* trace = FindActiveTrace(trace_id);
+  if (!trace) {
+    return;
+  }
+
+  trace->spans.push_back(SpanRecord{span, begin_us, end_us, false});
+  AddSample(span, end_us - begin_us);
+#ifndef STANDALONE_TOOLTIP_BUILD
+  TRACE_EVENT_NESTABLE_ASYNC_BEGIN_WITH_TIMESTAMP0(
+      kTraceCategory, GetSpanName(span), TRACE_ID_LOCAL(trace_id),
+      ToTimeTicks(begin_us));
+  TRACE_EVENT_NESTABLE_ASYNC_END_WITH_TIMESTAMP0(
+      kTraceCategory, GetSpanName(span), TRACE_ID_LOCAL(trace_id),
+      ToTimeTicks(end_us));
+#endif
+}
+
+bool TooltipTraceRecorder::HasSpan(uint64_t trace_id, Span span) const {
+  const Trace* trace = FindActiveTrace(trace_id);
+  if (!trace) {
+    return false;
+  }
+
+  return std::any_of(trace->spans.begin(), trace->spans.end(),
+                     [span](const SpanRecord& record) {
+                       return record.span == span && record.end_us >= 0;
+                     });
+}
+
+void TooltipTraceRecorder::FinishTrace(uint64_t trace_id) {
+  auto it = active_traces_.find(trace_id);
+  if (it == active_traces_.end()) {
+    return;
+  }
+
+  int64_t now = NowMicros();
+  for (SpanRecord& record : it->second.spans) {
+    if (record.end_us < 0) {
+      record.end_us = now;
+      record.cancelled = true;
+#ifndef STANDALONE_TOOLTIP_BUILD
+      TRACE_EVENT_NESTABLE_ASYNC_END0(kTraceCategory,
+                                      GetSpanName(record.span),
+                                      TRACE_ID_LOCAL(trace_id));
+#endif
+    }
+  }
+
+  completed_traces_.push_back(std::move(it->second));
+  active_traces_.erase(it);
+  if (completed_traces_.size() > kMaxCompletedTraces) {
+    completed_traces_.pop_front();
+  }
+}
+
+std::string TooltipTraceRecorder::ExportChromeTraceJson() const {
+  std::ostringstream out;
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  bool first = true;
+  for (const Trace& trace : completed_traces_) {
+    for (const SpanRecord& record : trace.spans) {
+      if (!first) {
+        out << ',';
+      }
+      first = false;
+
+      // Complete events on one track per trace
+      out << "{\"name\":\"" << GetSpanName(record.span) << "\",\"cat\":\""
+          << kTraceCategory << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+          << trace.id << ",\"ts\":" << record.begin_us
+          << ",\"dur\":" << (record.end_us - record.begin_us)
+          << ",\"args\":{\"element\":";
+      AppendJsonString(trace.label, &out);
+      out << ",\"cancelled\":" << (record.cancelled ? "true" : "false")
+          << "}}";
+    }
+  }
+
+  out << "]}";
+  return out.str();
+}
+
+TooltipTraceRecorder::SpanSummary TooltipTraceRecorder::GetSpanSummary(
+    Span span) const {
+  SpanSummary summary;
+  std::vector<int64_t> sorted = samples_[SpanIndex(span)];
+  if (sorted.empty()) {
+    return summary;
+  }
+
+  std::sort(sorted.begin(), sorted.end());
+  summary.count = sorted.size();
+  summary.p50_us = Percentile(sorted, 50);
+  summary.p95_us = Percentile(sorted, 95);
+  summary.p99_us = Percentile(sorted, 99);
+  summary.max_us = sorted.back();
+  return summary;
+}
+
+void TooltipTraceRecorder::Reset() {
+  active_traces_.clear();
+  completed_traces_.clear();
+  for (size_t i = 0; i < static_cast<size_t>(Span::kCount); ++i) {
+    samples_[i].clear();
+    next_sample_[i] = 0;
+  }
+}
+
+TooltipTraceRecorder::Trace* TooltipTraceRecorder::FindActiveTrace(
+    uint64_t trace_id) {
+  auto it = active_traces_.find(trace_id);
+  return it == active_traces_.end() ? nullptr : &it->second;
+}
+
+const TooltipTraceRecorder::Trace* TooltipTraceRecorder::FindActiveTrace(
+    uint64_t trace_id) const {
+  auto it = active_traces_.find(trace_id);
+  return it == active_traces_.end() ? nullptr : &it->second;
+}
+
+void TooltipTraceRecorder::AddSample(Span span, int64_t duration_us) {
+  std::vector<int64_t>& samples = samples_[SpanIndex(span)];
+  size_t& next = next_sample_[SpanIndex(span)];
+  if (samples.size() < kMaxSamplesPerSpan) {
+    samples.push_back(duration_us);
+  } else {
+    samples[next] = duration_us;
+  }
+  next = (next + 1) % kMaxSamplesPerSpan;
+}
+
+}  // namespace tooltip
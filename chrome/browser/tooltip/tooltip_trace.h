@@ -0,0 +1,141 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_TOOLTIP_TRACE_H_
+#define CHROME_BROWSER_TOOLTIP_TOOLTIP_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#endif
+
+namespace tooltip {
+
+// Records where the time goes between a hover and the tooltip description:
+// one trace per shown tooltip, made of timed spans for each stage. Traces
+// can be exported as Chrome trace-event JSON (loadable in chrome://tracing
+// or Perfetto) and are aggregated into per-span latency percentiles.
+//
+// Timestamps come from a monotonic clock in microseconds, so the recorder
+// works the same in STANDALONE_TOOLTIP_BUILD and in the browser, where the
+// spans are also emitted as trace events. Must be used on the UI thread.
+class TooltipTraceRecorder {
+ public:
+  enum class Span {
+    // ShowTooltipForElement() until the hover delay elapsed
+    kHoverDelay,
+    // Start of the show path until TooltipView::ShowAt() returned
+    kShow,
+    // ScreenshotCapture::CaptureElement() until the screenshot arrived
+    kScreenshotCapture,
+    // AIIntegration::GetDescription() until the response arrived
+    kAIDescription,
+    // Image refinement request of a pipelined show
+    kAIRefinement,
+    // Applying a response to the view and observers
+    kAIResponseHandling,
+    // ShowTooltipForElement() until the first description was displayed
+    kTimeToDescription,
+    kCount,
+  };
+
+  // Latency percentiles of one span, in microseconds
+  struct SpanSummary {
+    size_t count = 0;
+    int64_t p50_us = 0;
+    int64_t p95_us = 0;
+    int64_t p99_us = 0;
+    int64_t max_us = 0;
+  };
+
+  // Completed traces kept for export
+  static const size_t kMaxCompletedTraces;
+  // Samples kept per span for the percentiles
+  static const size_t kMaxSamplesPerSpan;
+
+  TooltipTraceRecorder();
+  ~TooltipTraceRecorder();
+
+  // Current monotonic time in microseconds
+  static int64_t NowMicros();
+
+  // Name used for |span| in exports
+  static const char* GetSpanName(Span span);
+
+  // Start a trace for the tooltip of an element labelled |label|. Returns
+  // the trace id; 0 is never used.
+  uint64_t StartTrace(const std::string& label);
+
+  // Open a span at the current time. A span may be opened more than once
+  // per trace.
+  void BeginSpan(uint64_t trace_id, Span span);
+
+  // Close the most recently opened |span| of the trace, if any
+  void EndSpan(uint64_t trace_id, Span span);
+
+  // Add a span that has already completed
+  void RecordSpan(uint64_t trace_id,
+                  Span span,
+                  int64_t begin_us,
+                  int64_t end_us);
+
+  // Check if the trace has a completed |span|
+  bool HasSpan(uint64_t trace_id, Span span) const;
+
+  // Close the trace. Spans still open are marked cancelled and left out of
+  // the percentiles.
+  void FinishTrace(uint64_t trace_id);
+
+  // Completed traces in Chrome trace-event JSON format
+  std::string ExportChromeTraceJson() const;
+
+  SpanSummary GetSpanSummary(Span span) const;
+
+  // Drop all traces and samples
+  void Reset();
+
+ private:
+  struct SpanRecord {
+    Span span;
+    int64_t begin_us;
+    // -1 while the span is open
+    int64_t end_us;
+    bool cancelled;
+  };
+
+  struct Trace {
+    uint64_t id;
+    std::string label;
+    std::vector<SpanRecord> spans;
+  };
+
+  Trace* FindActiveTrace(uint64_t trace_id);
+  const Trace* FindActiveTrace(uint64_t trace_id) const;
+
+  // Add a completed span to the percentile samples
+  void AddSample(Span span, int64_t duration_us);
+
+  uint64_t next_trace_id_;
+  std::map<uint64_t, Trace> active_traces_;
+  std::deque<Trace> completed_traces_;
+
+  // Ring buffer of durations per span
+  std::vector<int64_t> samples_[static_cast<size_t>(Span::kCount)];
+  size_t next_sample_[static_cast<size_t>(Span::kCount)];
+
+  DISALLOW_COPY_AND_ASSIGN(TooltipTraceRecorder);
+};
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_TOOLTIP_TRACE_H_
@@ -0,0 +1,431 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "tooltip_wire_format.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+
+namespace tooltip {
+
+namespace {
+
+// Header layout:
+//   0  magic "TW"
+//   2  format version
+//   3  record type
+//   4  field count (uint16)
+//   6  reserved, zero
+//   8  total record size (uint32)
+// followed by one kind byte per field, padding to 8 bytes, one 8-byte slot
+// per field and the payload. Offsets in slots are from the record start.
+constexpr uint8_t kMagic0 = 'T';
+constexpr uint8_t kMagic1 = 'W';
+constexpr size_t kHeaderSize = 12;
+constexpr size_t kSlotSize = 8;
+// Each list table entry is an offset and a size
+constexpr size_t kListEntrySize = 8;
+
+size_t SlotsOffset(size_t field_count) {
+  return (kHeaderSize + field_count + 7) & ~static_cast<size_t>(7);
+}
+
+size_t PayloadOffset(size_t field_count) {
+  return SlotsOffset(field_count) + field_count * kSlotSize;
+}
+
+void StoreUint16(char* out, uint16_t value) {
+  out[0] = static_cast<char>(value);
+  out[1] = static_cast<char>(value >> 8);
+}
+
+void StoreUint32(char* out, uint32_t value) {
+  StoreUint16(out, static_cast<uint16_t>(value));
+  StoreUint16(out + 2, static_cast<uint16_t>(value >> 16));
+}
+
+void StoreUint64(char* out, uint64_t value) {
+  StoreUint32(out, static_cast<uint32_t>(value));
+  StoreUint32(out + 4, static_cast<uint32_t>(value >> 32));
+}
+
+uint16_t LoadUint16(const char* in) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(in);
+  return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+uint32_t LoadUint32(const char* in) {
+  return LoadUint16(in) | (static_cast<uint32_t>(LoadUint16(in + 2)) << 16);
+}
+
+uint64_t LoadUint64(const char* in) {
+  return LoadUint32(in) | (static_cast<uint64_t>(LoadUint32(in + 4)) << 32);
+}
+
+uint64_t MakeRangeSlot(size_t offset, size_t size) {
+  return static_cast<uint64_t>(offset) | (static_cast<uint64_t>(size) << 32);
+}
+
+uint32_t SlotOffset(uint64_t slot) {
+  return static_cast<uint32_t>(slot);
+}
+
+uint32_t SlotSize(uint64_t slot) {
+  return static_cast<uint32_t>(slot >> 32);
+}
+
+bool RangeInBounds(uint64_t offset, uint64_t size, uint64_t limit) {
+  return offset <= limit && size <= limit - offset;
+}
+
+std::string ToString(std::string_view value) {
+  return std::string(value.data(), value.size());
+}
+
+}  // namespace
+
+enum class WireFieldKind : uint8_t {
+  kAbsent = 0,
+  kInt = 1,
+  // Slot holds the offset and size of the bytes
+  kString = 2,
+  // Slot holds the offset and entry count of a table of string ranges
+  kStringList = 3,
+};
+
+// WireRecordBuilder implementation
+WireRecordBuilder::WireRecordBuilder(WireRecordType type, size_t field_count)
+    : type_(type), field_count_(field_count), list_cursor_(0) {
+  DCHECK_LE(field_count, kMaxFields);
+  memset(kinds_, 0, sizeof(kinds_));
+  memset(slots_, 0, sizeof(slots_));
+}
+
+WireRecordBuilder::~WireRecordBuilder() = default;
+
+void WireRecordBuilder::SetInt(size_t field, int64_t value) {
+  DCHECK_LT(field, field_count_);
+  kinds_[field] = WireFieldKind::kInt;
+  slots_[field] = static_cast<uint64_t>(value);
+}
+
+void WireRecordBuilder::SetString(size_t field, std::string_view value) {
+  DCHECK_LT(field, field_count_);
+  kinds_[field] = WireFieldKind::kString;
+  slots_[field] =
+      MakeRangeSlot(PayloadOffset(field_count_) + payload_.size(),
+                    value.size());
+  payload_.append(value.data(), value.size());
+}
+
+void WireRecordBuilder::BeginStringList(size_t field, size_t count) {
+  DCHECK_LT(field, field_count_);
+  kinds_[field] = WireFieldKind::kStringList;
+  slots_[field] =
+      MakeRangeSlot(PayloadOffset(field_count_) + payload_.size(), count);
+  // The table comes first so that it can be found from the slot; the
+  // strings follow and the entries are filled in as they are added
+  list_cursor_ = payload_.size();
+  payload_.append(count * kListEntrySize, '\0');
+}
+
+void WireRecordBuilder::AddStringListItem(std::string_view value) {
+  DCHECK_LE(list_cursor_ + kListEntrySize, payload_.size());
+  StoreUint64(&payload_[list_cursor_],
+              MakeRangeSlot(PayloadOffset(field_count_) + payload_.size(),
+                            value.size()));
+  list_cursor_ += kListEntrySize;
+  payload_.append(value.data(), value.size());
+}
+
+void WireRecordBuilder::Finish(std::string* output) const {
+  size_t slots_offset = SlotsOffset(field_count_);
+  size_t payload_offset = PayloadOffset(field_count_);
+  size_t total_size = payload_offset + payload_.size();
+  DCHECK_LE(total_size, UINT32_MAX);
+
+  output->clear();
+  output->reserve(total_size);
+  output->assign(payload_offset, '\0');
+  char* header = &(*output)[0];
+  header[0] = static_cast<char>(kMagic0);
+  header[1] = static_cast<char>(kMagic1);
+  header[2] = static_cast<char>(kWireFormatVersion);
+  header[3] = static_cast<char>(type_);
+  StoreUint16(header + 4, static_cast<uint16_t>(field_count_));
+  StoreUint32(header + 8, static_cast<uint32_t>(total_size));
+  for (size_t i = 0; i < field_count_; ++i) {
+    header[kHeaderSize + i] = static_cast<char>(kinds_[i]);
+    StoreUint64(header + slots_offset + i * kSlotSize, slots_[i]);
+  }
+  output->append(payload_);
+}
+
+// WireRecordView implementation
+WireRecordView::WireRecordView() : field_count_(0) {}
+
+bool WireRecordView::Init(std::string_view data,
+                          WireRecordType expected_type) {
+  data_ = std::string_view();
+  field_count_ = 0;
+
+  if (data.size() < kHeaderSize ||
+      static_cast<uint8_t>(data[0]) != kMagic0 ||
+      static_cast<uint8_t>(data[1]) != kMagic1 ||
+      static_cast<uint8_t>(data[2]) != kWireFormatVersion ||
+      static_cast<uint8_t>(data[3]) != static_cast<uint8_t>(expected_type) ||
+      LoadUint32(data.data() + 8) != data.size()) {
+    return false;
+  }
+
+  size_t field_count = LoadUint16(data.data() + 4);
+  if (PayloadOffset(field_count) > data.size()) {
+    return false;
+  }
+
+  size_t slots_offset = SlotsOffset(field_count);
+  for (size_t i = 0; i < field_count; ++i) {
+    uint64_t slot = LoadUint64(data.data() + slots_offset + i * kSlotSize);
+    switch (static_cast<WireFieldKind>(data[kHeaderSize + i])) {
+      case WireFieldKind::kAbsent:
+      case WireFieldKind::kInt:
+        break;
+      case WireFieldKind::kString:
+        if (!RangeInBounds(SlotOffset(slot), SlotSize(slot), data.size())) {
+          return false;
+        }
+        break;
+      case WireFieldKind::kStringList: {
+        uint64_t table_size =
+            static_cast<uint64_t>(SlotSize(slot)) * kListEntrySize;
+        if (!RangeInBounds(SlotOffset(slot), table_size, data.size())) {
+          return false;
+        }
+        for (size_t j = 0; j < SlotSize(slot); ++j) {
+          uint64_t entry = LoadUint64(data.data() + SlotOffset(slot) +
+                                      j * kListEntrySize);
+          if (!RangeInBounds(SlotOffset(entry), SlotSize(entry),
+                             data.size())) {
+            return false;
+          }
+        }
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+
+  data_ = data;
+  field_count_ = field_count;
+  return true;
+}
+
+WireFieldKind WireRecordView::GetKind(size_t field) const {
+  if (field >= field_count_) {
+    return WireFieldKind::kAbsent;
+  }
+  return static_cast<WireFieldKind>(data_[kHeaderSize + field]);
+}
+
+uint64_t WireRecordView::GetSlot(size_t field) const {
+  return LoadUint64(data_.data() + SlotsOffset(field_count_) +
+                    field * kSlotSize);
+}
+
+int64_t WireRecordView::GetInt(size_t field) const {
+  if (GetKind(field) != WireFieldKind::kInt) {
+    return 0;
+  }
+  return static_cast<int64_t>(GetSlot(field));
+}
+
+std::string_view WireRecordView::GetString(size_t field) const {
+  if (GetKind(field) != WireFieldKind::kString) {
+    return std::string_view();
+  }
+  uint64_t slot = GetSlot(field);
+  return data_.substr(SlotOffset(slot), SlotSize(slot));
+}
+
+size_t WireRecordView::GetStringListSize(size_t field) const {
+  if (GetKind(field) != WireFieldKind::kStringList) {
+    return 0;
+  }
+  return SlotSize(GetSlot(field));
+}
+
+std::string_view WireRecordView::GetStringListItem(size_t field,
+                                                   size_t index) const {
+  DCHECK_LT(index, GetStringListSize(field));
+  uint64_t entry = LoadUint64(data_.data() + SlotOffset(GetSlot(field)) +
+                              index * kListEntrySize);
+  return data_.substr(SlotOffset(entry), SlotSize(entry));
+}
+
+// ElementInfo
+gfx::Rect ElementInfoWireView::bounds() const {
+  return gfx::Rect(static_cast<int>(record_.GetInt(kBoundsX)),
+                   static_cast<int>(record_.GetInt(kBoundsY)),
+                   static_cast<int>(record_.GetInt(kBoundsWidth)),
+                   static_cast<int>(record_.GetInt(kBoundsHeight)));
+}
+
+bool ElementInfoWireView::GetStyle(ComputedStyleBlock* style) const {
+  std::string_view encoded = record_.GetString(kStyleBlock);
+  return !encoded.empty() && ComputedStyleBlock::Decode(encoded, style);
+}
+
+ElementInfo ElementInfoWireView::ToElementInfo() const {
+  ElementInfo element_info;
+  element_info.tag_name = ToString(tag_name());
+  element_info.id = ToString(id());
+  element_info.class_name = ToString(class_name());
+  element_info.text_content = ToString(text_content());
+  element_info.href = ToString(href());
+  element_info.src = ToString(src());
+  element_info.alt_text = ToString(alt_text());
+  element_info.title = ToString(title());
+  element_info.role = ToString(role());
+  element_info.aria_label = ToString(aria_label());
+  element_info.type = ToString(type());
+  element_info.bounds = bounds();
+  element_info.computed_styles = ToString(computed_styles());
+  ComputedStyleBlock style;
+  if (GetStyle(&style)) {
+    element_info.SetStyle(style);
+  } else {
+    element_info.ParseComputedStyles();
+  }
+  return element_info;
+}
+
+void EncodeElementInfo(const ElementInfo& element_info, std::string* output) {
+  using Field = ElementInfoWireView::Field;
+  WireRecordBuilder builder(WireRecordType::kElementInfo, Field::kFieldCount);
+  builder.SetString(Field::kTagName, element_info.tag_name);
+  builder.SetString(Field::kId, element_info.id);
+  builder.SetString(Field::kClassName, element_info.class_name);
+  builder.SetString(Field::kTextContent, element_info.text_content);
+  builder.SetString(Field::kHref, element_info.href);
+  builder.SetString(Field::kSrc, element_info.src);
+  builder.SetString(Field::kAltText, element_info.alt_text);
+  builder.SetString(Field::kTitle, element_info.title);
+  builder.SetString(Field::kRole, element_info.role);
+  builder.SetString(Field::kAriaLabel, element_info.aria_label);
+  builder.SetString(Field::kType, element_info.type);
+  builder.SetInt(Field::kBoundsX, element_info.bounds.x());
+  builder.SetInt(Field::kBoundsY, element_info.bounds.y());
+  builder.SetInt(Field::kBoundsWidth, element_info.bounds.width());
+  builder.SetInt(Field::kBoundsHeight, element_info.bounds.height());
+  builder.SetString(Field::kComputedStyles, element_info.computed_styles);
+  // Ship the parsed style so the receiver does not parse the text again
+  if (element_info.has_style) {
+    builder.SetString(Field::kStyleBlock, element_info.GetStyle().Encode());
+  }
+  builder.Finish(output);
+}
+
+bool DecodeElementInfo(std::string_view data, ElementInfo* element_info) {
+  ElementInfoWireView view;
+  if (!view.Init(data)) {
+    return false;
+  }
+  *element_info = view.ToElementInfo();
+  return true;
+}
+
+// AIResponse
+AIResponse AIResponseWireView::ToAIResponse() const {
+  AIResponse response;
+  response.provider = ToString(provider());
+  response.description = ToString(description());
+  response.confidence = ToString(confidence());
+  response.timestamp = timestamp();
+  size_t count = suggested_action_count();
+  response.suggested_actions.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    response.suggested_actions.push_back(ToString(suggested_action(i)));
+  }
+  return response;
+}
+
+void EncodeAIResponse(const AIResponse& response, std::string* output) {
+  using Field = AIResponseWireView::Field;
+  WireRecordBuilder builder(WireRecordType::kAIResponse, Field::kFieldCount);
+  builder.SetString(Field::kProvider, response.provider);
+  builder.SetString(Field::kDescription, response.description);
+  builder.SetString(Field::kConfidence, response.confidence);
+  builder.SetInt(Field::kTimestamp, response.timestamp);
+  builder.SetStringList(Field::kSuggestedActions, response.suggested_actions);
+  builder.Finish(output);
+}
+
+bool DecodeAIResponse(std::string_view data, AIResponse* response) {
+  AIResponseWireView view;
+  if (!view.Init(data)) {
+    return false;
+  }
+  *response = view.ToAIResponse();
+  return true;
+}
+
+// AutomationAction
+AutomationAction AutomationActionWireView::ToAutomationAction() const {
+  AutomationAction action;
+  action.type = type();
+  action.text_input = ToString(text_input());
+  return action;
+}
+
+void EncodeAutomationAction(const AutomationAction& action,
+                            std::string* output) {
+  using Field = AutomationActionWireView::Field;
+  WireRecordBuilder builder(WireRecordType::kAutomationAction,
+                            Field::kFieldCount);
+  builder.SetInt(Field::kType, static_cast<int64_t>(action.type));
+  builder.SetString(Field::kTextInput, action.text_input);
+  builder.Finish(output);
+}
+
+bool DecodeAutomationAction(std::string_view data, AutomationAction* action) {
+  AutomationActionWireView view;
+  if (!view.Init(data)) {
+    return false;
+  }
+  *action = view.ToAutomationAction();
+  return true;
+}
+
+// AutomationResult
+AutomationResult AutomationResultWireView::ToAutomationResult() const {
+  AutomationResult result;
+  result.success = success();
+  result.result_data = ToString(result_data());
+  result.error_message = ToString(error_message());
+  return result;
+}
+
+void EncodeAutomationResult(const AutomationResult& result,
+                            std::string* output) {
+  using Field = AutomationResultWireView::Field;
+  WireRecordBuilder builder(WireRecordType::kAutomationResult,
+                            Field::kFieldCount);
+  builder.SetInt(Field::kSuccess, result.success ? 1 : 0);
+  builder.SetString(Field::kResultData, result.result_data);
+  builder.SetString(Field::kErrorMessage, result.error_message);
+  builder.Finish(output);
+}
+
+bool DecodeAutomationResult(std::string_view data, AutomationResult* result) {
+  AutomationResultWireView view;
+  if (!view.Init(data)) {
+    return false;
+  }
+  *result = view.ToAutomationResult();
+  return true;
+}
+
+}  // namespace tooltip
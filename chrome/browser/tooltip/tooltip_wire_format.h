@@ -0,0 +1,293 @@
+// Copyright 2024 The Chromium Authors
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CHROME_BROWSER_TOOLTIP_TOOLTIP_WIRE_FORMAT_H_
+#define CHROME_BROWSER_TOOLTIP_TOOLTIP_WIRE_FORMAT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/macros.h"
+#include "ui/gfx/geometry/rect.h"
+#endif
+#include "chrome/browser/tooltip/navigrab_integration.h"
+#include "chrome/browser/tooltip/tooltip_service.h"
+
+namespace tooltip {
+
+// Binary encoding for the tooltip types that cross process boundaries
+// (renderer to browser, tooltip service to NaviGrab and the API layer).
+//
+// A record is a fixed header, one kind byte per field, one 8-byte slot per
+// field and then the string payload. Slots hold integers directly and
+// strings as an offset and size into the payload, so any field is found in
+// constant time and strings are read in place. All integers are
+// little-endian and read byte-wise, so records need no alignment.
+//
+// Fields are only ever appended. A reader treats fields missing from an
+// older record as empty and ignores fields added by a newer writer; an
+// incompatible layout change bumps kWireFormatVersion, which readers
+// reject.
+
+constexpr uint8_t kWireFormatVersion = 1;
+
+// How a field's slot is interpreted; defined in the .cc
+enum class WireFieldKind : uint8_t;
+
+enum class WireRecordType : uint8_t {
+  kElementInfo = 1,
+  kAIResponse = 2,
+  kAutomationAction = 3,
+  kAutomationResult = 4,
+};
+
+// Writes one record. Fields may be set in any order; unset fields are
+// encoded as absent.
+class WireRecordBuilder {
+ public:
+  static constexpr size_t kMaxFields = 32;
+
+  WireRecordBuilder(WireRecordType type, size_t field_count);
+  ~WireRecordBuilder();
+
+  void SetInt(size_t field, int64_t value);
+  void SetString(size_t field, std::string_view value);
+  template <typename Container>
+  void SetStringList(size_t field, const Container& values);
+
+  // Replaces the contents of |output| with the record
+  void Finish(std::string* output) const;
+
+ private:
+  void BeginStringList(size_t field, size_t count);
+  void AddStringListItem(std::string_view value);
+
+  const WireRecordType type_;
+  const size_t field_count_;
+  WireFieldKind kinds_[kMaxFields];
+  uint64_t slots_[kMaxFields];
+
+  // String bytes and list tables, in order of the Set calls
+  std::string payload_;
+  // Where the next list entry goes while a list is being written
+  size_t list_cursor_;
+
+  DISALLOW_COPY_AND_ASSIGN(WireRecordBuilder);
+};
+
+template <typename Container>
+void WireRecordBuilder::SetStringList(size_t field, const Container& values) {
+  BeginStringList(field, values.size());
+  for (const auto& value : values) {
+    AddStringListItem(value);
+  }
+}
+
+// Read-only view of an encoded record. Init() checks the header and that
+// every string and list stays inside the buffer, so the accessors need no
+// further bounds checks. The buffer must outlive the view.
+class WireRecordView {
+ public:
+  WireRecordView();
+
+  bool Init(std::string_view data, WireRecordType expected_type);
+
+  // Number of fields the writer knew about
+  size_t field_count() const { return field_count_; }
+
+  // Absent fields and fields of another kind read as 0 or empty
+  int64_t GetInt(size_t field) const;
+  std::string_view GetString(size_t field) const;
+  size_t GetStringListSize(size_t field) const;
+  std::string_view GetStringListItem(size_t field, size_t index) const;
+
+ private:
+  WireFieldKind GetKind(size_t field) const;
+  uint64_t GetSlot(size_t field) const;
+
+  std::string_view data_;
+  size_t field_count_;
+};
+
+// In-place readers for each record type. Strings are views into the
+// encoded buffer, which must outlive the reader.
+class ElementInfoWireView {
+ public:
+  bool Init(std::string_view data) {
+    return record_.Init(data, WireRecordType::kElementInfo);
+  }
+
+  std::string_view tag_name() const { return record_.GetString(kTagName); }
+  std::string_view id() const { return record_.GetString(kId); }
+  std::string_view class_name() const {
+    return record_.GetString(kClassName);
+  }
+  std::string_view text_content() const {
+    return record_.GetString(kTextContent);
+  }
+  std::string_view href() const { return record_.GetString(kHref); }
+  std::string_view src() const { return record_.GetString(kSrc); }
+  std::string_view alt_text() const { return record_.GetString(kAltText); }
+  std::string_view title() const { return record_.GetString(kTitle); }
+  std::string_view role() const { return record_.GetString(kRole); }
+  std::string_view aria_label() const {
+    return record_.GetString(kAriaLabel);
+  }
+  std::string_view type() const { return record_.GetString(kType); }
+  gfx::Rect bounds() const;
+  std::string_view computed_styles() const {
+    return record_.GetString(kComputedStyles);
+  }
+
+  // The parsed style, if the sender had one. Returns false otherwise.
+  bool GetStyle(ComputedStyleBlock* style) const;
+
+  ElementInfo ToElementInfo() const;
+
+ private:
+  friend void EncodeElementInfo(const ElementInfo&, std::string*);
+
+  enum Field : size_t {
+    kTagName,
+    kId,
+    kClassName,
+    kTextContent,
+    kHref,
+    kSrc,
+    kAltText,
+    kTitle,
+    kRole,
+    kAriaLabel,
+    kType,
+    kBoundsX,
+    kBoundsY,
+    kBoundsWidth,
+    kBoundsHeight,
+    kComputedStyles,
+    // ComputedStyleBlock::Encode() output
+    kStyleBlock,
+    kFieldCount,
+  };
+
+  WireRecordView record_;
+};
+
+class AIResponseWireView {
+ public:
+  bool Init(std::string_view data) {
+    return record_.Init(data, WireRecordType::kAIResponse);
+  }
+
+  std::string_view provider() const { return record_.GetString(kProvider); }
+  std::string_view description() const {
+    return record_.GetString(kDescription);
+  }
+  std::string_view confidence() const {
+    return record_.GetString(kConfidence);
+  }
+  int64_t timestamp() const { return record_.GetInt(kTimestamp); }
+  size_t suggested_action_count() const {
+    return record_.GetStringListSize(kSuggestedActions);
+  }
+  std::string_view suggested_action(size_t index) const {
+    return record_.GetStringListItem(kSuggestedActions, index);
+  }
+
+  AIResponse ToAIResponse() const;
+
+ private:
+  friend void EncodeAIResponse(const AIResponse&, std::string*);
+
+  enum Field : size_t {
+    kProvider,
+    kDescription,
+    kConfidence,
+    kTimestamp,
+    kSuggestedActions,
+    kFieldCount,
+  };
+
+  WireRecordView record_;
+};
+
+class AutomationActionWireView {
+ public:
+  bool Init(std::string_view data) {
+    return record_.Init(data, WireRecordType::kAutomationAction);
+  }
+
+  AutomationActionType type() const {
+    return static_cast<AutomationActionType>(record_.GetInt(kType));
+  }
+  std::string_view text_input() const {
+    return record_.GetString(kTextInput);
+  }
+
+  AutomationAction ToAutomationAction() const;
+
+ private:
+  friend void EncodeAutomationAction(const AutomationAction&, std::string*);
+
+  enum Field : size_t {
+    kType,
+    kTextInput,
+    kFieldCount,
+  };
+
+  WireRecordView record_;
+};
+
+class AutomationResultWireView {
+ public:
+  bool Init(std::string_view data) {
+    return record_.Init(data, WireRecordType::kAutomationResult);
+  }
+
+  bool success() const { return record_.GetInt(kSuccess) != 0; }
+  std::string_view result_data() const {
+    return record_.GetString(kResultData);
+  }
+  std::string_view error_message() const {
+    return record_.GetString(kErrorMessage);
+  }
+
+  AutomationResult ToAutomationResult() const;
+
+ private:
+  friend void EncodeAutomationResult(const AutomationResult&, std::string*);
+
+  enum Field : size_t {
+    kSuccess,
+    kResultData,
+    kErrorMessage,
+    kFieldCount,
+  };
+
+  WireRecordView record_;
+};
+
+// Replace the contents of |output| with the encoded record
+void EncodeElementInfo(const ElementInfo& element_info, std::string* output);
+void EncodeAIResponse(const AIResponse& response, std::string* output);
+void EncodeAutomationAction(const AutomationAction& action,
+                            std::string* output);
+void EncodeAutomationResult(const AutomationResult& result,
+                            std::string* output);
+
+// Decode into owned structs. Return false, leaving the output untouched,
+// if |data| is not a valid record of the expected type.
+bool DecodeElementInfo(std::string_view data, ElementInfo* element_info);
+bool DecodeAIResponse(std::string_view data, AIResponse* response);
+bool DecodeAutomationAction(std::string_view data, AutomationAction* action);
+bool DecodeAutomationResult(std::string_view data, AutomationResult* result);
+
+}  // namespace tooltip
+
+#endif  // CHROME_BROWSER_TOOLTIP_TOOLTIP_WIRE_FORMAT_H_
@@ -0,0 +1,139 @@
+// Counts every heap allocation made through operator new by replacing the
+// global allocation functions, including the nothrow, aligned and sized
+// forms, so that every new is paired with a matching delete.
+//
+// Replacement allocation functions must be defined exactly once per
+// program: include this header from the benchmark's main source file only.
+
+#ifndef TESTS_BENCHMARKS_ALLOCATION_COUNTER_H_
+#define TESTS_BENCHMARKS_ALLOCATION_COUNTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+
+namespace {
+
+std::atomic<uint64_t> g_allocation_count{0};
+std::atomic<uint64_t> g_allocated_bytes{0};
+
+// Every replaced form allocates here and frees with FreeCounted(), so that
+// aligned and unaligned blocks share one deallocation function
+void* AllocateCounted(size_t size, size_t alignment) {
+  g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+  g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  void* pointer = nullptr;
+  if (alignment <= alignof(max_align_t)) {
+    pointer = malloc(size ? size : 1);
+  } else if (posix_memalign(&pointer, alignment, size ? size : 1) != 0) {
+    pointer = nullptr;
+  }
+  return pointer;
+}
+
+void FreeCounted(void* pointer) {
+  free(pointer);
+}
+
+void* AllocateCountedOrThrow(size_t size, size_t alignment) {
+  void* pointer = AllocateCounted(size, alignment);
+  if (!pointer) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+}  // namespace
+
+void* operator new(size_t size) {
+  return AllocateCountedOrThrow(size, 0);
+}
+
+void* operator new[](size_t size) {
+  return AllocateCountedOrThrow(size, 0);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return AllocateCounted(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return AllocateCounted(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  return AllocateCountedOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return AllocateCountedOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size,
+                   std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return AllocateCounted(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size,
+                     std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  return AllocateCounted(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete(void* pointer,
+                     std::align_val_t,
+                     const std::nothrow_t&) noexcept {
+  FreeCounted(pointer);
+}
+
+void operator delete[](void* pointer,
+                       std::align_val_t,
+                       const std::nothrow_t&) noexcept {
+  FreeCounted(pointer);
+}
+
+#endif  // TESTS_BENCHMARKS_ALLOCATION_COUNTER_H_
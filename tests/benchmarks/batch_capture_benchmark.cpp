@@ -0,0 +1,202 @@
+// Benchmark for screenshotting many elements of one page.
+//
+// Simulates a page whose captures cost a fixed latency (the round trip to
+// the compositor plus readback) and compares
+//   individual: one capture per element, as CaptureAllElementScreenshots()
+//               does today
+//   batched:    BatchElementCapture, one capture per viewport tile and
+//               parallel crops
+// Every batched crop is compared with the individual capture of the same
+// element, so the two modes must produce identical pixels.
+//
+// Usage:
+//   batch_capture_benchmark [--elements=N] [--capture-ms=N]
+//                           [--page-height=N] [--occluded-percent=N]
+
+#include <stdint.h>
+#include <string.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/batch_element_capture.h"
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  size_t elements = 300;
+  int capture_ms = 20;
+  int page_height = 6000;
+  int occluded_percent = 5;
+};
+
+const int kViewportWidth = 1280;
+const int kViewportHeight = 800;
+
+// Page whose pixels depend only on their page coordinates, so that a crop
+// of a tile and a direct capture of the same area can be compared
+class FakePage : public BatchElementCapture::Delegate {
+ public:
+  FakePage(int capture_ms, std::vector<bool> occluded)
+      : capture_ms_(capture_ms), occluded_(std::move(occluded)) {}
+
+  ScreenshotBitmap CaptureTile(const gfx::Rect& tile) override {
+    return Render(tile);
+  }
+
+  ScreenshotBitmap CaptureElement(const gfx::Rect& element_bounds) override {
+    return Render(element_bounds);
+  }
+
+  bool IsOccluded(const gfx::Rect& element_bounds,
+                  const gfx::Rect& /*tile*/) override {
+    // The benchmark marks elements by their top coordinate
+    return occluded_[element_bounds.y() % occluded_.size()];
+  }
+
+  size_t captures() const { return captures_; }
+  void ResetCaptures() { captures_ = 0; }
+
+ private:
+  ScreenshotBitmap Render(const gfx::Rect& area) {
+    ++captures_;
+    std::this_thread::sleep_for(std::chrono::milliseconds(capture_ms_));
+    ScreenshotBitmap bitmap(area.width(), area.height());
+    for (int y = 0; y < area.height(); ++y) {
+      uint8_t* row = bitmap.row(y);
+      for (int x = 0; x < area.width(); ++x) {
+        uint32_t page_x = area.x() + x;
+        uint32_t page_y = area.y() + y;
+        row[x * 4 + 0] = static_cast<uint8_t>(page_x * 7 + page_y);
+        row[x * 4 + 1] = static_cast<uint8_t>(page_y * 3);
+        row[x * 4 + 2] = static_cast<uint8_t>(page_x ^ page_y);
+        row[x * 4 + 3] = 0xFF;
+      }
+    }
+    return bitmap;
+  }
+
+  const int capture_ms_;
+  const std::vector<bool> occluded_;
+  size_t captures_ = 0;
+};
+
+bool SameBitmap(const ScreenshotBitmap& a, const ScreenshotBitmap& b) {
+  return a.width() == b.width() && a.height() == b.height() &&
+         memcmp(a.data(), b.data(), a.byte_size()) == 0;
+}
+
+double ElapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  std::mt19937 engine(17);
+  std::uniform_int_distribution<int> x(0, kViewportWidth - 200);
+  std::uniform_int_distribution<int> y(0, options.page_height - 100);
+  std::uniform_int_distribution<int> width(16, 200);
+  std::uniform_int_distribution<int> height(12, 100);
+
+  std::vector<gfx::Rect> elements;
+  for (size_t i = 0; i < options.elements; ++i) {
+    elements.emplace_back(x(engine), y(engine), width(engine),
+                          height(engine));
+  }
+  // A few elements too wide or too tall for any tile
+  if (!elements.empty()) {
+    elements[0] = gfx::Rect(0, 0, kViewportWidth + 100, 40);
+  }
+  if (elements.size() > 1) {
+    elements[1] = gfx::Rect(0, 200, 600, kViewportHeight + 50);
+  }
+
+  std::vector<bool> occluded(997);
+  std::uniform_int_distribution<int> percent(0, 99);
+  for (size_t i = 0; i < occluded.size(); ++i) {
+    occluded[i] = percent(engine) < options.occluded_percent;
+  }
+  FakePage page(options.capture_ms, occluded);
+
+  Clock::time_point start = Clock::now();
+  std::vector<ScreenshotBitmap> individual;
+  for (const gfx::Rect& bounds : elements) {
+    individual.push_back(page.CaptureElement(bounds));
+  }
+  double individual_ms = ElapsedMs(start);
+  size_t individual_captures = page.captures();
+  page.ResetCaptures();
+
+  BatchElementCapture::Options capture_options;
+  capture_options.viewport_size = gfx::Size(kViewportWidth, kViewportHeight);
+  capture_options.page_size = gfx::Size(kViewportWidth, options.page_height);
+  BatchElementCapture batch(&page, capture_options);
+
+  start = Clock::now();
+  std::vector<ScreenshotBitmap> batched = batch.Capture(elements);
+  double batched_ms = ElapsedMs(start);
+
+  for (size_t i = 0; i < elements.size(); ++i) {
+    if (!SameBitmap(individual[i], batched[i])) {
+      std::cerr << "Element " << i << " differs between modes" << std::endl;
+      return 1;
+    }
+  }
+
+  const BatchElementCapture::Stats& stats = batch.stats();
+  std::cout << std::fixed << std::setprecision(1) << elements.size()
+            << " elements on a " << kViewportWidth << "x"
+            << options.page_height << " page, " << options.capture_ms
+            << " ms per capture" << std::endl
+            << "  individual  " << std::setw(9) << individual_ms << " ms  "
+            << individual_captures << " captures" << std::endl
+            << "  batched     " << std::setw(9) << batched_ms << " ms  "
+            << page.captures() << " captures (" << stats.tiles_captured
+            << " tiles, " << stats.elements_cropped << " cropped, "
+            << stats.elements_captured_individually << " individual, "
+            << stats.elements_failed << " failed)" << std::endl
+            << "  speedup     " << std::setw(9) << individual_ms / batched_ms
+            << "x" << std::endl;
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 11, "--elements=") == 0) {
+      options.elements = std::stoul(arg.substr(11));
+    } else if (arg.compare(0, 13, "--capture-ms=") == 0) {
+      options.capture_ms = std::stoi(arg.substr(13));
+    } else if (arg.compare(0, 14, "--page-height=") == 0) {
+      options.page_height = std::stoi(arg.substr(14));
+    } else if (arg.compare(0, 19, "--occluded-percent=") == 0) {
+      options.occluded_percent = std::stoi(arg.substr(19));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.page_height < tooltip::kViewportHeight + 100) {
+    std::cerr << "--page-height must be at least "
+              << tooltip::kViewportHeight + 100 << std::endl;
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
@@ -0,0 +1,241 @@
+// Benchmark for keeping hover captures fast while a crawl is running.
+//
+// A crawl queues a few hundred page captures and a scraper some more. A
+// user hovers a new element at a steady rate meanwhile. Captures are
+// simulated by sleeping, as a capture mostly waits for the compositor.
+// For a shared FIFO, as the capture machinery behaves today, and for
+// ScreenshotCaptureScheduler's default policy, reports:
+//   - hover capture latency, from request to finished capture (p50, p99,
+//     max)
+//   - when the crawl and the scrape finished
+//   - per-class queue depth peaks and waits
+//
+// Usage:
+//   capture_scheduler_benchmark [--crawl=N] [--hovers=N] [--capture-ms=N]
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_capture_scheduler.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int crawl = 300;
+  int scrape = 60;
+  int hovers = 40;
+  int capture_ms = 10;
+  int hover_interval_ms = 50;
+};
+
+struct RunResult {
+  std::vector<double> hover_ms;
+  double crawl_done_ms = 0;
+  double scrape_done_ms = 0;
+  ScreenshotCaptureScheduler::ClassStats stats[kCapturePriorityCount];
+};
+
+double Percentile(std::vector<double> values, double fraction) {
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(fraction * (values.size() - 1) + 0.5)];
+}
+
+double MsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// |fifo| submits everything at one priority with no limits
+RunResult Run(const BenchmarkOptions& options, bool fifo) {
+  ScreenshotCaptureScheduler::Policy policy;
+  if (fifo) {
+    std::fill(std::begin(policy.max_running), std::end(policy.max_running),
+              0);
+    std::fill(std::begin(policy.max_queued), std::end(policy.max_queued), 0);
+  }
+  auto priority = [fifo](CapturePriority wanted) {
+    return fifo ? CapturePriority::kBatch : wanted;
+  };
+  auto capture = [&options] {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(options.capture_ms));
+  };
+
+  RunResult result;
+  std::mutex lock;
+  std::atomic<int> crawl_left(options.crawl);
+  std::atomic<int> scrape_left(options.scrape);
+  Clock::time_point start = Clock::now();
+  {
+    ScreenshotCaptureScheduler scheduler(policy);
+    for (int i = 0; i < options.crawl; ++i) {
+      scheduler.Submit(priority(CapturePriority::kBatch), [&] {
+        capture();
+        if (--crawl_left == 0) {
+          result.crawl_done_ms = MsSince(start);
+        }
+      });
+    }
+    for (int i = 0; i < options.scrape; ++i) {
+      scheduler.Submit(priority(CapturePriority::kBackground), [&] {
+        capture();
+        if (--scrape_left == 0) {
+          result.scrape_done_ms = MsSince(start);
+        }
+      });
+    }
+    for (int i = 0; i < options.hovers; ++i) {
+      std::this_thread::sleep_for(
+          std::chrono::milliseconds(options.hover_interval_ms));
+      Clock::time_point requested = Clock::now();
+      scheduler.Submit(priority(CapturePriority::kInteractive), [&, requested] {
+        capture();
+        std::lock_guard<std::mutex> hold(lock);
+        result.hover_ms.push_back(MsSince(requested));
+      });
+    }
+    auto hovers_done = [&] {
+      std::lock_guard<std::mutex> hold(lock);
+      return static_cast<int>(result.hover_ms.size()) == options.hovers;
+    };
+    while (crawl_left > 0 || scrape_left > 0 || !hovers_done()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    for (size_t index = 0; index < kCapturePriorityCount; ++index) {
+      result.stats[index] =
+          scheduler.GetStats(static_cast<CapturePriority>(index));
+    }
+  }
+  return result;
+}
+
+// Cancel() must drop a queued task, and a running batch task must be told
+// to yield while a hover waits for the only capture thread
+bool CheckCancelAndYield() {
+  ScreenshotCaptureScheduler::Policy policy;
+  policy.capture_threads = 1;
+  ScreenshotCaptureScheduler scheduler(policy);
+  std::atomic<bool> started(false);
+  std::atomic<bool> release(false);
+  std::atomic<bool> cancelled_ran(false);
+  bool yielded = false;
+  scheduler.Submit(CapturePriority::kBatch, [&] {
+    started = true;
+    while (!release) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    yielded = scheduler.ShouldYield(CapturePriority::kBatch);
+  });
+  while (!started) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ScreenshotCaptureScheduler::TaskId doomed = scheduler.Submit(
+      CapturePriority::kBatch, [&] { cancelled_ran = true; });
+  scheduler.Submit(CapturePriority::kInteractive, [] {});
+  bool cancelled = scheduler.Cancel(doomed);
+  release = true;
+  while (scheduler.GetStats(CapturePriority::kInteractive).completed == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (!cancelled || cancelled_ran || scheduler.Cancel(doomed) || !yielded) {
+    std::cerr << "Cancel() or ShouldYield() misbehaved" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+void Report(const std::string& name, const RunResult& result) {
+  std::cout << "  " << std::left << std::setw(10) << name << std::right
+            << std::fixed << std::setprecision(1) << std::setw(10)
+            << Percentile(result.hover_ms, 0.5) << std::setw(10)
+            << Percentile(result.hover_ms, 0.99) << std::setw(10)
+            << Percentile(result.hover_ms, 1.0) << std::setw(12)
+            << result.scrape_done_ms << std::setw(12)
+            << result.crawl_done_ms << std::endl;
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  if (!CheckCancelAndYield()) {
+    return 1;
+  }
+  std::cout << options.crawl << " crawl + " << options.scrape
+            << " scrape captures, " << options.hovers << " hovers every "
+            << options.hover_interval_ms << " ms, " << options.capture_ms
+            << " ms per capture, "
+            << ScreenshotCaptureScheduler::Policy().capture_threads
+            << " capture threads" << std::endl
+            << std::endl
+            << "  policy     hover p50  hover p99  hover max  scrape done"
+               "  crawl done  (ms)"
+            << std::endl;
+
+  RunResult fifo = Run(options, true);
+  Report("fifo", fifo);
+  RunResult scheduled = Run(options, false);
+  Report("priority", scheduled);
+
+  const char* const kClassNames[] = {"interactive", "background", "batch"};
+  std::cout << std::endl
+            << "  class         submitted  peak queued  mean wait(ms)"
+               "  max wait(ms)"
+            << std::endl;
+  for (size_t index = 0; index < kCapturePriorityCount; ++index) {
+    const ScreenshotCaptureScheduler::ClassStats& stats =
+        scheduled.stats[index];
+    std::cout << "  " << std::left << std::setw(12) << kClassNames[index]
+              << std::right << std::setw(11) << stats.submitted
+              << std::setw(13) << stats.peak_queued << std::setw(15)
+              << stats.total_wait.count() / 1000.0 /
+                     std::max<uint64_t>(1, stats.completed)
+              << std::setw(14) << stats.max_wait.count() / 1000.0
+              << std::endl;
+  }
+
+  if (Percentile(scheduled.hover_ms, 0.99) >
+      Percentile(fifo.hover_ms, 0.99)) {
+    std::cerr << "Prioritised hovers were slower than FIFO" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 8, "--crawl=") == 0) {
+      options.crawl = std::stoi(arg.substr(8));
+    } else if (arg.compare(0, 9, "--hovers=") == 0) {
+      options.hovers = std::stoi(arg.substr(9));
+    } else if (arg.compare(0, 13, "--capture-ms=") == 0) {
+      options.capture_ms = std::stoi(arg.substr(13));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.crawl <= 0 || options.hovers <= 0 || options.capture_ms <= 0) {
+    std::cerr << "--crawl, --hovers and --capture-ms must be positive"
+              << std::endl;
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
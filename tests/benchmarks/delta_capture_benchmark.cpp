@@ -0,0 +1,305 @@
+// Benchmark for encoding successive captures of one page.
+//
+// Replays an exploration run: a full-page capture after every click, where
+// most clicks open or close a dropdown and a few scroll a carousel. Each
+// frame is encoded three ways:
+//   full:  EncodeScreenshotTiled(), as every capture is encoded today
+//   image: ScreenshotDeltaEncoder::EncodeFrame(), a complete file built
+//          from cached strips
+//   delta: ScreenshotDeltaEncoder::EncodeDelta(), changed strips only
+//
+// Every delta image must equal an independent-strip EncodeScreenshotTiled()
+// of the same frame, and ScreenshotDeltaReader must rebuild the same bytes
+// from the delta records. The first and last frames are also decoded and
+// PNGs compared with the input.
+//
+// Usage:
+//   delta_capture_benchmark [--width=N] [--height=N] [--clicks=N]
+//                           [--strip-height=N] [--max-threads=N]
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <jpeglib.h>
+#include <png.h>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/screenshot_delta_encoder.h"
+#include "chrome/browser/tooltip/tiled_screenshot_encoder.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int width = 1280;
+  int height = 8000;
+  int clicks = 20;
+  int strip_height = 128;
+  size_t max_threads = 0;
+};
+
+struct Totals {
+  double ms = 0;
+  size_t bytes = 0;
+};
+
+double ElapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+void FillRect(ScreenshotBitmap* page,
+              int left,
+              int top,
+              int width,
+              int height,
+              uint8_t value) {
+  for (int y = std::max(0, top);
+       y < std::min(page->height(), top + height); ++y) {
+    uint8_t* row = page->row(y);
+    for (int x = std::max(0, left);
+         x < std::min(page->width(), left + width); ++x) {
+      memset(row + x * 4, value, 3);
+      row[x * 4 + 3] = 0xFF;
+    }
+  }
+}
+
+// Page-like content: flat backgrounds, lines of "text" and photo blocks
+ScreenshotBitmap MakePage(int width, int height) {
+  ScreenshotBitmap page(width, height);
+  std::mt19937 engine(11);
+  std::uniform_int_distribution<int> noise(0, 255);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = page.row(y);
+    int section = y / 400;
+    bool text_line = (y % 24) >= 6 && (y % 24) < 18;
+    for (int x = 0; x < width; ++x) {
+      uint8_t* pixel = row + x * 4;
+      if (section % 5 == 4 && x > width / 4 && x < width * 3 / 4) {
+        pixel[0] = static_cast<uint8_t>(x + y + noise(engine) / 8);
+        pixel[1] = static_cast<uint8_t>(x * 2 - y + noise(engine) / 8);
+        pixel[2] = static_cast<uint8_t>(y / 3 + noise(engine) / 8);
+      } else {
+        uint8_t value = section % 3 == 0 ? 0xFF : 0xF2;
+        if (text_line && x > 40 && x < width - 40 &&
+            ((x / 7 + y / 24 * 13) % 11) < 8 && noise(engine) < 110) {
+          value = 0x20;
+        }
+        memset(pixel, value, 3);
+      }
+      pixel[3] = 0xFF;
+    }
+  }
+  return page;
+}
+
+// Applies one click to |page|: a dropdown opening under a random menu
+// item, or every few clicks a carousel moving on
+void Click(int click, std::mt19937* engine, ScreenshotBitmap* page) {
+  if (click % 7 == 6) {
+    int top = page->height() / 3;
+    FillRect(page, 0, top, page->width(), 360,
+             static_cast<uint8_t>(0x40 + click * 9));
+    return;
+  }
+  std::uniform_int_distribution<int> menu(0, 7);
+  int left = 80 + menu(*engine) * 140;
+  FillRect(page, left, 64, 220, 40 + menu(*engine) * 40,
+           static_cast<uint8_t>(0xC0 + click));
+}
+
+bool DecodesTo(TiledEncodeOptions::Format format,
+               const std::vector<uint8_t>& encoded,
+               const ScreenshotBitmap& page) {
+  if (format == TiledEncodeOptions::Format::kPng) {
+    png_image image;
+    memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&image, encoded.data(),
+                                          encoded.size())) {
+      return false;
+    }
+    image.format = PNG_FORMAT_RGBA;
+    ScreenshotBitmap decoded(image.width, image.height);
+    return png_image_finish_read(&image, nullptr, decoded.data(), 0,
+                                 nullptr) &&
+           decoded.width() == page.width() &&
+           decoded.height() == page.height() &&
+           memcmp(decoded.data(), page.data(), page.byte_size()) == 0;
+  }
+
+  jpeg_decompress_struct cinfo;
+  jpeg_error_mgr errors;
+  cinfo.err = jpeg_std_error(&errors);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, encoded.data(), encoded.size());
+  jpeg_read_header(&cinfo, TRUE);
+  jpeg_start_decompress(&cinfo);
+  std::vector<uint8_t> row(cinfo.output_width * cinfo.output_components);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    JSAMPROW row_pointer = row.data();
+    jpeg_read_scanlines(&cinfo, &row_pointer, 1);
+  }
+  // libjpeg only warns about corrupt data
+  bool clean = errors.num_warnings == 0 &&
+               static_cast<int>(cinfo.output_width) == page.width() &&
+               static_cast<int>(cinfo.output_height) == page.height();
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return clean;
+}
+
+bool RunFormat(const char* name,
+               TiledEncodeOptions::Format format,
+               const BenchmarkOptions& options) {
+  TiledEncodeOptions full_options;
+  full_options.format = format;
+  full_options.strip_height = options.strip_height;
+  full_options.max_threads = options.max_threads;
+  TiledEncodeOptions independent_options = full_options;
+  independent_options.independent_strips = true;
+
+  ScreenshotDeltaEncoder::Options delta_options;
+  delta_options.encode = full_options;
+  ScreenshotDeltaEncoder image_encoder(delta_options);
+  ScreenshotDeltaEncoder delta_encoder(delta_options);
+  ScreenshotDeltaReader reader;
+
+  ScreenshotBitmap page = MakePage(options.width, options.height);
+  std::mt19937 engine(3);
+  Totals full;
+  Totals image;
+  Totals delta;
+  size_t strips_encoded = 0;
+  size_t strip_count = 0;
+
+  for (int frame = 0; frame <= options.clicks; ++frame) {
+    if (frame > 0) {
+      Click(frame, &engine, &page);
+    }
+
+    std::vector<uint8_t> full_file;
+    Clock::time_point start = Clock::now();
+    if (!EncodeScreenshotTiled(page, full_options, &full_file)) {
+      std::cerr << name << ": full encode failed" << std::endl;
+      return false;
+    }
+    full.ms += ElapsedMs(start);
+    full.bytes += full_file.size();
+
+    std::vector<uint8_t> image_file;
+    ScreenshotBitmap copy = page.Clone();
+    start = Clock::now();
+    if (!image_encoder.EncodeFrame("page", std::move(copy), &image_file)) {
+      std::cerr << name << ": delta image encode failed" << std::endl;
+      return false;
+    }
+    image.ms += ElapsedMs(start);
+    image.bytes += image_file.size();
+    strips_encoded += image_encoder.last_frame_stats().strips_encoded;
+    strip_count += image_encoder.last_frame_stats().strip_count;
+
+    std::vector<uint8_t> record;
+    copy = page.Clone();
+    start = Clock::now();
+    if (!delta_encoder.EncodeDelta("page", std::move(copy), &record)) {
+      std::cerr << name << ": delta record encode failed" << std::endl;
+      return false;
+    }
+    delta.ms += ElapsedMs(start);
+    delta.bytes += record.size();
+
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> rebuilt;
+    if (!EncodeScreenshotTiled(page, independent_options, &expected) ||
+        image_file != expected) {
+      std::cerr << name << ": frame " << frame
+                << " differs from a fresh encode" << std::endl;
+      return false;
+    }
+    if (!reader.Apply(record.data(), record.size(), &rebuilt) ||
+        rebuilt != expected) {
+      std::cerr << name << ": delta record " << frame
+                << " does not rebuild the frame" << std::endl;
+      return false;
+    }
+    if ((frame == 0 || frame == options.clicks) &&
+        !DecodesTo(format, image_file, page)) {
+      std::cerr << name << ": frame " << frame << " does not decode"
+                << std::endl;
+      return false;
+    }
+  }
+
+  int frames = options.clicks + 1;
+  std::cout << name << ": " << strips_encoded << " of " << strip_count
+            << " strips re-encoded" << std::endl
+            << "  mode     ms/frame   KB/frame" << std::endl
+            << std::fixed << std::setprecision(1);
+  const std::pair<const char*, const Totals*> kRows[] = {
+      {"full", &full}, {"image", &image}, {"delta", &delta}};
+  for (const auto& row : kRows) {
+    std::cout << "  " << std::left << std::setw(6) << row.first << std::right
+              << std::setw(11) << row.second->ms / frames << std::setw(11)
+              << row.second->bytes / 1024.0 / frames << std::endl;
+  }
+  std::cout << "  speedup  " << std::setprecision(2) << std::setw(10)
+            << full.ms / image.ms << "x (image), " << full.ms / delta.ms
+            << "x (delta)" << std::endl
+            << std::endl;
+  return true;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 8, "--width=") == 0) {
+      options.width = std::stoi(arg.substr(8));
+    } else if (arg.compare(0, 9, "--height=") == 0) {
+      options.height = std::stoi(arg.substr(9));
+    } else if (arg.compare(0, 9, "--clicks=") == 0) {
+      options.clicks = std::stoi(arg.substr(9));
+    } else if (arg.compare(0, 15, "--strip-height=") == 0) {
+      options.strip_height = std::stoi(arg.substr(15));
+    } else if (arg.compare(0, 14, "--max-threads=") == 0) {
+      options.max_threads = std::stoul(arg.substr(14));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.width <= 0 || options.height <= 0 || options.clicks < 0) {
+    std::cerr << "--width and --height must be positive" << std::endl;
+    return 1;
+  }
+
+  std::cout << options.width << "x" << options.height << " page, "
+            << options.clicks << " clicks, " << options.strip_height
+            << "-row strips" << std::endl
+            << std::endl;
+  bool ok = tooltip::RunFormat("PNG", tooltip::TiledEncodeOptions::Format::kPng,
+                               options) &&
+            tooltip::RunFormat("JPEG",
+                               tooltip::TiledEncodeOptions::Format::kJpeg,
+                               options);
+  return ok ? 0 : 1;
+}
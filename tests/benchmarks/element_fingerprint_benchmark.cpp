@@ -0,0 +1,197 @@
+// Throughput benchmark for the element fingerprint hash.
+//
+// Measures FingerprintHash() over buffers from a few bytes to several
+// megabytes with the scalar and SSE2 loops, and the rate of
+// ComputeElementFingerprint() over typical elements. Before timing it checks
+// that both loops agree on every length up to a few stripes and that fixed
+// inputs still hash to their recorded values, since fingerprints are
+// persisted as cache keys and must never change silently.
+//
+// Usage:
+//   element_fingerprint_benchmark [--min-ms=N]
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/element_fingerprint.h"
+#include "chrome/browser/tooltip/tooltip_service.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Hashes of fixed inputs. A mismatch means the fingerprint format changed
+// and every persisted cache key is invalid.
+struct GoldenHash {
+  const char* input;
+  size_t repeat;
+  uint64_t hash;
+};
+
+const GoldenHash kGoldenHashes[] = {
+    {"", 0, 0xad94ec6b6e5252ceULL},
+    {"a", 1, 0xbe41941589b204dcULL},
+    {"tooltip", 1, 0x82418f8428b65d5eULL},
+    {"0123456789abcdef", 4, 0x01cb0c0ac02bbac6ULL},
+    {"0123456789abcdef", 5, 0x704cd891827e015eULL},
+    {"The quick brown fox jumps over the lazy dog. ", 100,
+     0x136abf9934488054ULL},
+};
+
+std::string Expand(const GoldenHash& golden) {
+  std::string input;
+  for (size_t i = 0; i < golden.repeat; ++i) {
+    input += golden.input;
+  }
+  return input;
+}
+
+bool CheckConsistency() {
+  std::mt19937_64 engine(7);
+  std::vector<uint8_t> data(4096);
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>(engine());
+  }
+
+  for (size_t length = 0; length <= 1100; ++length) {
+    // Unaligned starts as well as aligned ones
+    for (size_t offset = 0; offset < 3; ++offset) {
+      uint64_t scalar =
+          internal::FingerprintHashScalar(data.data() + offset, length);
+      uint64_t sse2 =
+          internal::FingerprintHashSSE2(data.data() + offset, length);
+      if (scalar != sse2) {
+        std::cerr << "Scalar and SSE2 hashes differ at length " << length
+                  << std::endl;
+        return false;
+      }
+    }
+  }
+
+  bool ok = true;
+  for (const GoldenHash& golden : kGoldenHashes) {
+    std::string input = Expand(golden);
+    uint64_t hash = FingerprintHash(input.data(), input.size());
+    if (hash != golden.hash) {
+      std::cerr << "Hash of " << input.size() << " byte golden input is 0x"
+                << std::hex << hash << ", expected 0x" << golden.hash
+                << std::dec << std::endl;
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+template <typename Function>
+double MeasureNanosPerCall(Function function, double min_ms) {
+  uint64_t calls = 0;
+  Clock::time_point start = Clock::now();
+  double elapsed_ms = 0;
+  do {
+    for (int i = 0; i < 64; ++i) {
+      function();
+    }
+    calls += 64;
+    elapsed_ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+  } while (elapsed_ms < min_ms);
+  return elapsed_ms * 1e6 / calls;
+}
+
+int RunBenchmark(double min_ms) {
+  if (!CheckConsistency()) {
+    return 1;
+  }
+
+  std::mt19937_64 engine(42);
+  std::vector<uint8_t> data(8 * 1024 * 1024);
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>(engine());
+  }
+
+  // Keeps the hashes observable so the calls are not optimized away
+  volatile uint64_t sink = 0;
+
+  std::cout << "sse2                " << (internal::HasSSE2FingerprintHash()
+                                              ? "available"
+                                              : "not built")
+            << std::endl
+            << std::endl
+            << "  bytes         scalar(GB/s)   sse2(GB/s)   speedup"
+            << std::endl;
+  const size_t kSizes[] = {16,   64,    100,   256,    1024,
+                           4096, 65536, 1 << 20, 8 << 20};
+  for (size_t size : kSizes) {
+    double scalar_ns = MeasureNanosPerCall(
+        [&] {
+          sink = sink + internal::FingerprintHashScalar(data.data(), size);
+        },
+        min_ms);
+    double sse2_ns = MeasureNanosPerCall(
+        [&] {
+          sink = sink + internal::FingerprintHashSSE2(data.data(), size);
+        },
+        min_ms);
+    std::cout << "  " << std::left << std::setw(12) << size << std::right
+              << std::fixed << std::setprecision(2) << std::setw(14)
+              << size / scalar_ns << std::setw(13) << size / sse2_ns
+              << std::setw(10) << scalar_ns / sse2_ns << "x" << std::endl;
+  }
+
+  ElementInfo element_info;
+  element_info.tag_name = "button";
+  element_info.id = "checkout-submit";
+  element_info.class_name = "btn btn-primary btn-lg";
+  element_info.role = "button";
+  element_info.aria_label = "Proceed to checkout";
+  element_info.href = "";
+  element_info.src = "";
+  element_info.bounds = gfx::Rect(640, 1200, 180, 48);
+
+  double with_bounds_ns = MeasureNanosPerCall(
+      [&] { sink = sink + ComputeElementFingerprint(element_info).value; },
+      min_ms);
+  double without_bounds_ns = MeasureNanosPerCall(
+      [&] {
+        sink = sink + ComputeElementFingerprint(element_info,
+                                                FingerprintBounds::kIgnore)
+                          .value;
+      },
+      min_ms);
+  std::cout << std::endl
+            << "element fingerprint " << std::fixed << std::setprecision(1)
+            << with_bounds_ns << " ns with bounds, " << without_bounds_ns
+            << " ns without" << std::endl
+            << "example             "
+            << ComputeElementFingerprint(element_info).ToString() << std::endl;
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  double min_ms = 200;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 9, "--min-ms=") == 0) {
+      min_ms = std::stod(arg.substr(9));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  return tooltip::RunBenchmark(min_ms);
+}
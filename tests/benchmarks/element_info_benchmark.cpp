@@ -0,0 +1,358 @@
+// Memory benchmark for large scraped element sets.
+//
+// Builds the element set of a synthetic page twice: as std::vector of
+// ElementInfo, which holds every field in its own std::string, and as a
+// CompactElementStore, which interns tag/role/type/class and keeps the
+// remaining text in an arena. For each representation it reports heap
+// allocations, heap bytes, the RSS growth and the build time. It also times
+// converting compact elements back to ElementInfo.
+//
+// The page mixes a small vocabulary of tags, roles and class lists with
+// unique ids and text, the way real pages do. Text lengths straddle the
+// std::string small-buffer limit.
+//
+// Usage:
+//   element_info_benchmark [--elements=N] [--variant=both|legacy|compact]
+//       [--seed=N]
+//
+// RSS is only meaningful for the first representation built in a process,
+// because freed memory is not always returned to the OS. Use --variant to
+// measure each one in its own process.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/compact_element_info.h"
+#include "chrome/browser/tooltip/tooltip_service.h"
+#include "tests/benchmarks/allocation_counter.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int elements = 20000;
+  bool legacy = true;
+  bool compact = true;
+  uint32_t seed = 42;
+};
+
+// Fields of one scraped element, as the scraper hands them over
+struct SourceElement {
+  std::string fields[12];
+  gfx::Rect bounds;
+};
+
+enum SourceField {
+  kTagName,
+  kId,
+  kClassName,
+  kTextContent,
+  kHref,
+  kSrc,
+  kAltText,
+  kTitle,
+  kRole,
+  kAriaLabel,
+  kType,
+  kComputedStyles,
+};
+
+// Heap activity and RSS between construction and Finish()
+class Measurement {
+ public:
+  Measurement()
+      : allocations_(g_allocation_count.load()),
+        bytes_(g_allocated_bytes.load()),
+        rss_(ReadRssBytes()),
+        start_(Clock::now()) {}
+
+  void Finish() {
+    elapsed_ms_ =
+        std::chrono::duration<double, std::milli>(Clock::now() - start_)
+            .count();
+    allocations_ = g_allocation_count.load() - allocations_;
+    bytes_ = g_allocated_bytes.load() - bytes_;
+    rss_ = ReadRssBytes() - rss_;
+  }
+
+  void Print(const std::string& name) const {
+    std::cout << "  " << std::left << std::setw(18) << name << std::right
+              << std::setw(12) << allocations_ << std::setw(12)
+              << bytes_ / 1024 << std::setw(12) << rss_ / 1024 << std::fixed
+              << std::setprecision(2) << std::setw(12) << elapsed_ms_
+              << std::endl;
+  }
+
+  uint64_t allocations() const { return allocations_; }
+  uint64_t bytes() const { return bytes_; }
+
+ private:
+  // Resident set size from /proc; 0 where it is not available
+  static int64_t ReadRssBytes() {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) {
+      return 0;
+    }
+    long size = 0;
+    long resident = 0;
+    int fields = fscanf(statm, "%ld %ld", &size, &resident);
+    fclose(statm);
+    return fields == 2 ? static_cast<int64_t>(resident) * 4096 : 0;
+  }
+
+  uint64_t allocations_;
+  uint64_t bytes_;
+  int64_t rss_;
+  Clock::time_point start_;
+  double elapsed_ms_ = 0;
+};
+
+bool ParseFlag(const std::string& arg,
+               const std::string& name,
+               std::string* value) {
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = arg.substr(prefix.size());
+  return true;
+}
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value;
+    if (ParseFlag(arg, "elements", &value)) {
+      options->elements = std::max(1, std::stoi(value));
+    } else if (ParseFlag(arg, "variant", &value)) {
+      options->legacy = value == "both" || value == "legacy";
+      options->compact = value == "both" || value == "compact";
+      if (!options->legacy && !options->compact) {
+        std::cerr << "Unknown variant: " << value << std::endl;
+        return false;
+      }
+    } else if (ParseFlag(arg, "seed", &value)) {
+      options->seed = static_cast<uint32_t>(std::stoul(value));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<SourceElement> GeneratePage(const BenchmarkOptions& options) {
+  static const char* const kTags[] = {"div", "span", "a",      "button",
+                                      "li",  "img",  "input",  "p",
+                                      "svg", "path", "section", "label"};
+  static const char* const kRoles[] = {"", "", "", "button", "link",
+                                       "listitem", "navigation", "img"};
+  static const char* const kTypes[] = {"", "", "", "", "text", "submit",
+                                       "checkbox"};
+  static const char* const kClasses[] = {
+      "",
+      "container",
+      "row",
+      "col-md-6",
+      "btn btn-primary",
+      "btn btn-secondary btn-sm",
+      "nav-item",
+      "nav-link active",
+      "card",
+      "card-body",
+      "text-muted small",
+      "d-flex align-items-center justify-content-between",
+      "icon icon-16",
+      "list-group-item list-group-item-action"};
+  static const char* const kWords[] = {
+      "Sign", "in", "to", "your", "account", "Search", "results", "for",
+      "the", "latest", "news", "about", "products", "and", "services",
+      "Learn", "more", "Settings", "Privacy", "Help"};
+
+  std::mt19937 engine(options.seed);
+  auto pick = [&engine](size_t count) {
+    return std::uniform_int_distribution<size_t>(0, count - 1)(engine);
+  };
+  auto sentence = [&](size_t max_words) {
+    std::string text;
+    size_t words = pick(max_words + 1);
+    for (size_t i = 0; i < words; ++i) {
+      if (i) {
+        text.push_back(' ');
+      }
+      text.append(kWords[pick(sizeof(kWords) / sizeof(kWords[0]))]);
+    }
+    return text;
+  };
+
+  std::vector<SourceElement> page(options.elements);
+  for (int i = 0; i < options.elements; ++i) {
+    SourceElement& element = page[i];
+    std::string tag = kTags[pick(sizeof(kTags) / sizeof(kTags[0]))];
+    element.fields[kTagName] = tag;
+    element.fields[kClassName] =
+        kClasses[pick(sizeof(kClasses) / sizeof(kClasses[0]))];
+    element.fields[kRole] = kRoles[pick(sizeof(kRoles) / sizeof(kRoles[0]))];
+    element.fields[kType] =
+        tag == "input" ? kTypes[pick(sizeof(kTypes) / sizeof(kTypes[0]))] : "";
+    if (pick(3) == 0) {
+      element.fields[kId] = "el-" + std::to_string(i);
+    }
+    element.fields[kTextContent] = sentence(12);
+    if (tag == "a") {
+      element.fields[kHref] =
+          "https://bench.example/section/" + std::to_string(pick(500));
+    }
+    if (tag == "img") {
+      element.fields[kSrc] =
+          "https://cdn.bench.example/img/" + std::to_string(i) + ".png";
+      element.fields[kAltText] = sentence(6);
+    }
+    if (pick(4) == 0) {
+      element.fields[kTitle] = sentence(5);
+    }
+    if (pick(5) == 0) {
+      element.fields[kAriaLabel] = sentence(4);
+    }
+    element.fields[kComputedStyles] =
+        "display:" + std::string(pick(2) ? "block" : "flex") +
+        ";color:#333;font-size:" + std::to_string(12 + pick(8)) + "px";
+    element.bounds = gfx::Rect(static_cast<int>(pick(1280)),
+                               static_cast<int>(pick(20000)),
+                               static_cast<int>(8 + pick(400)),
+                               static_cast<int>(8 + pick(80)));
+  }
+  return page;
+}
+
+ElementInfo ToLegacy(const SourceElement& source) {
+  ElementInfo element_info;
+  element_info.tag_name = source.fields[kTagName];
+  element_info.id = source.fields[kId];
+  element_info.class_name = source.fields[kClassName];
+  element_info.text_content = source.fields[kTextContent];
+  element_info.href = source.fields[kHref];
+  element_info.src = source.fields[kSrc];
+  element_info.alt_text = source.fields[kAltText];
+  element_info.title = source.fields[kTitle];
+  element_info.role = source.fields[kRole];
+  element_info.aria_label = source.fields[kAriaLabel];
+  element_info.type = source.fields[kType];
+  element_info.bounds = source.bounds;
+  element_info.computed_styles = source.fields[kComputedStyles];
+  element_info.ParseComputedStyles();
+  return element_info;
+}
+
+ElementInfoView ToView(const SourceElement& source) {
+  ElementInfoView view;
+  view.tag_name = source.fields[kTagName];
+  view.id = source.fields[kId];
+  view.class_name = source.fields[kClassName];
+  view.text_content = source.fields[kTextContent];
+  view.href = source.fields[kHref];
+  view.src = source.fields[kSrc];
+  view.alt_text = source.fields[kAltText];
+  view.title = source.fields[kTitle];
+  view.role = source.fields[kRole];
+  view.aria_label = source.fields[kAriaLabel];
+  view.type = source.fields[kType];
+  view.bounds = source.bounds;
+  view.computed_styles = source.fields[kComputedStyles];
+  return view;
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  std::vector<SourceElement> page = GeneratePage(options);
+
+  std::cout << "elements            " << options.elements << std::endl
+            << std::endl
+            << "  representation     allocations   heap(KB)    "
+               "rss(KB)   time(ms)"
+            << std::endl;
+
+  uint64_t legacy_allocations = 0;
+  uint64_t legacy_bytes = 0;
+  if (options.legacy) {
+    Measurement measurement;
+    std::vector<ElementInfo> elements;
+    elements.reserve(page.size());
+    for (const SourceElement& source : page) {
+      elements.push_back(ToLegacy(source));
+    }
+    measurement.Finish();
+    measurement.Print("ElementInfo");
+    legacy_allocations = measurement.allocations();
+    legacy_bytes = measurement.bytes();
+  }
+
+  if (options.compact) {
+    Measurement measurement;
+    CompactElementStore store;
+    store.Reserve(page.size());
+    for (const SourceElement& source : page) {
+      store.Add(ToView(source));
+    }
+    measurement.Finish();
+    measurement.Print("CompactElement");
+
+    // What a hover pays to hand one element to TooltipService
+    Measurement conversion;
+    size_t checksum = 0;
+    for (size_t i = 0; i < store.size(); ++i) {
+      checksum += store.ToElementInfo(i).tag_name.size();
+    }
+    conversion.Finish();
+    conversion.Print("ToElementInfo");
+
+    CompactElementStore::MemoryStats stats = store.GetMemoryStats();
+    std::cout << std::endl
+              << "interned strings    " << stats.interned_strings << " ("
+              << stats.interned_bytes / 1024 << " KB)" << std::endl
+              << "text arena          " << stats.text_bytes / 1024 << " KB in "
+              << stats.arena_chunks << " chunks" << std::endl
+              << "element table       " << stats.element_bytes / 1024 << " KB"
+              << std::endl
+              << "conversion checksum " << checksum << std::endl;
+
+    if (options.legacy && measurement.allocations() > 0 &&
+        measurement.bytes() > 0) {
+      std::cout << std::fixed << std::setprecision(1)
+                << "allocation ratio    "
+                << static_cast<double>(legacy_allocations) /
+                       measurement.allocations()
+                << "x fewer" << std::endl
+                << "heap ratio          "
+                << static_cast<double>(legacy_bytes) / measurement.bytes()
+                << "x smaller" << std::endl;
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  if (!tooltip::ParseOptions(argc, argv, &options)) {
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
@@ -0,0 +1,282 @@
+// Benchmark for fitting JPEG screenshots into a byte budget.
+//
+// Encodes synthetic pages of several kinds (sparse text, dense text, mixed,
+// photo-heavy) and heights to a range of byte budgets, three ways:
+//   - binary search over quality, the obvious approach
+//   - EncodeJpegToBudget() with the sampled probe, as for a page seen for
+//     the first time
+//   - JpegQualityTuner on a second, slightly changed capture of the same
+//     page, seeded by the first
+// and reports full encodes per screenshot, time, and how much of the
+// budget the output uses.
+//
+// Every output that reports fitting must be within its budget, and the
+// history-seeded search must not need more encodes on average than the
+// probe.
+//
+// Usage:
+//   jpeg_budget_benchmark [--width=N] [--repeat=N]
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/screenshot_jpeg_budget.h"
+#include "chrome/browser/tooltip/tiled_screenshot_encoder.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int width = 1280;
+  int repeat = 1;
+};
+
+struct PageKind {
+  const char* name;
+  // Share of rows in photo blocks, in tenths
+  int photo_tenths;
+  // Glyph pixels per 255 in text lines
+  int ink;
+  int noise;
+};
+
+ScreenshotBitmap MakePage(const PageKind& kind,
+                          int width,
+                          int height,
+                          int seed) {
+  ScreenshotBitmap page(width, height);
+  std::mt19937 engine(seed);
+  std::uniform_int_distribution<int> random(0, 255);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = page.row(y);
+    int section = y / 320;
+    bool photo = (section * 7 + seed) % 10 < kind.photo_tenths;
+    bool text_line = (y % 22) >= 5 && (y % 22) < 17;
+    uint8_t background = section % 4 == 1 ? 0xF4 : 0xFF;
+    for (int x = 0; x < width; ++x) {
+      uint8_t* pixel = row + x * 4;
+      pixel[3] = 0xFF;
+      if (photo && x > width / 6 && x < width * 5 / 6) {
+        int shade = random(engine) * kind.noise / 255;
+        pixel[0] = static_cast<uint8_t>(x / 3 + y / 2 + shade);
+        pixel[1] = static_cast<uint8_t>(x - y / 3 + shade);
+        pixel[2] = static_cast<uint8_t>(y / 4 + x / 5 + shade);
+        continue;
+      }
+      uint8_t value = background;
+      if (text_line && x > 48 && x < width - 48 &&
+          ((x / 6 + y / 22 * 11 + seed) % 13) < 9 &&
+          random(engine) < kind.ink) {
+        value = 0x28;
+      }
+      pixel[0] = value;
+      pixel[1] = value;
+      pixel[2] = value;
+    }
+  }
+  return page;
+}
+
+// Binary search for the highest quality that fits, for comparison
+bool BinarySearchEncode(const ScreenshotBitmap& bitmap,
+                        const JpegBudgetOptions& options,
+                        std::vector<uint8_t>* output,
+                        JpegBudgetResult* result) {
+  *result = JpegBudgetResult();
+  TiledEncodeOptions encode = options.encode;
+  encode.format = TiledEncodeOptions::Format::kJpeg;
+  int low = options.min_quality;
+  int high = options.max_quality;
+  std::vector<uint8_t> attempt;
+  while (low <= high) {
+    int quality = (low + high + 1) / 2;
+    encode.jpeg_quality = quality;
+    if (!EncodeScreenshotTiled(bitmap, encode, &attempt)) {
+      return false;
+    }
+    ++result->encodes;
+    if (attempt.size() <= options.target_bytes) {
+      output->swap(attempt);
+      result->quality = quality;
+      result->bytes = output->size();
+      result->fits = true;
+      low = quality + 1;
+    } else {
+      high = quality - 1;
+    }
+  }
+  return true;
+}
+
+struct Totals {
+  int screenshots = 0;
+  int fitted = 0;
+  int encodes = 0;
+  int max_encodes = 0;
+  int within_two = 0;
+  double ms = 0;
+  double fill = 0;
+};
+
+bool Record(const JpegBudgetOptions& options,
+            const std::vector<uint8_t>& output,
+            const JpegBudgetResult& result,
+            double ms,
+            Totals* totals) {
+  if (result.fits && (output.size() > options.target_bytes ||
+                      output.size() != result.bytes || output.size() < 2 ||
+                      output[0] != 0xFF || output[1] != 0xD8)) {
+    std::cerr << "Output of " << output.size() << " bytes reported as "
+              << "fitting " << options.target_bytes << std::endl;
+    return false;
+  }
+  ++totals->screenshots;
+  totals->encodes += result.encodes;
+  totals->max_encodes = std::max(totals->max_encodes, result.encodes);
+  totals->within_two += result.encodes <= 2;
+  totals->ms += ms;
+  if (result.fits) {
+    ++totals->fitted;
+    totals->fill += static_cast<double>(result.bytes) / options.target_bytes;
+  }
+  return true;
+}
+
+void Report(const std::string& name, const Totals& totals) {
+  std::cout << "  " << std::left << std::setw(14) << name << std::right
+            << std::fixed << std::setprecision(2) << std::setw(9)
+            << static_cast<double>(totals.encodes) / totals.screenshots
+            << std::setw(6) << totals.max_encodes << std::setw(10)
+            << std::setprecision(0)
+            << 100.0 * totals.within_two / totals.screenshots << "%"
+            << std::setprecision(1) << std::setw(11)
+            << totals.ms / totals.screenshots << std::setw(10)
+            << 100.0 * totals.fill / std::max(1, totals.fitted) << "%"
+            << std::setw(6) << totals.fitted << "/" << totals.screenshots
+            << std::endl;
+}
+
+double TimeMs(int repeat, const std::function<void()>& run) {
+  double best_ms = 0;
+  for (int i = 0; i < repeat; ++i) {
+    Clock::time_point start = Clock::now();
+    run();
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                          start)
+                    .count();
+    best_ms = i == 0 ? ms : std::min(best_ms, ms);
+  }
+  return best_ms;
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  const PageKind kKinds[] = {
+      {"sparse text", 0, 60, 0},
+      {"dense text", 0, 200, 0},
+      {"mixed", 3, 130, 40},
+      {"photo heavy", 8, 130, 90},
+  };
+  const int kHeights[] = {800, 3000, 8000};
+  const double kBytesPerPixelTargets[] = {0.18, 0.25, 0.35, 0.5};
+
+  Totals binary;
+  Totals probed;
+  Totals seeded;
+  JpegQualityTuner tuner(16);
+  int page_id = 0;
+  for (const PageKind& kind : kKinds) {
+    for (int height : kHeights) {
+      ScreenshotBitmap first = MakePage(kind, options.width, height, 1);
+      // The next capture: the same layout with different content
+      ScreenshotBitmap second = MakePage(kind, options.width, height, 2);
+      for (double bytes_per_pixel : kBytesPerPixelTargets) {
+        JpegBudgetOptions budget;
+        budget.target_bytes = static_cast<size_t>(
+            bytes_per_pixel * options.width * height);
+        std::string page_key = "page" + std::to_string(page_id++);
+        std::vector<uint8_t> output;
+        JpegBudgetResult result;
+
+        double ms = TimeMs(options.repeat, [&] {
+          BinarySearchEncode(first, budget, &output, &result);
+        });
+        if (!Record(budget, output, result, ms, &binary)) {
+          return 1;
+        }
+
+        ms = TimeMs(options.repeat, [&] {
+          EncodeJpegToBudget(first, budget, nullptr, &output, &result,
+                             nullptr);
+        });
+        if (!Record(budget, output, result, ms, &probed)) {
+          return 1;
+        }
+
+        tuner.Encode(page_key, first, budget, &output, &result);
+        ms = TimeMs(options.repeat, [&] {
+          tuner.Encode(page_key, second, budget, &output, &result);
+        });
+        if (!result.from_history ||
+            !Record(budget, output, result, ms, &seeded)) {
+          std::cerr << "Second capture of " << page_key
+                    << " was not seeded" << std::endl;
+          return 1;
+        }
+      }
+    }
+  }
+
+  std::cout << probed.screenshots << " screenshots, " << options.width
+            << " wide, budgets of 0.18-0.5 bytes per pixel" << std::endl
+            << std::endl
+            << "  search         encodes   max  <=2 encodes  time(ms)"
+               "      fill  fitted"
+            << std::endl;
+  Report("binary", binary);
+  Report("model + probe", probed);
+  Report("model + page", seeded);
+
+  if (seeded.encodes > probed.encodes) {
+    std::cerr << "History-seeded search took more encodes than the probe"
+              << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 8, "--width=") == 0) {
+      options.width = std::stoi(arg.substr(8));
+    } else if (arg.compare(0, 9, "--repeat=") == 0) {
+      options.repeat = std::stoi(arg.substr(9));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.width <= 0 || options.repeat <= 0) {
+    std::cerr << "--width and --repeat must be positive" << std::endl;
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
@@ -0,0 +1,308 @@
+// Benchmark for perceptual hashing of element screenshots.
+//
+// Takes the elements of the repository's fixture pages (buttons, links,
+// labels, headings, options, inputs and images with their text), renders
+// each as a flat widget with its label drawn as glyph bars, and reports
+// per page:
+//   - dHash and pHash time per element and throughput in megapixels/s
+//   - how many element screenshots are visual duplicates by each hash
+// and over all pages:
+//   - Hamming distances between each element and a lightly altered copy
+//     (shifted a pixel, brightened, noised) against distances between
+//     different elements
+//   - PerceptualHashIndex lookup time
+//
+// Usage:
+//   perceptual_hash_benchmark [--fixtures=DIR] [--repeat=N]
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/screenshot_perceptual_hash.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  std::string fixtures = ".";
+  int repeat = 20;
+};
+
+const char* const kFixturePages[] = {
+    "test_automation_page.html", "tooltip_demo.html",
+    "navigrab_test_page.html", "navigrab_tooltip_test.html",
+    "navigrab_real_screenshots.html"};
+
+// Above this distance two screenshots count as different
+const int kSimilarDistance = 10;
+
+struct Element {
+  std::string tag;
+  std::string text;
+};
+
+std::vector<Element> ReadElements(const std::string& path) {
+  std::ifstream file(path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  std::string html = contents.str();
+  std::regex pattern(
+      "<(button|a|label|h[1-6]|option|input|img|textarea)\\b[^>]*>([^<]*)",
+      std::regex::icase);
+  std::vector<Element> elements;
+  for (std::sregex_iterator it(html.begin(), html.end(), pattern), end;
+       it != end; ++it) {
+    std::string text = (*it)[2];
+    text.erase(0, text.find_first_not_of(" \n\t"));
+    text.erase(text.find_last_not_of(" \n\t") + 1);
+    elements.push_back({(*it)[1], text});
+  }
+  return elements;
+}
+
+// Flat widget per tag with |text| as glyph bars; equal tag and text render
+// equal pixels, as repeated buttons and list rows do on real pages
+ScreenshotBitmap Render(const Element& element) {
+  bool heading = element.tag[0] == 'h' || element.tag[0] == 'H';
+  bool image = element.tag == "img";
+  int width = std::max<int>(48, 16 + 9 * element.text.size());
+  int height = heading ? 40 : 28;
+  if (image) {
+    width = 160;
+    height = 120;
+  }
+  uint32_t seed = std::hash<std::string>()(element.tag + element.text);
+  uint8_t background = element.tag == "button" ? 0x3A : 0xF4;
+  uint8_t ink = element.tag == "button" ? 0xFF : 0x20;
+
+  ScreenshotBitmap bitmap(width, height);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = bitmap.row(y);
+    for (int x = 0; x < width; ++x) {
+      uint8_t* pixel = row + x * 4;
+      uint8_t value = background;
+      if (image) {
+        value = static_cast<uint8_t>((seed >> ((x / 20 + y / 20) % 24)) +
+                                     x * 2 + y);
+      } else if (x == 0 || y == 0 || x == width - 1 || y == height - 1) {
+        value = 0x90;
+      } else {
+        int glyph = (x - 8) / 9;
+        int column = (x - 8) % 9;
+        if (x >= 8 && glyph < static_cast<int>(element.text.size()) &&
+            column < 7 && y >= height / 4 && y < height * 3 / 4) {
+          unsigned char c = element.text[glyph];
+          int stroke_row = (y - height / 4) * 5 / (height / 2);
+          if ((c >> ((column + stroke_row) % 8)) & 1) {
+            value = ink;
+          }
+        }
+      }
+      pixel[0] = value;
+      pixel[1] = value;
+      pixel[2] = static_cast<uint8_t>(std::min(255, value + 12));
+      pixel[3] = 0xFF;
+    }
+  }
+  return bitmap;
+}
+
+// |bitmap| shifted right a pixel, brightened and lightly noised, as a
+// re-render after a relayout or a lossy re-encode would be
+ScreenshotBitmap Alter(const ScreenshotBitmap& bitmap, std::mt19937* engine) {
+  std::uniform_int_distribution<int> noise(-3, 3);
+  ScreenshotBitmap altered(bitmap.width(), bitmap.height());
+  for (int y = 0; y < bitmap.height(); ++y) {
+    for (int x = 0; x < bitmap.width(); ++x) {
+      const uint8_t* source = bitmap.row(y) + std::max(0, x - 1) * 4;
+      uint8_t* dest = altered.row(y) + x * 4;
+      for (int c = 0; c < 3; ++c) {
+        dest[c] = static_cast<uint8_t>(
+            std::max(0, std::min(255, source[c] + 6 + noise(*engine))));
+      }
+      dest[3] = 0xFF;
+    }
+  }
+  return altered;
+}
+
+double Median(std::vector<int> values) {
+  std::sort(values.begin(), values.end());
+  return values.empty() ? 0 : values[values.size() / 2];
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  std::cout << "  page                              elements  dhash(us)"
+               "  phash(us)  dhash(MP/s) phash(MP/s)  dup(d)  dup(p)"
+            << std::endl;
+
+  std::vector<ScreenshotBitmap> everything;
+  for (const char* page : kFixturePages) {
+    std::vector<Element> elements =
+        ReadElements(options.fixtures + "/" + page);
+    if (elements.empty()) {
+      std::cerr << "No elements in " << options.fixtures << "/" << page
+                << "; pass --fixtures=<repository root>" << std::endl;
+      return 1;
+    }
+    std::vector<ScreenshotBitmap> bitmaps;
+    double megapixels = 0;
+    for (const Element& element : elements) {
+      bitmaps.push_back(Render(element));
+      megapixels += bitmaps.back().width() * bitmaps.back().height() / 1e6;
+    }
+
+    auto time = [&](PerceptualHash (*hash)(const ScreenshotBitmap&),
+                    std::set<uint64_t>* distinct) {
+      double best_ms = 0;
+      for (int i = 0; i < options.repeat; ++i) {
+        distinct->clear();
+        Clock::time_point start = Clock::now();
+        for (const ScreenshotBitmap& bitmap : bitmaps) {
+          distinct->insert(hash(bitmap).value);
+        }
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                              start)
+                        .count();
+        best_ms = i == 0 ? ms : std::min(best_ms, ms);
+      }
+      return best_ms;
+    };
+    std::set<uint64_t> distinct_d;
+    std::set<uint64_t> distinct_p;
+    double dhash_ms = time(&ComputeDifferenceHash, &distinct_d);
+    double phash_ms = time(&ComputeDctHash, &distinct_p);
+
+    std::cout << "  " << std::left << std::setw(34) << page << std::right
+              << std::setw(8) << elements.size() << std::fixed
+              << std::setprecision(2) << std::setw(11)
+              << dhash_ms * 1000 / elements.size() << std::setw(11)
+              << phash_ms * 1000 / elements.size() << std::setprecision(0)
+              << std::setw(13) << megapixels / (dhash_ms / 1000)
+              << std::setw(12) << megapixels / (phash_ms / 1000)
+              << std::setw(8) << elements.size() - distinct_d.size()
+              << std::setw(8) << elements.size() - distinct_p.size()
+              << std::endl;
+    for (ScreenshotBitmap& bitmap : bitmaps) {
+      everything.push_back(std::move(bitmap));
+    }
+  }
+
+  // Robustness: altered copies should stay near, different elements far
+  std::mt19937 engine(11);
+  std::vector<PerceptualHash> dhashes;
+  std::vector<PerceptualHash> phashes;
+  std::vector<int> near_d;
+  std::vector<int> near_p;
+  for (const ScreenshotBitmap& bitmap : everything) {
+    ScreenshotBitmap altered = Alter(bitmap, &engine);
+    dhashes.push_back(ComputeDifferenceHash(bitmap));
+    phashes.push_back(ComputeDctHash(bitmap));
+    near_d.push_back(dhashes.back().DistanceTo(ComputeDifferenceHash(altered)));
+    near_p.push_back(phashes.back().DistanceTo(ComputeDctHash(altered)));
+  }
+  std::vector<int> far_d;
+  std::vector<int> far_p;
+  for (size_t i = 0; i < everything.size(); ++i) {
+    for (size_t j = i + 1; j < everything.size(); ++j) {
+      if (dhashes[i] != dhashes[j]) {
+        far_d.push_back(dhashes[i].DistanceTo(dhashes[j]));
+      }
+      if (phashes[i] != phashes[j]) {
+        far_p.push_back(phashes[i].DistanceTo(phashes[j]));
+      }
+    }
+  }
+  auto within = [](const std::vector<int>& distances) {
+    return 100.0 *
+           std::count_if(distances.begin(), distances.end(),
+                         [](int d) { return d <= kSimilarDistance; }) /
+           std::max<size_t>(1, distances.size());
+  };
+  std::cout << std::endl
+            << "distance     altered copy (median, % <= " << kSimilarDistance
+            << ")   different elements (median, % <= " << kSimilarDistance
+            << ")" << std::endl
+            << std::setprecision(1) << "  dHash      " << std::setw(6)
+            << Median(near_d) << std::setw(8) << within(near_d) << "%"
+            << std::setw(26) << Median(far_d) << std::setw(8) << within(far_d)
+            << "%" << std::endl
+            << "  pHash      " << std::setw(6) << Median(near_p)
+            << std::setw(8) << within(near_p) << "%" << std::setw(26)
+            << Median(far_p) << std::setw(8) << within(far_p) << "%"
+            << std::endl;
+
+  // Index lookups against a store of many screenshots' hashes
+  PerceptualHashIndex index;
+  std::mt19937_64 random_hashes(5);
+  for (int i = 0; i < 100000; ++i) {
+    index.Add({random_hashes()}, i);
+  }
+  for (size_t i = 0; i < dhashes.size(); ++i) {
+    index.Add(dhashes[i], 1000000 + i);
+  }
+  size_t found = 0;
+  Clock::time_point start = Clock::now();
+  for (const PerceptualHash& hash : dhashes) {
+    found += index.Find(hash, PerceptualHashIndex::kMaxIndexedDistance)
+                 .empty()
+                 ? 0
+                 : 1;
+  }
+  double lookup_us =
+      std::chrono::duration<double, std::micro>(Clock::now() - start)
+          .count() /
+      dhashes.size();
+  if (found != dhashes.size()) {
+    std::cerr << "Index lost " << dhashes.size() - found << " hashes"
+              << std::endl;
+    return 1;
+  }
+  std::cout << std::endl
+            << "index of " << index.size() << " hashes: " << std::setprecision(2)
+            << lookup_us << " us per lookup within distance "
+            << PerceptualHashIndex::kMaxIndexedDistance << std::endl;
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 11, "--fixtures=") == 0) {
+      options.fixtures = arg.substr(11);
+    } else if (arg.compare(0, 9, "--repeat=") == 0) {
+      options.repeat = std::stoi(arg.substr(9));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.repeat <= 0) {
+    std::cerr << "--repeat must be positive" << std::endl;
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
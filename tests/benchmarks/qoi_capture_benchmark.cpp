@@ -0,0 +1,226 @@
+// Benchmark for the lossless intermediate screenshot format.
+//
+// Encodes a synthetic full-page capture as QOI and as PNG at zlib levels 1
+// and 6, on one thread and on every core, and reports time, throughput in
+// input megabytes per second and size. Then reports what keeping a capture
+// in QOI costs when it has to leave the process after all: decoding, and
+// transcoding to PNG.
+//
+// Every QOI output is decoded and must reproduce the input exactly, for
+// several strip heights, with and without independent strips and for a
+// capture with translucent pixels. Outputs for different thread counts
+// must be byte-identical.
+//
+// Usage:
+//   qoi_capture_benchmark [--width=N] [--height=N] [--repeat=N]
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/screenshot_qoi_codec.h"
+#include "chrome/browser/tooltip/tiled_screenshot_encoder.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int width = 1280;
+  int height = 8000;
+  int repeat = 3;
+};
+
+// Page-like content: flat backgrounds, lines of "text", gradients and a
+// noisy photo block
+ScreenshotBitmap MakePage(int width, int height, bool translucent) {
+  ScreenshotBitmap page(width, height);
+  std::mt19937 engine(9);
+  std::uniform_int_distribution<int> noise(0, 255);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = page.row(y);
+    int section = y / 400;
+    bool text_line = (y % 24) >= 6 && (y % 24) < 18;
+    for (int x = 0; x < width; ++x) {
+      uint8_t* pixel = row + x * 4;
+      pixel[3] = 0xFF;
+      if (section % 5 == 4 && x > width / 4 && x < width * 3 / 4) {
+        pixel[0] = static_cast<uint8_t>(x + y + noise(engine) / 8);
+        pixel[1] = static_cast<uint8_t>(x * 2 - y + noise(engine) / 8);
+        pixel[2] = static_cast<uint8_t>(y / 3 + noise(engine) / 8);
+        continue;
+      }
+      uint8_t value = section % 3 == 0 ? 0xFF : 0xF2;
+      if (section % 5 == 2 && x < width / 3) {
+        // Gradient banner
+        value = static_cast<uint8_t>(0x40 + x * 0x80 / width);
+      }
+      if (text_line && x > 40 && x < width - 40 &&
+          ((x / 7 + y / 24 * 13) % 11) < 8 && noise(engine) < 110) {
+        value = 0x20;
+      }
+      pixel[0] = value;
+      pixel[1] = value;
+      pixel[2] = static_cast<uint8_t>(value - (value > 0xF0 ? 4 : 0));
+      if (translucent && section % 7 == 3) {
+        pixel[3] = static_cast<uint8_t>(x % 256);
+      }
+    }
+  }
+  return page;
+}
+
+double BestMs(int repeat, const std::function<void()>& run) {
+  double best_ms = 0;
+  for (int i = 0; i < repeat; ++i) {
+    Clock::time_point start = Clock::now();
+    run();
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                          start)
+                    .count();
+    best_ms = i == 0 ? ms : std::min(best_ms, ms);
+  }
+  return best_ms;
+}
+
+bool RoundTrips(const ScreenshotBitmap& page,
+                const TiledEncodeOptions& options,
+                const std::string& what) {
+  std::vector<uint8_t> qoi;
+  ScreenshotBitmap decoded;
+  if (!EncodeScreenshotTiled(page, options, &qoi) ||
+      !DecodeQoiScreenshot(qoi.data(), qoi.size(), &decoded) ||
+      decoded.width() != page.width() || decoded.height() != page.height() ||
+      memcmp(decoded.data(), page.data(), page.byte_size()) != 0) {
+    std::cerr << "QOI does not round-trip: " << what << std::endl;
+    return false;
+  }
+  // Truncation must be caught rather than read past
+  if (DecodeQoiScreenshot(qoi.data(), qoi.size() / 2, &decoded)) {
+    std::cerr << "Truncated QOI decoded: " << what << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  ScreenshotBitmap page = MakePage(options.width, options.height, false);
+  ScreenshotBitmap translucent =
+      MakePage(options.width, options.height / 4, true);
+  for (int strip_height : {16, 100, 256, options.height}) {
+    for (bool independent : {false, true}) {
+      TiledEncodeOptions qoi;
+      qoi.format = TiledEncodeOptions::Format::kQoi;
+      qoi.strip_height = strip_height;
+      qoi.independent_strips = independent;
+      std::string what = "strip height " + std::to_string(strip_height) +
+                         (independent ? ", independent" : "");
+      if (!RoundTrips(page, qoi, what) ||
+          !RoundTrips(translucent, qoi, what + ", translucent")) {
+        return 1;
+      }
+    }
+  }
+
+  double megabytes = page.byte_size() / (1024.0 * 1024.0);
+  std::cout << options.width << "x" << options.height << " capture, "
+            << std::fixed << std::setprecision(1) << megabytes << " MB raw"
+            << std::endl
+            << std::endl
+            << "  format  threads   time(ms)     MB/s    size(KB)" << std::endl;
+
+  struct Format {
+    const char* name;
+    TiledEncodeOptions::Format format;
+    int png_level;
+  };
+  const Format kFormats[] = {
+      {"qoi", TiledEncodeOptions::Format::kQoi, 0},
+      {"png 1", TiledEncodeOptions::Format::kPng, 1},
+      {"png 6", TiledEncodeOptions::Format::kPng, 6},
+  };
+  std::vector<uint8_t> qoi_file;
+  for (const Format& format : kFormats) {
+    std::vector<uint8_t> reference;
+    for (size_t threads : {size_t{1}, size_t{0}}) {
+      TiledEncodeOptions encode;
+      encode.format = format.format;
+      encode.png_compression_level = format.png_level;
+      encode.max_threads = threads;
+      std::vector<uint8_t> file;
+      double ms = BestMs(options.repeat,
+                         [&] { EncodeScreenshotTiled(page, encode, &file); });
+      if (threads == 1) {
+        reference = file;
+      } else if (file != reference) {
+        std::cerr << format.name << " output depends on the thread count"
+                  << std::endl;
+        return 1;
+      }
+      std::cout << "  " << std::left << std::setw(8) << format.name
+                << std::right << std::setw(7)
+                << (threads ? std::string("1") : std::string("all"))
+                << std::setw(11) << ms << std::setw(9)
+                << megabytes / (ms / 1000) << std::setw(12)
+                << file.size() / 1024.0 << std::endl;
+    }
+    if (format.format == TiledEncodeOptions::Format::kQoi) {
+      qoi_file = reference;
+    }
+  }
+
+  ScreenshotBitmap decoded;
+  double decode_ms = BestMs(options.repeat, [&] {
+    DecodeQoiScreenshot(qoi_file.data(), qoi_file.size(), &decoded);
+  });
+  TiledEncodeOptions png;
+  std::vector<uint8_t> png_file;
+  double transcode_ms = BestMs(options.repeat, [&] {
+    TranscodeQoiScreenshot(qoi_file, png, &png_file);
+  });
+  std::cout << std::endl
+            << "leaving the process: QOI decode " << decode_ms << " ms ("
+            << megabytes / (decode_ms / 1000) << " MB/s), transcode to PNG "
+            << transcode_ms << " ms" << std::endl;
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 8, "--width=") == 0) {
+      options.width = std::stoi(arg.substr(8));
+    } else if (arg.compare(0, 9, "--height=") == 0) {
+      options.height = std::stoi(arg.substr(9));
+    } else if (arg.compare(0, 9, "--repeat=") == 0) {
+      options.repeat = std::stoi(arg.substr(9));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.width <= 0 || options.height < 4 || options.repeat <= 0) {
+    std::cerr << "--width and --repeat must be positive and --height at "
+                 "least 4"
+              << std::endl;
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
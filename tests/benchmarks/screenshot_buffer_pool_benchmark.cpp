@@ -0,0 +1,172 @@
+// Benchmark for recycling capture buffers under concurrent load.
+//
+// Several threads capture pages of mixed viewport sizes at once, as a
+// crawler running concurrent CapturePage calls does. Each capture fills a
+// raw frame, "encodes" it into an output buffer a fraction of its size and
+// drops both. Reports, with fresh allocations and with a
+// ScreenshotBufferPool:
+//   - time per capture
+//   - minor page faults per capture, the cost of mapping fresh buffers
+//   - the pool's reuse rate and high-water marks
+//
+// Usage:
+//   screenshot_buffer_pool_benchmark [--threads=N] [--captures=N]
+
+#include <stdint.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/screenshot_buffer_pool.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int threads = 4;
+  // Captures per thread
+  int captures = 100;
+};
+
+struct Viewport {
+  int width;
+  int height;
+};
+
+const Viewport kViewports[] = {
+    {1280, 800}, {1920, 1080}, {1366, 768}, {2560, 1440}, {1280, 720}};
+
+// Encoded output is roughly this fraction of the raw frame
+const size_t kEncodedDivisor = 12;
+
+// Stand-ins for readback and encoding that touch every byte, as the real
+// ones do
+void FillFrame(uint8_t* pixels, size_t size, int seed) {
+  memset(pixels, seed & 0xFF, size);
+}
+
+uint32_t Encode(const uint8_t* pixels, size_t size, uint8_t* output) {
+  size_t output_size = size / kEncodedDivisor;
+  memcpy(output, pixels, output_size);
+  return output[output_size / 2];
+}
+
+long MinorFaults() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt;
+}
+
+struct RunResult {
+  double ms_per_capture = 0;
+  double faults_per_capture = 0;
+};
+
+RunResult Run(const BenchmarkOptions& options,
+              const std::function<uint32_t(int, const Viewport&)>& capture) {
+  long faults = MinorFaults();
+  Clock::time_point start = Clock::now();
+  std::vector<std::thread> threads;
+  std::vector<uint32_t> checksums(options.threads);
+  for (int t = 0; t < options.threads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < options.captures; ++i) {
+        const Viewport& viewport =
+            kViewports[(t + i) % (sizeof(kViewports) / sizeof(kViewports[0]))];
+        checksums[t] += capture(i, viewport);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  double captures = static_cast<double>(options.threads) * options.captures;
+  RunResult result;
+  result.ms_per_capture =
+      std::chrono::duration<double, std::milli>(Clock::now() - start)
+          .count() /
+      captures;
+  result.faults_per_capture = (MinorFaults() - faults) / captures;
+  return result;
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  RunResult fresh = Run(options, [](int i, const Viewport& viewport) {
+    ScreenshotBitmap frame(viewport.width, viewport.height);
+    FillFrame(frame.data(), frame.byte_size(), i);
+    std::vector<uint8_t> output(frame.byte_size() / kEncodedDivisor);
+    return Encode(frame.data(), frame.byte_size(), output.data());
+  });
+
+  ScreenshotBufferPool pool{ScreenshotBufferPool::Options()};
+  RunResult pooled = Run(options, [&](int i, const Viewport& viewport) {
+    PooledScreenshotBitmap frame =
+        pool.AcquireBitmap(viewport.width, viewport.height);
+    FillFrame(frame->data(), frame->byte_size(), i);
+    ScreenshotBuffer output =
+        pool.Acquire(frame->byte_size() / kEncodedDivisor);
+    return Encode(frame->data(), frame->byte_size(), output.data());
+  });
+  ScreenshotBufferPool::Stats stats = pool.GetStats();
+  if (stats.in_use_buffers != 0 ||
+      stats.acquires != 2u * options.threads * options.captures) {
+    std::cerr << "Pool accounting is off: " << stats.in_use_buffers
+              << " buffers still in use" << std::endl;
+    return 1;
+  }
+
+  std::cout << options.threads << " threads x " << options.captures
+            << " captures" << std::endl
+            << std::endl
+            << "  mode     ms/capture  faults/capture" << std::endl
+            << std::fixed << std::setprecision(3) << "  fresh  " << std::setw(12)
+            << fresh.ms_per_capture << std::setprecision(1) << std::setw(16)
+            << fresh.faults_per_capture << std::endl
+            << std::setprecision(3) << "  pooled " << std::setw(12)
+            << pooled.ms_per_capture << std::setprecision(1) << std::setw(16)
+            << pooled.faults_per_capture << std::endl
+            << std::endl
+            << "pool: " << stats.reuses << "/" << stats.acquires
+            << " acquires reused, " << stats.discards << " discarded, peak "
+            << stats.peak_in_use_buffers << " buffers / "
+            << stats.peak_in_use_bytes / (1024 * 1024) << " MB in use, peak "
+            << stats.peak_pooled_bytes / (1024 * 1024) << " MB idle"
+            << std::endl;
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 10, "--threads=") == 0) {
+      options.threads = std::stoi(arg.substr(10));
+    } else if (arg.compare(0, 11, "--captures=") == 0) {
+      options.captures = std::stoi(arg.substr(11));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.threads <= 0 || options.captures <= 0) {
+    std::cerr << "--threads and --captures must be positive" << std::endl;
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
@@ -0,0 +1,540 @@
+// Microbenchmark suite for the screenshot capture path.
+//
+// Runs offline on synthetic frames: a page-like 1280-wide frame stands in
+// for the compositor, and "reading back" an area copies it out the way a
+// surface copy delivers it. Cases:
+//   encode/<format>/<size>       encoding alone: PNG, JPEG and QOI of an
+//                                element, a viewport and a full page
+//   capture/viewport/<format>    readback of the viewport, then encode
+//   capture/full_page/<format>   viewport-sized readbacks stitched into the
+//                                full page, then encode
+//   capture/element/<format>     viewport readback, crop, encode
+//   capture/elements24/<format>  24 elements through BatchElementCapture,
+//                                each encoded
+//   concurrent/<format>/threadsN N threads each capturing viewports on
+//                                one core's worth of encoder
+// Every case reports time (min, p50, mean), input throughput, output size
+// and heap allocations per run; concurrent cases also report captures per
+// second and scaling against one thread.
+//
+// Usage:
+//   screenshot_capture_benchmark [--iterations=N] [--filter=SUBSTRING]
+//       [--page-height=N] [--max-threads=N] [--json=report.json]
+//
+// --json writes every case as one object of a "cases" array, with the same
+// fields as the table, for comparing runs.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/batch_element_capture.h"
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/tiled_screenshot_encoder.h"
+#include "tests/benchmarks/allocation_counter.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int kPageWidth = 1280;
+const int kViewportHeight = 800;
+const int kElementBatchSize = 24;
+
+struct BenchmarkOptions {
+  int iterations = 3;
+  int page_height = 8000;
+  int max_threads = 8;
+  std::string filter;
+  std::string json_path;
+};
+
+struct CaseResult {
+  std::string name;
+  int iterations = 0;
+  double min_ms = 0;
+  double p50_ms = 0;
+  double mean_ms = 0;
+  // Raw RGBA input per run
+  size_t input_bytes = 0;
+  size_t output_bytes = 0;
+  double allocations = 0;
+  double allocated_bytes = 0;
+  // Concurrent cases only
+  int threads = 0;
+  double captures_per_second = 0;
+  double scaling = 0;
+
+  double MegabytesPerSecond() const {
+    return p50_ms > 0 ? input_bytes / (1024.0 * 1024.0) / (p50_ms / 1000)
+                      : 0;
+  }
+};
+
+struct Format {
+  const char* name;
+  TiledEncodeOptions::Format format;
+};
+
+const Format kFormats[] = {
+    {"png", TiledEncodeOptions::Format::kPng},
+    {"jpeg", TiledEncodeOptions::Format::kJpeg},
+    {"qoi", TiledEncodeOptions::Format::kQoi},
+};
+
+// Page-like content: flat backgrounds, lines of "text", a gradient banner
+// every few sections and a noisy photo block
+ScreenshotBitmap MakePage(int width, int height) {
+  ScreenshotBitmap page(width, height);
+  std::mt19937 engine(5);
+  std::uniform_int_distribution<int> noise(0, 255);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = page.row(y);
+    int section = y / 400;
+    bool text_line = (y % 24) >= 6 && (y % 24) < 18;
+    for (int x = 0; x < width; ++x) {
+      uint8_t* pixel = row + x * 4;
+      pixel[3] = 0xFF;
+      if (section % 5 == 4 && x > width / 4 && x < width * 3 / 4) {
+        pixel[0] = static_cast<uint8_t>(x + y + noise(engine) / 8);
+        pixel[1] = static_cast<uint8_t>(x * 2 - y + noise(engine) / 8);
+        pixel[2] = static_cast<uint8_t>(y / 3 + noise(engine) / 8);
+        continue;
+      }
+      uint8_t value = section % 3 == 0 ? 0xFF : 0xF2;
+      if (section % 5 == 2 && x < width / 3) {
+        value = static_cast<uint8_t>(0x40 + x * 0x80 / width);
+      }
+      if (text_line && x > 40 && x < width - 40 &&
+          ((x / 7 + y / 24 * 13) % 11) < 8 && noise(engine) < 110) {
+        value = 0x20;
+      }
+      pixel[0] = value;
+      pixel[1] = value;
+      pixel[2] = value;
+    }
+  }
+  return page;
+}
+
+// What a surface copy of |area| delivers: a fresh bitmap of those pixels
+ScreenshotBitmap Readback(const ScreenshotBitmap& page,
+                          const gfx::Rect& area) {
+  return page.Crop(area);
+}
+
+// A full-page capture as scroll-and-stitch: one viewport readback per
+// scroll position, copied into the page bitmap
+ScreenshotBitmap ReadbackFullPage(const ScreenshotBitmap& page) {
+  ScreenshotBitmap full(page.width(), page.height());
+  for (int top = 0; top < page.height(); top += kViewportHeight) {
+    int height = std::min(kViewportHeight, page.height() - top);
+    ScreenshotBitmap tile =
+        Readback(page, gfx::Rect(0, top, page.width(), height));
+    memcpy(full.row(top), tile.data(), tile.byte_size());
+  }
+  return full;
+}
+
+class SyntheticPage : public BatchElementCapture::Delegate {
+ public:
+  explicit SyntheticPage(const ScreenshotBitmap* page) : page_(page) {}
+
+  ScreenshotBitmap CaptureTile(const gfx::Rect& tile) override {
+    return Readback(*page_, tile);
+  }
+
+  ScreenshotBitmap CaptureElement(const gfx::Rect& element_bounds) override {
+    return Readback(*page_, element_bounds);
+  }
+
+ private:
+  const ScreenshotBitmap* const page_;
+};
+
+// Element boxes of the sizes tooltips capture: buttons, links, cards
+std::vector<gfx::Rect> MakeElements(int page_height) {
+  std::vector<gfx::Rect> elements;
+  std::mt19937 engine(11);
+  std::uniform_int_distribution<int> width(48, 480);
+  std::uniform_int_distribution<int> height(20, 240);
+  for (int i = 0; i < kElementBatchSize; ++i) {
+    int element_width = width(engine);
+    int element_height = height(engine);
+    std::uniform_int_distribution<int> x(0, kPageWidth - element_width);
+    std::uniform_int_distribution<int> y(
+        0, std::max(0, std::min(page_height, 3 * kViewportHeight) -
+                           element_height));
+    elements.push_back(
+        gfx::Rect(x(engine), y(engine), element_width, element_height));
+  }
+  return elements;
+}
+
+bool HasSignature(const std::vector<uint8_t>& file, Format format) {
+  if (file.size() < 4) {
+    return false;
+  }
+  switch (format.format) {
+    case TiledEncodeOptions::Format::kPng:
+      return file[0] == 0x89 && file[1] == 'P';
+    case TiledEncodeOptions::Format::kJpeg:
+      return file[0] == 0xFF && file[1] == 0xD8;
+    case TiledEncodeOptions::Format::kQoi:
+      return memcmp(file.data(), "qoif", 4) == 0;
+  }
+  return false;
+}
+
+double Percentile(std::vector<double> values, double fraction) {
+  std::sort(values.begin(), values.end());
+  return values[static_cast<size_t>(fraction * (values.size() - 1) + 0.5)];
+}
+
+// Times |run|, which returns its output size or 0 on failure, after one
+// warm-up run
+bool Measure(const std::string& name,
+             int iterations,
+             size_t input_bytes,
+             const std::function<size_t()>& run,
+             CaseResult* result) {
+  *result = CaseResult();
+  result->name = name;
+  result->iterations = iterations;
+  result->input_bytes = input_bytes;
+  if (!run()) {
+    std::cerr << name << " failed" << std::endl;
+    return false;
+  }
+  std::vector<double> times;
+  uint64_t allocations = g_allocation_count.load();
+  uint64_t allocated_bytes = g_allocated_bytes.load();
+  for (int i = 0; i < iterations; ++i) {
+    Clock::time_point start = Clock::now();
+    size_t output_bytes = run();
+    times.push_back(
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count());
+    if (!output_bytes) {
+      std::cerr << name << " failed" << std::endl;
+      return false;
+    }
+    result->output_bytes = output_bytes;
+  }
+  result->allocations =
+      static_cast<double>(g_allocation_count.load() - allocations) /
+      iterations;
+  result->allocated_bytes =
+      static_cast<double>(g_allocated_bytes.load() - allocated_bytes) /
+      iterations;
+  result->min_ms = Percentile(times, 0);
+  result->p50_ms = Percentile(times, 0.5);
+  double total_ms = 0;
+  for (double ms : times) {
+    total_ms += ms;
+  }
+  result->mean_ms = total_ms / iterations;
+  return true;
+}
+
+void PrintHeader() {
+  std::cout << "  " << std::left << std::setw(30) << "case" << std::right
+            << std::setw(10) << "min(ms)" << std::setw(10) << "p50(ms)"
+            << std::setw(10) << "MB/s" << std::setw(12) << "out(KB)"
+            << std::setw(10) << "allocs" << std::setw(12) << "alloc(KB)"
+            << std::setw(12) << "captures/s" << std::endl;
+}
+
+void PrintCase(const CaseResult& result) {
+  std::cout << "  " << std::left << std::setw(30) << result.name
+            << std::right << std::fixed << std::setprecision(2)
+            << std::setw(10) << result.min_ms << std::setw(10)
+            << result.p50_ms << std::setprecision(1) << std::setw(10)
+            << result.MegabytesPerSecond() << std::setw(12)
+            << result.output_bytes / 1024.0 << std::setw(10)
+            << result.allocations << std::setw(12)
+            << result.allocated_bytes / 1024.0;
+  if (result.threads) {
+    std::cout << std::setw(12) << result.captures_per_second << "  x"
+              << std::setprecision(2) << result.scaling;
+  }
+  std::cout << std::endl;
+}
+
+void WriteJson(const std::string& path,
+               const BenchmarkOptions& options,
+               const std::vector<CaseResult>& results) {
+  std::ofstream out(path);
+  out << "{\n  \"benchmark\": \"screenshot_capture\",\n"
+      << "  \"page_width\": " << kPageWidth << ",\n"
+      << "  \"page_height\": " << options.page_height << ",\n"
+      << "  \"viewport_height\": " << kViewportHeight << ",\n"
+      << "  \"hardware_threads\": " << std::thread::hardware_concurrency()
+      << ",\n  \"cases\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const CaseResult& result = results[i];
+    out << "    {\"name\": \"" << result.name << "\""
+        << ", \"iterations\": " << result.iterations
+        << ", \"min_ms\": " << result.min_ms
+        << ", \"p50_ms\": " << result.p50_ms
+        << ", \"mean_ms\": " << result.mean_ms
+        << ", \"input_bytes\": " << result.input_bytes
+        << ", \"mb_per_second\": " << result.MegabytesPerSecond()
+        << ", \"output_bytes\": " << result.output_bytes
+        << ", \"allocations\": " << result.allocations
+        << ", \"allocated_bytes\": " << result.allocated_bytes;
+    if (result.threads) {
+      out << ", \"threads\": " << result.threads
+          << ", \"captures_per_second\": " << result.captures_per_second
+          << ", \"scaling\": " << result.scaling;
+    }
+    out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  ScreenshotBitmap page = MakePage(kPageWidth, options.page_height);
+  int viewport_height = std::min(kViewportHeight, options.page_height);
+  gfx::Rect viewport(0, 0, kPageWidth, viewport_height);
+  std::vector<gfx::Rect> elements = MakeElements(options.page_height);
+  // A typical single tooltip target, inside the viewport
+  gfx::Rect element(320, std::min(240, viewport_height / 2), 320,
+                    std::min(180, viewport_height / 2));
+
+  BatchElementCapture::Options batch_options;
+  batch_options.viewport_size = gfx::Size(kPageWidth, viewport_height);
+  batch_options.page_size = gfx::Size(kPageWidth, options.page_height);
+
+  auto wanted = [&options](const std::string& name) {
+    return options.filter.empty() ||
+           name.find(options.filter) != std::string::npos;
+  };
+
+  std::vector<CaseResult> results;
+  std::cout << kPageWidth << "x" << options.page_height << " page, "
+            << kPageWidth << "x" << viewport_height << " viewport, "
+            << std::thread::hardware_concurrency() << " hardware threads, "
+            << options.iterations << " iterations" << std::endl
+            << std::endl;
+  PrintHeader();
+
+  for (const Format& format : kFormats) {
+    TiledEncodeOptions encode;
+    encode.format = format.format;
+    auto encode_bitmap = [&encode, format](const ScreenshotBitmap& bitmap) {
+      std::vector<uint8_t> file;
+      if (!EncodeScreenshotTiled(bitmap, encode, &file) ||
+          !HasSignature(file, format)) {
+        return size_t{0};
+      }
+      return file.size();
+    };
+
+    ScreenshotBitmap element_bitmap = Readback(page, element);
+    ScreenshotBitmap viewport_bitmap = Readback(page, viewport);
+    struct Input {
+      const char* size;
+      const ScreenshotBitmap* bitmap;
+    };
+    const Input kInputs[] = {
+        {"element", &element_bitmap},
+        {"viewport", &viewport_bitmap},
+        {"full_page", &page},
+    };
+    for (const Input& input : kInputs) {
+      std::string name =
+          std::string("encode/") + format.name + "/" + input.size;
+      if (!wanted(name)) {
+        continue;
+      }
+      CaseResult result;
+      if (!Measure(name, options.iterations, input.bitmap->byte_size(),
+                   [&] { return encode_bitmap(*input.bitmap); }, &result)) {
+        return 1;
+      }
+      PrintCase(result);
+      results.push_back(result);
+    }
+
+    struct Capture {
+      const char* kind;
+      size_t input_bytes;
+      std::function<size_t()> run;
+    };
+    const Capture kCaptures[] = {
+        {"viewport", viewport_bitmap.byte_size(),
+         [&] { return encode_bitmap(Readback(page, viewport)); }},
+        {"full_page", page.byte_size(),
+         [&] { return encode_bitmap(ReadbackFullPage(page)); }},
+        {"element", element_bitmap.byte_size(),
+         [&] {
+           return encode_bitmap(Readback(page, viewport).Crop(element));
+         }},
+        {"elements24", 0,
+         [&] {
+           SyntheticPage delegate(&page);
+           BatchElementCapture batch(&delegate, batch_options);
+           size_t total = 0;
+           for (const ScreenshotBitmap& bitmap : batch.Capture(elements)) {
+             size_t size = encode_bitmap(bitmap);
+             if (!size) {
+               return size_t{0};
+             }
+             total += size;
+           }
+           return total;
+         }},
+    };
+    for (const Capture& capture : kCaptures) {
+      std::string name =
+          std::string("capture/") + capture.kind + "/" + format.name;
+      if (!wanted(name)) {
+        continue;
+      }
+      size_t input_bytes = capture.input_bytes;
+      if (!input_bytes) {
+        for (const gfx::Rect& bounds : elements) {
+          input_bytes += static_cast<size_t>(bounds.width()) *
+                         bounds.height() * ScreenshotBitmap::kBytesPerPixel;
+        }
+      }
+      CaseResult result;
+      if (!Measure(name, options.iterations, input_bytes, capture.run,
+                   &result)) {
+        return 1;
+      }
+      PrintCase(result);
+      results.push_back(result);
+    }
+
+    // Independent captures at once, as several tabs or crawl workers do,
+    // each encoding on its own thread
+    TiledEncodeOptions single_thread = encode;
+    single_thread.max_threads = 1;
+    double one_thread_rate = 0;
+    for (int threads = 1; threads <= options.max_threads; threads *= 2) {
+      std::string name = std::string("concurrent/") + format.name +
+                         "/threads" + std::to_string(threads);
+      if (!wanted(name)) {
+        continue;
+      }
+      const int kCapturesPerThread = 4;
+      CaseResult result;
+      bool ok = Measure(
+          name, options.iterations,
+          viewport_bitmap.byte_size() * kCapturesPerThread * threads,
+          [&] {
+            std::atomic<size_t> output_bytes(0);
+            std::atomic<bool> failed(false);
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; ++t) {
+              workers.emplace_back([&] {
+                for (int i = 0; i < kCapturesPerThread; ++i) {
+                  std::vector<uint8_t> file;
+                  if (!EncodeScreenshotTiled(Readback(page, viewport),
+                                             single_thread, &file)) {
+                    failed = true;
+                  }
+                  output_bytes += file.size();
+                }
+              });
+            }
+            for (std::thread& worker : workers) {
+              worker.join();
+            }
+            return failed ? size_t{0} : output_bytes.load();
+          },
+          &result);
+      if (!ok) {
+        return 1;
+      }
+      result.threads = threads;
+      result.captures_per_second =
+          kCapturesPerThread * threads / (result.p50_ms / 1000);
+      if (threads == 1) {
+        one_thread_rate = result.captures_per_second;
+      }
+      result.scaling = one_thread_rate > 0
+                           ? result.captures_per_second / one_thread_rate
+                           : 0;
+      PrintCase(result);
+      results.push_back(result);
+    }
+  }
+
+  if (results.empty()) {
+    std::cerr << "No case matches --filter=" << options.filter << std::endl;
+    return 1;
+  }
+  if (!options.json_path.empty()) {
+    WriteJson(options.json_path, options, results);
+  }
+  return 0;
+}
+
+bool ParseFlag(const std::string& arg,
+               const std::string& name,
+               std::string* value) {
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = arg.substr(prefix.size());
+  return true;
+}
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value;
+    if (ParseFlag(arg, "iterations", &value)) {
+      options->iterations = std::max(1, std::stoi(value));
+    } else if (ParseFlag(arg, "page-height", &value)) {
+      options->page_height = std::stoi(value);
+    } else if (ParseFlag(arg, "max-threads", &value)) {
+      options->max_threads = std::max(1, std::stoi(value));
+    } else if (ParseFlag(arg, "filter", &value)) {
+      options->filter = value;
+    } else if (ParseFlag(arg, "json", &value)) {
+      options->json_path = value;
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return false;
+    }
+  }
+  if (options->page_height < 16) {
+    std::cerr << "--page-height must be at least 16" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  if (!tooltip::ParseOptions(argc, argv, &options)) {
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
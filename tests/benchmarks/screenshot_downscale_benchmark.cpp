@@ -0,0 +1,268 @@
+// Benchmark for scaling screenshots down to the configured size limit.
+//
+// Downscales a synthetic HiDPI capture to a range of longest edges and
+// reports, for each:
+//   - area averaging time with the scalar and SSE2 loops, which must write
+//     identical bytes
+//   - PSNR against an exact floating-point area average, and the PSNR that
+//     point sampling reaches, for comparison
+//   - what the capture costs to upload: downscale plus JPEG encode time and
+//     bytes, against encoding the capture at native resolution
+//
+// Usage:
+//   screenshot_downscale_benchmark [--width=N] [--height=N] [--repeat=N]
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/screenshot_downscaler.h"
+#include "chrome/browser/tooltip/tiled_screenshot_encoder.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int width = 2560;
+  int height = 1600;
+  int repeat = 5;
+};
+
+const int kMaxEdges[] = {1920, 1280, 1024, 800, 512, 256};
+
+// The fixed-point average must stay indistinguishable from the exact one
+const double kMinPsnr = 45.0;
+
+typedef void (*DownscaleFunction)(const uint8_t*,
+                                  int,
+                                  int,
+                                  size_t,
+                                  uint8_t*,
+                                  int,
+                                  int,
+                                  size_t,
+                                  size_t);
+
+// Page-like content with the fine detail that makes naive resizing alias:
+// one-pixel text strokes, hairline borders and photo blocks
+ScreenshotBitmap MakeCapture(int width, int height) {
+  ScreenshotBitmap capture(width, height);
+  std::mt19937 engine(7);
+  std::uniform_int_distribution<int> noise(0, 255);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = capture.row(y);
+    bool text_line = (y % 36) >= 8 && (y % 36) < 26;
+    for (int x = 0; x < width; ++x) {
+      uint8_t* pixel = row + x * 4;
+      if (y > height / 2 && x > width / 2) {
+        pixel[0] = static_cast<uint8_t>(128 + 100 * sin(x * 0.05) +
+                                        noise(engine) / 16);
+        pixel[1] = static_cast<uint8_t>(128 + 100 * cos(y * 0.03));
+        pixel[2] = static_cast<uint8_t>((x ^ y) + noise(engine) / 16);
+      } else {
+        uint8_t value = 0xFA;
+        if (x % 240 == 0 || y % 200 == 0) {
+          value = 0xA0;
+        } else if (text_line && ((x / 3 + y / 36 * 7) % 5) < 3 &&
+                   (x + y) % 2 == 0) {
+          value = 0x18;
+        }
+        memset(pixel, value, 3);
+      }
+      pixel[3] = 0xFF;
+    }
+  }
+  return capture;
+}
+
+ScreenshotBitmap ExactAreaAverage(const ScreenshotBitmap& source,
+                                  int width,
+                                  int height) {
+  ScreenshotBitmap result(width, height);
+  double scale_x = static_cast<double>(source.width()) / width;
+  double scale_y = static_cast<double>(source.height()) / height;
+  std::vector<double> row(source.width() * 4);
+  for (int y = 0; y < height; ++y) {
+    std::fill(row.begin(), row.end(), 0.0);
+    double top = y * scale_y;
+    double bottom = top + scale_y;
+    for (int sy = static_cast<int>(top); sy < bottom && sy < source.height();
+         ++sy) {
+      double weight =
+          std::min<double>(sy + 1, bottom) - std::max<double>(sy, top);
+      for (size_t i = 0; i < row.size(); ++i) {
+        row[i] += weight * source.row(sy)[i];
+      }
+    }
+    for (int x = 0; x < width; ++x) {
+      double left = x * scale_x;
+      double right = left + scale_x;
+      double sums[4] = {};
+      for (int sx = static_cast<int>(left); sx < right && sx < source.width();
+           ++sx) {
+        double weight =
+            std::min<double>(sx + 1, right) - std::max<double>(sx, left);
+        for (int c = 0; c < 4; ++c) {
+          sums[c] += weight * row[sx * 4 + c];
+        }
+      }
+      for (int c = 0; c < 4; ++c) {
+        result.row(y)[x * 4 + c] = static_cast<uint8_t>(
+            std::min(255.0, sums[c] / (scale_x * scale_y) + 0.5));
+      }
+    }
+  }
+  return result;
+}
+
+ScreenshotBitmap PointSample(const ScreenshotBitmap& source,
+                             int width,
+                             int height) {
+  ScreenshotBitmap result(width, height);
+  for (int y = 0; y < height; ++y) {
+    int sy = static_cast<int>((y + 0.5) * source.height() / height);
+    for (int x = 0; x < width; ++x) {
+      int sx = static_cast<int>((x + 0.5) * source.width() / width);
+      memcpy(result.row(y) + x * 4, source.row(sy) + sx * 4, 4);
+    }
+  }
+  return result;
+}
+
+double Psnr(const ScreenshotBitmap& a, const ScreenshotBitmap& b) {
+  double squared_error = 0;
+  for (size_t i = 0; i < a.byte_size(); ++i) {
+    double difference = static_cast<double>(a.data()[i]) - b.data()[i];
+    squared_error += difference * difference;
+  }
+  double mse = squared_error / a.byte_size();
+  return mse == 0 ? 99.0 : 10 * log10(255.0 * 255.0 / mse);
+}
+
+double BestMs(int repeat, const std::function<void()>& run) {
+  double best_ms = 0;
+  for (int i = 0; i < repeat; ++i) {
+    Clock::time_point start = Clock::now();
+    run();
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                          start)
+                    .count();
+    best_ms = i == 0 ? ms : std::min(best_ms, ms);
+  }
+  return best_ms;
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  ScreenshotBitmap capture = MakeCapture(options.width, options.height);
+  TiledEncodeOptions jpeg;
+  jpeg.format = TiledEncodeOptions::Format::kJpeg;
+  jpeg.max_threads = 1;
+
+  std::vector<uint8_t> native_file;
+  double native_ms = BestMs(options.repeat, [&] {
+    EncodeScreenshotTiled(capture, jpeg, &native_file);
+  });
+
+  std::cout << options.width << "x" << options.height << " capture, SSE2 "
+            << (internal::HasSSE2Downscale() ? "on" : "off") << std::endl
+            << "native JPEG: " << std::fixed << std::setprecision(1)
+            << native_ms << " ms, " << native_file.size() / 1024.0 << " KB"
+            << std::endl
+            << std::endl
+            << "  edge  size       scalar(ms) sse2(ms) speedup  psnr(dB)"
+               " point(dB) upload(ms) upload(KB) smaller"
+            << std::endl;
+
+  for (int max_edge : kMaxEdges) {
+    gfx::Size size =
+        GetDownscaledSize(capture.width(), capture.height(), max_edge);
+    ScreenshotBitmap scalar(size.width(), size.height());
+    ScreenshotBitmap sse2(size.width(), size.height());
+    auto time = [&](DownscaleFunction function, ScreenshotBitmap* out) {
+      return BestMs(options.repeat, [&] {
+        function(capture.data(), capture.width(), capture.height(),
+                 capture.stride(), out->data(), out->width(), out->height(),
+                 out->stride(), 1);
+      });
+    };
+    double scalar_ms = time(&internal::DownscalePixelsScalar, &scalar);
+    double sse2_ms = time(&internal::DownscalePixelsSSE2, &sse2);
+    if (memcmp(scalar.data(), sse2.data(), scalar.byte_size()) != 0) {
+      std::cerr << "Scalar and SSE2 results differ at " << max_edge
+                << std::endl;
+      return 1;
+    }
+
+    ScreenshotBitmap exact =
+        ExactAreaAverage(capture, size.width(), size.height());
+    double psnr = Psnr(exact, sse2);
+    double point_psnr =
+        Psnr(exact, PointSample(capture, size.width(), size.height()));
+    if (psnr < kMinPsnr) {
+      std::cerr << "PSNR " << psnr << " dB at " << max_edge
+                << " is below " << kMinPsnr << std::endl;
+      return 1;
+    }
+
+    std::vector<uint8_t> file;
+    double upload_ms = BestMs(options.repeat, [&] {
+      ScreenshotBitmap scaled = DownscaleScreenshot(capture, max_edge);
+      EncodeScreenshotTiled(scaled, jpeg, &file);
+    });
+
+    std::string dimensions =
+        std::to_string(size.width()) + "x" + std::to_string(size.height());
+    std::cout << "  " << std::setw(4) << max_edge << "  " << std::left
+              << std::setw(10) << dimensions << std::right << std::setw(11)
+              << scalar_ms << std::setw(9) << sse2_ms << std::setw(7)
+              << std::setprecision(2) << scalar_ms / sse2_ms << "x"
+              << std::setprecision(1) << std::setw(10) << psnr
+              << std::setw(10) << point_psnr << std::setw(11) << upload_ms
+              << std::setw(11) << file.size() / 1024.0 << std::setw(7)
+              << std::setprecision(2)
+              << static_cast<double>(native_file.size()) / file.size()
+              << "x" << std::setprecision(1) << std::endl;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 8, "--width=") == 0) {
+      options.width = std::stoi(arg.substr(8));
+    } else if (arg.compare(0, 9, "--height=") == 0) {
+      options.height = std::stoi(arg.substr(9));
+    } else if (arg.compare(0, 9, "--repeat=") == 0) {
+      options.repeat = std::stoi(arg.substr(9));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.width <= 0 || options.height <= 0 || options.repeat <= 0) {
+    std::cerr << "--width, --height and --repeat must be positive"
+              << std::endl;
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
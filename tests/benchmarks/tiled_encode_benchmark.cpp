@@ -0,0 +1,293 @@
+// Thread scaling benchmark for tiled screenshot encoding.
+//
+// Encodes a synthetic full-page capture as PNG and JPEG with 1, 2, 4, ...
+// threads up to the core count and reports time, speedup and size. The
+// single-strip encode (strip height = image height) is the unsplit
+// baseline, to show what splitting costs in file size.
+//
+// Every output is decoded with libpng/libjpeg: PNGs must reproduce the
+// input exactly and JPEGs must stay above a PSNR floor. Outputs for
+// different thread counts must be byte-identical.
+//
+// Usage:
+//   tiled_encode_benchmark [--width=N] [--height=N] [--strip-height=N]
+//                          [--repeat=N] [--max-threads=N]
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <jpeglib.h>
+#include <png.h>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/screenshot_bitmap.h"
+#include "chrome/browser/tooltip/tiled_screenshot_encoder.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int width = 1280;
+  int height = 16000;
+  int strip_height = 256;
+  int repeat = 3;
+  // Highest thread count to try; 0 means the number of cores
+  size_t max_threads = 0;
+};
+
+// The synthetic page has noisy photo blocks and hard-edged text, which
+// quality 85 keeps at about 28 dB; a broken stitch falls far below this
+const double kMinJpegPsnr = 25.0;
+
+// Page-like content: flat backgrounds, blocks of "text" and a few images
+ScreenshotBitmap MakePage(int width, int height) {
+  ScreenshotBitmap page(width, height);
+  std::mt19937 engine(5);
+  std::uniform_int_distribution<int> noise(0, 255);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = page.row(y);
+    int section = y / 400;
+    uint8_t background = section % 3 == 0 ? 0xFF : 0xF2;
+    bool text_line = (y % 24) >= 6 && (y % 24) < 18;
+    for (int x = 0; x < width; ++x) {
+      uint8_t* pixel = row + x * 4;
+      uint8_t value = background;
+      if (section % 5 == 4 && x > width / 4 && x < width * 3 / 4) {
+        // Photo-like block
+        pixel[0] = static_cast<uint8_t>(x + y + noise(engine) / 8);
+        pixel[1] = static_cast<uint8_t>(x * 2 - y + noise(engine) / 8);
+        pixel[2] = static_cast<uint8_t>(y / 3 + noise(engine) / 8);
+        pixel[3] = 0xFF;
+        continue;
+      }
+      if (text_line && x > 40 && x < width - 40 &&
+          ((x / 7 + y / 24 * 13) % 11) < 8 && noise(engine) < 110) {
+        value = 0x20;
+      }
+      pixel[0] = value;
+      pixel[1] = value;
+      pixel[2] = value;
+      pixel[3] = 0xFF;
+    }
+  }
+  return page;
+}
+
+bool DecodePng(const std::vector<uint8_t>& png, ScreenshotBitmap* bitmap) {
+  png_image image;
+  memset(&image, 0, sizeof(image));
+  image.version = PNG_IMAGE_VERSION;
+  if (!png_image_begin_read_from_memory(&image, png.data(), png.size())) {
+    return false;
+  }
+  image.format = PNG_FORMAT_RGBA;
+  ScreenshotBitmap decoded(image.width, image.height);
+  if (!png_image_finish_read(&image, nullptr, decoded.data(), 0, nullptr)) {
+    return false;
+  }
+  *bitmap = std::move(decoded);
+  return true;
+}
+
+bool DecodeJpeg(const std::vector<uint8_t>& jpeg, ScreenshotBitmap* bitmap) {
+  jpeg_decompress_struct cinfo;
+  jpeg_error_mgr errors;
+  cinfo.err = jpeg_std_error(&errors);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, jpeg.data(), jpeg.size());
+  if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  cinfo.out_color_space = JCS_RGB;
+  jpeg_start_decompress(&cinfo);
+  ScreenshotBitmap decoded(cinfo.output_width, cinfo.output_height);
+  std::vector<uint8_t> row(cinfo.output_width * 3);
+  while (cinfo.output_scanline < cinfo.output_height) {
+    int y = cinfo.output_scanline;
+    JSAMPROW row_pointer = row.data();
+    jpeg_read_scanlines(&cinfo, &row_pointer, 1);
+    for (int x = 0; x < decoded.width(); ++x) {
+      memcpy(decoded.row(y) + x * 4, row.data() + x * 3, 3);
+      decoded.row(y)[x * 4 + 3] = 0xFF;
+    }
+  }
+  // libjpeg only warns about corrupt data, so count the warnings
+  bool clean = errors.num_warnings == 0;
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  *bitmap = std::move(decoded);
+  return clean;
+}
+
+double Psnr(const ScreenshotBitmap& a, const ScreenshotBitmap& b) {
+  double squared_error = 0;
+  size_t samples = 0;
+  for (size_t i = 0; i < a.byte_size(); ++i) {
+    if (i % 4 == 3) {
+      continue;
+    }
+    double difference = static_cast<double>(a.data()[i]) - b.data()[i];
+    squared_error += difference * difference;
+    ++samples;
+  }
+  double mse = squared_error / samples;
+  return mse == 0 ? 99.0 : 10 * log10(255.0 * 255.0 / mse);
+}
+
+bool Verify(TiledEncodeOptions::Format format,
+            const ScreenshotBitmap& page,
+            const std::vector<uint8_t>& encoded) {
+  ScreenshotBitmap decoded;
+  if (format == TiledEncodeOptions::Format::kPng) {
+    if (!DecodePng(encoded, &decoded) || decoded.width() != page.width() ||
+        decoded.height() != page.height() ||
+        memcmp(decoded.data(), page.data(), page.byte_size()) != 0) {
+      std::cerr << "PNG does not decode to the input" << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  if (!DecodeJpeg(encoded, &decoded) || decoded.width() != page.width() ||
+      decoded.height() != page.height()) {
+    std::cerr << "JPEG does not decode cleanly" << std::endl;
+    return false;
+  }
+  double psnr = Psnr(page, decoded);
+  if (psnr < kMinJpegPsnr) {
+    std::cerr << "JPEG PSNR " << psnr << " dB is below " << kMinJpegPsnr
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+double BestEncodeMs(const ScreenshotBitmap& page,
+                    const TiledEncodeOptions& options,
+                    int repeat,
+                    std::vector<uint8_t>* encoded) {
+  double best_ms = 0;
+  for (int i = 0; i < repeat; ++i) {
+    Clock::time_point start = Clock::now();
+    if (!EncodeScreenshotTiled(page, options, encoded)) {
+      return -1;
+    }
+    double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+                                                          start)
+                    .count();
+    best_ms = i == 0 ? ms : std::min(best_ms, ms);
+  }
+  return best_ms;
+}
+
+bool RunFormat(const char* name,
+               TiledEncodeOptions::Format format,
+               const ScreenshotBitmap& page,
+               const BenchmarkOptions& options) {
+  TiledEncodeOptions encode_options;
+  encode_options.format = format;
+
+  // Unsplit baseline
+  encode_options.strip_height = page.height();
+  encode_options.max_threads = 1;
+  std::vector<uint8_t> baseline;
+  double baseline_ms =
+      BestEncodeMs(page, encode_options, options.repeat, &baseline);
+  if (baseline_ms < 0 || !Verify(format, page, baseline)) {
+    return false;
+  }
+
+  std::cout << name << std::endl
+            << "  threads      time(ms)   speedup    size(KB)" << std::endl
+            << std::fixed << std::setprecision(1) << "  unsplit "
+            << std::setw(13) << baseline_ms << std::setw(10) << 1.0
+            << std::setw(12) << baseline.size() / 1024.0 << std::endl;
+
+  encode_options.strip_height = options.strip_height;
+  std::vector<uint8_t> reference;
+  size_t cores = options.max_threads;
+  if (cores == 0) {
+    cores = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t threads = 1;; threads = std::min(threads * 2, cores)) {
+    encode_options.max_threads = threads;
+    std::vector<uint8_t> encoded;
+    double ms = BestEncodeMs(page, encode_options, options.repeat, &encoded);
+    if (ms < 0 || !Verify(format, page, encoded)) {
+      return false;
+    }
+    if (reference.empty()) {
+      reference = encoded;
+    } else if (encoded != reference) {
+      std::cerr << name << " output changes with the thread count"
+                << std::endl;
+      return false;
+    }
+    std::cout << "  " << std::left << std::setw(8) << threads << std::right
+              << std::setw(12) << ms << std::setw(10) << baseline_ms / ms
+              << std::setw(12) << encoded.size() / 1024.0 << std::endl;
+    if (threads == cores) {
+      break;
+    }
+  }
+  std::cout << std::endl;
+  return true;
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  ScreenshotBitmap page = MakePage(options.width, options.height);
+  std::cout << options.width << "x" << options.height << " page, "
+            << options.strip_height << "-row strips" << std::endl
+            << std::endl;
+  bool ok = RunFormat("PNG", TiledEncodeOptions::Format::kPng, page,
+                      options) &&
+            RunFormat("JPEG", TiledEncodeOptions::Format::kJpeg, page,
+                      options);
+  return ok ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 8, "--width=") == 0) {
+      options.width = std::stoi(arg.substr(8));
+    } else if (arg.compare(0, 9, "--height=") == 0) {
+      options.height = std::stoi(arg.substr(9));
+    } else if (arg.compare(0, 15, "--strip-height=") == 0) {
+      options.strip_height = std::stoi(arg.substr(15));
+    } else if (arg.compare(0, 9, "--repeat=") == 0) {
+      options.repeat = std::stoi(arg.substr(9));
+    } else if (arg.compare(0, 14, "--max-threads=") == 0) {
+      options.max_threads = std::stoul(arg.substr(14));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.width <= 0 || options.height <= 0 || options.repeat <= 0) {
+    std::cerr << "--width, --height and --repeat must be positive"
+              << std::endl;
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
@@ -0,0 +1,683 @@
+// Headless hover-trace replay benchmark for the tooltip pipeline.
+//
+// Feeds TooltipService a stream of hover events (ElementInfo, mouse position
+// and timestamp) against test WebContents, a fake ScreenshotCapture and a
+// mock AI backend whose latencies follow configurable log-normal
+// distributions. Reports throughput, how much work the hover-intent
+// scheduler and request tokens saved, and per-stage latency percentiles
+// from TooltipTraceRecorder.
+//
+// Usage:
+//   tooltip_pipeline_benchmark [--trace=hovers.csv] [--mode=realtime|fast]
+//       [--events=N] [--tabs=N] [--hover-delay-ms=N] [--pipelined]
+//       [--ai-median-ms=N] [--ai-sigma=F] [--capture-median-ms=N]
+//       [--capture-sigma=F] [--speed=F] [--seed=N]
+//       [--json=report.json] [--trace-json=trace.json]
+//
+// realtime replays events at their recorded times (divided by --speed).
+// fast ignores the timestamps and the hover delay and issues every event
+// back to back, so each hover runs the full show path; use it to find the
+// event rate at which the UI thread saturates.
+//
+// Without --trace a synthetic stream is generated: pointer sweeps across
+// several elements followed by a dwell long enough to show a tooltip, over
+// a fixed pool of elements per tab so that re-hovers can hit the cache.
+//
+// Trace format, one event per line ('#' starts a comment, no quoting):
+//   <time_ms>,<hover|leave>,<tab>,<tag>,<id>,<class>,<role>,<x>,<y>,<w>,<h>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#else
+#include "base/bind.h"
+#include "base/macros.h"
+#include "base/run_loop.h"
+#include "base/task/single_thread_task_executor.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "content/public/browser/web_contents.h"
+#include "content/public/test/browser_task_environment.h"
+#include "content/public/test/test_browser_context.h"
+#include "content/public/test/test_renderer_host.h"
+#include "content/public/test/web_contents_tester.h"
+#include "ui/gfx/geometry/rect.h"
+#include "ui/gfx/image/image_unittest_util.h"
+#include "url/gurl.h"
+#endif
+#include "chrome/browser/tooltip/ai_integration.h"
+#include "chrome/browser/tooltip/screenshot_capture.h"
+#include "chrome/browser/tooltip/tooltip_cache.h"
+#include "chrome/browser/tooltip/tooltip_image_budget.h"
+#include "chrome/browser/tooltip/tooltip_prefs.h"
+#include "chrome/browser/tooltip/tooltip_request_token.h"
+#include "chrome/browser/tooltip/tooltip_service.h"
+#include "chrome/browser/tooltip/tooltip_trace.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Span = TooltipTraceRecorder::Span;
+
+struct BenchmarkOptions {
+  std::string trace_path;
+  bool fast = false;
+  int events = 5000;
+  int tabs = 4;
+  int hover_delay_ms = 300;
+  bool pipelined = false;
+  double ai_median_ms = 800;
+  double ai_sigma = 0.5;
+  double capture_median_ms = 40;
+  double capture_sigma = 0.3;
+  double speed = 1.0;
+  uint32_t seed = 42;
+  std::string json_path;
+  std::string trace_json_path;
+};
+
+struct HoverEvent {
+  int64_t time_ms = 0;
+  bool leave = false;
+  int tab = 0;
+  ElementInfo element_info;
+  gfx::Point mouse_position;
+};
+
+// Log-normal latency with the given median, in milliseconds
+class LatencyModel {
+ public:
+  LatencyModel(double median_ms, double sigma, uint32_t seed)
+      : engine_(seed),
+        distribution_(std::log(std::max(median_ms, 0.001)), sigma) {}
+
+  base::TimeDelta Sample() {
+    return base::TimeDelta::FromMicroseconds(
+        static_cast<int64_t>(distribution_(engine_) * 1000));
+  }
+
+ private:
+  std::mt19937 engine_;
+  std::lognormal_distribution<double> distribution_;
+};
+
+// Counters shared by the fakes and the replay driver
+struct BenchmarkState {
+  int outstanding_tasks = 0;
+  bool replay_done = false;
+  base::OnceClosure quit;
+
+  uint64_t captures_requested = 0;
+  uint64_t captures_delivered = 0;
+  uint64_t ai_requests = 0;
+  uint64_t ai_cancelled_before_send = 0;
+  uint64_t ai_cancelled_in_flight = 0;
+  uint64_t ai_completed = 0;
+
+  void TaskFinished() {
+    --outstanding_tasks;
+    MaybeQuit();
+  }
+
+  void MaybeQuit() {
+    if (replay_done && outstanding_tasks == 0 && quit) {
+      std::move(quit).Run();
+    }
+  }
+};
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+// The stub content::WebContents only carries what TooltipTabState reads
+class FakeWebContents : public content::WebContents {
+ public:
+  explicit FakeWebContents(const GURL& url) : url_(url) {}
+
+  gfx::Rect GetContainerBounds() override { return gfx::Rect(0, 0, 1280, 800); }
+  const GURL& GetLastCommittedURL() override { return url_; }
+
+ private:
+  GURL url_;
+};
+#endif
+
+// Task environment and the tabs the replay hovers in. Each tab has its own
+// URL so that tabs never share cache keys.
+class BenchmarkEnvironment {
+ public:
+  explicit BenchmarkEnvironment(int tab_count) {
+    for (int i = 0; i < tab_count; ++i) {
+      GURL url("https://bench.example/tab" + std::to_string(i));
+#ifdef STANDALONE_TOOLTIP_BUILD
+      tabs_.push_back(std::make_unique<FakeWebContents>(url));
+#else
+      tabs_.push_back(content::WebContentsTester::CreateTestWebContents(
+          &browser_context_, nullptr));
+      content::WebContentsTester::For(tabs_.back().get())
+          ->NavigateAndCommit(url);
+#endif
+    }
+  }
+
+  content::WebContents* tab(int index) const { return tabs_[index].get(); }
+  const std::vector<std::unique_ptr<content::WebContents>>& tabs() const {
+    return tabs_;
+  }
+
+ private:
+#ifdef STANDALONE_TOOLTIP_BUILD
+  base::SingleThreadTaskExecutor executor_;
+#else
+  content::BrowserTaskEnvironment task_environment_;
+  content::RenderViewHostTestEnabler test_enabler_;
+  content::TestBrowserContext browser_context_;
+#endif
+  // Destroyed before the browser context and task environment
+  std::vector<std::unique_ptr<content::WebContents>> tabs_;
+
+  DISALLOW_COPY_AND_ASSIGN(BenchmarkEnvironment);
+};
+
+class FakeScreenshotCapture : public ScreenshotCapture {
+ public:
+  FakeScreenshotCapture(BenchmarkState* state, LatencyModel latency)
+      : state_(state), latency_(std::move(latency)) {}
+
+  void CaptureElement(
+      content::WebContents* web_contents,
+      const ElementInfo& element_info,
+      base::OnceCallback<void(const gfx::Image&)> callback) override {
+    ++state_->captures_requested;
+
+    int width = std::max(1, element_info.bounds.width());
+    int height = std::max(1, element_info.bounds.height());
+    ++state_->outstanding_tasks;
+    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+        FROM_HERE,
+        base::BindOnce(
+            [](BenchmarkState* state, int width, int height,
+               base::OnceCallback<void(const gfx::Image&)> callback) {
+              // TooltipTabState drops screenshots for superseded shows
+              ++state->captures_delivered;
+              std::move(callback).Run(gfx::test::CreateImage(width, height));
+              state->TaskFinished();
+            },
+            state_, width, height, std::move(callback)),
+        latency_.Sample());
+  }
+
+ private:
+  BenchmarkState* state_;
+  LatencyModel latency_;
+};
+
+class MockAIIntegration : public AIIntegration {
+ public:
+  MockAIIntegration(BenchmarkState* state, LatencyModel latency)
+      : state_(state), latency_(std::move(latency)) {}
+
+  void GetDescription(
+      const ElementInfo& element_info,
+      const gfx::Image& screenshot,
+      TooltipRequestToken* token,
+      base::OnceCallback<void(const AIResponse&)> callback) override {
+    ++state_->ai_requests;
+    if (token->IsCancelled()) {
+      ++state_->ai_cancelled_before_send;
+      return;
+    }
+
+    AIResponse response;
+    response.provider = "mock";
+    response.description = "Mock description of " + element_info.tag_name;
+    response.confidence = screenshot.IsEmpty() ? "text" : "vision";
+
+    ++state_->outstanding_tasks;
+    base::ThreadTaskRunnerHandle::Get()->PostDelayedTask(
+        FROM_HERE,
+        base::BindOnce(
+            [](BenchmarkState* state,
+               scoped_refptr<TooltipRequestToken> token, AIResponse response,
+               base::OnceCallback<void(const AIResponse&)> callback) {
+              if (token->IsCancelled()) {
+                ++state->ai_cancelled_in_flight;
+              } else {
+                ++state->ai_completed;
+                std::move(callback).Run(response);
+              }
+              state->TaskFinished();
+            },
+            state_, base::WrapRefCounted(token), std::move(response),
+            std::move(callback)),
+        latency_.Sample());
+  }
+
+ private:
+  BenchmarkState* state_;
+  LatencyModel latency_;
+};
+
+class ShownCounter : public TooltipObserver {
+ public:
+  using TooltipObserver::OnTooltipShown;
+  void OnTooltipShown(content::WebContents* /*web_contents*/,
+                      const ElementInfo& /*element_info*/) override {
+    ++shown;
+  }
+
+  uint64_t shown = 0;
+};
+
+bool ParseFlag(const std::string& arg,
+               const std::string& name,
+               std::string* value) {
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = arg.substr(prefix.size());
+  return true;
+}
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value;
+    if (arg == "--pipelined") {
+      options->pipelined = true;
+    } else if (ParseFlag(arg, "trace", &value)) {
+      options->trace_path = value;
+    } else if (ParseFlag(arg, "mode", &value)) {
+      if (value != "realtime" && value != "fast") {
+        std::cerr << "Unknown mode: " << value << std::endl;
+        return false;
+      }
+      options->fast = value == "fast";
+    } else if (ParseFlag(arg, "events", &value)) {
+      options->events = std::stoi(value);
+    } else if (ParseFlag(arg, "tabs", &value)) {
+      options->tabs = std::max(1, std::stoi(value));
+    } else if (ParseFlag(arg, "hover-delay-ms", &value)) {
+      options->hover_delay_ms = std::stoi(value);
+    } else if (ParseFlag(arg, "ai-median-ms", &value)) {
+      options->ai_median_ms = std::stod(value);
+    } else if (ParseFlag(arg, "ai-sigma", &value)) {
+      options->ai_sigma = std::stod(value);
+    } else if (ParseFlag(arg, "capture-median-ms", &value)) {
+      options->capture_median_ms = std::stod(value);
+    } else if (ParseFlag(arg, "capture-sigma", &value)) {
+      options->capture_sigma = std::stod(value);
+    } else if (ParseFlag(arg, "speed", &value)) {
+      options->speed = std::max(0.001, std::stod(value));
+    } else if (ParseFlag(arg, "seed", &value)) {
+      options->seed = static_cast<uint32_t>(std::stoul(value));
+    } else if (ParseFlag(arg, "json", &value)) {
+      options->json_path = value;
+    } else if (ParseFlag(arg, "trace-json", &value)) {
+      options->trace_json_path = value;
+    } else {
+      std::cerr << "Unknown argument: " << arg << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LoadTrace(const std::string& path, std::vector<HoverEvent>* events) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << "Cannot open trace: " << path << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, ',')) {
+      fields.push_back(field);
+    }
+    if (fields.size() != 11) {
+      std::cerr << path << ":" << line_number << ": expected 11 fields"
+                << std::endl;
+      return false;
+    }
+
+    HoverEvent event;
+    event.time_ms = std::stoll(fields[0]);
+    event.leave = fields[1] == "leave";
+    event.tab = std::stoi(fields[2]);
+    event.element_info.tag_name = fields[3];
+    event.element_info.id = fields[4];
+    event.element_info.class_name = fields[5];
+    event.element_info.role = fields[6];
+    int x = std::stoi(fields[7]);
+    int y = std::stoi(fields[8]);
+    event.element_info.bounds =
+        gfx::Rect(x, y, std::stoi(fields[9]), std::stoi(fields[10]));
+    event.mouse_position = gfx::Point(x + 1, y + 1);
+    events->push_back(event);
+  }
+  return true;
+}
+
+std::vector<HoverEvent> GenerateTrace(const BenchmarkOptions& options) {
+  static const char* const kTags[] = {"a", "button", "input", "img", "div"};
+  static const char* const kRoles[] = {"link", "button", "textbox", "img", ""};
+  const int kElementsPerTab = 200;
+
+  std::mt19937 engine(options.seed);
+  std::uniform_int_distribution<int> element_dist(0, kElementsPerTab - 1);
+  std::uniform_int_distribution<int> sweep_length(3, 12);
+  std::uniform_int_distribution<int> sweep_gap_ms(15, 60);
+  std::uniform_int_distribution<int> dwell_ms(400, 2500);
+
+  std::vector<HoverEvent> events;
+  int64_t now_ms = 0;
+  while (static_cast<int>(events.size()) < options.events) {
+    int tab = static_cast<int>(events.size() / 7) % options.tabs;
+    int hovers = sweep_length(engine);
+    for (int i = 0; i < hovers; ++i) {
+      int element = element_dist(engine);
+      HoverEvent event;
+      event.time_ms = now_ms;
+      event.tab = tab;
+      event.element_info.tag_name = kTags[element % 5];
+      event.element_info.role = kRoles[element % 5];
+      event.element_info.id = "element-" + std::to_string(element);
+      event.element_info.class_name = "bench-item";
+      event.element_info.bounds =
+          gfx::Rect(20 + (element % 10) * 120, 20 + (element / 10) * 36, 100,
+                    28);
+      event.mouse_position = event.element_info.bounds.CenterPoint();
+      events.push_back(event);
+
+      // The last hover of a sweep is where the pointer rests
+      now_ms += i + 1 < hovers ? sweep_gap_ms(engine) : dwell_ms(engine);
+    }
+
+    HoverEvent leave = events.back();
+    leave.time_ms = now_ms;
+    leave.leave = true;
+    events.push_back(leave);
+    now_ms += sweep_gap_ms(engine);
+  }
+  return events;
+}
+
+void PrintSpan(TooltipTraceRecorder* recorder, Span span) {
+  TooltipTraceRecorder::SpanSummary summary = recorder->GetSpanSummary(span);
+  std::cout << "  " << std::left << std::setw(22)
+            << TooltipTraceRecorder::GetSpanName(span) << std::right
+            << std::setw(8) << summary.count << std::fixed
+            << std::setprecision(2) << std::setw(10) << summary.p50_us / 1000.0
+            << std::setw(10) << summary.p95_us / 1000.0 << std::setw(10)
+            << summary.p99_us / 1000.0 << std::setw(10)
+            << summary.max_us / 1000.0 << std::endl;
+}
+
+void WriteJsonReport(const std::string& path,
+                     const BenchmarkOptions& options,
+                     const BenchmarkState& state,
+                     size_t event_count,
+                     uint64_t shown,
+                     uint64_t cache_hits,
+                     double wall_ms,
+                     TooltipTraceRecorder* recorder) {
+  std::ofstream out(path);
+  out << "{\"mode\":\"" << (options.fast ? "fast" : "realtime") << "\""
+      << ",\"pipelined\":" << (options.pipelined ? "true" : "false")
+      << ",\"events\":" << event_count << ",\"wall_ms\":" << wall_ms
+      << ",\"events_per_sec\":" << event_count * 1000.0 / wall_ms
+      << ",\"tooltips_shown\":" << shown << ",\"cache_hits\":" << cache_hits
+      << ",\"captures_requested\":" << state.captures_requested
+      << ",\"captures_delivered\":" << state.captures_delivered
+      << ",\"ai_requests\":" << state.ai_requests
+      << ",\"ai_cancelled_before_send\":" << state.ai_cancelled_before_send
+      << ",\"ai_cancelled_in_flight\":" << state.ai_cancelled_in_flight
+      << ",\"ai_completed\":" << state.ai_completed << ",\"spans\":{";
+  for (int i = 0; i < static_cast<int>(Span::kCount); ++i) {
+    Span span = static_cast<Span>(i);
+    TooltipTraceRecorder::SpanSummary summary = recorder->GetSpanSummary(span);
+    out << (i ? "," : "") << "\"" << TooltipTraceRecorder::GetSpanName(span)
+        << "\":{\"count\":" << summary.count << ",\"p50_us\":"
+        << summary.p50_us << ",\"p95_us\":" << summary.p95_us
+        << ",\"p99_us\":" << summary.p99_us << ",\"max_us\":" << summary.max_us
+        << "}";
+  }
+  out << "}}" << std::endl;
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  std::vector<HoverEvent> events;
+  if (!options.trace_path.empty()) {
+    if (!LoadTrace(options.trace_path, &events)) {
+      return 1;
+    }
+  } else {
+    events = GenerateTrace(options);
+  }
+
+  int tab_count = options.tabs;
+  for (const HoverEvent& event : events) {
+    tab_count = std::max(tab_count, event.tab + 1);
+  }
+  BenchmarkEnvironment environment(tab_count);
+  BenchmarkState state;
+
+  TooltipService::ComponentFactory factory;
+  factory.screenshot_capture = base::BindRepeating(
+      [](BenchmarkState* state, const BenchmarkOptions* options)
+          -> std::unique_ptr<ScreenshotCapture> {
+        return std::make_unique<FakeScreenshotCapture>(
+            state, LatencyModel(options->capture_median_ms,
+                                options->capture_sigma, options->seed + 1));
+      },
+      &state, &options);
+  factory.ai_integration = base::BindRepeating(
+      [](BenchmarkState* state, const BenchmarkOptions* options)
+          -> std::unique_ptr<AIIntegration> {
+        return std::make_unique<MockAIIntegration>(
+            state, LatencyModel(options->ai_median_ms, options->ai_sigma,
+                                options->seed + 2));
+      },
+      &state, &options);
+
+  TooltipService* service = TooltipService::GetInstance();
+  service->SetComponentFactoryForTesting(factory);
+  service->Initialize();
+  service->GetPrefs()->SetAutoCapture(true);
+  service->GetPrefs()->SetPreferredAIProvider("openai");
+  service->GetPrefs()->SetTooltipDelay(options.fast ? 0
+                                                    : options.hover_delay_ms);
+  service->SetShowMode(options.pipelined ? TooltipService::ShowMode::kPipelined
+                                         : TooltipService::ShowMode::kSerial);
+
+  ShownCounter shown_counter;
+  service->AddObserver(&shown_counter);
+
+  // In serial mode nothing else asks for a description, so request it once
+  // the screenshot arrives, as the browser integration does.
+  class SerialDescriber : public TooltipObserver {
+   public:
+    explicit SerialDescriber(TooltipService* service) : service_(service) {}
+    using TooltipObserver::OnScreenshotCaptured;
+    using TooltipObserver::OnTooltipShown;
+    void OnTooltipShown(content::WebContents* web_contents,
+                        const ElementInfo& element_info) override {
+      element_infos_[web_contents] = element_info;
+    }
+    void OnScreenshotCaptured(content::WebContents* web_contents,
+                              const gfx::Image& screenshot) override {
+      service_->GetAIDescription(web_contents, element_infos_[web_contents],
+                                 screenshot);
+    }
+
+   private:
+    TooltipService* service_;
+    // Element of the tooltip last shown in each tab
+    std::map<content::WebContents*, ElementInfo> element_infos_;
+  } serial_describer(service);
+  if (!options.pipelined) {
+    service->AddObserver(&serial_describer);
+  }
+
+  auto dispatch = [](TooltipService* service,
+                     content::WebContents* web_contents,
+                     const HoverEvent* event) {
+    if (event->leave) {
+      service->CancelPendingTooltip(web_contents);
+    } else {
+      service->ShowTooltipForElement(web_contents, event->element_info,
+                                     event->mouse_position);
+    }
+  };
+
+  base::RunLoop run_loop;
+  state.quit = run_loop.QuitClosure();
+  Clock::time_point start = Clock::now();
+
+  scoped_refptr<base::SingleThreadTaskRunner> task_runner =
+      base::ThreadTaskRunnerHandle::Get();
+  int64_t first_ms = events.empty() ? 0 : events.front().time_ms;
+  int64_t last_delay_us = 0;
+  for (const HoverEvent& event : events) {
+    content::WebContents* web_contents = environment.tab(event.tab);
+    if (options.fast) {
+      task_runner->PostTask(
+          FROM_HERE, base::BindOnce(dispatch, service, web_contents, &event));
+      continue;
+    }
+    last_delay_us = static_cast<int64_t>((event.time_ms - first_ms) * 1000 /
+                                         options.speed);
+    task_runner->PostDelayedTask(
+        FROM_HERE, base::BindOnce(dispatch, service, web_contents, &event),
+        base::TimeDelta::FromMicroseconds(last_delay_us));
+  }
+
+  // Let the last dwell show its tooltip, then wait for in-flight work
+  int64_t settle_us =
+      options.fast ? 0
+                   : static_cast<int64_t>(options.hover_delay_ms * 1000 /
+                                          options.speed) +
+                         1000;
+  task_runner->PostDelayedTask(
+      FROM_HERE, base::BindOnce(
+                     [](BenchmarkState* state) {
+                       state->replay_done = true;
+                       state->MaybeQuit();
+                     },
+                     &state),
+      base::TimeDelta::FromMicroseconds(last_delay_us + settle_us));
+
+  run_loop.Run();
+  double wall_ms =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  // Close the remaining traces so their spans are exported
+  service->HideTooltip();
+
+  uint64_t cache_hits = 0;
+  for (const auto& web_contents : environment.tabs()) {
+    TooltipCache* cache = service->GetCache(web_contents.get());
+    if (cache) {
+      cache_hits += cache->GetStats().hits;
+    }
+  }
+
+  size_t hover_count = std::count_if(
+      events.begin(), events.end(),
+      [](const HoverEvent& event) { return !event.leave; });
+  TooltipTraceRecorder* recorder = service->GetTraceRecorder();
+
+  std::cout << "mode                " << (options.fast ? "fast" : "realtime")
+            << (options.pipelined ? ", pipelined" : ", serial") << std::endl;
+  std::cout << "events              " << events.size() << " (" << hover_count
+            << " hovers, " << tab_count << " tabs)" << std::endl;
+  std::cout << "wall time           " << std::fixed << std::setprecision(1)
+            << wall_ms << " ms" << std::endl;
+  std::cout << "throughput          " << events.size() * 1000.0 / wall_ms
+            << " events/s, " << shown_counter.shown * 1000.0 / wall_ms
+            << " tooltips/s" << std::endl;
+  std::cout << "tooltips shown      " << shown_counter.shown << " ("
+            << cache_hits << " from cache)" << std::endl;
+  std::cout << "captures            " << state.captures_requested
+            << " requested, " << state.captures_delivered << " delivered"
+            << std::endl;
+  std::cout << "ai requests         " << state.ai_requests << " requested, "
+            << state.ai_cancelled_before_send << " cancelled before send, "
+            << state.ai_cancelled_in_flight << " cancelled in flight, "
+            << state.ai_completed << " completed" << std::endl;
+
+  // Image memory still held once the replay has settled, per component
+  TooltipImageBudget::Usage image_usage = service->GetImageBudget()->GetUsage();
+  std::cout << "screenshot memory   " << image_usage.bytes_used << " of "
+            << image_usage.byte_budget << " bytes in "
+            << image_usage.image_count << " images ("
+            << image_usage.images_downscaled << " of "
+            << image_usage.images_admitted << " admitted downscaled, "
+            << image_usage.images_shared << " shared)" << std::endl;
+  for (int i = 0; i < static_cast<int>(TooltipImageBudget::Consumer::kCount);
+       ++i) {
+    const TooltipImageBudget::ConsumerUsage& consumer =
+        image_usage.consumers[i];
+    std::cout << "  " << std::left << std::setw(18)
+              << TooltipImageBudget::ConsumerName(
+                     static_cast<TooltipImageBudget::Consumer>(i))
+              << std::right << consumer.bytes << " bytes, " << consumer.leases
+              << " leases, " << consumer.evictions << " evictions"
+              << std::endl;
+  }
+
+  std::cout << std::endl
+            << "  span                     count   p50(ms)   p95(ms)   "
+               "p99(ms)   max(ms)"
+            << std::endl;
+  for (int i = 0; i < static_cast<int>(Span::kCount); ++i) {
+    PrintSpan(recorder, static_cast<Span>(i));
+  }
+
+  if (!options.json_path.empty()) {
+    WriteJsonReport(options.json_path, options, state, events.size(),
+                    shown_counter.shown, cache_hits, wall_ms, recorder);
+  }
+  if (!options.trace_json_path.empty()) {
+    std::ofstream(options.trace_json_path) << recorder->ExportChromeTraceJson();
+  }
+
+  service->RemoveObserver(&serial_describer);
+  service->RemoveObserver(&shown_counter);
+  service->Shutdown();
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  if (!tooltip::ParseOptions(argc, argv, &options)) {
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
@@ -0,0 +1,182 @@
+// Startup benchmark for TooltipService.
+//
+// Repeatedly initializes and shuts down the service and compares
+//   eager: Initialize() followed immediately by WarmUpComponents(), which is
+//          what every startup paid before components were created lazily
+//   lazy:  Initialize() alone; components are created on first use or by
+//          the idle-priority warm-up scheduled after the first paint
+// The difference is the time taken off the startup path. The deferred cost
+// is reported separately so that it can be checked against the budget of
+// the post-first-paint warm-up.
+//
+// Usage:
+//   tooltip_startup_benchmark [--iterations=N] [--json=report.json]
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/tooltip_service.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchmarkOptions {
+  int iterations = 200;
+  std::string json_path;
+};
+
+// Timing samples for one phase, in milliseconds
+struct PhaseStats {
+  std::vector<double> samples;
+
+  double Mean() const {
+    double total = 0;
+    for (double sample : samples) {
+      total += sample;
+    }
+    return samples.empty() ? 0 : total / samples.size();
+  }
+
+  double Percentile(double p) const {
+    if (samples.empty()) {
+      return 0;
+    }
+    std::vector<double> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+  }
+};
+
+double ElapsedMs(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+bool ParseFlag(const std::string& arg,
+               const std::string& name,
+               std::string* value) {
+  std::string prefix = "--" + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+  *value = arg.substr(prefix.size());
+  return true;
+}
+
+bool ParseOptions(int argc, char** argv, BenchmarkOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    std::string value;
+    if (ParseFlag(arg, "iterations", &value)) {
+      options->iterations = std::max(1, std::stoi(value));
+    } else if (ParseFlag(arg, "json", &value)) {
+      options->json_path = value;
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+void PrintPhase(const std::string& name, const PhaseStats& stats) {
+  std::cout << "  " << std::left << std::setw(22) << name << std::right
+            << std::fixed << std::setprecision(3) << std::setw(10)
+            << stats.Mean() << std::setw(10) << stats.Percentile(0.5)
+            << std::setw(10) << stats.Percentile(0.95) << std::endl;
+}
+
+void WritePhaseJson(std::ofstream& out,
+                    const std::string& name,
+                    const PhaseStats& stats,
+                    bool last) {
+  out << "    \"" << name << "\": {\"mean_ms\": " << stats.Mean()
+      << ", \"p50_ms\": " << stats.Percentile(0.5)
+      << ", \"p95_ms\": " << stats.Percentile(0.95) << "}"
+      << (last ? "\n" : ",\n");
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  TooltipService* service = TooltipService::GetInstance();
+
+  // One untimed cycle so that first-run costs such as loading shared state
+  // do not land on whichever variant runs first
+  service->Initialize();
+  service->WarmUpComponents();
+  service->Shutdown();
+
+  PhaseStats eager_startup;
+  PhaseStats lazy_startup;
+  PhaseStats deferred_warm_up;
+
+  for (int i = 0; i < options.iterations; ++i) {
+    Clock::time_point start = Clock::now();
+    service->Initialize();
+    service->WarmUpComponents();
+    eager_startup.samples.push_back(ElapsedMs(start));
+    service->Shutdown();
+
+    start = Clock::now();
+    service->Initialize();
+    lazy_startup.samples.push_back(ElapsedMs(start));
+
+    // What the post-first-paint warm-up (or the first hover) pays later
+    start = Clock::now();
+    service->WarmUpComponents();
+    deferred_warm_up.samples.push_back(ElapsedMs(start));
+    service->Shutdown();
+  }
+
+  double saved_ms = eager_startup.Mean() - lazy_startup.Mean();
+  double saved_percent =
+      eager_startup.Mean() > 0 ? saved_ms * 100 / eager_startup.Mean() : 0;
+
+  std::cout << "iterations          " << options.iterations << std::endl
+            << std::endl
+            << "  phase                  mean(ms)   p50(ms)   p95(ms)"
+            << std::endl;
+  PrintPhase("eager startup", eager_startup);
+  PrintPhase("lazy startup", lazy_startup);
+  PrintPhase("deferred warm-up", deferred_warm_up);
+  std::cout << std::endl
+            << "startup time saved  " << std::fixed << std::setprecision(3)
+            << saved_ms << " ms (" << std::setprecision(1) << saved_percent
+            << "%)" << std::endl;
+
+  if (!options.json_path.empty()) {
+    std::ofstream out(options.json_path);
+    out << "{\n  \"iterations\": " << options.iterations << ",\n"
+        << "  \"startup_saved_ms\": " << saved_ms << ",\n"
+        << "  \"startup_saved_percent\": " << saved_percent << ",\n"
+        << "  \"phases\": {\n";
+    WritePhaseJson(out, "eager_startup", eager_startup, false);
+    WritePhaseJson(out, "lazy_startup", lazy_startup, false);
+    WritePhaseJson(out, "deferred_warm_up", deferred_warm_up, true);
+    out << "  }\n}\n";
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  if (!tooltip::ParseOptions(argc, argv, &options)) {
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}
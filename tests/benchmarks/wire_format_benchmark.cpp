@@ -0,0 +1,442 @@
+// Encode/decode throughput of the tooltip wire format against JSON.
+//
+// For ElementInfo, AIResponse, AutomationAction and AutomationResult it
+// times, over a corpus of generated records,
+//   json encode:  build an nlohmann::json object and dump() it
+//   json decode:  parse() and copy every field into the struct
+//   wire encode:  Encode*()
+//   wire decode:  Decode*() into an owned struct
+//   wire view:    Init() a *WireView and read every string in place
+// and prints the mean encoded size of each format. The view column is what
+// a receiver pays when it only looks at a few fields and never copies them.
+//
+// Usage:
+//   wire_format_benchmark [--records=N] [--min-ms=N]
+
+#include <stdint.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#ifdef STANDALONE_TOOLTIP_BUILD
+#include "base/base_stubs.h"
+#endif
+#include "chrome/browser/tooltip/navigrab_integration.h"
+#include "chrome/browser/tooltip/tooltip_service.h"
+#include "chrome/browser/tooltip/tooltip_wire_format.h"
+
+namespace tooltip {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Json = nlohmann::json;
+
+struct BenchmarkOptions {
+  size_t records = 1000;
+  double min_ms = 200;
+};
+
+// Random text drawn from a small vocabulary, roughly like page content
+class TextGenerator {
+ public:
+  explicit TextGenerator(uint32_t seed) : engine_(seed) {}
+
+  std::string Words(size_t min_words, size_t max_words) {
+    static const char* const kWords[] = {
+        "checkout", "submit",  "cart",   "search",  "account", "settings",
+        "primary",  "button",  "nav",    "item",    "product", "details",
+        "open",     "the",     "menu",   "to",      "view",    "your",
+        "order",    "history", "and",    "manage",  "payment", "methods"};
+    std::uniform_int_distribution<size_t> count(min_words, max_words);
+    std::uniform_int_distribution<size_t> word(0, std::size(kWords) - 1);
+    std::string text;
+    for (size_t i = count(engine_); i > 0; --i) {
+      if (!text.empty()) {
+        text += ' ';
+      }
+      text += kWords[word(engine_)];
+    }
+    return text;
+  }
+
+  int Int(int min, int max) {
+    return std::uniform_int_distribution<int>(min, max)(engine_);
+  }
+
+ private:
+  std::mt19937 engine_;
+};
+
+// JSON path, matching the field names the structs use
+
+Json ElementInfoToJson(const ElementInfo& element_info) {
+  return Json{{"tag_name", element_info.tag_name},
+              {"id", element_info.id},
+              {"class_name", element_info.class_name},
+              {"text_content", element_info.text_content},
+              {"href", element_info.href},
+              {"src", element_info.src},
+              {"alt_text", element_info.alt_text},
+              {"title", element_info.title},
+              {"role", element_info.role},
+              {"aria_label", element_info.aria_label},
+              {"type", element_info.type},
+              {"bounds",
+               {{"x", element_info.bounds.x()},
+                {"y", element_info.bounds.y()},
+                {"width", element_info.bounds.width()},
+                {"height", element_info.bounds.height()}}},
+              {"computed_styles", element_info.computed_styles}};
+}
+
+ElementInfo ElementInfoFromJson(const Json& json) {
+  ElementInfo element_info;
+  element_info.tag_name = json.at("tag_name").get<std::string>();
+  element_info.id = json.at("id").get<std::string>();
+  element_info.class_name = json.at("class_name").get<std::string>();
+  element_info.text_content = json.at("text_content").get<std::string>();
+  element_info.href = json.at("href").get<std::string>();
+  element_info.src = json.at("src").get<std::string>();
+  element_info.alt_text = json.at("alt_text").get<std::string>();
+  element_info.title = json.at("title").get<std::string>();
+  element_info.role = json.at("role").get<std::string>();
+  element_info.aria_label = json.at("aria_label").get<std::string>();
+  element_info.type = json.at("type").get<std::string>();
+  const Json& bounds = json.at("bounds");
+  element_info.bounds =
+      gfx::Rect(bounds.at("x").get<int>(), bounds.at("y").get<int>(),
+                bounds.at("width").get<int>(), bounds.at("height").get<int>());
+  element_info.computed_styles =
+      json.at("computed_styles").get<std::string>();
+  element_info.ParseComputedStyles();
+  return element_info;
+}
+
+Json AIResponseToJson(const AIResponse& response) {
+  return Json{{"provider", response.provider},
+              {"description", response.description},
+              {"confidence", response.confidence},
+              {"timestamp", response.timestamp},
+              {"suggested_actions", response.suggested_actions}};
+}
+
+AIResponse AIResponseFromJson(const Json& json) {
+  AIResponse response;
+  response.provider = json.at("provider").get<std::string>();
+  response.description = json.at("description").get<std::string>();
+  response.confidence = json.at("confidence").get<std::string>();
+  response.timestamp = json.at("timestamp").get<int64_t>();
+  response.suggested_actions =
+      json.at("suggested_actions").get<std::vector<std::string>>();
+  return response;
+}
+
+Json AutomationActionToJson(const AutomationAction& action) {
+  return Json{{"type", static_cast<int>(action.type)},
+              {"text_input", action.text_input}};
+}
+
+AutomationAction AutomationActionFromJson(const Json& json) {
+  AutomationAction action;
+  action.type = static_cast<AutomationActionType>(json.at("type").get<int>());
+  action.text_input = json.at("text_input").get<std::string>();
+  return action;
+}
+
+Json AutomationResultToJson(const AutomationResult& result) {
+  return Json{{"success", result.success},
+              {"result_data", result.result_data},
+              {"error_message", result.error_message}};
+}
+
+AutomationResult AutomationResultFromJson(const Json& json) {
+  AutomationResult result;
+  result.success = json.at("success").get<bool>();
+  result.result_data = json.at("result_data").get<std::string>();
+  result.error_message = json.at("error_message").get<std::string>();
+  return result;
+}
+
+// Corpus generation
+
+std::vector<ElementInfo> MakeElements(size_t count, TextGenerator* text) {
+  static const char* const kTags[] = {"a", "button", "img", "input", "div"};
+  std::vector<ElementInfo> elements(count);
+  for (ElementInfo& element_info : elements) {
+    element_info.tag_name = kTags[text->Int(0, 4)];
+    element_info.id = text->Words(0, 2);
+    element_info.class_name = text->Words(1, 4);
+    element_info.text_content = text->Words(0, 24);
+    element_info.href = "https://example.com/" + text->Words(1, 3);
+    element_info.title = text->Words(0, 6);
+    element_info.role = element_info.tag_name;
+    element_info.aria_label = text->Words(0, 5);
+    element_info.bounds = gfx::Rect(text->Int(0, 1920), text->Int(0, 8000),
+                                    text->Int(8, 600), text->Int(8, 200));
+    element_info.computed_styles =
+        "color: rgb(33, 37, 41); background-color: rgba(0, 0, 0, 0); "
+        "font-size: 16px; font-weight: 400; display: inline-block; "
+        "visibility: visible; position: static; opacity: 1";
+    element_info.ParseComputedStyles();
+  }
+  return elements;
+}
+
+std::vector<AIResponse> MakeResponses(size_t count, TextGenerator* text) {
+  std::vector<AIResponse> responses(count);
+  for (AIResponse& response : responses) {
+    response.provider = "openai";
+    response.description = text->Words(30, 80);
+    response.confidence = "high";
+    response.timestamp = 1700000000000LL + text->Int(0, 1 << 30);
+    for (int i = text->Int(0, 4); i > 0; --i) {
+      response.suggested_actions.push_back(text->Words(2, 6));
+    }
+  }
+  return responses;
+}
+
+std::vector<AutomationAction> MakeActions(size_t count, TextGenerator* text) {
+  std::vector<AutomationAction> actions(count);
+  for (AutomationAction& action : actions) {
+    action.type = static_cast<AutomationActionType>(text->Int(0, 5));
+    action.text_input = text->Words(0, 6);
+  }
+  return actions;
+}
+
+std::vector<AutomationResult> MakeResults(size_t count, TextGenerator* text) {
+  std::vector<AutomationResult> results(count);
+  for (AutomationResult& result : results) {
+    result.success = text->Int(0, 9) != 0;
+    if (result.success) {
+      result.result_data = text->Words(2, 20);
+    } else {
+      result.error_message = text->Words(3, 10);
+    }
+  }
+  return results;
+}
+
+// Timing
+
+template <typename Function>
+double MeasureNanosPerRecord(size_t records, Function function,
+                             double min_ms) {
+  uint64_t passes = 0;
+  Clock::time_point start = Clock::now();
+  double elapsed_ms = 0;
+  do {
+    function();
+    ++passes;
+    elapsed_ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+  } while (elapsed_ms < min_ms);
+  return elapsed_ms * 1e6 / (passes * records);
+}
+
+// Sums string sizes read through a view so that the reads are not elided
+template <typename View>
+size_t TouchStrings(const View& view);
+
+template <>
+size_t TouchStrings(const ElementInfoWireView& view) {
+  return view.tag_name().size() + view.id().size() +
+         view.class_name().size() + view.text_content().size() +
+         view.href().size() + view.src().size() + view.alt_text().size() +
+         view.title().size() + view.role().size() + view.aria_label().size() +
+         view.type().size() + view.computed_styles().size() +
+         view.bounds().width();
+}
+
+template <>
+size_t TouchStrings(const AIResponseWireView& view) {
+  size_t total = view.provider().size() + view.description().size() +
+                 view.confidence().size();
+  for (size_t i = 0; i < view.suggested_action_count(); ++i) {
+    total += view.suggested_action(i).size();
+  }
+  return total;
+}
+
+template <>
+size_t TouchStrings(const AutomationActionWireView& view) {
+  return view.text_input().size() + static_cast<size_t>(view.type());
+}
+
+template <>
+size_t TouchStrings(const AutomationResultWireView& view) {
+  return view.result_data().size() + view.error_message().size() +
+         view.success();
+}
+
+// Runs every codec over |corpus| and prints one block of results
+template <typename T, typename View>
+bool RunType(const char* name,
+             const std::vector<T>& corpus,
+             Json (*to_json)(const T&),
+             T (*from_json)(const Json&),
+             void (*encode)(const T&, std::string*),
+             bool (*decode)(std::string_view, T*),
+             const BenchmarkOptions& options) {
+  std::vector<std::string> json_records;
+  std::vector<std::string> wire_records;
+  size_t json_bytes = 0;
+  size_t wire_bytes = 0;
+  for (const T& record : corpus) {
+    json_records.push_back(to_json(record).dump());
+    wire_records.emplace_back();
+    encode(record, &wire_records.back());
+    json_bytes += json_records.back().size();
+    wire_bytes += wire_records.back().size();
+  }
+
+  // Both paths must carry the same data
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    T from_wire;
+    View view;
+    if (!decode(wire_records[i], &from_wire) || !view.Init(wire_records[i]) ||
+        to_json(from_wire) != to_json(corpus[i]) ||
+        to_json(from_json(Json::parse(json_records[i]))) !=
+            to_json(corpus[i])) {
+      std::cerr << name << " record " << i << " does not round-trip"
+                << std::endl;
+      return false;
+    }
+  }
+
+  volatile size_t sink = 0;
+  size_t records = corpus.size();
+  std::string scratch;
+
+  double json_encode_ns = MeasureNanosPerRecord(
+      records,
+      [&] {
+        for (const T& record : corpus) {
+          scratch = to_json(record).dump();
+          sink = sink + scratch.size();
+        }
+      },
+      options.min_ms);
+  double json_decode_ns = MeasureNanosPerRecord(
+      records,
+      [&] {
+        for (const std::string& json : json_records) {
+          T record = from_json(Json::parse(json));
+          sink = sink + sizeof(record);
+        }
+      },
+      options.min_ms);
+  double wire_encode_ns = MeasureNanosPerRecord(
+      records,
+      [&] {
+        for (const T& record : corpus) {
+          encode(record, &scratch);
+          sink = sink + scratch.size();
+        }
+      },
+      options.min_ms);
+  double wire_decode_ns = MeasureNanosPerRecord(
+      records,
+      [&] {
+        for (const std::string& wire : wire_records) {
+          T record;
+          decode(wire, &record);
+          sink = sink + sizeof(record);
+        }
+      },
+      options.min_ms);
+  double wire_view_ns = MeasureNanosPerRecord(
+      records,
+      [&] {
+        for (const std::string& wire : wire_records) {
+          View view;
+          if (view.Init(wire)) {
+            sink = sink + TouchStrings(view);
+          }
+        }
+      },
+      options.min_ms);
+
+  std::cout << name << " (" << records << " records, json "
+            << json_bytes / records << " B, wire " << wire_bytes / records
+            << " B per record)" << std::endl;
+  auto print_row = [&](const char* label, double ns, double baseline_ns) {
+    std::cout << "  " << std::left << std::setw(14) << label << std::right
+              << std::fixed << std::setprecision(1) << std::setw(10) << ns
+              << " ns" << std::setw(10)
+              << (json_bytes / records) * 1e3 / ns << " MB/s";
+    if (baseline_ns > 0) {
+      std::cout << std::setw(9) << baseline_ns / ns << "x";
+    }
+    std::cout << std::endl;
+  };
+  print_row("json encode", json_encode_ns, 0);
+  print_row("json decode", json_decode_ns, 0);
+  print_row("wire encode", wire_encode_ns, json_encode_ns);
+  print_row("wire decode", wire_decode_ns, json_decode_ns);
+  print_row("wire view", wire_view_ns, json_decode_ns);
+  std::cout << std::endl;
+  return true;
+}
+
+int RunBenchmark(const BenchmarkOptions& options) {
+  TextGenerator text(1234);
+  std::vector<ElementInfo> elements = MakeElements(options.records, &text);
+  std::vector<AIResponse> responses = MakeResponses(options.records, &text);
+  std::vector<AutomationAction> actions = MakeActions(options.records, &text);
+  std::vector<AutomationResult> results = MakeResults(options.records, &text);
+
+  std::cout << "Throughput is in JSON-equivalent bytes; speedups are "
+               "against the JSON row of the same direction"
+            << std::endl
+            << std::endl;
+
+  bool ok =
+      RunType<ElementInfo, ElementInfoWireView>(
+          "ElementInfo", elements, &ElementInfoToJson, &ElementInfoFromJson,
+          &EncodeElementInfo, &DecodeElementInfo, options) &&
+      RunType<AIResponse, AIResponseWireView>(
+          "AIResponse", responses, &AIResponseToJson, &AIResponseFromJson,
+          &EncodeAIResponse, &DecodeAIResponse, options) &&
+      RunType<AutomationAction, AutomationActionWireView>(
+          "AutomationAction", actions, &AutomationActionToJson,
+          &AutomationActionFromJson, &EncodeAutomationAction,
+          &DecodeAutomationAction, options) &&
+      RunType<AutomationResult, AutomationResultWireView>(
+          "AutomationResult", results, &AutomationResultToJson,
+          &AutomationResultFromJson, &EncodeAutomationResult,
+          &DecodeAutomationResult, options);
+  return ok ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace tooltip
+
+int main(int argc, char** argv) {
+  tooltip::BenchmarkOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 10, "--records=") == 0) {
+      options.records = std::stoul(arg.substr(10));
+    } else if (arg.compare(0, 9, "--min-ms=") == 0) {
+      options.min_ms = std::stod(arg.substr(9));
+    } else {
+      std::cerr << "Unknown flag: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (options.records == 0) {
+    std::cerr << "--records must be positive" << std::endl;
+    return 1;
+  }
+  return tooltip::RunBenchmark(options);
+}